@@ -67,6 +67,7 @@ namespace IR
 			return " align=" + std::to_string(1<<imm.alignmentLog2) + " offset=" + std::to_string(imm.offset);
 		}
 		std::string describeImm(MemoryImm) { return ""; }
+		std::string describeImm(MemoryCopyImm) { return ""; }
 
 		#if ENABLE_SIMD_PROTOTYPE
 		template<Uptr numLanes>
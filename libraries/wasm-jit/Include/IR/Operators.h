@@ -11,6 +11,7 @@ namespace IR
 
 	struct NoImm {};
 	struct MemoryImm {};
+	struct MemoryCopyImm {};
 
 	struct ControlStructureImm
 	{
@@ -117,6 +118,7 @@ namespace IR
 		STORE(T) : (i32,T) -> ()
 		VECTORSELECT(V) : (V,V,V) -> V
         REPLACELANE(S,V) : (V,S) -> V
+		BULKMEMORY : (i32,i32,i32) -> ()
 		COMPAREEXCHANGE(T) : (i32,T,T) -> T
 		WAIT(T) : (i32,T,f64) -> i32
 		LAUNCHTHREAD : (i32,i32,i32) -> ()
@@ -294,12 +296,16 @@ namespace IR
 		visitOp(0xbd,i64_reinterpret_f64,"i64.reinterpret/f64",NoImm,UNARY(f64,i64)) \
 		visitOp(0xbe,f32_reinterpret_i32,"f32.reinterpret/i32",NoImm,UNARY(i32,f32)) \
 		visitOp(0xbf,f64_reinterpret_i64,"f64.reinterpret/i64",NoImm,UNARY(i64,f64)) \
+		\
+		visitOp(0xfc0a,memory_copy,"memory.copy",MemoryCopyImm,BULKMEMORY) \
+		visitOp(0xfc0b,memory_fill,"memory.fill",MemoryImm,BULKMEMORY) \
 		ENUM_SIMD_OPERATORS(visitOp) \
 		ENUM_THREADING_OPERATORS(visitOp)
 
 	#if !ENABLE_SIMD_PROTOTYPE
 	#define ENUM_SIMD_OPERATORS(visitOp)
 	#else
+	// The prototype's operators are 0xfd followed by a single byte, rather than the standard 0xfd followed by a LEB128 index.
 	#define SIMDOP(simdOpIndex) (0xfd00|simdOpIndex)
 	#define ENUM_SIMD_OPERATORS(visitOp) \
 		visitOp(SIMDOP(0),v128_const,"v128.const",LiteralImm<V128>,NULLARY(v128)) \
@@ -376,7 +382,7 @@ namespace IR
 		visitOp(SIMDOP(59),v128_and,"v128.and",NoImm,BINARY(v128,v128)) \
 		visitOp(SIMDOP(60),v128_or,"v128.or",NoImm,BINARY(v128,v128)) \
 		visitOp(SIMDOP(61),v128_xor,"v128.xor",NoImm,BINARY(v128,v128)) \
-		visitOp(SIMDOP(62),v128_not,"v128.not",NoImm,BINARY(v128,v128)) \
+		visitOp(SIMDOP(62),v128_not,"v128.not",NoImm,UNARY(v128,v128)) \
 		\
 		visitOp(SIMDOP(63),v128_bitselect,"v128.bitselect",NoImm,VECTORSELECT(v128)) \
 		\
@@ -608,6 +614,15 @@ namespace IR
 			MemoryImm imm;
 		};
 	};
+	template<>
+	struct OpcodeAndImm<MemoryCopyImm>
+	{
+		union
+		{
+			Opcode opcode;
+			MemoryCopyImm imm;
+		};
+	};
 
 	// Decodes an operator from an input stream and dispatches by opcode.
 	struct OperatorDecoderStream
@@ -59,4 +59,7 @@ namespace IR
 	};
 
 	IR_API void validateDefinitions(const IR::Module& module);
+
+	// Validates a function's code as it is stored in the IR, e.g. after it was rewritten by a pass over the decoded module.
+	IR_API void validateFunctionBody(const IR::Module& module,const FunctionDef& functionDef);
 }
@@ -105,6 +105,9 @@ namespace Serialization
 			return next;
 		}
 
+		// Returns the number of bytes that can be read from the current buffer without requesting more data.
+		inline Uptr getNumBufferedBytes() const { return end - next; }
+
 	protected:
 
 		const U8* next;
@@ -176,19 +179,56 @@ namespace Serialization
 	template<typename Value,Uptr maxBits>
 	FORCEINLINE void serializeVarInt(InputStream& stream,Value& value,Value minValue,Value maxValue)
 	{
-		// First, read the variable number of input bytes into a fixed size buffer.
 		enum { maxBytes = (maxBits + 6) / 7 };
-		U8 bytes[maxBytes] = {0};
+
+		// Most LEB128 values in a module are small non-negative numbers that fit in a single byte.
+		const U8 firstByte = *stream.peek(1);
+		if(maxBits >= 7 && firstByte < 0x40)
+		{
+			stream.advance(1);
+			value = Value(firstByte);
+			if(value < minValue || value > maxValue)
+			{ throw FatalSerializationException(std::string("out-of-range value: ") + std::to_string(minValue) + "<=" + std::to_string(value) + "<=" + std::to_string(maxValue)); }
+			return;
+		}
+
+		// Find the end of the encoded value. If there are at least 8 bytes buffered, find the terminating byte (the first byte
+		// without the continuation bit) in a single 64-bit word instead of testing one byte at a time.
+		U64 encodedBits = 0;
 		Uptr numBytes = 0;
 		I8 signExtendShift = (I8)sizeof(Value) * 8;
-		while(numBytes < maxBytes)
+		U8 lastByte = 0;
+		if(maxBytes <= 8 && stream.getNumBufferedBytes() >= 8)
 		{
-			U8 byte = *stream.advance(1);
-			bytes[numBytes] = byte;
-			++numBytes;
-			signExtendShift -= 7;
-			if(!(byte & 0x80)) { break; }
-		};
+			const U8* bytes = stream.peek(8);
+			memcpy(&encodedBits,bytes,sizeof(U64));
+			#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+				encodedBits = __builtin_bswap64(encodedBits);
+			#endif
+			const U64 terminatorBits = ~encodedBits & 0x8080808080808080ull;
+			numBytes = std::min(Uptr(Platform::countTrailingZeroes(terminatorBits) / 8 + 1),Uptr(maxBytes));
+			stream.advance(numBytes);
+			if(numBytes == maxBytes) { lastByte = U8(encodedBits >> ((maxBytes - 1) * 8)); }
+
+			// Gather the 7-bit groups of the value's bytes.
+			value = 0;
+			for(Uptr byteIndex = 0;byteIndex < numBytes;++byteIndex)
+			{ value |= Value((encodedBits >> (byteIndex * 8)) & 0x7f) << (byteIndex * 7); }
+		}
+		else
+		{
+			// Read the variable number of input bytes one at a time.
+			value = 0;
+			while(numBytes < maxBytes)
+			{
+				const U8 byte = *stream.advance(1);
+				value |= Value(byte & ~0x80) << (numBytes * 7);
+				++numBytes;
+				if(numBytes == maxBytes) { lastByte = byte; }
+				if(!(byte & 0x80)) { break; }
+			};
+		}
+		signExtendShift -= I8(numBytes * 7);
 
 		// Ensure that the input does not encode more than maxBits of data.
 		enum { numUsedBitsInLastByte = maxBits - (maxBytes-1) * 7 };
@@ -196,7 +236,6 @@ namespace Serialization
 		enum { lastBitUsedMask = U8(1<<(numUsedBitsInLastByte-1)) };
 		enum { lastByteUsedMask = U8(1<<numUsedBitsInLastByte)-U8(1) };
 		enum { lastByteSignedMask = U8(~U8(lastByteUsedMask) & ~U8(0x80)) };
-		const U8 lastByte = bytes[maxBytes-1];
 		if(!std::is_signed<Value>::value)
 		{
 			if((lastByte & ~lastByteUsedMask) != 0)
@@ -215,11 +254,6 @@ namespace Serialization
 			}
 		}
 
-		// Decode the buffer's bytes into the output integer.
-		value = 0;
-		for(Uptr byteIndex = 0;byteIndex < maxBytes;++byteIndex)
-		{ value |= Value(bytes[byteIndex] & ~0x80) << (byteIndex * 7); }
-		
 		// Sign extend the output integer to the full size of Value.
 		if(std::is_signed<Value>::value && signExtendShift > 0)
 		{ value = Value(value << signExtendShift) >> signExtendShift; }
@@ -16,6 +16,11 @@ namespace Timing
 			if(!isStopped) { stop(); }
 			return std::chrono::duration_cast<std::chrono::microseconds>(endTime - startTime).count();
 		}
+		U64 getNanoseconds()
+		{
+			if(!isStopped) { stop(); }
+			return std::chrono::duration_cast<std::chrono::nanoseconds>(endTime - startTime).count();
+		}
 		F64 getMilliseconds() { return getMicroseconds() / 1000.0; }
 		F64 getSeconds() { return getMicroseconds() / 1000000.0; }
 	private:
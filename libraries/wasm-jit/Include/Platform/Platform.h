@@ -66,6 +66,7 @@ namespace Platform
 		ReadOnly,
 		ReadWrite,
 		Execute,
+		ReadExecute,
 		ReadWriteExecute
 	};
 
@@ -76,6 +77,10 @@ namespace Platform
 	// Returns the base virtual address of the allocated addresses, or nullptr if the virtual address space has been exhausted.
 	PLATFORM_API U8* allocateVirtualPages(Uptr numPages);
 
+	// Allocates virtual addresses like allocateVirtualPages, but with a base address that is a multiple of 2^alignmentLog2 bytes.
+	// outUnalignedBaseAddress receives the address that must be passed to freeAlignedVirtualPages to free them.
+	PLATFORM_API U8* allocateAlignedVirtualPages(Uptr numPages,Uptr alignmentLog2,U8*& outUnalignedBaseAddress);
+
 	// Commits physical memory to the specified virtual pages.
 	// baseVirtualAddress must be a multiple of the preferred page size.
 	// Return true if successful, or false if physical memory has been exhausted.
@@ -90,22 +95,46 @@ namespace Platform
 	// baseVirtualAddress must be a multiple of the preferred page size.
 	PLATFORM_API void decommitVirtualPages(U8* baseVirtualAddress,Uptr numPages);
 
+	// Discards the contents of the specified committed virtual pages, leaving them committed and accessible.
+	// The pages will read as zero the next time they are accessed, and only pages that had physical memory behind them cost anything to discard.
+	// baseVirtualAddress must be a multiple of the preferred page size.
+	PLATFORM_API void discardVirtualPages(U8* baseVirtualAddress,Uptr numPages);
+
 	// Frees virtual addresses. Any physical memory committed to the addresses must have already been decommitted.
 	// baseVirtualAddress must be a multiple of the preferred page size.
 	PLATFORM_API void freeVirtualPages(U8* baseVirtualAddress,Uptr numPages);
 
+	// Frees virtual addresses allocated by allocateAlignedVirtualPages, given the unaligned base address it returned.
+	// Any physical memory committed to the addresses must have already been decommitted.
+	PLATFORM_API void freeAlignedVirtualPages(U8* unalignedBaseAddress,Uptr numPages,Uptr alignmentLog2);
+
+	// Hints that the specified committed virtual pages should be backed by huge pages if the OS supports it.
+	// Whether it happens, and when, is up to the OS; the pages behave the same either way.
+	PLATFORM_API void adviseHugeVirtualPages(U8* baseVirtualAddress,Uptr numPages);
+
 	//
 	// Call stack and exceptions
 	//
 
-	// Describes a call stack.
+	// Describes a call stack. The frames are stored inline so a call stack can be captured in a signal handler and thrown
+	// with a runtime exception without allocating; frames beyond maxFrames are dropped from the bottom of the stack.
 	struct CallStack
 	{
+		enum { maxFrames = 64 };
+
 		struct Frame
 		{
 			Uptr ip;
 		};
-		std::vector<Frame> stackFrames;
+		Frame stackFrames[maxFrames];
+		Uptr numStackFrames = 0;
+
+		bool pushFrame(Uptr ip)
+		{
+			if(numStackFrames == maxFrames) { return false; }
+			stackFrames[numStackFrames++] = {ip};
+			return true;
+		}
 	};
 
 	// Captures the execution context of the caller.
@@ -182,4 +211,8 @@ namespace Platform
 	PLATFORM_API void destroyEvent(Event* event);
 	PLATFORM_API bool waitForEvent(Event* event,U64 untilClock);
 	PLATFORM_API void signalEvent(Event* event);
+
+	// Calls body for each index in [0,numItems) on a shared pool of worker threads, and returns when every call has finished.
+	// If any of the calls throw, the exception thrown for the lowest index is rethrown on the calling thread.
+	PLATFORM_API void parallelFor(Uptr numItems,const std::function<void(Uptr)>& body);
 }
@@ -14,6 +14,8 @@ namespace Intrinsics
 		RUNTIME_API Function(const char* inName,const IR::FunctionType* type,void* nativeFunction);
 		RUNTIME_API ~Function();
 
+		const char* getName() const { return name; }
+
 	private:
 		const char* name;
 	};
@@ -93,6 +95,10 @@ namespace Intrinsics
 	// Finds an intrinsic object by name and type.
 	RUNTIME_API Runtime::ObjectInstance* find(const std::string& name,const IR::ObjectType& type);
 
+	// Finds an intrinsic function by module name, export name, and type.
+	// The set of intrinsic functions is frozen into a perfect hash table on first use, so this doesn't build any strings or take a lock.
+	RUNTIME_API Runtime::FunctionInstance* findFunction(const std::string& moduleName,const std::string& exportName,const IR::FunctionType* type);
+
 	// Returns an array of all intrinsic runtime Objects; used as roots for garbage collection.
 	RUNTIME_API std::vector<Runtime::ObjectInstance*> getAllIntrinsicObjects();
 }
@@ -3,6 +3,9 @@
 #include "Inline/BasicTypes.h"
 #include "TaggedValue.h"
 #include "IR/Types.h"
+#include "Platform/Platform.h"
+
+#include <map>
 
 #ifndef RUNTIME_API
 	#define RUNTIME_API DLL_IMPORT
@@ -34,11 +37,15 @@ namespace Runtime
 			calledUnimplementedIntrinsic,
 			outOfMemory,
 			invalidSegmentOffset,
-			misalignedAtomicMemoryAccess
+			misalignedAtomicMemoryAccess,
+			callStackExhausted
 		};
 
 		Cause cause;
-		std::vector<std::string> callStack;		
+
+		// The raw instruction pointers of the call stack at the point the exception was caused. Use describeCallStack
+		// to symbolize them; that is only done on demand, so causing an exception doesn't lock or allocate.
+		Platform::CallStack callStack;
 	};
 	
 	// Returns a string that describes the given exception cause.
@@ -59,6 +66,7 @@ namespace Runtime
 		case Exception::Cause::outOfMemory: return "out of memory";
 		case Exception::Cause::invalidSegmentOffset: return "invalid segment offset";
 		case Exception::Cause::misalignedAtomicMemoryAccess: return "misaligned atomic memory access";
+		case Exception::Cause::callStackExhausted: return "call stack exhausted";
 		default: return "unknown";
 		}
 	}
@@ -66,6 +74,24 @@ namespace Runtime
 	// Causes a runtime exception.
 	[[noreturn]] RUNTIME_API void causeException(Exception::Cause cause);
 
+	// Returns a vector of strings, each element describing a frame of the call stack.
+	RUNTIME_API std::vector<std::string> describeCallStack(const Platform::CallStack& callStack);
+
+	// Limits how deeply WebAssembly function calls may nest, counting from the outermost invokeFunction and including the
+	// calls made by nested invokeFunctions. A call that would exceed the limit causes a callStackExhausted exception, at
+	// the same depth regardless of how much native stack the functions use. There is no limit by default.
+	// Each thread invoking functions has its own budget, so threads running at the same time do not limit each other.
+	// Must not be called while a function is being invoked.
+	RUNTIME_API void setMaxCallDepth(U32 maxCallDepth);
+
+	// Emits calls to the 128-bit integer builtins that modules import from env (__multi3, __divti3, __udivti3, __modti3
+	// and __umodti3) as inline i128 operations instead of calling the imported functions. Where the imported function
+	// would fail, it is still called, so it reports the failure. The imported functions aren't called for the calls that
+	// succeed, so anything they do besides the operation, like charging for it, must be done by the calling code instead.
+	// Off by default. Must be set before any module is instantiated.
+	RUNTIME_API void setInlineInt128Builtins(bool enable);
+	RUNTIME_API bool getInlineInt128Builtins();
+
 	// These are subclasses of Object, but are only defined within Runtime, so other modules must
 	// use these forward declarations as opaque pointers.
 	struct FunctionInstance;
@@ -118,6 +144,16 @@ namespace Runtime
 	// Frees unreferenced Objects, using the provided array of Objects as the root set.
 	RUNTIME_API void freeUnreferencedObjects(std::vector<ObjectInstance*>&& rootObjectReferences);
 
+	// Adds and removes explicit references to a ModuleInstance. A ModuleInstance with references is a root for freeUnreferencedObjects.
+	// Removing the last reference immediately frees the instance, the functions, tables and globals it defines, its generated code,
+	// and any memory that no other instance uses (other than theMemoryInstance), without scanning any other objects.
+	// The caller must ensure that no other live object refers to the objects the instance defines.
+	RUNTIME_API void addModuleInstanceReference(ModuleInstance* moduleInstance);
+	RUNTIME_API void removeModuleInstanceReference(ModuleInstance* moduleInstance);
+
+	// Frees a memory if it isn't used by any ModuleInstance and isn't theMemoryInstance.
+	RUNTIME_API void freeMemoryIfUnused(MemoryInstance* memory);
+
 	//
 	// Functions
 	//
@@ -157,6 +193,11 @@ namespace Runtime
 	// Creates a Memory. May return null if the memory allocation fails.
 	RUNTIME_API MemoryInstance* createMemory(IR::MemoryType type);
 
+	// Allocates memories whose maximum size is at most maxPages from a pool of fixed-size slots, instead of reserving 8GB
+	// of address-space for each. maxPages must leave room for a guard region in a 64MB slot. Memories aren't pooled by
+	// default. Must be called before any memory is created.
+	RUNTIME_API void setMemorySlotMaxPages(Uptr maxPages);
+
 	// Gets the base address of the memory's data.
 	RUNTIME_API U8* getMemoryBaseAddress(MemoryInstance* memory);
 
@@ -207,11 +248,42 @@ namespace Runtime
 	// Instantiates a module, bindings its imports to the specified objects. May throw InstantiationException.
 	RUNTIME_API ModuleInstance* instantiateModule(const IR::Module& module,ImportBindings&& imports);
 
+	// Counts of how the code of a function ran, keyed by the index of the operator in the function's code.
+	struct FunctionProfile
+	{
+		// For an if or br_if, the number of times its condition was false and the number of times it was true. For a
+		// br_table, the number of times each of its targets was chosen, the default target last.
+		std::map<Uptr,std::vector<U64>> branchCounts;
+		// For a call_indirect, the number of calls through each table element.
+		std::map<Uptr,std::map<U32,U64>> indirectCallCounts;
+	};
+
+	// Counts of how the code of a module's function definitions ran.
+	struct ModuleProfile
+	{
+		std::vector<FunctionProfile> functionDefs;
+	};
+
+	// Instantiates a module like instantiateModule, and compiles it with a profile.
+	// If isCollectingProfile is true, the code counts how it runs, and adds the counts to the profile when the instance is
+	// freed, so the profile must outlive the instance. Otherwise the code is compiled with the profile's counts as branch
+	// weights, and each call_indirect that mostly called one table element's function calls it directly when the index
+	// matches. The runtime reads and writes profiles under a lock, so instances on different threads may share one.
+	// Neither kind of instance shares the code of its functions with other modules.
+	RUNTIME_API ModuleInstance* instantiateModule(const IR::Module& module,ImportBindings&& imports,ModuleProfile* profile,bool isCollectingProfile);
+
 	// Gets the default table/memory for a ModuleInstance.
 	RUNTIME_API MemoryInstance* getDefaultMemory(ModuleInstance* moduleInstance);
 	RUNTIME_API uint64_t getDefaultMemorySize(ModuleInstance* moduleInstance);
 	RUNTIME_API TableInstance* getDefaultTable(ModuleInstance* moduleInstance);
 
+	// Gets the number of bytes of machine code compiled for a ModuleInstance's functions. Code the instance shares with
+	// other modules isn't counted.
+	RUNTIME_API Uptr getInstanceCodeSize(ModuleInstance* moduleInstance);
+
+	// Gets the number of a ModuleInstance's function definitions that use code shared with other modules.
+	RUNTIME_API Uptr getInstanceNumSharedFunctions(ModuleInstance* moduleInstance);
+
 	RUNTIME_API void runInstanceStartFunc(ModuleInstance* moduleInstance);
 	RUNTIME_API void resetGlobalInstances(ModuleInstance* moduleInstance);
 	RUNTIME_API void resetMemory(MemoryInstance* memory, IR::MemoryType& newMemoryType);
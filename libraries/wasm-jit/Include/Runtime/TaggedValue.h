@@ -5,8 +5,6 @@
 
 #include <string.h>
 
-#undef ENABLE_SIMD_PROTOTYPE
-
 namespace Runtime
 {
 	// A runtime value of any type.
@@ -332,7 +332,12 @@ namespace IR
 		
 		void validateImm(MemoryImm)
 		{
-			VALIDATE_UNLESS("current_memory and grow_memory are only valid if there is a default memory",module.memories.size() == 0);
+			VALIDATE_UNLESS("current_memory, grow_memory and memory.fill are only valid if there is a default memory",module.memories.size() == 0);
+		}
+
+		void validateImm(MemoryCopyImm)
+		{
+			VALIDATE_UNLESS("memory.copy is only valid if there is a default memory",module.memories.size() == 0);
 		}
 
 		#if ENABLE_SIMD_PROTOTYPE
@@ -382,6 +387,8 @@ namespace IR
 		#define UNARY(operandTypeId,resultTypeId) \
 			popAndValidateOperand(operatorName,ValueType::operandTypeId); \
 			pushOperand(ResultType::resultTypeId)
+		#define BULKMEMORY \
+			popAndValidateOperands(operatorName,ValueType::i32,ValueType::i32,ValueType::i32);
 
 		#if ENABLE_SIMD_PROTOTYPE
 		#define VECTORSELECT(vectorTypeId) \
@@ -685,4 +692,29 @@ namespace IR
 		}
 	ENUM_OPERATORS(VISIT_OPCODE)
 	#undef VISIT_OPCODE
-}
\ No newline at end of file
+
+	// Passes the operators decoded from a function's IR code to a CodeValidationStream.
+	struct CodeValidationDecoder
+	{
+		typedef void Result;
+
+		CodeValidationStream& stream;
+
+		CodeValidationDecoder(CodeValidationStream& inStream): stream(inStream) {}
+
+		#define VISIT_OPCODE(_,name,nameString,Imm,...) void name(Imm imm) { stream.name(imm); }
+		ENUM_OPERATORS(VISIT_OPCODE)
+		#undef VISIT_OPCODE
+
+		void unknown(Opcode opcode) { throw ValidationException("unknown opcode"); }
+	};
+
+	void validateFunctionBody(const Module& module,const FunctionDef& functionDef)
+	{
+		CodeValidationStream codeValidationStream(module,functionDef);
+		CodeValidationDecoder decoder(codeValidationStream);
+		OperatorDecoderStream decoderStream(functionDef.code);
+		while(decoderStream) { decoderStream.decodeOp(decoder); }
+		codeValidationStream.finish();
+	}
+}
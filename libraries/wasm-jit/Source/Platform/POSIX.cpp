@@ -60,6 +60,7 @@ namespace Platform
 		case MemoryAccess::ReadOnly: return PROT_READ;
 		case MemoryAccess::ReadWrite: return PROT_READ | PROT_WRITE;
 		case MemoryAccess::Execute: return PROT_EXEC;
+		case MemoryAccess::ReadExecute: return PROT_EXEC | PROT_READ;
 		case MemoryAccess::ReadWriteExecute: return PROT_EXEC | PROT_READ | PROT_WRITE;
 		}
 	}
@@ -81,6 +82,18 @@ namespace Platform
 		return (U8*)result;
 	}
 
+	U8* allocateAlignedVirtualPages(Uptr numPages,Uptr alignmentLog2,U8*& outUnalignedBaseAddress)
+	{
+		// Over-allocate by the alignment, and return the first aligned address in the allocation.
+		const Uptr pageSizeLog2 = getPageSizeLog2();
+		const Uptr numAlignmentPages = alignmentLog2 > pageSizeLog2 ? (Uptr(1) << (alignmentLog2 - pageSizeLog2)) : 0;
+		outUnalignedBaseAddress = allocateVirtualPages(numPages + numAlignmentPages);
+		if(!outUnalignedBaseAddress) { return nullptr; }
+
+		const Uptr alignmentMask = (Uptr(1) << alignmentLog2) - 1;
+		return reinterpret_cast<U8*>((reinterpret_cast<Uptr>(outUnalignedBaseAddress) + alignmentMask) & ~alignmentMask);
+	}
+
 	bool commitVirtualPages(U8* baseVirtualAddress,Uptr numPages,MemoryAccess access)
 	{
 		errorUnless(isPageAligned(baseVirtualAddress));
@@ -93,12 +106,29 @@ namespace Platform
 		return mprotect(baseVirtualAddress,numPages << getPageSizeLog2(),memoryAccessAsPOSIXFlag(access)) == 0;
 	}
 
+	// Drops the physical pages behind a range of private anonymous memory, so it reads as zero the next time it's accessed,
+	// and sets its access. Only Linux guarantees that for MADV_DONTNEED; other systems, like macOS, may keep the pages'
+	// contents, so the range is replaced with a new anonymous mapping instead.
+	static void zeroVirtualPages(U8* baseVirtualAddress,Uptr numBytes,int protection)
+	{
+		#ifdef __linux__
+			if(madvise(baseVirtualAddress,numBytes,MADV_DONTNEED)) { Errors::fatal("madvise failed"); }
+			if(protection != (PROT_READ | PROT_WRITE) && mprotect(baseVirtualAddress,numBytes,protection)) { Errors::fatal("mprotect failed"); }
+		#else
+			if(mmap(baseVirtualAddress,numBytes,protection,MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED,-1,0) == MAP_FAILED) { Errors::fatal("mmap failed"); }
+		#endif
+	}
+
 	void decommitVirtualPages(U8* baseVirtualAddress,Uptr numPages)
 	{
 		errorUnless(isPageAligned(baseVirtualAddress));
-		auto numBytes = numPages << getPageSizeLog2();
-		if(madvise(baseVirtualAddress,numBytes,MADV_DONTNEED)) { Errors::fatal("madvise failed"); }
-		if(mprotect(baseVirtualAddress,numBytes,PROT_NONE)) { Errors::fatal("mprotect failed"); }
+		zeroVirtualPages(baseVirtualAddress,numPages << getPageSizeLog2(),PROT_NONE);
+	}
+
+	void discardVirtualPages(U8* baseVirtualAddress,Uptr numPages)
+	{
+		errorUnless(isPageAligned(baseVirtualAddress));
+		zeroVirtualPages(baseVirtualAddress,numPages << getPageSizeLog2(),PROT_READ | PROT_WRITE);
 	}
 
 	void freeVirtualPages(U8* baseVirtualAddress,Uptr numPages)
@@ -107,6 +137,22 @@ namespace Platform
 		if(munmap(baseVirtualAddress,numPages << getPageSizeLog2())) { Errors::fatal("munmap failed"); }
 	}
 
+	void freeAlignedVirtualPages(U8* unalignedBaseAddress,Uptr numPages,Uptr alignmentLog2)
+	{
+		const Uptr pageSizeLog2 = getPageSizeLog2();
+		const Uptr numAlignmentPages = alignmentLog2 > pageSizeLog2 ? (Uptr(1) << (alignmentLog2 - pageSizeLog2)) : 0;
+		freeVirtualPages(unalignedBaseAddress,numPages + numAlignmentPages);
+	}
+
+	void adviseHugeVirtualPages(U8* baseVirtualAddress,Uptr numPages)
+	{
+		// This is only a hint, so ignore failures, e.g. from a kernel built without transparent huge pages.
+		errorUnless(isPageAligned(baseVirtualAddress));
+		#ifdef MADV_HUGEPAGE
+			madvise(baseVirtualAddress,numPages << getPageSizeLog2(),MADV_HUGEPAGE);
+		#endif
+	}
+
 	bool describeInstructionPointer(Uptr ip,std::string& outDescription)
 	{
 		#if defined __linux__ || defined __FreeBSD__
@@ -249,9 +295,31 @@ namespace Platform
 		initThread();
 		initSignals();
 		
-		jmp_buf oldSignalReturnEnv;
-		memcpy(&oldSignalReturnEnv,&signalReturnEnv,sizeof(jmp_buf));
-		const bool oldIsCatchingSignals = isCatchingSignals;
+		// Save the signal state of an enclosing catchHardwareTraps, and restore it when this one returns or an exception
+		// propagates out of the thunk, so the enclosing call still catches the traps that occur after this one.
+		struct SignalStateGuard
+		{
+			sigjmp_buf returnEnv;
+			HardwareTrapType type;
+			CallStack* callStack;
+			Uptr* operand;
+			bool isCatching;
+
+			SignalStateGuard()
+			: type(signalType), callStack(signalCallStack), operand(signalOperand), isCatching(isCatchingSignals)
+			{
+				memcpy(&returnEnv,&signalReturnEnv,sizeof(sigjmp_buf));
+			}
+			~SignalStateGuard()
+			{
+				memcpy(&signalReturnEnv,&returnEnv,sizeof(sigjmp_buf));
+				signalType = type;
+				signalCallStack = callStack;
+				signalOperand = operand;
+				isCatchingSignals = isCatching;
+				isReentrantSignal = false;
+			}
+		} signalStateGuard;
 
 		// Use setjmp to allow signals to jump back to this point.
 		bool isReturningFromSignalHandler = sigsetjmp(signalReturnEnv,1);
@@ -266,13 +334,7 @@ namespace Platform
 			thunk();
 		}
 
-		// Reset the signal state.
-		memcpy(&signalReturnEnv,&oldSignalReturnEnv,sizeof(jmp_buf));
-		isCatchingSignals = oldIsCatchingSignals;
-		isReentrantSignal = false;
-		signalCallStack = nullptr;
-		signalOperand = nullptr;
-
+		// The signal state is reset by signalStateGuard after the trap type is returned.
 		return signalType;
 	}
 
@@ -294,7 +356,7 @@ namespace Platform
 			CallStack result;
 			for(Iptr index = numOmittedFramesFromTop + 1;index < numCallStackEntries;++index)
 			{
-				result.stackFrames.push_back({(Uptr)callstackAddresses[index]});
+				if(!result.pushFrame((Uptr)callstackAddresses[index])) { break; }
 			}
 			return result;
 		#else
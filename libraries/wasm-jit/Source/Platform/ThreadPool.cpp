@@ -0,0 +1,159 @@
+#include "Inline/BasicTypes.h"
+#include "Inline/Errors.h"
+#include "Platform/Platform.h"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <thread>
+
+namespace Platform
+{
+	// The state shared by the threads that are running the items of a parallelFor call.
+	struct ParallelForJob
+	{
+		const std::function<void(Uptr)>& body;
+		const Uptr numItems;
+
+		std::atomic<Uptr> nextItemIndex;
+		std::atomic<Uptr> failedItemIndex;
+
+		// These are protected by the thread pool's mutex.
+		Uptr numCompletedItems;
+		Uptr numActiveWorkers;
+		std::exception_ptr failedItemException;
+
+		ParallelForJob(const std::function<void(Uptr)>& inBody,Uptr inNumItems)
+		: body(inBody)
+		, numItems(inNumItems)
+		, nextItemIndex(0)
+		, failedItemIndex(UINTPTR_MAX)
+		, numCompletedItems(0)
+		, numActiveWorkers(0)
+		{}
+	};
+
+	struct ThreadPool
+	{
+		static ThreadPool& get()
+		{
+			static ThreadPool threadPool;
+			return threadPool;
+		}
+
+		Uptr getNumWorkers() const { return workerThreads.size(); }
+
+		void run(ParallelForJob& job)
+		{
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				pendingJobs.push_back(&job);
+			}
+			workAvailable.notify_all();
+
+			// The calling thread runs items too, so the job completes even if every worker is busy with other jobs.
+			runItems(job);
+
+			std::unique_lock<std::mutex> lock(mutex);
+			auto pendingJobIt = std::find(pendingJobs.begin(),pendingJobs.end(),&job);
+			if(pendingJobIt != pendingJobs.end()) { pendingJobs.erase(pendingJobIt); }
+			jobCompleted.wait(lock,[&job] { return job.numCompletedItems == job.numItems && !job.numActiveWorkers; });
+		}
+
+	private:
+
+		std::mutex mutex;
+		std::condition_variable workAvailable;
+		std::condition_variable jobCompleted;
+		std::deque<ParallelForJob*> pendingJobs;
+		std::vector<std::thread> workerThreads;
+		bool isShuttingDown;
+
+		ThreadPool(): isShuttingDown(false)
+		{
+			// Leave a core for the calling thread, and cap the pool so small jobs aren't dominated by waking workers.
+			const Uptr numHardwareThreads = std::thread::hardware_concurrency();
+			const Uptr numWorkers = std::min(numHardwareThreads > 1 ? numHardwareThreads - 1 : 0,Uptr(15));
+			for(Uptr workerIndex = 0;workerIndex < numWorkers;++workerIndex)
+			{
+				workerThreads.emplace_back([this] { workerMain(); });
+			}
+		}
+
+		~ThreadPool()
+		{
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				isShuttingDown = true;
+			}
+			workAvailable.notify_all();
+			for(std::thread& workerThread : workerThreads) { workerThread.join(); }
+		}
+
+		void workerMain()
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			while(true)
+			{
+				workAvailable.wait(lock,[this] { return isShuttingDown || !pendingJobs.empty(); });
+				if(isShuttingDown) { return; }
+
+				ParallelForJob* job = pendingJobs.front();
+				if(job->nextItemIndex >= job->numItems)
+				{
+					// All of the job's items have been claimed, so stop offering it to workers.
+					pendingJobs.pop_front();
+					continue;
+				}
+
+				++job->numActiveWorkers;
+				lock.unlock();
+				runItems(*job);
+				lock.lock();
+				if(!--job->numActiveWorkers) { jobCompleted.notify_all(); }
+			}
+		}
+
+		void runItems(ParallelForJob& job)
+		{
+			while(true)
+			{
+				const Uptr itemIndex = job.nextItemIndex++;
+				if(itemIndex >= job.numItems) { break; }
+
+				// Items after a failed item don't need to run, since only the lowest failure is reported.
+				std::exception_ptr itemException;
+				if(itemIndex < job.failedItemIndex)
+				{
+					try { job.body(itemIndex); }
+					catch(...) { itemException = std::current_exception(); }
+				}
+
+				std::lock_guard<std::mutex> lock(mutex);
+				if(itemException && itemIndex < job.failedItemIndex)
+				{
+					job.failedItemIndex = itemIndex;
+					job.failedItemException = itemException;
+				}
+				if(++job.numCompletedItems == job.numItems) { jobCompleted.notify_all(); }
+			}
+		}
+	};
+
+	void parallelFor(Uptr numItems,const std::function<void(Uptr)>& body)
+	{
+		ThreadPool& threadPool = ThreadPool::get();
+		if(numItems <= 1 || !threadPool.getNumWorkers())
+		{
+			for(Uptr itemIndex = 0;itemIndex < numItems;++itemIndex) { body(itemIndex); }
+			return;
+		}
+
+		ParallelForJob job(body,numItems);
+		threadPool.run(job);
+		if(job.failedItemException) { std::rethrow_exception(job.failedItemException); }
+	}
+}
@@ -37,6 +37,7 @@ namespace Platform
 		case MemoryAccess::ReadOnly: return PAGE_READONLY;
 		case MemoryAccess::ReadWrite: return PAGE_READWRITE;
 		case MemoryAccess::Execute: return PAGE_EXECUTE_READ;
+		case MemoryAccess::ReadExecute: return PAGE_EXECUTE_READ;
 		case MemoryAccess::ReadWriteExecute: return PAGE_EXECUTE_READWRITE;
 		}
 	}
@@ -58,6 +59,18 @@ namespace Platform
 		return (U8*)result;
 	}
 
+	U8* allocateAlignedVirtualPages(Uptr numPages,Uptr alignmentLog2,U8*& outUnalignedBaseAddress)
+	{
+		// Over-reserve by the alignment, and return the first aligned address in the reservation.
+		const Uptr pageSizeLog2 = getPageSizeLog2();
+		const Uptr numAlignmentPages = alignmentLog2 > pageSizeLog2 ? (Uptr(1) << (alignmentLog2 - pageSizeLog2)) : 0;
+		outUnalignedBaseAddress = allocateVirtualPages(numPages + numAlignmentPages);
+		if(!outUnalignedBaseAddress) { return nullptr; }
+
+		const Uptr alignmentMask = (Uptr(1) << alignmentLog2) - 1;
+		return reinterpret_cast<U8*>((reinterpret_cast<Uptr>(outUnalignedBaseAddress) + alignmentMask) & ~alignmentMask);
+	}
+
 	bool commitVirtualPages(U8* baseVirtualAddress,Uptr numPages,MemoryAccess access)
 	{
 		errorUnless(isPageAligned(baseVirtualAddress));
@@ -78,6 +91,14 @@ namespace Platform
 		if(baseVirtualAddress && !result) { Errors::fatal("VirtualFree(MEM_DECOMMIT) failed"); }
 	}
 
+	void discardVirtualPages(U8* baseVirtualAddress,Uptr numPages)
+	{
+		// Decommit and recommit the pages: recommitted pages are zero-filled on demand.
+		errorUnless(isPageAligned(baseVirtualAddress));
+		if(!VirtualFree(baseVirtualAddress,numPages << getPageSizeLog2(),MEM_DECOMMIT)) { Errors::fatal("VirtualFree(MEM_DECOMMIT) failed"); }
+		if(baseVirtualAddress != VirtualAlloc(baseVirtualAddress,numPages << getPageSizeLog2(),MEM_COMMIT,PAGE_READWRITE)) { Errors::fatal("VirtualAlloc(MEM_COMMIT) failed"); }
+	}
+
 	void freeVirtualPages(U8* baseVirtualAddress,Uptr numPages)
 	{
 		errorUnless(isPageAligned(baseVirtualAddress));
@@ -85,6 +106,18 @@ namespace Platform
 		if(baseVirtualAddress && !result) { Errors::fatal("VirtualFree(MEM_RELEASE) failed"); }
 	}
 
+	void freeAlignedVirtualPages(U8* unalignedBaseAddress,Uptr numPages,Uptr alignmentLog2)
+	{
+		// MEM_RELEASE frees the whole reservation, so the number of pages doesn't matter.
+		freeVirtualPages(unalignedBaseAddress,numPages);
+	}
+
+	void adviseHugeVirtualPages(U8* baseVirtualAddress,Uptr numPages)
+	{
+		// Windows can only use large pages for memory that was allocated with MEM_LARGE_PAGES, which requires a privilege
+		// that processes don't normally have, so this is a no-op.
+	}
+
 	// The interface to the DbgHelp DLL
 	struct DbgHelp
 	{
@@ -159,9 +192,8 @@ namespace Platform
 		// Unwind the stack until there isn't a valid instruction pointer, which signals we've reached the base.
 		CallStack callStack;
 		#ifdef _WIN64
-		while(context.Rip)
+		while(context.Rip && callStack.pushFrame(context.Rip))
 		{
-			callStack.stackFrames.push_back({context.Rip});
 
 			// Look up the SEH unwind information for this function.
 			U64 imageBase;
@@ -204,8 +236,9 @@ namespace Platform
 		auto result = unwindStack(context);
 
 		// Remote the requested number of omitted frames, +1 for this function.
-		const Uptr numOmittedFrames = std::min(result.stackFrames.size(),numOmittedFramesFromTop + 1);
-		result.stackFrames.erase(result.stackFrames.begin(),result.stackFrames.begin() + numOmittedFrames);
+		const Uptr numOmittedFrames = std::min(result.numStackFrames,numOmittedFramesFromTop + 1);
+		result.numStackFrames -= numOmittedFrames;
+		memmove(result.stackFrames,result.stackFrames + numOmittedFrames,result.numStackFrames * sizeof(CallStack::Frame));
 
 		return result;
 	}
@@ -0,0 +1,806 @@
+#include "Inline/BasicTypes.h"
+#include "Inline/Timing.h"
+#include "Platform/Platform.h"
+#include "Runtime/Runtime.h"
+#include "Runtime/Intrinsics.h"
+#include "IR/Types.h"
+#include "IR/Module.h"
+#include "WAST/WAST.h"
+#include "WASM/WASM.h"
+
+#include "CLI.h"
+
+#include <cstring>
+#include <cstdio>
+
+#ifdef __linux__
+	#include <linux/perf_event.h>
+	#include <sys/ioctl.h>
+	#include <sys/syscall.h>
+	#include <unistd.h>
+#endif
+
+using namespace IR;
+using namespace Runtime;
+
+// Measures the cost of resetting a memory as a function of the number of pages the previous execution dirtied.
+static int benchmarkMemoryReset(int argc,char** argv)
+{
+	enum { numMaxPages = 528 };
+	enum { numIterations = 1000 };
+
+	MemoryType memoryType(false,{numMaxPages,numMaxPages});
+	MemoryInstance* memory = createMemory(memoryType);
+	if(!memory) { std::cerr << "Failed to create memory" << std::endl; return EXIT_FAILURE; }
+
+	const Uptr platformPageSize = Uptr(1) << Platform::getPageSizeLog2();
+	for(Uptr numDirtyPages : {Uptr(0),Uptr(1),Uptr(4),Uptr(16),Uptr(64),Uptr(256),Uptr(numMaxPages)})
+	{
+		U64 totalResetNanoseconds = 0;
+		for(Uptr iterationIndex = 0;iterationIndex < numIterations;++iterationIndex)
+		{
+			// Touch every platform page in the first numDirtyPages WebAssembly pages.
+			U8* baseAddress = getMemoryBaseAddress(memory);
+			for(Uptr offset = 0;offset < (numDirtyPages << IR::numBytesPerPageLog2);offset += platformPageSize)
+			{
+				baseAddress[offset] = 1;
+			}
+
+			Timing::Timer resetTimer;
+			resetMemory(memory,memoryType);
+			totalResetNanoseconds += resetTimer.getNanoseconds();
+		}
+
+		std::cout << "reset " << numMaxPages << " page memory with " << numDirtyPages << " dirty pages: "
+			<< std::fixed << std::setprecision(2) << totalResetNanoseconds / 1000.0 / numIterations << "us" << std::endl;
+	}
+
+	return EXIT_SUCCESS;
+}
+
+// Returns the resident set size of the process in bytes.
+static Uptr getResidentBytes()
+{
+	Uptr numTotalPages = 0;
+	Uptr numResidentPages = 0;
+	FILE* statmFile = fopen("/proc/self/statm","r");
+	if(!statmFile) { return 0; }
+	if(fscanf(statmFile,"%zu %zu",&numTotalPages,&numResidentPages) != 2) { numResidentPages = 0; }
+	fclose(statmFile);
+	return numResidentPages << Platform::getPageSizeLog2();
+}
+
+// Instantiates, calls, and releases many distinct modules, and checks that the resident set size stays bounded.
+static int benchmarkModuleSoak(int argc,char** argv)
+{
+	enum { numModules = 20000 };
+	enum { numModulesPerReport = 1000 };
+
+	Uptr baselineResidentBytes = 0;
+	Timing::Timer soakTimer;
+	for(Uptr moduleIndex = 0;moduleIndex < numModules;++moduleIndex)
+	{
+		// Generate a module that differs from every other module.
+		const std::string wastString =
+			"(module (memory 1 1) (table anyfunc (elem $f))"
+			" (global $g (mut i64) (i64.const " + std::to_string(moduleIndex) + "))"
+			" (func $f (export \"apply\") (param i64) (result i64)"
+			"  (i64.store (i32.const 0) (get_local 0))"
+			"  (set_global $g (i64.add (get_global $g) (i64.load (i32.const 0))))"
+			"  (get_global $g)))";
+		IR::Module module;
+		std::vector<WAST::Error> parseErrors;
+		if(!WAST::parseModule(wastString.c_str(),wastString.size(),module,parseErrors))
+		{
+			std::cerr << "Failed to parse generated module" << std::endl;
+			return EXIT_FAILURE;
+		}
+
+		ModuleInstance* moduleInstance = instantiateModule(module,{});
+		addModuleInstanceReference(moduleInstance);
+		invokeFunction(asFunction(getInstanceExport(moduleInstance,"apply")),{Value(U64(moduleIndex))});
+		removeModuleInstanceReference(moduleInstance);
+
+		if((moduleIndex + 1) % numModulesPerReport == 0)
+		{
+			const Uptr residentBytes = getResidentBytes();
+			if(moduleIndex + 1 == numModulesPerReport) { baselineResidentBytes = residentBytes; }
+			std::cout << moduleIndex + 1 << " modules: " << (residentBytes >> 10) << "KB resident" << std::endl;
+
+			// Fail if the resident set has more than doubled since the first report.
+			if(baselineResidentBytes && residentBytes > baselineResidentBytes * 2)
+			{
+				std::cerr << "Resident set size grew from " << (baselineResidentBytes >> 10) << "KB to " << (residentBytes >> 10) << "KB" << std::endl;
+				return EXIT_FAILURE;
+			}
+		}
+	}
+	Timing::logRatePerSecond("Instantiated and released modules",soakTimer,numModules,"modules");
+
+	return EXIT_SUCCESS;
+}
+
+// Measures how fast binary modules are decoded and validated, for each .wasm file given on the command line.
+static int benchmarkWASMParse(int argc,char** argv)
+{
+	enum { minIterations = 10 };
+	enum { minNanoseconds = 1000000000 };
+
+	if(!argc)
+	{
+		std::cerr << "Usage: Benchmark wasm-parse in1.wasm [in2.wasm ...]" << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	Uptr totalBytes = 0;
+	U64 totalNanoseconds = 0;
+	for(int fileIndex = 0;fileIndex < argc;++fileIndex)
+	{
+		const std::string wasmBytes = loadFile(argv[fileIndex]);
+		if(!wasmBytes.size()) { return EXIT_FAILURE; }
+
+		// Decode the module repeatedly until enough time has passed to get a stable measurement.
+		Uptr numIterations = 0;
+		U64 fileNanoseconds = 0;
+		while(numIterations < minIterations || fileNanoseconds < minNanoseconds)
+		{
+			IR::Module module;
+			Timing::Timer parseTimer;
+			if(!loadBinaryModule(wasmBytes,module)) { return EXIT_FAILURE; }
+			fileNanoseconds += parseTimer.getNanoseconds();
+			++numIterations;
+		}
+
+		std::cout << argv[fileIndex] << ": " << std::fixed << std::setprecision(2)
+			<< wasmBytes.size() * numIterations * 1000.0 / fileNanoseconds << "MB/s" << std::endl;
+		totalBytes += wasmBytes.size() * numIterations;
+		totalNanoseconds += fileNanoseconds;
+	}
+
+	std::cout << "total: " << std::fixed << std::setprecision(2) << totalBytes * 1000.0 / totalNanoseconds << "MB/s" << std::endl;
+	return EXIT_SUCCESS;
+}
+
+// Host implementations of the 128-bit integer builtins, called through the intrinsic thunk when not imported from env.
+static MemoryInstance* int128BenchmarkMemory = nullptr;
+
+static void storeInt128(I32 resultAddress,unsigned __int128 result)
+{
+	memcpy(memoryArrayPtr<U8>(int128BenchmarkMemory,resultAddress,16),&result,16);
+}
+
+DEFINE_INTRINSIC_FUNCTION5(benchmark,multi3,__multi3,none,i32,resultAddress,i64,leftLow,i64,leftHigh,i64,rightLow,i64,rightHigh)
+{
+	const unsigned __int128 left = (unsigned __int128)U64(leftHigh) << 64 | U64(leftLow);
+	const unsigned __int128 right = (unsigned __int128)U64(rightHigh) << 64 | U64(rightLow);
+	storeInt128(resultAddress,left * right);
+}
+
+DEFINE_INTRINSIC_FUNCTION5(benchmark,udivti3,__udivti3,none,i32,resultAddress,i64,leftLow,i64,leftHigh,i64,rightLow,i64,rightHigh)
+{
+	const unsigned __int128 left = (unsigned __int128)U64(leftHigh) << 64 | U64(leftLow);
+	const unsigned __int128 right = (unsigned __int128)U64(rightHigh) << 64 | U64(rightLow);
+	if(!right) { causeException(Exception::Cause::integerDivideByZeroOrIntegerOverflow); }
+	storeInt128(resultAddress,left / right);
+}
+
+// Compares calling the 128-bit integer builtins through the intrinsic thunk with the JIT's inline lowering of them.
+static int benchmarkInt128Builtins(int argc,char** argv)
+{
+	enum { numIterations = 10000000 };
+
+	setInlineInt128Builtins(true);
+	for(const char* builtinName : {"__multi3","__udivti3"})
+	{
+		// The builtin imported from env is emitted inline, and the one imported from host is called through its thunk.
+		const std::string wastString = std::string(
+			"(module"
+			" (import \"env\" \"") + builtinName + "\" (func $inline (param i32 i64 i64 i64 i64)))"
+			" (import \"host\" \"" + builtinName + "\" (func $host (param i32 i64 i64 i64 i64)))"
+			" (memory 1)"
+			" (func (export \"inline\") (param $n i32) (result i64)"
+			"  (loop $loop"
+			"   (call $inline (i32.const 16) (i64.extend_u/i32 (get_local $n)) (i64.const 0x0123456789abcdef)"
+			"    (i64.const 0x9e3779b97f4a7c15) (i64.const 3))"
+			"   (br_if $loop (tee_local $n (i32.sub (get_local $n) (i32.const 1)))))"
+			"  (i64.xor (i64.load (i32.const 16)) (i64.load (i32.const 24))))"
+			" (func (export \"host\") (param $n i32) (result i64)"
+			"  (loop $loop"
+			"   (call $host (i32.const 16) (i64.extend_u/i32 (get_local $n)) (i64.const 0x0123456789abcdef)"
+			"    (i64.const 0x9e3779b97f4a7c15) (i64.const 3))"
+			"   (br_if $loop (tee_local $n (i32.sub (get_local $n) (i32.const 1)))))"
+			"  (i64.xor (i64.load (i32.const 16)) (i64.load (i32.const 24)))))";
+		IR::Module module;
+		std::vector<WAST::Error> parseErrors;
+		if(!WAST::parseModule(wastString.c_str(),wastString.size(),module,parseErrors))
+		{
+			std::cerr << "Failed to parse " << builtinName << " module" << std::endl;
+			return EXIT_FAILURE;
+		}
+
+		// Bind both imports to the benchmark's host implementation.
+		ImportBindings importBindings;
+		for(const auto& functionImport : module.functions.imports)
+		{
+			importBindings.functions.push_back(Intrinsics::findFunction(
+				"benchmark",functionImport.exportName,module.types[functionImport.type.index]));
+		}
+
+		ModuleInstance* moduleInstance = instantiateModule(module,std::move(importBindings));
+		addModuleInstanceReference(moduleInstance);
+		int128BenchmarkMemory = getDefaultMemory(moduleInstance);
+
+		U64 results[2];
+		for(Uptr pathIndex = 0;pathIndex < 2;++pathIndex)
+		{
+			const char* pathName = pathIndex ? "host" : "inline";
+			Timing::Timer pathTimer;
+			results[pathIndex] = invokeFunction(asFunction(getInstanceExport(moduleInstance,pathName)),{I32(numIterations)}).i64;
+			std::cout << builtinName << " " << pathName << ": " << std::fixed << std::setprecision(2)
+				<< pathTimer.getNanoseconds() / double(numIterations) << "ns/op" << std::endl;
+		}
+		removeModuleInstanceReference(moduleInstance);
+
+		if(results[0] != results[1])
+		{
+			std::cerr << builtinName << " results differ between the inline and host paths" << std::endl;
+			return EXIT_FAILURE;
+		}
+	}
+	setInlineInt128Builtins(false);
+
+	return EXIT_SUCCESS;
+}
+
+// Counts the instruction TLB misses of the calling thread, if the kernel allows this process to use perf events.
+struct ITLBMissCounter
+{
+	ITLBMissCounter(): perfEventFD(-1)
+	{
+		#ifdef __linux__
+			perf_event_attr attributes;
+			memset(&attributes,0,sizeof(attributes));
+			attributes.size = sizeof(attributes);
+			attributes.type = PERF_TYPE_HW_CACHE;
+			attributes.config = PERF_COUNT_HW_CACHE_ITLB
+				| (PERF_COUNT_HW_CACHE_OP_READ << 8)
+				| (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+			attributes.disabled = 1;
+			attributes.exclude_kernel = 1;
+			attributes.exclude_hv = 1;
+			perfEventFD = (int)syscall(__NR_perf_event_open,&attributes,0,-1,-1,0);
+		#endif
+	}
+	~ITLBMissCounter()
+	{
+		#ifdef __linux__
+			if(perfEventFD >= 0) { close(perfEventFD); }
+		#endif
+	}
+
+	bool isAvailable() const { return perfEventFD >= 0; }
+
+	void start()
+	{
+		#ifdef __linux__
+			if(perfEventFD >= 0)
+			{
+				ioctl(perfEventFD,PERF_EVENT_IOC_RESET,0);
+				ioctl(perfEventFD,PERF_EVENT_IOC_ENABLE,0);
+			}
+		#endif
+	}
+
+	U64 stop()
+	{
+		U64 numMisses = 0;
+		#ifdef __linux__
+			if(perfEventFD >= 0)
+			{
+				ioctl(perfEventFD,PERF_EVENT_IOC_DISABLE,0);
+				if(read(perfEventFD,&numMisses,sizeof(numMisses)) != sizeof(numMisses)) { numMisses = 0; }
+			}
+		#endif
+		return numMisses;
+	}
+
+private:
+	int perfEventFD;
+};
+
+// Calls many small modules round-robin, so the working set of JIT code is spread over as many modules as a busy node
+// keeps cached, and reports the time and instruction TLB misses per call.
+static int benchmarkCodeArena(int argc,char** argv)
+{
+	enum { numModules = 4096 };
+	enum { numRounds = 64 };
+
+	std::vector<ModuleInstance*> moduleInstances;
+	std::vector<FunctionInstance*> functions;
+	for(Uptr moduleIndex = 0;moduleIndex < numModules;++moduleIndex)
+	{
+		const std::string wastString =
+			"(module (func (export \"apply\") (param i64) (result i64)"
+			" (i64.add (get_local 0) (i64.const " + std::to_string(moduleIndex) + "))))";
+		IR::Module module;
+		std::vector<WAST::Error> parseErrors;
+		if(!WAST::parseModule(wastString.c_str(),wastString.size(),module,parseErrors))
+		{
+			std::cerr << "Failed to parse generated module" << std::endl;
+			return EXIT_FAILURE;
+		}
+
+		ModuleInstance* moduleInstance = instantiateModule(module,{});
+		addModuleInstanceReference(moduleInstance);
+		moduleInstances.push_back(moduleInstance);
+		functions.push_back(asFunction(getInstanceExport(moduleInstance,"apply")));
+	}
+
+	ITLBMissCounter itlbMissCounter;
+	U64 checksum = 0;
+	Timing::Timer callTimer;
+	itlbMissCounter.start();
+	for(Uptr roundIndex = 0;roundIndex < numRounds;++roundIndex)
+	{
+		for(FunctionInstance* function : functions) { checksum += invokeFunction(function,{Value(U64(roundIndex))}).i64; }
+	}
+	const U64 numITLBMisses = itlbMissCounter.stop();
+	const F64 numCalls = F64(numModules) * numRounds;
+
+	std::cout << numModules << " modules: " << std::fixed << std::setprecision(2)
+		<< callTimer.getNanoseconds() / numCalls << "ns/call, ";
+	if(itlbMissCounter.isAvailable()) { std::cout << numITLBMisses / numCalls << " iTLB misses/call" << std::endl; }
+	else { std::cout << "iTLB misses unavailable (perf events are disabled)" << std::endl; }
+
+	for(ModuleInstance* moduleInstance : moduleInstances) { removeModuleInstanceReference(moduleInstance); }
+
+	// Check the sum of (round + moduleIndex) over every call, so the calls can't be optimized away.
+	const U64 expectedChecksum = U64(numModules) * (U64(numRounds) * (numRounds - 1) / 2) + U64(numRounds) * (U64(numModules) * (numModules - 1) / 2);
+	if(checksum != expectedChecksum)
+	{
+		std::cerr << "Calls returned the wrong results" << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	return EXIT_SUCCESS;
+}
+
+// Instantiates many contracts that are built from the same library of pure functions, plus a function of their own
+// that accesses memory, and compares the time to instantiate the first contract with the time for the rest, which only
+// compile their own function and share the library's code.
+static int benchmarkFunctionDedup(int argc,char** argv)
+{
+	enum { numLibraryFunctions = 256 };
+	enum { numModules = 64 };
+
+	std::string libraryWAST;
+	for(Uptr functionIndex = 0;functionIndex < numLibraryFunctions;++functionIndex)
+	{
+		libraryWAST += " (func $lib" + std::to_string(functionIndex) + " (param i64) (result i64)"
+			" (i64.xor (i64.mul (get_local 0) (i64.const " + std::to_string(2 * functionIndex + 1) + "))"
+			+ (functionIndex ? " (call $lib" + std::to_string(functionIndex - 1) + " (i64.rotl (get_local 0) (i64.const 7)))" : " (i64.const 0)")
+			+ "))";
+	}
+
+	std::vector<ModuleInstance*> moduleInstances;
+	std::vector<F64> instantiateMicroseconds;
+	U64 expectedResult = 0;
+	for(Uptr moduleIndex = 0;moduleIndex < numModules;++moduleIndex)
+	{
+		const std::string wastString =
+			"(module (memory 1)" + libraryWAST +
+			" (func (export \"apply\") (param i64) (result i64)"
+			"  (i64.store (i32.const 8) (call $lib" + std::to_string(numLibraryFunctions - 1) + " (get_local 0)))"
+			"  (i64.add (i64.load (i32.const 8)) (i64.const " + std::to_string(moduleIndex) + "))))";
+		IR::Module module;
+		std::vector<WAST::Error> parseErrors;
+		if(!WAST::parseModule(wastString.c_str(),wastString.size(),module,parseErrors))
+		{
+			std::cerr << "Failed to parse generated module" << std::endl;
+			return EXIT_FAILURE;
+		}
+
+		Timing::Timer instantiateTimer;
+		ModuleInstance* moduleInstance = instantiateModule(module,{});
+		instantiateMicroseconds.push_back(instantiateTimer.getMicroseconds());
+		addModuleInstanceReference(moduleInstance);
+		moduleInstances.push_back(moduleInstance);
+
+		// Every contract computes the same library result, offset by its index.
+		FunctionInstance* function = asFunction(getInstanceExport(moduleInstance,"apply"));
+		const U64 result = invokeFunction(function,{Value(U64(12345))}).i64 - moduleIndex;
+		if(moduleIndex == 0) { expectedResult = result; }
+		else if(result != expectedResult)
+		{
+			std::cerr << "Contracts sharing library code returned different results" << std::endl;
+			return EXIT_FAILURE;
+		}
+	}
+
+	F64 sharedMicroseconds = 0.0;
+	for(Uptr moduleIndex = 1;moduleIndex < numModules;++moduleIndex) { sharedMicroseconds += instantiateMicroseconds[moduleIndex]; }
+	std::cout << numLibraryFunctions << " library functions: " << std::fixed << std::setprecision(2)
+		<< instantiateMicroseconds[0] << "us to instantiate the first contract, "
+		<< sharedMicroseconds / (numModules - 1) << "us for each of the others" << std::endl;
+
+	for(ModuleInstance* moduleInstance : moduleInstances) { removeModuleInstanceReference(moduleInstance); }
+	return EXIT_SUCCESS;
+}
+
+// Measures a deep recursion under call depth metering, and the cost of the trap when a contract recurses past the limit
+// compared with the trap when it runs out of native stack.
+static int benchmarkCallDepth(int argc,char** argv)
+{
+	enum { maxCallDepth = 250 };
+	enum { numIterations = 100000 };
+	enum { numMeteredTrapIterations = 1000 };
+	enum { numStackOverflowIterations = 10 };
+
+	const char* wastString =
+		"(module"
+		" (func $recurse (export \"recurse\") (param $n i32) (result i32)"
+		"  (if (result i32) (i32.eqz (get_local $n))"
+		"   (then (i32.const 0))"
+		"   (else (i32.add (call $recurse (i32.sub (get_local $n) (i32.const 1))) (i32.const 1))))))";
+	IR::Module module;
+	std::vector<WAST::Error> parseErrors;
+	if(!WAST::parseModule(wastString,strlen(wastString),module,parseErrors))
+	{
+		std::cerr << "Failed to parse recursion module" << std::endl;
+		return EXIT_FAILURE;
+	}
+	ModuleInstance* moduleInstance = instantiateModule(module,{});
+	addModuleInstanceReference(moduleInstance);
+	FunctionInstance* recurse = asFunction(getInstanceExport(moduleInstance,"recurse"));
+
+	// Calls recurse with the given depth until it fails, and returns the cause of the exception.
+	auto recurseUntilException = [recurse](I32 depth) -> Exception::Cause
+	{
+		try { invokeFunction(recurse,{depth}); }
+		catch(const Exception& exception) { return exception.cause; }
+		return Exception::Cause::unknown;
+	};
+
+	// Recurse to exactly the limit: recurse(n) is n + 1 nested calls.
+	setMaxCallDepth(maxCallDepth);
+	Timing::Timer recursionTimer;
+	for(Uptr iterationIndex = 0;iterationIndex < numIterations;++iterationIndex)
+	{
+		if(invokeFunction(recurse,{I32(maxCallDepth - 1)}).i32 != maxCallDepth - 1)
+		{
+			std::cerr << "recurse returned the wrong result" << std::endl;
+			return EXIT_FAILURE;
+		}
+	}
+	std::cout << "recursion to depth " << maxCallDepth << ": " << std::fixed << std::setprecision(2)
+		<< recursionTimer.getNanoseconds() / double(numIterations) / maxCallDepth << "ns/call" << std::endl;
+
+	// One call past the limit traps, at the same depth every time.
+	Timing::Timer meteredTrapTimer;
+	for(Uptr iterationIndex = 0;iterationIndex < numMeteredTrapIterations;++iterationIndex)
+	{
+		if(recurseUntilException(I32(maxCallDepth)) != Exception::Cause::callStackExhausted)
+		{
+			std::cerr << "recursing past the call depth limit didn't exhaust the call stack" << std::endl;
+			return EXIT_FAILURE;
+		}
+	}
+	std::cout << "call depth limit trap: " << std::fixed << std::setprecision(2)
+		<< meteredTrapTimer.getMicroseconds() / double(numMeteredTrapIterations) << "us/trap" << std::endl;
+
+	// Without a limit, unbounded recursion is only stopped by the native stack overflowing.
+	setMaxCallDepth(UINT32_MAX);
+	Timing::Timer stackOverflowTimer;
+	for(Uptr iterationIndex = 0;iterationIndex < numStackOverflowIterations;++iterationIndex)
+	{
+		if(recurseUntilException(I32(INT32_MAX)) != Exception::Cause::stackOverflow)
+		{
+			std::cerr << "unbounded recursion didn't overflow the stack" << std::endl;
+			return EXIT_FAILURE;
+		}
+	}
+	std::cout << "stack overflow trap: " << std::fixed << std::setprecision(2)
+		<< stackOverflowTimer.getMicroseconds() / double(numStackOverflowIterations) << "us/trap" << std::endl;
+
+	removeModuleInstanceReference(moduleInstance);
+	return EXIT_SUCCESS;
+}
+
+// Host implementations of a contract assertion failing, either by throwing an exception with a formatted message through
+// the JITed frames, or by recording the raw message and jumping straight back to invokeFunction.
+struct RevertException
+{
+	std::string message;
+};
+
+static MemoryInstance* revertBenchmarkMemory = nullptr;
+static const char* revertMessage = nullptr;
+static Uptr revertMessageSize = 0;
+
+DEFINE_INTRINSIC_FUNCTION2(benchmark,revertThrow,revertThrow,none,i32,messageAddress,i32,messageSize)
+{
+	std::ostringstream messageStream;
+	messageStream << "assertion failure with message: "
+		<< std::string(memoryArrayPtr<char>(revertBenchmarkMemory,messageAddress,messageSize),messageSize);
+	throw RevertException {messageStream.str()};
+}
+
+DEFINE_INTRINSIC_FUNCTION2(benchmark,revertJump,revertJump,none,i32,messageAddress,i32,messageSize)
+{
+	revertMessage = memoryArrayPtr<char>(revertBenchmarkMemory,messageAddress,messageSize);
+	revertMessageSize = messageSize;
+	#ifdef _WIN32
+		throw RevertException {std::string(revertMessage,revertMessageSize)};
+	#else
+		Platform::immediately_exit();
+	#endif
+}
+
+// Compares the cost of the two ways of reverting a contract, as a function of how many JITed frames are on the stack.
+static int benchmarkRevert(int argc,char** argv)
+{
+	enum { numIterations = 10000 };
+
+	const char* wastString =
+		"(module"
+		" (import \"benchmark\" \"revertThrow\" (func $revertThrow (param i32 i32)))"
+		" (import \"benchmark\" \"revertJump\" (func $revertJump (param i32 i32)))"
+		" (memory 1)"
+		" (data (i32.const 0) \"invalid input\")"
+		" (func $throw (export \"throw\") (param $depth i32)"
+		"  (if (i32.eqz (get_local $depth))"
+		"   (then (call $revertThrow (i32.const 0) (i32.const 13)))"
+		"   (else (call $throw (i32.sub (get_local $depth) (i32.const 1))))))"
+		" (func $jump (export \"jump\") (param $depth i32)"
+		"  (if (i32.eqz (get_local $depth))"
+		"   (then (call $revertJump (i32.const 0) (i32.const 13)))"
+		"   (else (call $jump (i32.sub (get_local $depth) (i32.const 1)))))))";
+	IR::Module module;
+	std::vector<WAST::Error> parseErrors;
+	if(!WAST::parseModule(wastString,strlen(wastString),module,parseErrors))
+	{
+		std::cerr << "Failed to parse revert module" << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	ImportBindings importBindings;
+	for(const auto& functionImport : module.functions.imports)
+	{
+		importBindings.functions.push_back(Intrinsics::findFunction(
+			"benchmark",functionImport.exportName,module.types[functionImport.type.index]));
+	}
+	ModuleInstance* moduleInstance = instantiateModule(module,std::move(importBindings));
+	addModuleInstanceReference(moduleInstance);
+	revertBenchmarkMemory = getDefaultMemory(moduleInstance);
+	FunctionInstance* throwFunction = asFunction(getInstanceExport(moduleInstance,"throw"));
+	FunctionInstance* jumpFunction = asFunction(getInstanceExport(moduleInstance,"jump"));
+
+	for(I32 depth : {0,16,64,200})
+	{
+		Timing::Timer throwTimer;
+		for(Uptr iterationIndex = 0;iterationIndex < numIterations;++iterationIndex)
+		{
+			try
+			{
+				invokeFunction(throwFunction,{depth});
+				std::cerr << "throw didn't revert" << std::endl;
+				return EXIT_FAILURE;
+			}
+			catch(const RevertException&) {}
+		}
+		const F64 throwMicroseconds = throwTimer.getMicroseconds() / F64(numIterations);
+
+		Timing::Timer jumpTimer;
+		for(Uptr iterationIndex = 0;iterationIndex < numIterations;++iterationIndex)
+		{
+			revertMessage = nullptr;
+			invokeFunction(jumpFunction,{depth});
+			if(!revertMessage || std::string(revertMessage,revertMessageSize) != "invalid input")
+			{
+				std::cerr << "jump didn't revert" << std::endl;
+				return EXIT_FAILURE;
+			}
+		}
+		const F64 jumpMicroseconds = jumpTimer.getMicroseconds() / F64(numIterations);
+
+		std::cout << "revert from depth " << depth << ": " << std::fixed << std::setprecision(2)
+			<< throwMicroseconds << "us/throw, " << jumpMicroseconds << "us/jump" << std::endl;
+	}
+
+	removeModuleInstanceReference(moduleInstance);
+	return EXIT_SUCCESS;
+}
+
+// Invokes a WebAssembly function from a host function, which catches traps inside the trap catching of the caller.
+static FunctionInstance* nestedCallFunction = nullptr;
+
+DEFINE_INTRINSIC_FUNCTION0(benchmark,nestedCall,nestedCall,none)
+{
+	invokeFunction(nestedCallFunction,{});
+}
+
+static int benchmarkTraps(int argc,char** argv)
+{
+	enum { numIterations = 100000 };
+
+	const char* wastString =
+		"(module"
+		" (import \"benchmark\" \"nestedCall\" (func $nestedCall))"
+		" (memory 1)"
+		" (func (export \"nop\"))"
+		" (func (export \"outOfBounds\") (param $address i32) (result i32) (i32.load (get_local $address)))"
+		" (func (export \"divideByZero\") (param $divisor i32) (result i32) (i32.div_s (i32.const 1) (get_local $divisor)))"
+		" (func (export \"outOfBoundsAfterNestedCall\") (param $address i32) (result i32)"
+		"  (call $nestedCall) (i32.load (get_local $address)))"
+		" (func (export \"divideByZeroAfterNestedCall\") (param $divisor i32) (result i32)"
+		"  (call $nestedCall) (i32.div_s (i32.const 1) (get_local $divisor))))";
+	IR::Module module;
+	std::vector<WAST::Error> parseErrors;
+	if(!WAST::parseModule(wastString,strlen(wastString),module,parseErrors))
+	{
+		std::cerr << "Failed to parse trap module" << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	ImportBindings importBindings;
+	for(const auto& functionImport : module.functions.imports)
+	{
+		importBindings.functions.push_back(Intrinsics::findFunction(
+			"benchmark",functionImport.exportName,module.types[functionImport.type.index]));
+	}
+	ModuleInstance* moduleInstance = instantiateModule(module,std::move(importBindings));
+	addModuleInstanceReference(moduleInstance);
+	nestedCallFunction = asFunction(getInstanceExport(moduleInstance,"nop"));
+
+	// The calls after a nested call check that the caller still catches its own traps once the nested call has returned.
+	const std::pair<const char*,I32> trappingCalls[] =
+	{
+		{"outOfBounds",I32(0xfffffff0)},
+		{"divideByZero",0},
+		{"outOfBoundsAfterNestedCall",I32(0xfffffff0)},
+		{"divideByZeroAfterNestedCall",0},
+	};
+	for(const auto& trappingCall : trappingCalls)
+	{
+		FunctionInstance* function = asFunction(getInstanceExport(moduleInstance,trappingCall.first));
+
+		// Only the raw call stack is captured when the trap occurs.
+		Exception lastException;
+		Timing::Timer trapTimer;
+		for(Uptr iterationIndex = 0;iterationIndex < numIterations;++iterationIndex)
+		{
+			try
+			{
+				invokeFunction(function,{trappingCall.second});
+				std::cerr << trappingCall.first << " didn't trap" << std::endl;
+				return EXIT_FAILURE;
+			}
+			catch(const Exception& exception) { lastException = exception; }
+		}
+		const F64 trapMicroseconds = trapTimer.getMicroseconds() / F64(numIterations);
+
+		// Symbolizing it is deferred until somebody asks for a description.
+		Timing::Timer describeTimer;
+		const std::vector<std::string> callStackDescription = describeCallStack(lastException.callStack);
+		const F64 describeMicroseconds = describeTimer.getMicroseconds();
+
+		std::cout << trappingCall.first << " (" << describeExceptionCause(lastException.cause) << "): "
+			<< std::fixed << std::setprecision(2) << trapMicroseconds << "us/trap, "
+			<< describeMicroseconds << "us to describe " << callStackDescription.size() << " frames" << std::endl;
+	}
+
+	removeModuleInstanceReference(moduleInstance);
+	return EXIT_SUCCESS;
+}
+
+// Measures a contract compiled without a profile, compiled to collect one, and compiled with the profile it collected. Its
+// loop almost always skips the branch in it, and almost all of its indirect calls call the same function.
+static int benchmarkProfileGuided(int argc,char** argv)
+{
+	enum { numIterations = 10000000 };
+	enum { numCollectingRuns = 4 };
+
+	const char* wastString =
+		"(module"
+		" (type $unary (func (param i64) (result i64)))"
+		" (table anyfunc (elem $mix $double))"
+		" (func $mix (param i64) (result i64) (i64.xor (i64.mul (get_local 0) (i64.const 0x9e3779b97f4a7c15)) (i64.const 1)))"
+		" (func $double (param i64) (result i64) (i64.shl (get_local 0) (i64.const 1)))"
+		" (func (export \"run\") (param $n i32) (result i64) (local $acc i64)"
+		"  (loop $loop"
+		"   (if (i32.eqz (i32.and (get_local $n) (i32.const 1023)))"
+		"    (then (set_local $acc (i64.rotl (get_local $acc) (i64.const 13)))))"
+		"   (set_local $acc (call_indirect $unary (i64.add (get_local $acc) (i64.extend_u/i32 (get_local $n)))"
+		"    (select (i32.const 1) (i32.const 0) (i32.eqz (i32.rem_u (get_local $n) (i32.const 100))))))"
+		"   (br_if $loop (tee_local $n (i32.sub (get_local $n) (i32.const 1)))))"
+		"  (get_local $acc)))";
+	IR::Module module;
+	std::vector<WAST::Error> parseErrors;
+	if(!WAST::parseModule(wastString,strlen(wastString),module,parseErrors))
+	{
+		std::cerr << "Failed to parse profile-guided module" << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	// The collecting instances add their counts to the profile when they're freed, so it has all of them by the time the
+	// last tier is compiled.
+	ModuleProfile profile;
+	const char* tierNames[] = {"without a profile","collecting a profile","with the profile"};
+	F64 tierNanoseconds[3];
+	U64 tierResults[3];
+	for(Uptr tierIndex = 0;tierIndex < 3;++tierIndex)
+	{
+		const Uptr numRuns = tierIndex == 1 ? numCollectingRuns : 1;
+		F64 nanoseconds = 0.0;
+		for(Uptr runIndex = 0;runIndex < numRuns;++runIndex)
+		{
+			ModuleInstance* moduleInstance = tierIndex == 0
+				? instantiateModule(module,{})
+				: instantiateModule(module,{},&profile,tierIndex == 1);
+			addModuleInstanceReference(moduleInstance);
+
+			Timing::Timer runTimer;
+			tierResults[tierIndex] = invokeFunction(asFunction(getInstanceExport(moduleInstance,"run")),{I32(numIterations)}).i64;
+			nanoseconds += runTimer.getNanoseconds();
+
+			removeModuleInstanceReference(moduleInstance);
+		}
+		tierNanoseconds[tierIndex] = nanoseconds / numRuns;
+		std::cout << tierNames[tierIndex] << ": " << std::fixed << std::setprecision(2)
+			<< tierNanoseconds[tierIndex] / numIterations << "ns/iteration" << std::endl;
+	}
+
+	if(tierResults[1] != tierResults[0] || tierResults[2] != tierResults[0])
+	{
+		std::cerr << "The profile changed the contract's result" << std::endl;
+		return EXIT_FAILURE;
+	}
+	std::cout << "speedup with the profile: " << std::fixed << std::setprecision(2)
+		<< tierNanoseconds[0] / tierNanoseconds[2] << "x" << std::endl;
+	return EXIT_SUCCESS;
+}
+
+struct Benchmark
+{
+	const char* name;
+	int (*run)(int argc,char** argv);
+	bool needsArguments;
+};
+
+static const Benchmark benchmarks[] =
+{
+	{"memory-reset",benchmarkMemoryReset,false},
+	{"module-soak",benchmarkModuleSoak,false},
+	{"wasm-parse",benchmarkWASMParse,true},
+	{"int128-builtins",benchmarkInt128Builtins,false},
+	{"code-arena",benchmarkCodeArena,false},
+	{"call-depth",benchmarkCallDepth,false},
+	{"revert",benchmarkRevert,false},
+	{"traps",benchmarkTraps,false},
+	{"function-dedup",benchmarkFunctionDedup,false},
+	{"profile-guided",benchmarkProfileGuided,false},
+};
+
+int commandMain(int argc,char** argv)
+{
+	Runtime::init();
+
+	// Run the named benchmark with the remaining arguments, or all of the benchmarks that don't need arguments.
+	const char* benchmarkName = argc >= 2 ? argv[1] : nullptr;
+	bool ranBenchmark = false;
+	for(const Benchmark& benchmark : benchmarks)
+	{
+		if(benchmarkName ? strcmp(benchmarkName,benchmark.name) != 0 : benchmark.needsArguments) { continue; }
+		std::cout << benchmark.name << ":" << std::endl;
+		if(benchmark.run(benchmarkName ? argc - 2 : 0,benchmarkName ? argv + 2 : nullptr) != EXIT_SUCCESS) { return EXIT_FAILURE; }
+		ranBenchmark = true;
+	}
+	if(!ranBenchmark)
+	{
+		std::cerr << "Usage: Benchmark [name [args...]]" << std::endl;
+		for(const Benchmark& benchmark : benchmarks) { std::cerr << "  " << benchmark.name << std::endl; }
+		return EXIT_FAILURE;
+	}
+
+	return EXIT_SUCCESS;
+}
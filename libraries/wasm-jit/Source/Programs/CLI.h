@@ -173,7 +173,7 @@ int main(int argc,char** argv)
 	catch(Runtime::Exception exception)
 	{
 		std::cerr << "Runtime exception: " << describeExceptionCause(exception.cause) << std::endl;
-		for(auto calledFunction : exception.callStack) { std::cerr << "  " << calledFunction << std::endl; }
+		for(auto calledFunction : Runtime::describeCallStack(exception.callStack)) { std::cerr << "  " << calledFunction << std::endl; }
 		return EXIT_FAILURE;
 	}
 	catch(Serialization::FatalSerializationException exception)
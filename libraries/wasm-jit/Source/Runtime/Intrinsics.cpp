@@ -3,11 +3,149 @@
 #include "Platform/Platform.h"
 #include "Runtime.h"
 #include "RuntimePrivate.h"
+#include <algorithm>
+#include <atomic>
 #include <iostream>
+#include <memory>
 #include <string>
+#include <string.h>
 
 namespace Intrinsics
 {
+	// A perfect hash table of the intrinsic functions, keyed by (module name, export name, type).
+	// Each key is hashed to a bucket, and each bucket has a seed that was chosen so that all keys map to distinct slots.
+	struct FrozenFunctionTable
+	{
+		struct Slot
+		{
+			std::string name;
+			const IR::FunctionType* type;
+			Runtime::FunctionInstance* function;
+		};
+
+		std::vector<U32> bucketSeeds;
+		std::vector<Slot> slots;
+
+		FrozenFunctionTable(const std::map<std::string,Intrinsics::Function*>& functionMap);
+
+		Runtime::FunctionInstance* find(const std::string& moduleName,const std::string& exportName,const IR::FunctionType* type) const
+		{
+			const U64 hash = hashKey(moduleName,exportName,type);
+			const Slot& slot = slots[getSlotIndex(hash,bucketSeeds[hash & (bucketSeeds.size() - 1)])];
+			if(slot.type != type
+			|| slot.name.size() != moduleName.size() + 1 + exportName.size()
+			|| memcmp(slot.name.data(),moduleName.data(),moduleName.size())
+			|| slot.name[moduleName.size()] != '.'
+			|| memcmp(slot.name.data() + moduleName.size() + 1,exportName.data(),exportName.size()))
+			{ return nullptr; }
+			return slot.function;
+		}
+
+	private:
+
+		static U64 mix(U64 value)
+		{
+			value ^= value >> 33;
+			value *= 0xff51afd7ed558ccdull;
+			value ^= value >> 33;
+			value *= 0xc4ceb9fe1a85ec53ull;
+			value ^= value >> 33;
+			return value;
+		}
+
+		static U64 hashBytes(U64 hash,const char* bytes,Uptr numBytes)
+		{
+			for(Uptr index = 0;index < numBytes;++index) { hash = (hash ^ U8(bytes[index])) * 0x100000001b3ull; }
+			return hash;
+		}
+
+		static U64 hashKey(const std::string& moduleName,const std::string& exportName,const IR::FunctionType* type)
+		{
+			U64 hash = hashBytes(0xcbf29ce484222325ull,moduleName.data(),moduleName.size());
+			hash = hashBytes(hash,".",1);
+			hash = hashBytes(hash,exportName.data(),exportName.size());
+			return mix(hash ^ reinterpret_cast<Uptr>(type));
+		}
+
+		Uptr getSlotIndex(U64 hash,U32 seed) const
+		{
+			return Uptr(mix(hash + seed)) & (slots.size() - 1);
+		}
+	};
+
+	FrozenFunctionTable::FrozenFunctionTable(const std::map<std::string,Intrinsics::Function*>& functionMap)
+	{
+		struct Key
+		{
+			U64 hash;
+			Intrinsics::Function* function;
+		};
+
+		// Hash the qualified names of the intrinsics, which were registered as "module.export".
+		std::vector<Key> keys;
+		for(auto& mapIt : functionMap)
+		{
+			const std::string& name = mapIt.second->getName();
+			const Uptr dotIndex = name.find('.');
+			const std::string moduleName = dotIndex == std::string::npos ? std::string() : name.substr(0,dotIndex);
+			const std::string exportName = dotIndex == std::string::npos ? name : name.substr(dotIndex + 1);
+			keys.push_back({hashKey(moduleName,exportName,mapIt.second->function->type),mapIt.second});
+		}
+
+		Uptr numBuckets = 1;
+		while(numBuckets * 4 < keys.size()) { numBuckets <<= 1; }
+		Uptr numSlots = 2;
+		while(numSlots < keys.size() * 2) { numSlots <<= 1; }
+
+		// Group the keys by bucket, and place the largest buckets first.
+		std::vector<std::vector<const Key*>> buckets(numBuckets);
+		for(const Key& key : keys) { buckets[key.hash & (numBuckets - 1)].push_back(&key); }
+		std::vector<Uptr> bucketOrder;
+		for(Uptr bucketIndex = 0;bucketIndex < numBuckets;++bucketIndex) { bucketOrder.push_back(bucketIndex); }
+		std::stable_sort(bucketOrder.begin(),bucketOrder.end(),[&](Uptr left,Uptr right) { return buckets[left].size() > buckets[right].size(); });
+
+		// Find a seed for each bucket that maps its keys to free slots. If some bucket can't be placed, retry with more slots.
+		enum { maxSeedsPerBucket = 1 << 16 };
+		while(true)
+		{
+			bucketSeeds.assign(numBuckets,0);
+			slots.assign(numSlots,Slot {std::string(),nullptr,nullptr});
+			std::vector<bool> isSlotUsed(numSlots,false);
+			std::vector<Uptr> bucketSlotIndices;
+
+			bool placedAllBuckets = true;
+			for(Uptr bucketIndex : bucketOrder)
+			{
+				const std::vector<const Key*>& bucket = buckets[bucketIndex];
+				if(!bucket.size()) { break; }
+
+				U32 seed = 0;
+				for(;seed < maxSeedsPerBucket;++seed)
+				{
+					bucketSlotIndices.clear();
+					for(const Key* key : bucket)
+					{
+						const Uptr slotIndex = getSlotIndex(key->hash,seed);
+						if(isSlotUsed[slotIndex] || std::count(bucketSlotIndices.begin(),bucketSlotIndices.end(),slotIndex)) { break; }
+						bucketSlotIndices.push_back(slotIndex);
+					}
+					if(bucketSlotIndices.size() == bucket.size()) { break; }
+				}
+				if(seed == maxSeedsPerBucket) { placedAllBuckets = false; break; }
+
+				bucketSeeds[bucketIndex] = seed;
+				for(Uptr keyIndex = 0;keyIndex < bucket.size();++keyIndex)
+				{
+					Intrinsics::Function* function = bucket[keyIndex]->function;
+					isSlotUsed[bucketSlotIndices[keyIndex]] = true;
+					slots[bucketSlotIndices[keyIndex]] = {function->getName(),function->function->type,function->function};
+				}
+			}
+			if(placedAllBuckets) { break; }
+			numSlots <<= 1;
+		}
+	}
+
 	struct Singleton
 	{
 		std::map<std::string,Intrinsics::Function*> functionMap;
@@ -16,7 +154,12 @@ namespace Intrinsics
 		std::map<std::string,Intrinsics::Table*> tableMap;
 		Platform::Mutex* mutex;
 
-		Singleton(): mutex(Platform::createMutex()) {}
+		// The frozen function table, or null if the set of intrinsic functions changed since it was built.
+		// Tables that are replaced are kept alive, since another thread may still be reading them.
+		std::atomic<const FrozenFunctionTable*> frozenFunctionTable;
+		std::vector<std::unique_ptr<FrozenFunctionTable>> frozenFunctionTables;
+
+		Singleton(): mutex(Platform::createMutex()), frozenFunctionTable(nullptr) {}
 		Singleton(const Singleton&) = delete;
 
 		static Singleton& get()
@@ -40,6 +183,7 @@ namespace Intrinsics
 		function = new Runtime::FunctionInstance(nullptr,type,nativeFunction);
 		Platform::Lock lock(Singleton::get().mutex);
 		Singleton::get().functionMap[getDecoratedName(inName,type)] = this;
+		Singleton::get().frozenFunctionTable = nullptr;
 	}
 
 	Function::~Function()
@@ -47,6 +191,7 @@ namespace Intrinsics
       {
          Platform::Lock Lock(Singleton::get().mutex);
          Singleton::get().functionMap.erase(Singleton::get().functionMap.find(getDecoratedName(name,function->type)));
+         Singleton::get().frozenFunctionTable = nullptr;
       }
       delete function;
 	}
@@ -153,6 +298,27 @@ namespace Intrinsics
 		return result;
 	}
 	
+	Runtime::FunctionInstance* findFunction(const std::string& moduleName,const std::string& exportName,const IR::FunctionType* type)
+	{
+		Singleton& singleton = Singleton::get();
+
+		// Freeze the current set of intrinsic functions the first time they're looked up.
+		const FrozenFunctionTable* frozenFunctionTable = singleton.frozenFunctionTable.load(std::memory_order_acquire);
+		if(!frozenFunctionTable)
+		{
+			Platform::Lock lock(singleton.mutex);
+			frozenFunctionTable = singleton.frozenFunctionTable.load(std::memory_order_acquire);
+			if(!frozenFunctionTable)
+			{
+				singleton.frozenFunctionTables.emplace_back(new FrozenFunctionTable(singleton.functionMap));
+				frozenFunctionTable = singleton.frozenFunctionTables.back().get();
+				singleton.frozenFunctionTable.store(frozenFunctionTable,std::memory_order_release);
+			}
+		}
+
+		return frozenFunctionTable->find(moduleName,exportName,type);
+	}
+
 	std::vector<Runtime::ObjectInstance*> getAllIntrinsicObjects()
 	{
 		Platform::Lock lock(Singleton::get().mutex);
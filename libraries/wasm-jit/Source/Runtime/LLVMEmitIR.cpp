@@ -18,15 +18,24 @@ namespace LLVMJIT
 	{
 		const Module& module;
 		ModuleInstance* moduleInstance;
+		const std::vector<bool>& emitFunctionDefs;
+		const std::vector<void*>& compiledFunctionDefs;
+		ModuleProfile* profileCounters;
+		const ModuleProfile* profile;
 
 		llvm::Module* llvmModule;
-		std::vector<llvm::Function*> functionDefs;
+		std::vector<llvm::Constant*> functionDefs;
 		std::vector<llvm::Constant*> importedFunctionPointers;
 		std::vector<llvm::Constant*> globalPointers;
 		llvm::Constant* defaultTablePointer;
 		llvm::Constant* defaultTableMaxElementIndex;
 		llvm::Constant* defaultMemoryBase;
 		llvm::Constant* defaultMemoryEndOffset;
+		bool defaultMemoryNeedsBoundsChecks;
+
+		// The index of the function each element of the default table is initialized to, if the module defines the table
+		// and is compiled with a profile.
+		std::map<U32,Uptr> defaultTableFunctionIndices;
 		
 		llvm::DIBuilder diBuilder;
 		llvm::DICompileUnit* diCompileUnit;
@@ -37,9 +46,13 @@ namespace LLVMJIT
 		llvm::MDNode* likelyFalseBranchWeights;
 		llvm::MDNode* likelyTrueBranchWeights;
 
-		EmitModuleContext(const Module& inModule,ModuleInstance* inModuleInstance)
+		EmitModuleContext(const Module& inModule,ModuleInstance* inModuleInstance,const std::vector<bool>& inEmitFunctionDefs,const std::vector<void*>& inCompiledFunctionDefs,ModuleProfile* inProfileCounters,const ModuleProfile* inProfile)
 		: module(inModule)
 		, moduleInstance(inModuleInstance)
+		, emitFunctionDefs(inEmitFunctionDefs)
+		, compiledFunctionDefs(inCompiledFunctionDefs)
+		, profileCounters(inProfileCounters)
+		, profile(inProfile)
 		, llvmModule(new llvm::Module("",context))
 		, diBuilder(*llvmModule)
 		{
@@ -77,6 +90,13 @@ namespace LLVMJIT
 		llvm::Function* llvmFunction;
 		llvm::IRBuilder<> irBuilder;
 
+		// The counters the function's code increments if it collects a profile, and its profile if it's compiled with one.
+		FunctionProfile* profileCounters;
+		const FunctionProfile* profile;
+
+		// The index of the operator being emitted.
+		Uptr opIndex;
+
 		std::vector<llvm::Value*> localPointers;
 
 		llvm::DISubprogram* diFunction;
@@ -115,7 +135,7 @@ namespace LLVMJIT
 		std::vector<BranchTarget> branchTargetStack;
 		std::vector<llvm::Value*> stack;
 
-		EmitFunctionContext(EmitModuleContext& inEmitModuleContext,const Module& inModule,const FunctionDef& inFunctionDef,FunctionInstance* inFunctionInstance,llvm::Function* inLLVMFunction)
+		EmitFunctionContext(EmitModuleContext& inEmitModuleContext,const Module& inModule,const FunctionDef& inFunctionDef,FunctionInstance* inFunctionInstance,llvm::Function* inLLVMFunction,FunctionProfile* inProfileCounters,const FunctionProfile* inProfile)
 		: moduleContext(inEmitModuleContext)
 		, module(inModule)
 		, functionDef(inFunctionDef)
@@ -123,6 +143,9 @@ namespace LLVMJIT
 		, functionInstance(inFunctionInstance)
 		, llvmFunction(inLLVMFunction)
 		, irBuilder(context)
+		, profileCounters(inProfileCounters)
+		, profile(inProfile)
+		, opIndex(0)
 		{}
 
 		void emit();
@@ -234,7 +257,21 @@ namespace LLVMJIT
 
 				// If HAS_64BIT_ADDRESS_SPACE, the memory has enough virtual address space allocated to
 				// ensure that any 32-bit byte index + 32-bit offset will fall within the virtual address sandbox,
-				// so no explicit bounds check is necessary.
+				// so no explicit bounds check is necessary. Memories allocated from the slot pool only reserve
+				// enough address-space for their maximum size, so check that the access ends within it.
+				// The 32-bit index + 32-bit offset can't overflow 64-bits.
+				if(moduleContext.defaultMemoryNeedsBoundsChecks)
+				{
+					emitConditionalTrapIntrinsic(
+						irBuilder.CreateICmpUGT(
+							byteIndex,
+							irBuilder.CreateSub(
+								moduleContext.defaultMemoryEndOffset,
+								emitLiteral(Uptr(memoryType->getPrimitiveSizeInBits() / 8))
+								)
+							),
+						"wavmIntrinsics.accessViolationTrap",FunctionType::get(),{});
+				}
 			}
 			else
 			{
@@ -331,6 +368,84 @@ namespace LLVMJIT
 
 		void nop(NoImm) {}
 		void unknown(Opcode opcode) { Errors::unreachable(); }
+
+		//
+		// Profiles
+		//
+
+		// If the function collects a profile, emits code that increments the counter at index of the numCounters the
+		// operator being emitted has.
+		void emitBranchCount(Uptr numCounters,llvm::Value* index)
+		{
+			if(!profileCounters) { return; }
+			std::vector<U64>& counters = profileCounters->branchCounts[opIndex];
+			counters.resize(numCounters,0);
+			auto counterPointer = irBuilder.CreateInBoundsGEP(
+				emitLiteralPointer(counters.data(),llvmI64Type->getPointerTo()),
+				{irBuilder.CreateZExt(index,llvmI64Type)});
+			irBuilder.CreateStore(irBuilder.CreateAdd(irBuilder.CreateLoad(counterPointer),emitLiteral(U64(1))),counterPointer);
+		}
+
+		// Creates branch weights from counts, scaled down to fit in 32 bits. Returns null if all counts are zero.
+		static llvm::MDNode* createBranchWeights(const std::vector<U64>& counts)
+		{
+			U64 maxCount = 0;
+			for(U64 count : counts) { maxCount = std::max(maxCount,count); }
+			if(!maxCount) { return nullptr; }
+
+			const U64 divisor = maxCount / UINT32_MAX + 1;
+			std::vector<uint32_t> weights;
+			for(U64 count : counts) { weights.push_back(uint32_t(count / divisor)); }
+			return llvm::MDBuilder(context).createBranchWeights(weights);
+		}
+
+		// Returns the branch weights of the operator being emitted for its successors, whose counts in the profile are
+		// at successorCounterIndices, or null if the profile has no counts for it.
+		llvm::MDNode* getProfileBranchWeights(const std::vector<Uptr>& successorCounterIndices)
+		{
+			if(!profile) { return nullptr; }
+			auto countsIt = profile->branchCounts.find(opIndex);
+			if(countsIt == profile->branchCounts.end()) { return nullptr; }
+
+			std::vector<U64> successorCounts;
+			for(Uptr counterIndex : successorCounterIndices)
+			{
+				if(counterIndex >= countsIt->second.size()) { return nullptr; }
+				successorCounts.push_back(countsIt->second[counterIndex]);
+			}
+			return createBranchWeights(successorCounts);
+		}
+
+		// Finds the table element that at least 90% of the calls made by the call_indirect being emitted went through,
+		// if the profile has one and the element is initialized to a function the module defines with the expected type.
+		bool getDominantIndirectCallee(const FunctionType* calleeType,U32& outElementIndex,Uptr& outFunctionDefIndex,llvm::MDNode*& outBranchWeights)
+		{
+			if(!profile) { return false; }
+			auto countsIt = profile->indirectCallCounts.find(opIndex);
+			if(countsIt == profile->indirectCallCounts.end()) { return false; }
+
+			U64 totalCount = 0;
+			U64 dominantCount = 0;
+			for(const auto& elementCount : countsIt->second)
+			{
+				totalCount += elementCount.second;
+				if(elementCount.second > dominantCount)
+				{
+					dominantCount = elementCount.second;
+					outElementIndex = elementCount.first;
+				}
+			}
+			if(!dominantCount || dominantCount < totalCount - totalCount / 10) { return false; }
+
+			auto functionIndexIt = moduleContext.defaultTableFunctionIndices.find(outElementIndex);
+			if(functionIndexIt == moduleContext.defaultTableFunctionIndices.end()
+			|| functionIndexIt->second < module.functions.imports.size()) { return false; }
+			outFunctionDefIndex = functionIndexIt->second - module.functions.imports.size();
+			if(module.types[module.functions.defs[outFunctionDefIndex].type.index] != calleeType) { return false; }
+
+			outBranchWeights = createBranchWeights({dominantCount,totalCount - dominantCount});
+			return true;
+		}
 		
 		//
 		// Control structure operators
@@ -393,8 +508,9 @@ namespace LLVMJIT
 			auto endPHI = createPHI(endBlock,imm.resultType);
 
 			// Pop the if condition from the operand stack.
-			auto condition = pop();
-			irBuilder.CreateCondBr(coerceI32ToBool(condition),thenBlock,elseBlock);
+			auto condition = coerceI32ToBool(pop());
+			emitBranchCount(2,condition);
+			irBuilder.CreateCondBr(condition,thenBlock,elseBlock,getProfileBranchWeights({1,0}));
 			
 			// Switch the IR builder to emit the then block.
 			irBuilder.SetInsertPoint(thenBlock);
@@ -517,7 +633,8 @@ namespace LLVMJIT
 		void br_if(BranchImm imm)
 		{
 			// Pop the condition from operand stack.
-			auto condition = pop();
+			auto condition = coerceI32ToBool(pop());
+			emitBranchCount(2,condition);
 
 			BranchTarget& target = getBranchTargetByDepth(imm.targetDepth);
 			if(target.argumentType != ResultType::none)
@@ -531,7 +648,7 @@ namespace LLVMJIT
 			auto falseBlock = llvm::BasicBlock::Create(context,"br_ifElse",llvmFunction);
 
 			// Emit a conditional branch to either the falseBlock or the target block.
-			irBuilder.CreateCondBr(coerceI32ToBool(condition),target.block,falseBlock);
+			irBuilder.CreateCondBr(condition,target.block,falseBlock,getProfileBranchWeights({1,0}));
 
 			// Resume emitting instructions in the falseBlock.
 			irBuilder.SetInsertPoint(falseBlock);
@@ -569,10 +686,19 @@ namespace LLVMJIT
 				defaultTarget.phi->addIncoming(argument,irBuilder.GetInsertBlock());
 			}
 
-			// Create a LLVM switch instruction.
+			// Count the target that's chosen, the default target last.
 			WAVM_ASSERT_THROW(imm.branchTableIndex < functionDef.branchTables.size());
 			const std::vector<U32>& targetDepths = functionDef.branchTables[imm.branchTableIndex];
-			auto llvmSwitch = irBuilder.CreateSwitch(index,defaultTarget.block,(unsigned int)targetDepths.size());
+			if(profileCounters)
+			{
+				auto numTargets = emitLiteral(U32(targetDepths.size()));
+				emitBranchCount(targetDepths.size() + 1,irBuilder.CreateSelect(irBuilder.CreateICmpULT(index,numTargets),index,numTargets));
+			}
+
+			// Create a LLVM switch instruction, weighted with the profile's counts: the default target's come first.
+			std::vector<Uptr> successorCounterIndices = {targetDepths.size()};
+			for(Uptr targetIndex = 0;targetIndex < targetDepths.size();++targetIndex) { successorCounterIndices.push_back(targetIndex); }
+			auto llvmSwitch = irBuilder.CreateSwitch(index,defaultTarget.block,(unsigned int)targetDepths.size(),getProfileBranchWeights(successorCounterIndices));
 
 			for(Uptr targetIndex = 0;targetIndex < targetDepths.size();++targetIndex)
 			{
@@ -633,6 +759,94 @@ namespace LLVMJIT
 		// Call operators
 		//
 
+		// Combines the low and high 64-bit words of a 128-bit integer.
+		llvm::Value* emitI128(llvm::Value* low,llvm::Value* high)
+		{
+			return irBuilder.CreateOr(
+				irBuilder.CreateShl(irBuilder.CreateZExt(high,llvmI128Type),emitLiteral128(64)),
+				irBuilder.CreateZExt(low,llvmI128Type)
+				);
+		}
+
+		llvm::Constant* emitLiteral128(U64 low,U64 high = 0)
+		{
+			const U64 words[2] = {low,high};
+			return llvm::ConstantInt::get(llvmI128Type,llvm::APInt(128,llvm::ArrayRef<U64>(words,2)));
+		}
+
+		// Compilers lower 128-bit integer arithmetic to calls to builtins, which contracts import from the env module. Each
+		// builtin takes the address to write the 128-bit result to, followed by the operands as pairs of 64-bit words. If
+		// inlining them is enabled, emit the equivalent i128 operation inline. When the host implementation would fail,
+		// because the result address is null or outside the memory or the divisor is zero, call it instead, so the failure
+		// is reported by the host the same way it is without inlining.
+		bool emitInt128Builtin(const Import<IndexedFunctionType>& functionImport,llvm::Value* callee,const FunctionType* calleeType)
+		{
+			const std::string& name = functionImport.exportName;
+			if(!moduleContext.moduleInstance->defaultMemory || !isInt128Builtin(functionImport,calleeType)) { return false; }
+
+			// Pop the operands and the result address.
+			llvm::Value* operands[5];
+			const Uptr numOperands = calleeType->parameters.size();
+			popMultiple(operands,numOperands);
+			auto resultAddress = operands[0];
+			auto left = emitI128(operands[1],operands[2]);
+			auto right = emitI128(operands[3],operands[4]);
+
+			// Check the result address the same way the host converts it to a reference: it may not be null, and the 16
+			// bytes written must end before the last byte of the memory.
+			llvm::Type* iptrType = sizeof(Uptr) == 4 ? llvmI32Type : llvmI64Type;
+			auto resultByteIndex = irBuilder.CreateZExt(resultAddress,iptrType);
+			auto memoryNumPages = irBuilder.CreateLoad(emitLiteralPointer(
+				&moduleContext.moduleInstance->defaultMemory->numPages,
+				iptrType->getPointerTo()));
+			auto isHostCall = irBuilder.CreateOr(
+				irBuilder.CreateICmpEQ(resultAddress,emitLiteral(U32(0))),
+				irBuilder.CreateICmpUGE(
+					irBuilder.CreateAdd(resultByteIndex,llvm::ConstantInt::get(iptrType,16)),
+					irBuilder.CreateShl(memoryNumPages,llvm::ConstantInt::get(iptrType,IR::numBytesPerPageLog2))
+					)
+				);
+			if(name != "__multi3") { isHostCall = irBuilder.CreateOr(isHostCall,irBuilder.CreateICmpEQ(right,emitLiteral128(0))); }
+
+			auto hostCallBlock = llvm::BasicBlock::Create(context,"int128HostCall",llvmFunction);
+			auto inlineBlock = llvm::BasicBlock::Create(context,"int128Inline",llvmFunction);
+			auto endBlock = llvm::BasicBlock::Create(context,"int128End",llvmFunction);
+			irBuilder.CreateCondBr(isHostCall,hostCallBlock,inlineBlock,moduleContext.likelyFalseBranchWeights);
+
+			irBuilder.SetInsertPoint(hostCallBlock);
+			irBuilder.CreateCall(callee,llvm::ArrayRef<llvm::Value*>(operands,numOperands));
+			irBuilder.CreateBr(endBlock);
+
+			irBuilder.SetInsertPoint(inlineBlock);
+			llvm::Value* result;
+			if(name == "__multi3") { result = irBuilder.CreateMul(left,right); }
+			else if(name == "__udivti3") { result = irBuilder.CreateUDiv(left,right); }
+			else if(name == "__umodti3") { result = irBuilder.CreateURem(left,right); }
+			else
+			{
+				// LLVM's sdiv and srem are undefined for INT128_MIN / -1. The host implementations wrap, giving a quotient of
+				// INT128_MIN and a remainder of 0, so divide by 1 instead and select those results.
+				auto isOverflow = irBuilder.CreateAnd(
+					irBuilder.CreateICmpEQ(left,emitLiteral128(0,U64(1) << 63)),
+					irBuilder.CreateICmpEQ(right,emitLiteral128(UINT64_MAX,UINT64_MAX))
+					);
+				auto safeRight = irBuilder.CreateSelect(isOverflow,emitLiteral128(1),right);
+				if(name == "__divti3") { result = irBuilder.CreateSDiv(left,safeRight); }
+				else { result = irBuilder.CreateSelect(isOverflow,emitLiteral128(0),irBuilder.CreateSRem(left,safeRight)); }
+			}
+
+			auto resultPointer = irBuilder.CreatePointerCast(
+				irBuilder.CreateInBoundsGEP(moduleContext.defaultMemoryBase,resultByteIndex),
+				llvmI128Type->getPointerTo());
+			auto store = irBuilder.CreateStore(result,resultPointer);
+			store->setVolatile(true);
+			store->setAlignment(1);
+			irBuilder.CreateBr(endBlock);
+
+			irBuilder.SetInsertPoint(endBlock);
+			return true;
+		}
+
 		void call(CallImm imm)
 		{
 			// Map the callee function index to either an imported function pointer or a function in this module.
@@ -643,11 +857,15 @@ namespace LLVMJIT
 				WAVM_ASSERT_THROW(imm.functionIndex < moduleContext.moduleInstance->functions.size());
 				callee = moduleContext.importedFunctionPointers[imm.functionIndex];
 				calleeType = moduleContext.moduleInstance->functions[imm.functionIndex]->type;
+
+				WAVM_ASSERT_THROW(imm.functionIndex < module.functions.imports.size());
+				if(emitInt128Builtin(module.functions.imports[imm.functionIndex],callee,calleeType)) { return; }
 			}
 			else
 			{
 				const Uptr calleeIndex = imm.functionIndex - moduleContext.importedFunctionPointers.size();
 				WAVM_ASSERT_THROW(calleeIndex < moduleContext.functionDefs.size());
+				WAVM_ASSERT_THROW(moduleContext.functionDefs[calleeIndex]);
 				callee = moduleContext.functionDefs[calleeIndex];
 				calleeType = module.types[module.functions.defs[calleeIndex].type.index];
 			}
@@ -676,6 +894,30 @@ namespace LLVMJIT
 			auto llvmArgs = (llvm::Value**)alloca(sizeof(llvm::Value*) * calleeType->parameters.size());
 			popMultiple(llvmArgs,calleeType->parameters.size());
 
+			// If most of the calls the profile counted went through one table element, call the element's function
+			// directly if the index is that element's, and through the table otherwise.
+			U32 dominantElementIndex;
+			Uptr dominantFunctionDefIndex;
+			llvm::MDNode* dominantBranchWeights;
+			llvm::BasicBlock* directCallBlock = nullptr;
+			llvm::Value* directCallResult = nullptr;
+			llvm::BasicBlock* endBlock = nullptr;
+			if(getDominantIndirectCallee(calleeType,dominantElementIndex,dominantFunctionDefIndex,dominantBranchWeights))
+			{
+				directCallBlock = llvm::BasicBlock::Create(context,"call_indirectDirect",llvmFunction);
+				auto tableCallBlock = llvm::BasicBlock::Create(context,"call_indirectTable",llvmFunction);
+				endBlock = llvm::BasicBlock::Create(context,"call_indirectEnd",llvmFunction);
+				irBuilder.CreateCondBr(
+					irBuilder.CreateICmpEQ(tableElementIndex,emitLiteral(dominantElementIndex)),
+					directCallBlock,tableCallBlock,dominantBranchWeights);
+
+				irBuilder.SetInsertPoint(directCallBlock);
+				directCallResult = irBuilder.CreateCall(moduleContext.functionDefs[dominantFunctionDefIndex],llvm::ArrayRef<llvm::Value*>(llvmArgs,calleeType->parameters.size()));
+				irBuilder.CreateBr(endBlock);
+
+				irBuilder.SetInsertPoint(tableCallBlock);
+			}
+
 			// Zero extend the function index to the pointer size.
 			auto functionIndexZExt = irBuilder.CreateZExt(tableElementIndex,sizeof(Uptr) == 4 ? llvmI32Type : llvmI64Type);
 			
@@ -699,10 +941,35 @@ namespace LLVMJIT
 					emitLiteral(reinterpret_cast<U64>(moduleContext.moduleInstance->defaultTable))	}
 				);
 
+			// If the module collects a profile, count the call through the element.
+			if(profileCounters)
+			{
+				std::map<U32,U64>& counts = profileCounters->indirectCallCounts[opIndex];
+				emitRuntimeIntrinsic(
+					"wavmIntrinsics.countIndirectCall",
+					FunctionType::get(ResultType::none,{ValueType::i32,ValueType::i64}),
+					{tableElementIndex,emitLiteral(reinterpret_cast<U64>(&counts))});
+			}
+
 			// Call the function loaded from the table.
 			auto functionPointerPointer = irBuilder.CreateInBoundsGEP(moduleContext.defaultTablePointer,{functionIndexZExt,emitLiteral((U32)1)});
 			auto functionPointer = irBuilder.CreateLoad(irBuilder.CreatePointerCast(functionPointerPointer,functionPointerType));
-			auto result = irBuilder.CreateCall(functionPointer,llvm::ArrayRef<llvm::Value*>(llvmArgs,calleeType->parameters.size()));
+			llvm::Value* result = irBuilder.CreateCall(functionPointer,llvm::ArrayRef<llvm::Value*>(llvmArgs,calleeType->parameters.size()));
+
+			// Join the direct call's result with the call through the table's.
+			if(directCallBlock)
+			{
+				auto tableCallEndBlock = irBuilder.GetInsertBlock();
+				irBuilder.CreateBr(endBlock);
+				irBuilder.SetInsertPoint(endBlock);
+				if(calleeType->ret != ResultType::none)
+				{
+					auto resultPHI = irBuilder.CreatePHI(asLLVMType(calleeType->ret),2);
+					resultPHI->addIncoming(directCallResult,directCallBlock);
+					resultPHI->addIncoming(result,tableCallEndBlock);
+					result = resultPHI;
+				}
+			}
 
 			// Push the result on the operand stack.
 			if(calleeType->ret != ResultType::none) { push(result); }
@@ -767,6 +1034,51 @@ namespace LLVMJIT
 			push(currentNumPages);
 		}
 
+		//
+		// Bulk memory operators
+		// These check that the bytes they go through are within the default memory's current size before touching any of
+		// them, so they trap without a partial write, and then are lowered to LLVM's memmove and memset.
+		//
+
+		llvm::Value* coerceBulkMemoryRangeToPointer(llvm::Value* byteIndex,llvm::Value* numBytes)
+		{
+			// The 32-bit index + 32-bit length can't overflow 64-bits.
+			byteIndex = irBuilder.CreateZExt(byteIndex,llvmI64Type);
+			auto endByteIndex = irBuilder.CreateAdd(byteIndex,irBuilder.CreateZExt(numBytes,llvmI64Type));
+
+			// Load the number of pages the memory has now, since grow_memory may have changed it since the code was compiled.
+			llvm::Type* iptrType = sizeof(Uptr) == 4 ? llvmI32Type : llvmI64Type;
+			auto numPagesPointer = emitLiteralPointer(&moduleContext.moduleInstance->defaultMemory->numPages,iptrType->getPointerTo());
+			auto numPages = irBuilder.CreateLoad(numPagesPointer);
+			numPages->setVolatile(true);
+			auto numMemoryBytes = irBuilder.CreateShl(
+				irBuilder.CreateZExtOrBitCast(numPages,llvmI64Type),
+				emitLiteral(U64(IR::numBytesPerPageLog2)));
+			emitConditionalTrapIntrinsic(
+				irBuilder.CreateICmpUGT(endByteIndex,numMemoryBytes),
+				"wavmIntrinsics.accessViolationTrap",FunctionType::get(),{});
+
+			return irBuilder.CreateInBoundsGEP(moduleContext.defaultMemoryBase,byteIndex);
+		}
+
+		void memory_copy(MemoryCopyImm)
+		{
+			auto numBytes = pop();
+			auto sourceIndex = pop();
+			auto destIndex = pop();
+			auto sourcePointer = coerceBulkMemoryRangeToPointer(sourceIndex,numBytes);
+			auto destPointer = coerceBulkMemoryRangeToPointer(destIndex,numBytes);
+			irBuilder.CreateMemMove(destPointer,sourcePointer,irBuilder.CreateZExt(numBytes,llvmI64Type),1,true);
+		}
+		void memory_fill(MemoryImm)
+		{
+			auto numBytes = pop();
+			auto value = pop();
+			auto destIndex = pop();
+			auto destPointer = coerceBulkMemoryRangeToPointer(destIndex,numBytes);
+			irBuilder.CreateMemSet(destPointer,irBuilder.CreateTrunc(value,llvmI8Type),irBuilder.CreateZExt(numBytes,llvmI64Type),1,true);
+		}
+
 		//
 		// Constant operators
 		//
@@ -992,27 +1304,94 @@ namespace LLVMJIT
 		EMIT_INT_UNARY_OP(trunc_u_f64,emitRuntimeIntrinsic("wavmIntrinsics.floatToUnsignedInt",FunctionType::get(asResultType(type),{ValueType::f64}),{operand}))
 
 		#if ENABLE_SIMD_PROTOTYPE
-		llvm::Value* emitAnyTrue(llvm::Value* boolVector)
+		// Pushes a v128 value as the <2 x i64> that all v128 values are represented as, so values computed in another
+		// lane type can flow into locals, phis and stores. Comparisons yield a lane of all ones or all zeros.
+		void pushVector(llvm::Value* vector)
 		{
-			const Uptr numLanes = boolVector->getType()->getVectorNumElements();
-			llvm::Value* result = nullptr;
-			for(Uptr laneIndex = 0;laneIndex < numLanes;++laneIndex)
+			if(vector->getType()->getScalarType() == llvmBoolType)
 			{
-				llvm::Value* scalar = irBuilder.CreateExtractElement(boolVector,laneIndex);
-				result = result ? irBuilder.CreateOr(result,scalar) : scalar;
+				switch(vector->getType()->getVectorNumElements())
+				{
+				case 16: vector = irBuilder.CreateSExt(vector,llvmI8x16Type); break;
+				case 8: vector = irBuilder.CreateSExt(vector,llvmI16x8Type); break;
+				case 4: vector = irBuilder.CreateSExt(vector,llvmI32x4Type); break;
+				case 2: vector = irBuilder.CreateSExt(vector,llvmI64x2Type); break;
+				default: Errors::unreachable();
+				};
 			}
-			return result;
+			push(irBuilder.CreateBitCast(vector,llvmI64x2Type));
+		}
+
+		llvm::Value* emitAnyTrue(llvm::Value* vector)
+		{
+			auto bits = irBuilder.CreateBitCast(vector,llvmI128Type);
+			return irBuilder.CreateZExt(
+				irBuilder.CreateICmpNE(bits,llvm::ConstantInt::get(llvmI128Type,0)),
+				llvmI32Type);
 		}
-		llvm::Value* emitAllTrue(llvm::Value* boolVector)
+		llvm::Value* emitAllTrue(llvm::Value* vector)
 		{
-			const Uptr numLanes = boolVector->getType()->getVectorNumElements();
-			llvm::Value* result = nullptr;
-			for(Uptr laneIndex = 0;laneIndex < numLanes;++laneIndex)
-			{
-				llvm::Value* scalar = irBuilder.CreateExtractElement(boolVector,laneIndex);
-				result = result ? irBuilder.CreateAnd(result,scalar) : scalar;
-			}
-			return result;
+			auto laneIsTrue = irBuilder.CreateSExt(
+				irBuilder.CreateICmpNE(vector,llvm::Constant::getNullValue(vector->getType())),
+				vector->getType());
+			auto bits = irBuilder.CreateBitCast(laneIsTrue,llvmI128Type);
+			return irBuilder.CreateZExt(
+				irBuilder.CreateICmpEQ(bits,llvm::Constant::getAllOnesValue(llvmI128Type)),
+				llvmI32Type);
+		}
+
+		// Like the scalar shifts, the shift count of each lane wraps at the lane's bit width.
+		llvm::Value* emitLaneShiftCountMask(llvm::Value* shiftCount)
+		{
+			auto vectorType = llvm::cast<llvm::VectorType>(shiftCount->getType());
+			auto bitsMinusOne = llvm::ConstantInt::get(vectorType,vectorType->getScalarSizeInBits() - 1);
+			return irBuilder.CreateAnd(shiftCount,bitsMinusOne);
+		}
+
+		// The saturating operators clamp a lane that overflows to the lane type's minimum or maximum value.
+		llvm::Value* emitAddSaturateS(llvm::Value* left,llvm::Value* right)
+		{
+			auto vectorType = left->getType();
+			auto sum = irBuilder.CreateAdd(left,right);
+			auto zero = llvm::Constant::getNullValue(vectorType);
+			auto overflowed = irBuilder.CreateICmpSLT(
+				irBuilder.CreateAnd(irBuilder.CreateXor(sum,left),irBuilder.CreateXor(sum,right)),
+				zero);
+			return irBuilder.CreateSelect(overflowed,emitSaturatedValue(left),sum);
+		}
+		llvm::Value* emitSubSaturateS(llvm::Value* left,llvm::Value* right)
+		{
+			auto vectorType = left->getType();
+			auto difference = irBuilder.CreateSub(left,right);
+			auto zero = llvm::Constant::getNullValue(vectorType);
+			auto overflowed = irBuilder.CreateICmpSLT(
+				irBuilder.CreateAnd(irBuilder.CreateXor(left,right),irBuilder.CreateXor(left,difference)),
+				zero);
+			return irBuilder.CreateSelect(overflowed,emitSaturatedValue(left),difference);
+		}
+		// The value a signed lane saturates to: the minimum if the left operand is negative, the maximum otherwise.
+		llvm::Value* emitSaturatedValue(llvm::Value* left)
+		{
+			auto vectorType = llvm::cast<llvm::VectorType>(left->getType());
+			const unsigned laneBits = vectorType->getScalarSizeInBits();
+			auto sign = irBuilder.CreateAShr(left,llvm::ConstantInt::get(vectorType,laneBits - 1));
+			auto maxValue = llvm::ConstantInt::get(vectorType,llvm::APInt::getSignedMaxValue(laneBits));
+			return irBuilder.CreateXor(sign,maxValue);
+		}
+		llvm::Value* emitAddSaturateU(llvm::Value* left,llvm::Value* right)
+		{
+			auto sum = irBuilder.CreateAdd(left,right);
+			return irBuilder.CreateSelect(
+				irBuilder.CreateICmpULT(sum,left),
+				llvm::Constant::getAllOnesValue(left->getType()),
+				sum);
+		}
+		llvm::Value* emitSubSaturateU(llvm::Value* left,llvm::Value* right)
+		{
+			return irBuilder.CreateSelect(
+				irBuilder.CreateICmpULT(left,right),
+				llvm::Constant::getNullValue(left->getType()),
+				irBuilder.CreateSub(left,right));
 		}
 
 		llvm::Value* unimplemented()
@@ -1024,7 +1403,7 @@ namespace LLVMJIT
 			void vectorType##_splat(NoImm) \
 			{ \
 				auto scalar = pop(); \
-				push(irBuilder.CreateVectorSplat(numLanes,coerceScalar)); \
+				pushVector(irBuilder.CreateVectorSplat(numLanes,coerceScalar)); \
 			}
 		EMIT_SIMD_SPLAT(i8x16,irBuilder.CreateTrunc(scalar,llvmI8Type),16)
 		EMIT_SIMD_SPLAT(i16x8,irBuilder.CreateTrunc(scalar,llvmI16Type),8)
@@ -1041,13 +1420,13 @@ namespace LLVMJIT
 			{ \
 				auto right = irBuilder.CreateBitCast(pop(),llvmType); SUPPRESS_UNUSED(right); \
 				auto left = irBuilder.CreateBitCast(pop(),llvmType); SUPPRESS_UNUSED(left); \
-				push(emitCode); \
+				pushVector(emitCode); \
 			}
 		#define EMIT_SIMD_UNARY_OP(name,llvmType,emitCode) \
 			void name(NoImm) \
 			{ \
 				auto operand = irBuilder.CreateBitCast(pop(),llvmType); SUPPRESS_UNUSED(operand); \
-				push(emitCode); \
+				pushVector(emitCode); \
 			}
 		#define EMIT_SIMD_INT_BINARY_OP(name,emitCode) \
 			EMIT_SIMD_BINARY_OP(i8x16##_##name,llvmI8x16Type,emitCode) \
@@ -1068,9 +1447,9 @@ namespace LLVMJIT
 		EMIT_SIMD_INT_BINARY_OP(add,irBuilder.CreateAdd(left,right))
 		EMIT_SIMD_INT_BINARY_OP(sub,irBuilder.CreateSub(left,right))
 
-		EMIT_SIMD_INT_BINARY_OP(shl,irBuilder.CreateShl(left,right))
-		EMIT_SIMD_INT_BINARY_OP(shr_s,irBuilder.CreateAShr(left,right))
-		EMIT_SIMD_INT_BINARY_OP(shr_u,irBuilder.CreateLShr(left,right))
+		EMIT_SIMD_INT_BINARY_OP(shl,irBuilder.CreateShl(left,emitLaneShiftCountMask(right)))
+		EMIT_SIMD_INT_BINARY_OP(shr_s,irBuilder.CreateAShr(left,emitLaneShiftCountMask(right)))
+		EMIT_SIMD_INT_BINARY_OP(shr_u,irBuilder.CreateLShr(left,emitLaneShiftCountMask(right)))
 		EMIT_SIMD_INT_BINARY_OP(mul,irBuilder.CreateMul(left,right))
 		EMIT_SIMD_INT_BINARY_OP(div_s,irBuilder.CreateSDiv(left,right))
 		EMIT_SIMD_INT_BINARY_OP(div_u,irBuilder.CreateUDiv(left,right))
@@ -1088,14 +1467,14 @@ namespace LLVMJIT
 
 		EMIT_SIMD_INT_UNARY_OP(neg,irBuilder.CreateNeg(operand))
 
-		EMIT_SIMD_BINARY_OP(i8x16_add_saturate_s,llvmI8x16Type,unimplemented())
-		EMIT_SIMD_BINARY_OP(i8x16_add_saturate_u,llvmI16x8Type,unimplemented())
-		EMIT_SIMD_BINARY_OP(i8x16_sub_saturate_s,llvmI8x16Type,unimplemented())
-		EMIT_SIMD_BINARY_OP(i8x16_sub_saturate_u,llvmI16x8Type,unimplemented())
-		EMIT_SIMD_BINARY_OP(i16x8_add_saturate_s,llvmI8x16Type,unimplemented())
-		EMIT_SIMD_BINARY_OP(i16x8_add_saturate_u,llvmI16x8Type,unimplemented())
-		EMIT_SIMD_BINARY_OP(i16x8_sub_saturate_s,llvmI8x16Type,unimplemented())
-		EMIT_SIMD_BINARY_OP(i16x8_sub_saturate_u,llvmI16x8Type,unimplemented())
+		EMIT_SIMD_BINARY_OP(i8x16_add_saturate_s,llvmI8x16Type,emitAddSaturateS(left,right))
+		EMIT_SIMD_BINARY_OP(i8x16_add_saturate_u,llvmI8x16Type,emitAddSaturateU(left,right))
+		EMIT_SIMD_BINARY_OP(i8x16_sub_saturate_s,llvmI8x16Type,emitSubSaturateS(left,right))
+		EMIT_SIMD_BINARY_OP(i8x16_sub_saturate_u,llvmI8x16Type,emitSubSaturateU(left,right))
+		EMIT_SIMD_BINARY_OP(i16x8_add_saturate_s,llvmI16x8Type,emitAddSaturateS(left,right))
+		EMIT_SIMD_BINARY_OP(i16x8_add_saturate_u,llvmI16x8Type,emitAddSaturateU(left,right))
+		EMIT_SIMD_BINARY_OP(i16x8_sub_saturate_s,llvmI16x8Type,emitSubSaturateS(left,right))
+		EMIT_SIMD_BINARY_OP(i16x8_sub_saturate_u,llvmI16x8Type,emitSubSaturateU(left,right))
 
 		EMIT_SIMD_UNARY_OP(i32x4_trunc_s_f32x4_sat,llvmF32x4Type,unimplemented());
 		EMIT_SIMD_UNARY_OP(i32x4_trunc_u_f32x4_sat,llvmF32x4Type,unimplemented());
@@ -1125,15 +1504,21 @@ namespace LLVMJIT
 		EMIT_SIMD_UNARY_OP(f64x2_convert_s_i64x2,llvmI64x2Type,irBuilder.CreateSIToFP(operand,llvmF64x2Type));
 		EMIT_SIMD_UNARY_OP(f64x2_convert_u_i64x2,llvmI64x2Type,irBuilder.CreateUIToFP(operand,llvmF64x2Type));
 
-		EMIT_SIMD_UNARY_OP(i8x16_any_true,llvmI8x16Type,emitAnyTrue(operand))
-		EMIT_SIMD_UNARY_OP(i16x8_any_true,llvmI16x8Type,emitAnyTrue(operand))
-		EMIT_SIMD_UNARY_OP(i32x4_any_true,llvmI32x4Type,emitAnyTrue(operand))
-		EMIT_SIMD_UNARY_OP(i64x2_any_true,llvmI64x2Type,emitAnyTrue(operand))
+		#define EMIT_SIMD_REDUCE_OP(name,llvmType,emitCode) \
+			void name(NoImm) \
+			{ \
+				auto operand = irBuilder.CreateBitCast(pop(),llvmType); \
+				push(emitCode); \
+			}
+		EMIT_SIMD_REDUCE_OP(i8x16_any_true,llvmI8x16Type,emitAnyTrue(operand))
+		EMIT_SIMD_REDUCE_OP(i16x8_any_true,llvmI16x8Type,emitAnyTrue(operand))
+		EMIT_SIMD_REDUCE_OP(i32x4_any_true,llvmI32x4Type,emitAnyTrue(operand))
+		EMIT_SIMD_REDUCE_OP(i64x2_any_true,llvmI64x2Type,emitAnyTrue(operand))
 
-		EMIT_SIMD_UNARY_OP(i8x16_all_true,llvmI8x16Type,emitAllTrue(operand))
-		EMIT_SIMD_UNARY_OP(i16x8_all_true,llvmI16x8Type,emitAllTrue(operand))
-		EMIT_SIMD_UNARY_OP(i32x4_all_true,llvmI32x4Type,emitAllTrue(operand))
-		EMIT_SIMD_UNARY_OP(i64x2_all_true,llvmI64x2Type,emitAllTrue(operand))
+		EMIT_SIMD_REDUCE_OP(i8x16_all_true,llvmI8x16Type,emitAllTrue(operand))
+		EMIT_SIMD_REDUCE_OP(i16x8_all_true,llvmI16x8Type,emitAllTrue(operand))
+		EMIT_SIMD_REDUCE_OP(i32x4_all_true,llvmI32x4Type,emitAllTrue(operand))
+		EMIT_SIMD_REDUCE_OP(i64x2_all_true,llvmI64x2Type,emitAllTrue(operand))
 
 		void v128_and(NoImm)
 		{
@@ -1179,9 +1564,9 @@ namespace LLVMJIT
 		#define EMIT_SIMD_REPLACE_LANE_OP(typePrefix,llvmType,numLanes,coerceScalar) \
 			void typePrefix##_replace_lane(LaneIndexImm<numLanes> imm) \
 			{ \
-				auto vector = irBuilder.CreateBitCast(pop(),llvmType); \
 				auto scalar = pop(); \
-				push(irBuilder.CreateInsertElement(vector,coerceScalar,imm.laneIndex)); \
+				auto vector = irBuilder.CreateBitCast(pop(),llvmType); \
+				pushVector(irBuilder.CreateInsertElement(vector,coerceScalar,imm.laneIndex)); \
 			}
 
 		EMIT_SIMD_REPLACE_LANE_OP(i8x16,llvmI8x16Type,16,irBuilder.CreateTrunc(scalar,llvmI8Type))
@@ -1201,7 +1586,7 @@ namespace LLVMJIT
 			{
 				laneIndices[laneIndex] = imm.laneIndices[laneIndex];
 			}
-			push(irBuilder.CreateShuffleVector(left,right,llvm::ArrayRef<unsigned int>(laneIndices,16)));
+			pushVector(irBuilder.CreateShuffleVector(left,right,llvm::ArrayRef<unsigned int>(laneIndices,16)));
 		}
 		
 		void v128_const(LiteralImm<V128> imm)
@@ -1540,14 +1925,25 @@ namespace LLVMJIT
 			}
 		}
 
+		// Take a call from the call depth budget until the function returns, or trap if the budget is exhausted. This comes
+		// after the local allocas, which must stay in the entry block to be promoted to registers. The budget is thread-local,
+		// so its address is looked up once per call rather than baked into the code.
+		auto callDepthBudgetPointer = irBuilder.CreateIntToPtr(
+			emitRuntimeIntrinsic("wavmIntrinsics.getCallDepthBudgetAddress",FunctionType::get(ResultType::i64),{}),
+			llvmI32Type->getPointerTo());
+		auto callDepthBudget = irBuilder.CreateLoad(callDepthBudgetPointer);
+		emitConditionalTrapIntrinsic(
+			irBuilder.CreateICmpEQ(callDepthBudget,emitLiteral(U32(0))),
+			"wavmIntrinsics.callStackExhaustedTrap",FunctionType::get(),{});
+		irBuilder.CreateStore(irBuilder.CreateSub(callDepthBudget,emitLiteral(U32(1))),callDepthBudgetPointer);
+
 		// Decode the WebAssembly opcodes and emit LLVM IR for them.
 		OperatorDecoderStream decoder(functionDef.code);
 		UnreachableOpVisitor unreachableOpVisitor(*this);
 		OperatorPrinter operatorPrinter(module,functionDef);
-		Uptr opIndex = 0;
 		while(decoder && controlStack.size())
 		{
-			irBuilder.SetCurrentDebugLocation(llvm::DILocation::get(context,(unsigned int)opIndex++,0,diFunction));
+			irBuilder.SetCurrentDebugLocation(llvm::DILocation::get(context,(unsigned int)opIndex,0,diFunction));
 			if(ENABLE_LOGGING)
 			{
 				logOperator(decoder.decodeOpWithoutConsume(operatorPrinter));
@@ -1555,6 +1951,7 @@ namespace LLVMJIT
 
 			if(controlStack.back().isReachable) { decoder.decodeOp(*this); }
 			else { decoder.decodeOp(unreachableOpVisitor); }
+			++opIndex;
 		};
 		WAVM_ASSERT_THROW(irBuilder.GetInsertBlock() == returnBlock);
 		
@@ -1568,6 +1965,9 @@ namespace LLVMJIT
 				);
 		}
 
+		// Give the call back to the call depth budget.
+		irBuilder.CreateStore(callDepthBudget,callDepthBudgetPointer);
+
 		// Emit the function return.
 		if(functionType->ret == ResultType::none) { irBuilder.CreateRetVoid(); }
 		else { irBuilder.CreateRet(pop()); }
@@ -1583,8 +1983,13 @@ namespace LLVMJIT
 			defaultMemoryBase = emitLiteralPointer(moduleInstance->defaultMemory->baseAddress,llvmI8PtrType);
 			const Uptr defaultMemoryEndOffsetValue = Uptr(moduleInstance->defaultMemory->endOffset);
 			defaultMemoryEndOffset = emitLiteral(defaultMemoryEndOffsetValue);
+			defaultMemoryNeedsBoundsChecks = moduleInstance->defaultMemory->isPooled;
+		}
+		else
+		{
+			defaultMemoryBase = defaultMemoryEndOffset = nullptr;
+			defaultMemoryNeedsBoundsChecks = false;
 		}
-		else { defaultMemoryBase = defaultMemoryEndOffset = nullptr; }
 
 		// Set up the LLVM values used to access the global table.
 		if(moduleInstance->defaultTable)
@@ -1601,6 +2006,25 @@ namespace LLVMJIT
 			defaultTablePointer = defaultTableMaxElementIndex = nullptr;
 		}
 
+		// Find the function each element of the default table is initialized to, for calling the dominant targets of
+		// indirect calls directly. Only the elements of a table the module defines, initialized at constant offsets, can't
+		// change before the code runs.
+		if(profile && module.tables.defs.size() && !module.tables.imports.size())
+		{
+			for(const TableSegment& tableSegment : module.tableSegments)
+			{
+				if(tableSegment.baseOffset.type != InitializerExpression::Type::i32_const)
+				{
+					defaultTableFunctionIndices.clear();
+					break;
+				}
+				for(Uptr index = 0;index < tableSegment.indices.size();++index)
+				{
+					defaultTableFunctionIndices[U32(tableSegment.baseOffset.i32 + index)] = tableSegment.indices[index];
+				}
+			}
+		}
+
 		// Create LLVM pointer constants for the module's imported functions.
 		for(Uptr functionIndex = 0;functionIndex < module.functions.imports.size();++functionIndex)
 		{
@@ -1612,18 +2036,40 @@ namespace LLVMJIT
 		for(auto global : moduleInstance->globals)
 		{ globalPointers.push_back(emitLiteralPointer(&global->value,asLLVMType(global->type.valueType)->getPointerTo())); }
 		
-		// Create the LLVM functions.
+		// Create the LLVM functions for the function bodies to emit, and pointer constants for the functions that are
+		// already compiled.
+		WAVM_ASSERT_THROW(emitFunctionDefs.size() == module.functions.defs.size());
+		WAVM_ASSERT_THROW(compiledFunctionDefs.size() == module.functions.defs.size());
 		functionDefs.resize(module.functions.defs.size());
 		for(Uptr functionDefIndex = 0;functionDefIndex < module.functions.defs.size();++functionDefIndex)
 		{
 			auto llvmFunctionType = asLLVMType(module.types[module.functions.defs[functionDefIndex].type.index]);
-			auto externalName = getExternalFunctionName(moduleInstance,functionDefIndex);
-			functionDefs[functionDefIndex] = llvm::Function::Create(llvmFunctionType,llvm::Function::ExternalLinkage,externalName,llvmModule);
+			if(emitFunctionDefs[functionDefIndex])
+			{
+				auto externalName = getExternalFunctionName(moduleInstance,functionDefIndex);
+				functionDefs[functionDefIndex] = llvm::Function::Create(llvmFunctionType,llvm::Function::ExternalLinkage,externalName,llvmModule);
+			}
+			else if(compiledFunctionDefs[functionDefIndex])
+			{
+				functionDefs[functionDefIndex] = emitLiteralPointer(compiledFunctionDefs[functionDefIndex],llvmFunctionType->getPointerTo());
+			}
+			else { functionDefs[functionDefIndex] = nullptr; }
 		}
 
 		// Compile each function in the module.
 		for(Uptr functionDefIndex = 0;functionDefIndex < module.functions.defs.size();++functionDefIndex)
-		{ EmitFunctionContext(*this,module,module.functions.defs[functionDefIndex],moduleInstance->functionDefs[functionDefIndex],functionDefs[functionDefIndex]).emit(); }
+		{
+			if(!emitFunctionDefs[functionDefIndex]) { continue; }
+			EmitFunctionContext(
+				*this,
+				module,
+				module.functions.defs[functionDefIndex],
+				moduleInstance->functionDefs[functionDefIndex],
+				llvm::cast<llvm::Function>(functionDefs[functionDefIndex]),
+				profileCounters ? &profileCounters->functionDefs[functionDefIndex] : nullptr,
+				profile ? &profile->functionDefs[functionDefIndex] : nullptr
+				).emit();
+		}
 		
 		// Finalize the debug info.
 		diBuilder.finalize();
@@ -1633,8 +2079,25 @@ namespace LLVMJIT
 		return llvmModule;
 	}
 
-	llvm::Module* emitModule(const Module& module,ModuleInstance* moduleInstance)
+	bool isInt128Builtin(const Import<IndexedFunctionType>& functionImport,const FunctionType* calleeType)
+	{
+		const std::string& name = functionImport.exportName;
+		if(!Runtime::shouldInlineInt128Builtins || functionImport.moduleName != "env") { return false; }
+		if(name == "__multi3" || name == "__divti3" || name == "__udivti3" || name == "__modti3" || name == "__umodti3")
+		{
+			return calleeType == FunctionType::get(ResultType::none,{ValueType::i32,ValueType::i64,ValueType::i64,ValueType::i64,ValueType::i64});
+		}
+		return false;
+	}
+
+	llvm::Module* emitModule(
+		const Module& module,
+		ModuleInstance* moduleInstance,
+		const std::vector<bool>& emitFunctionDefs,
+		const std::vector<void*>& compiledFunctionDefs,
+		ModuleProfile* profileCounters,
+		const ModuleProfile* profile)
 	{
-		return EmitModuleContext(module,moduleInstance).emit();
+		return EmitModuleContext(module,moduleInstance,emitFunctionDefs,compiledFunctionDefs,profileCounters,profile).emit();
 	}
 }
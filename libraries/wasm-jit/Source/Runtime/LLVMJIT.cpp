@@ -3,8 +3,12 @@
 #include "Inline/Timing.h"
 #include "Logging/Logging.h"
 #include "RuntimePrivate.h"
+#include "IR/Operators.h"
 #include "IR/Validate.h"
 
+#include <set>
+#include <unordered_map>
+
 #ifdef _DEBUG
 	// This needs to be 1 to allow debuggers such as Visual Studio to place breakpoints and step through the JITed code.
 	#define USE_WRITEABLE_JIT_CODE_PAGES 1
@@ -35,6 +39,7 @@ namespace LLVMJIT
 	llvm::Type* llvmI16Type;
 	llvm::Type* llvmI32Type;
 	llvm::Type* llvmI64Type;
+	llvm::Type* llvmI128Type;
 	llvm::Type* llvmF32Type;
 	llvm::Type* llvmF64Type;
 	llvm::Type* llvmVoidType;
@@ -59,32 +64,219 @@ namespace LLVMJIT
 	// A map from function types to function indices in the invoke thunk unit.
 	std::map<const FunctionType*,struct JITSymbol*> invokeThunkTypeToSymbolMap;
 
+	// Guards the contents of every ModuleProfile.
+	Platform::Mutex* profileMutex = Platform::createMutex();
+
+	// Maps an offset in a JIT symbol's code to the index of the WebAssembly operator it was compiled from. The entries are
+	// sorted by offset, so the operator for an instruction pointer is found with a binary search.
+	struct OffsetToOpIndex
+	{
+		U32 offset;
+		U32 opIndex;
+	};
+	typedef std::vector<OffsetToOpIndex> OffsetToOpIndexMap;
+
 	// Information about a JIT symbol, used to map instruction pointers to descriptive names.
 	struct JITSymbol
 	{
 		enum class Type
 		{
 			functionInstance,
-			invokeThunk
+			invokeThunk,
+			sharedFunction
 		};
 		Type type;
 		union
 		{
 			FunctionInstance* functionInstance;
 			const FunctionType* invokeThunkType;
+			struct JITSharedFunction* sharedFunction;
 		};
 		Uptr baseAddress;
 		Uptr numBytes;
-		std::map<U32,U32> offsetToOpIndexMap;
+		OffsetToOpIndexMap offsetToOpIndexMap;
 		
-		JITSymbol(FunctionInstance* inFunctionInstance,Uptr inBaseAddress,Uptr inNumBytes,std::map<U32,U32>&& inOffsetToOpIndexMap)
-		: type(Type::functionInstance), functionInstance(inFunctionInstance), baseAddress(inBaseAddress), numBytes(inNumBytes), offsetToOpIndexMap(inOffsetToOpIndexMap) {}
+		JITSymbol(FunctionInstance* inFunctionInstance,Uptr inBaseAddress,Uptr inNumBytes,OffsetToOpIndexMap&& inOffsetToOpIndexMap)
+		: type(Type::functionInstance), functionInstance(inFunctionInstance), baseAddress(inBaseAddress), numBytes(inNumBytes), offsetToOpIndexMap(std::move(inOffsetToOpIndexMap)) {}
+
+		JITSymbol(const FunctionType* inInvokeThunkType,Uptr inBaseAddress,Uptr inNumBytes,OffsetToOpIndexMap&& inOffsetToOpIndexMap)
+		: type(Type::invokeThunk), invokeThunkType(inInvokeThunkType), baseAddress(inBaseAddress), numBytes(inNumBytes), offsetToOpIndexMap(std::move(inOffsetToOpIndexMap)) {}
 
-		JITSymbol(const FunctionType* inInvokeThunkType,Uptr inBaseAddress,Uptr inNumBytes,std::map<U32,U32>&& inOffsetToOpIndexMap)
-		: type(Type::invokeThunk), invokeThunkType(inInvokeThunkType), baseAddress(inBaseAddress), numBytes(inNumBytes), offsetToOpIndexMap(inOffsetToOpIndexMap) {}
+		JITSymbol(struct JITSharedFunction* inSharedFunction,Uptr inBaseAddress,Uptr inNumBytes,OffsetToOpIndexMap&& inOffsetToOpIndexMap)
+		: type(Type::sharedFunction), sharedFunction(inSharedFunction), baseAddress(inBaseAddress), numBytes(inNumBytes), offsetToOpIndexMap(std::move(inOffsetToOpIndexMap)) {}
+	};
+
+	// A compiled function whose code doesn't depend on the module instance that defined it. It is shared by all the modules
+	// that define a function with the same key: the function's type, locals, and operators, with the callees of its calls
+	// identified by their code rather than by their index in the module.
+	struct JITSharedFunction
+	{
+		// Identifies the function in the keys of its callers. IDs are never reused, so a key can't refer to a function that
+		// was freed and then replaced by a different function.
+		U64 id;
+		std::string debugName;
+		struct JITSharedUnit* unit;
+		const std::string* key;
+		void* nativeFunction;
+
+		// Whether the function's unit has finished compiling. Its key is added to the shared function map before it is
+		// compiled, so other modules don't compile it again, but they can't use it until this is set.
+		bool isCompiled;
+	};
+
+	// A map from keys to the shared functions that are currently compiled.
+	Platform::Mutex* sharedFunctionMapMutex = Platform::createMutex();
+	std::unordered_map<std::string,JITSharedFunction*> sharedFunctionMap;
+	U64 nextSharedFunctionId = 0;
+
+	// Packs the code of many JIT units into shared regions that are aligned to and advised as huge pages, so a few
+	// instruction TLB entries cover the code of many modules instead of one entry for every page of every module.
+	// Allocations are whole pages, so making one unit's pages writable while it is loaded never affects the code of another
+	// unit. Once every unit in a region has been finalized, the whole region has the same access again, which lets the OS
+	// back it with huge pages.
+	struct CodeArena
+	{
+		static CodeArena& get()
+		{
+			// The arena is never destroyed, since units may be destroyed by other static destructors.
+			static CodeArena* codeArena = new CodeArena;
+			return *codeArena;
+		}
+
+		// Allocates numPages contiguous pages, and makes them writable.
+		U8* allocate(Uptr numPages)
+		{
+			Platform::Lock lock(mutex);
+
+			U8* baseAddress = nullptr;
+			for(Region* region : regions)
+			{
+				baseAddress = region->allocate(numPages);
+				if(baseAddress) { break; }
+			}
+			if(!baseAddress)
+			{
+				// Create a new region, big enough for the allocation if it's bigger than a huge page.
+				const Uptr numRegionPages = shrAndRoundUp(numPages << Platform::getPageSizeLog2(),hugePageSizeLog2) << (hugePageSizeLog2 - Platform::getPageSizeLog2());
+				Region* region = new Region(numRegionPages);
+				regions.push_back(region);
+				baseAddress = region->allocate(numPages);
+				WAVM_ASSERT_THROW(baseAddress);
+			}
+
+			if(!Platform::setVirtualPageAccess(baseAddress,numPages,Platform::MemoryAccess::ReadWrite)) { Errors::fatal("memory allocation for JIT code failed"); }
+			return baseAddress;
+		}
+
+		// Frees pages allocated by allocate. Regions that become empty are freed, except for one to absorb churn.
+		void free(U8* baseAddress,Uptr numPages)
+		{
+			Platform::Lock lock(mutex);
+
+			// Give the pages the same access as the rest of the region, so the region can be mapped by huge pages again.
+			if(!Platform::setVirtualPageAccess(baseAddress,numPages,Platform::MemoryAccess::ReadExecute)) { Errors::fatal("mprotect failed"); }
+
+			for(Uptr regionIndex = 0;regionIndex < regions.size();++regionIndex)
+			{
+				Region* region = regions[regionIndex];
+				if(baseAddress >= region->baseAddress && baseAddress < region->baseAddress + (region->numPages << Platform::getPageSizeLog2()))
+				{
+					region->free(baseAddress,numPages);
+					if(!region->numAllocatedPages && regions.size() > 1)
+					{
+						regions.erase(regions.begin() + regionIndex);
+						delete region;
+					}
+					return;
+				}
+			}
+			Errors::unreachable();
+		}
+
+	private:
+
+		enum { hugePageSizeLog2 = 21 };
+
+		struct Region
+		{
+			U8* unalignedBaseAddress;
+			U8* baseAddress;
+			Uptr numPages;
+			Uptr numAllocatedPages;
+
+			// A map from the base address of each run of free pages to its length in pages.
+			std::map<U8*,Uptr> freeRuns;
+
+			Region(Uptr inNumPages): numPages(inNumPages), numAllocatedPages(0)
+			{
+				// The whole region is committed up front, but physical pages are only used once the code is written. The
+				// unallocated pages have the same access as finalized code, so the region starts out as a single mapping.
+				baseAddress = Platform::allocateAlignedVirtualPages(numPages,hugePageSizeLog2,unalignedBaseAddress);
+				if(!baseAddress || !Platform::commitVirtualPages(baseAddress,numPages,Platform::MemoryAccess::ReadExecute)) { Errors::fatal("memory allocation for JIT code failed"); }
+				Platform::adviseHugeVirtualPages(baseAddress,numPages);
+				freeRuns[baseAddress] = numPages;
+			}
+
+			~Region()
+			{
+				Platform::decommitVirtualPages(baseAddress,numPages);
+				Platform::freeAlignedVirtualPages(unalignedBaseAddress,numPages,hugePageSizeLog2);
+			}
+
+			U8* allocate(Uptr numAllocationPages)
+			{
+				// Use the lowest run that is big enough, which keeps the live code packed toward the start of the region.
+				for(auto freeRunIt = freeRuns.begin();freeRunIt != freeRuns.end();++freeRunIt)
+				{
+					if(freeRunIt->second >= numAllocationPages)
+					{
+						U8* allocationBaseAddress = freeRunIt->first;
+						const Uptr numRemainingPages = freeRunIt->second - numAllocationPages;
+						freeRuns.erase(freeRunIt);
+						if(numRemainingPages) { freeRuns[allocationBaseAddress + (numAllocationPages << Platform::getPageSizeLog2())] = numRemainingPages; }
+						numAllocatedPages += numAllocationPages;
+						return allocationBaseAddress;
+					}
+				}
+				return nullptr;
+			}
+
+			void free(U8* allocationBaseAddress,Uptr numAllocationPages)
+			{
+				WAVM_ASSERT_THROW(numAllocatedPages >= numAllocationPages);
+				numAllocatedPages -= numAllocationPages;
+
+				// Merge the freed pages with the free runs on either side of them.
+				auto nextFreeRunIt = freeRuns.lower_bound(allocationBaseAddress);
+				if(nextFreeRunIt != freeRuns.end() && nextFreeRunIt->first == allocationBaseAddress + (numAllocationPages << Platform::getPageSizeLog2()))
+				{
+					numAllocationPages += nextFreeRunIt->second;
+					nextFreeRunIt = freeRuns.erase(nextFreeRunIt);
+				}
+				if(nextFreeRunIt != freeRuns.begin())
+				{
+					auto previousFreeRunIt = std::prev(nextFreeRunIt);
+					if(previousFreeRunIt->first + (previousFreeRunIt->second << Platform::getPageSizeLog2()) == allocationBaseAddress)
+					{
+						previousFreeRunIt->second += numAllocationPages;
+						return;
+					}
+				}
+				freeRuns[allocationBaseAddress] = numAllocationPages;
+			}
+		};
+
+		Platform::Mutex* mutex;
+		std::vector<Region*> regions;
+
+		CodeArena(): mutex(Platform::createMutex()) {}
+
+		static Uptr shrAndRoundUp(Uptr value,Uptr shift) { return (value + (Uptr(1)<<shift) - 1) >> shift; }
 	};
 
 	// Allocates memory for the LLVM object loader.
+	// The code and read-only data of a unit are allocated together from the code arena, so a unit has at most one partially
+	// used page, and the whole image is made executable and read-only once it's loaded.
 	struct UnitMemoryManager : llvm::RTDyldMemoryManager
 	{
 		UnitMemoryManager()
@@ -93,7 +285,6 @@ namespace LLVMJIT
 		, isFinalized(false)
 		, codeSection({0})
 		, readOnlySection({0})
-		, readWriteSection({0})
 		, hasRegisteredEHFrames(false)
 		{}
 		virtual ~UnitMemoryManager() override
@@ -105,9 +296,8 @@ namespace LLVMJIT
             llvm::RTDyldMemoryManager::deregisterEHFrames(ehFramesAddr,ehFramesLoadAddr,ehFramesNumBytes);
 			}
 
-			// Decommit the image pages, but leave them reserved to catch any references to them that might erroneously remain.
-			if(numAllocatedImagePages)
-				Platform::decommitVirtualPages(imageBaseAddress,numAllocatedImagePages);
+			// Return the image pages to the code arena. The unit is only destroyed once nothing refers to its code.
+			if(numAllocatedImagePages) { CodeArena::get().free(imageBaseAddress,numAllocatedImagePages); }
 		}
 		
 		void registerEHFrames(U8* addr, U64 loadAddr,uintptr_t numBytes) override
@@ -128,19 +318,17 @@ namespace LLVMJIT
 		{
 			if(numReadWriteBytes)
 				 Runtime::causeException(Exception::Cause::outOfMemory);
-			// Calculate the number of pages to be used by each section.
-			codeSection.numPages = shrAndRoundUp(numCodeBytes,Platform::getPageSizeLog2());
-			readOnlySection.numPages = shrAndRoundUp(numReadOnlyBytes,Platform::getPageSizeLog2());
-			readWriteSection.numPages = shrAndRoundUp(numReadWriteBytes,Platform::getPageSizeLog2());
-			numAllocatedImagePages = codeSection.numPages + readOnlySection.numPages + readWriteSection.numPages;
+			// The read-only data directly follows the code, aligned to the greatest alignment of the read-only sections.
+			const Uptr readOnlyOffset = align(numCodeBytes,std::max(readOnlyAlignment,U32(1)));
+			numAllocatedImagePages = shrAndRoundUp(readOnlyOffset + numReadOnlyBytes,Platform::getPageSizeLog2());
+			codeSection.numBytes = readOnlyOffset;
+			readOnlySection.numBytes = (numAllocatedImagePages << Platform::getPageSizeLog2()) - readOnlyOffset;
 			if(numAllocatedImagePages)
 			{
-				// Reserve enough contiguous pages for all sections.
-				imageBaseAddress = Platform::allocateVirtualPages(numAllocatedImagePages);
-				if(!imageBaseAddress || !Platform::commitVirtualPages(imageBaseAddress,numAllocatedImagePages)) { Errors::fatal("memory allocation for JIT code failed"); }
+				WAVM_ASSERT_THROW(codeAlignment <= (Uptr(1) << Platform::getPageSizeLog2()));
+				imageBaseAddress = CodeArena::get().allocate(numAllocatedImagePages);
 				codeSection.baseAddress = imageBaseAddress;
-				readOnlySection.baseAddress = codeSection.baseAddress + (codeSection.numPages << Platform::getPageSizeLog2());
-				readWriteSection.baseAddress = readOnlySection.baseAddress + (readOnlySection.numPages << Platform::getPageSizeLog2());
+				readOnlySection.baseAddress = imageBaseAddress + readOnlyOffset;
 			}
 		}
 		virtual U8* allocateCodeSection(uintptr_t numBytes,U32 alignment,U32 sectionID,llvm::StringRef sectionName) override
@@ -149,17 +337,17 @@ namespace LLVMJIT
 		}
 		virtual U8* allocateDataSection(uintptr_t numBytes,U32 alignment,U32 sectionID,llvm::StringRef SectionName,bool isReadOnly) override
 		{
-			return allocateBytes((Uptr)numBytes,alignment,isReadOnly ? readOnlySection : readWriteSection);
+			// reserveAllocationSpace rejects images with read-write data.
+			WAVM_ASSERT_THROW(isReadOnly);
+			return allocateBytes((Uptr)numBytes,alignment,readOnlySection);
 		}
 		virtual bool finalizeMemory(std::string* ErrMsg = nullptr) override
 		{
 			WAVM_ASSERT_THROW(!isFinalized);
 			isFinalized = true;
-			// Set the requested final memory access for each section's pages.
-			const Platform::MemoryAccess codeAccess = USE_WRITEABLE_JIT_CODE_PAGES ? Platform::MemoryAccess::ReadWriteExecute : Platform::MemoryAccess::Execute;
-			if(codeSection.numPages && !Platform::setVirtualPageAccess(codeSection.baseAddress,codeSection.numPages,codeAccess)) { return false; }
-			if(readOnlySection.numPages && !Platform::setVirtualPageAccess(readOnlySection.baseAddress,readOnlySection.numPages,Platform::MemoryAccess::ReadOnly)) { return false; }
-			if(readWriteSection.numPages && !Platform::setVirtualPageAccess(readWriteSection.baseAddress,readWriteSection.numPages,Platform::MemoryAccess::ReadWrite)) { return false; }
+			// Make the image executable, and no longer writable.
+			const Platform::MemoryAccess imageAccess = USE_WRITEABLE_JIT_CODE_PAGES ? Platform::MemoryAccess::ReadWriteExecute : Platform::MemoryAccess::ReadExecute;
+			if(numAllocatedImagePages && !Platform::setVirtualPageAccess(imageBaseAddress,numAllocatedImagePages,imageAccess)) { return false; }
 			return true;
 		}
 		virtual void invalidateInstructionCache()
@@ -174,7 +362,7 @@ namespace LLVMJIT
 		struct Section
 		{
 			U8* baseAddress;
-			Uptr numPages;
+			Uptr numBytes;
 			Uptr numCommittedBytes;
 		};
 		
@@ -184,7 +372,6 @@ namespace LLVMJIT
 
 		Section codeSection;
 		Section readOnlySection;
-		Section readWriteSection;
 
 		bool hasRegisteredEHFrames;
 		U8* ehFramesAddr;
@@ -203,7 +390,7 @@ namespace LLVMJIT
 			section.numCommittedBytes = align(section.numCommittedBytes,alignment) + align(numBytes,alignment);
 
 			// Check that enough space was reserved in the section.
-			if(section.numCommittedBytes > (section.numPages << Platform::getPageSizeLog2())) { Errors::fatal("didn't reserve enough space in section"); }
+			if(section.numCommittedBytes > section.numBytes) { Errors::fatal("didn't reserve enough space in section"); }
 
 			return allocationBaseAddress;
 		}
@@ -240,7 +427,7 @@ namespace LLVMJIT
 
 		void compile(llvm::Module* llvmModule);
 
-		virtual void notifySymbolLoaded(const char* name,Uptr baseAddress,Uptr numBytes,std::map<U32,U32>&& offsetToOpIndexMap) = 0;
+		virtual void notifySymbolLoaded(const char* name,Uptr baseAddress,Uptr numBytes,OffsetToOpIndexMap&& offsetToOpIndexMap) = 0;
 
 	private:
 		
@@ -286,26 +473,132 @@ namespace LLVMJIT
 		#endif
 	};
 
+	// The JIT compilation unit for the shared functions that were first defined by a module instance. It is kept alive by
+	// references from the module instances that use its functions, and from the other shared units that call them.
+	struct JITSharedUnit : JITUnit
+	{
+		std::vector<JITSharedFunction*> sharedFunctions;
+		std::vector<JITSymbol*> symbols;
+		std::set<JITSharedUnit*> calleeUnits;
+		Uptr numReferences;
+
+		// The shared function compiled from each of the defining module's functions. Only used while compiling.
+		std::vector<JITSharedFunction*> functionDefSharedFunctions;
+
+		JITSharedUnit(): numReferences(0) {}
+		~JITSharedUnit()
+		{
+			Platform::Lock addressToSymbolMapLock(addressToSymbolMapMutex);
+			for(auto symbol : symbols)
+			{
+				addressToSymbolMap.erase(addressToSymbolMap.find(symbol->baseAddress + symbol->numBytes));
+				delete symbol;
+			}
+			for(auto sharedFunction : sharedFunctions) { delete sharedFunction; }
+		}
+
+		void notifySymbolLoaded(const char* name,Uptr baseAddress,Uptr numBytes,OffsetToOpIndexMap&& offsetToOpIndexMap) override
+		{
+			Uptr functionDefIndex;
+			if(getFunctionIndexFromExternalName(name,functionDefIndex))
+			{
+				WAVM_ASSERT_THROW(functionDefIndex < functionDefSharedFunctions.size());
+				JITSharedFunction* sharedFunction = functionDefSharedFunctions[functionDefIndex];
+				WAVM_ASSERT_THROW(sharedFunction && sharedFunction->unit == this);
+
+				// If the defining module has more than one function with the same key, each is compiled, but only the code
+				// of the first is shared.
+				if(!sharedFunction->nativeFunction) { sharedFunction->nativeFunction = reinterpret_cast<void*>(baseAddress); }
+
+				auto symbol = new JITSymbol(sharedFunction,baseAddress,numBytes,std::move(offsetToOpIndexMap));
+				symbols.push_back(symbol);
+				{
+					Platform::Lock addressToSymbolMapLock(addressToSymbolMapMutex);
+					addressToSymbolMap[baseAddress + numBytes] = symbol;
+				}
+			}
+		}
+	};
+
+	// Removes a reference to a shared unit. When the last reference is removed, its functions are removed from the shared
+	// function map and its code is freed. Must be called with sharedFunctionMapMutex locked.
+	static void removeSharedUnitReference(JITSharedUnit* sharedUnit)
+	{
+		WAVM_ASSERT_THROW(sharedUnit->numReferences > 0);
+		if(--sharedUnit->numReferences) { return; }
+
+		for(auto sharedFunction : sharedUnit->sharedFunctions) { sharedFunctionMap.erase(sharedFunctionMap.find(*sharedFunction->key)); }
+		for(auto calleeUnit : sharedUnit->calleeUnits) { removeSharedUnitReference(calleeUnit); }
+		delete sharedUnit;
+	}
+
 	// The JIT compilation unit for a WebAssembly module instance.
 	struct JITModule : JITUnit, JITModuleBase
 	{
 		ModuleInstance* moduleInstance;
 
 		std::vector<JITSymbol*> functionDefSymbols;
+		std::vector<JITSharedUnit*> sharedUnits;
 
-		JITModule(ModuleInstance* inModuleInstance): moduleInstance(inModuleInstance) {}
+		// If the module collects a profile, the counters its code increments, and the profile they're added to.
+		ModuleProfile profileCounters;
+		ModuleProfile* collectingProfile;
+
+		// The number of the module's functions that use code shared with other modules.
+		Uptr numSharedFunctionDefs;
+
+		JITModule(ModuleInstance* inModuleInstance): moduleInstance(inModuleInstance), collectingProfile(nullptr), numSharedFunctionDefs(0) {}
 		~JITModule() override
 		{
+			if(collectingProfile) { addProfileCounts(); }
+
 			// Delete the module's symbols, and remove them from the global address-to-symbol map.
-			Platform::Lock addressToSymbolMapLock(addressToSymbolMapMutex);
-			for(auto symbol : functionDefSymbols)
 			{
-				addressToSymbolMap.erase(addressToSymbolMap.find(symbol->baseAddress + symbol->numBytes));
-				delete symbol;
+				Platform::Lock addressToSymbolMapLock(addressToSymbolMapMutex);
+				for(auto symbol : functionDefSymbols)
+				{
+					addressToSymbolMap.erase(addressToSymbolMap.find(symbol->baseAddress + symbol->numBytes));
+					delete symbol;
+				}
+			}
+
+			// Release the shared functions the module used.
+			Platform::Lock sharedFunctionMapLock(sharedFunctionMapMutex);
+			for(auto sharedUnit : sharedUnits) { removeSharedUnitReference(sharedUnit); }
+		}
+
+		void addProfileCounts()
+		{
+			Platform::Lock profileLock(profileMutex);
+			collectingProfile->functionDefs.resize(profileCounters.functionDefs.size());
+			for(Uptr functionDefIndex = 0;functionDefIndex < profileCounters.functionDefs.size();++functionDefIndex)
+			{
+				const FunctionProfile& counters = profileCounters.functionDefs[functionDefIndex];
+				FunctionProfile& functionProfile = collectingProfile->functionDefs[functionDefIndex];
+				for(const auto& siteCounters : counters.branchCounts)
+				{
+					std::vector<U64>& siteCounts = functionProfile.branchCounts[siteCounters.first];
+					siteCounts.resize(siteCounters.second.size(),0);
+					for(Uptr index = 0;index < siteCounters.second.size();++index) { siteCounts[index] += siteCounters.second[index]; }
+				}
+				for(const auto& siteCounters : counters.indirectCallCounts)
+				{
+					std::map<U32,U64>& siteCounts = functionProfile.indirectCallCounts[siteCounters.first];
+					for(const auto& elementCount : siteCounters.second) { siteCounts[elementCount.first] += elementCount.second; }
+				}
 			}
 		}
 
-		void notifySymbolLoaded(const char* name,Uptr baseAddress,Uptr numBytes,std::map<U32,U32>&& offsetToOpIndexMap) override
+		Uptr getNumCodeBytes() const override
+		{
+			Uptr numCodeBytes = 0;
+			for(auto symbol : functionDefSymbols) { numCodeBytes += symbol->numBytes; }
+			return numCodeBytes;
+		}
+
+		Uptr getNumSharedFunctionDefs() const override { return numSharedFunctionDefs; }
+
+		void notifySymbolLoaded(const char* name,Uptr baseAddress,Uptr numBytes,OffsetToOpIndexMap&& offsetToOpIndexMap) override
 		{
 			// Save the address range this function was loaded at for future address->symbol lookups.
 			Uptr functionDefIndex;
@@ -335,7 +628,7 @@ namespace LLVMJIT
 
 		JITInvokeThunkUnit(const FunctionType* inFunctionType): JITUnit(false), functionType(inFunctionType), symbol(nullptr) {}
 
-		void notifySymbolLoaded(const char* name,Uptr baseAddress,Uptr numBytes,std::map<U32,U32>&& offsetToOpIndexMap) override
+		void notifySymbolLoaded(const char* name,Uptr baseAddress,Uptr numBytes,OffsetToOpIndexMap&& offsetToOpIndexMap) override
 		{
 			#if defined(_WIN32) && !defined(_WIN64)
 				WAVM_ASSERT_THROW(!strcmp(name,"_invokeThunk"));
@@ -522,8 +815,17 @@ namespace LLVMJIT
 
 					// Get the DWARF line info for this symbol, which maps machine code addresses to WebAssembly op indices.
 					llvm::DILineInfoTable lineInfoTable = dwarfContext->getLineInfoForAddressRange(loadedAddress,symbolSizePair.second);
-					std::map<U32,U32> offsetToOpIndexMap;
-					for(auto lineInfo : lineInfoTable) { offsetToOpIndexMap.emplace(U32(lineInfo.first - loadedAddress),lineInfo.second.Line); }
+					OffsetToOpIndexMap offsetToOpIndexMap;
+					offsetToOpIndexMap.reserve(lineInfoTable.size());
+					for(auto lineInfo : lineInfoTable) { offsetToOpIndexMap.push_back({U32(lineInfo.first - loadedAddress),U32(lineInfo.second.Line)}); }
+
+					// Sort the entries by offset, keeping only the first entry for each offset.
+					std::stable_sort(offsetToOpIndexMap.begin(),offsetToOpIndexMap.end(),
+						[](const OffsetToOpIndex& left,const OffsetToOpIndex& right) { return left.offset < right.offset; });
+					auto uniqueEnd = std::unique(offsetToOpIndexMap.begin(),offsetToOpIndexMap.end(),
+						[](const OffsetToOpIndex& left,const OffsetToOpIndex& right) { return left.offset == right.offset; });
+					offsetToOpIndexMap.erase(uniqueEnd,offsetToOpIndexMap.end());
+					offsetToOpIndexMap.shrink_to_fit();
 					
 					#if PRINT_DISASSEMBLY
 					Log::printf(Log::Category::error,"Disassembly for function %s\n",name.get().data());
@@ -610,17 +912,348 @@ namespace LLVMJIT
 		delete llvmModule;
 	}
 
-	void instantiateModule(const IR::Module& module,ModuleInstance* moduleInstance)
+	// Collects the indices of the module-defined functions called by a function.
+	struct CalleeVisitor
 	{
-		// Emit LLVM IR for the module.
-		auto llvmModule = emitModule(module,moduleInstance);
+		typedef void Result;
+
+		Uptr numImportedFunctions;
+		std::vector<Uptr>& calleeDefIndices;
+
+		CalleeVisitor(Uptr inNumImportedFunctions,std::vector<Uptr>& inCalleeDefIndices)
+		: numImportedFunctions(inNumImportedFunctions), calleeDefIndices(inCalleeDefIndices) {}
+
+		#define VISIT_OPCODE(_,name,nameString,Imm,...) void name(Imm imm) { visit(imm); }
+		ENUM_OPERATORS(VISIT_OPCODE)
+		#undef VISIT_OPCODE
+		void unknown(Opcode opcode) {}
+
+		template<typename Imm> void visit(Imm imm) {}
+		void visit(CallImm imm)
+		{
+			if(imm.functionIndex >= numImportedFunctions) { calleeDefIndices.push_back(imm.functionIndex - numImportedFunctions); }
+		}
+	};
+
+	// Encodes the key of a function that doesn't depend on the module instance that defined it. The operators are encoded
+	// as they are stored, except that calls identify their callee by its code, and branch tables are encoded inline.
+	// Fails if the function accesses the instance's memory, tables, or globals, or calls a module-defined function that
+	// isn't shared (other than itself).
+	struct SharedFunctionKeyVisitor
+	{
+		typedef bool Result;
+
+		const IR::Module& module;
+		ModuleInstance* moduleInstance;
+		const FunctionDef& functionDef;
+		Uptr functionDefIndex;
+		const std::vector<JITSharedFunction*>& functionDefSharedFunctions;
+		std::string& key;
+		std::vector<JITSharedFunction*>& sharedCallees;
+
+		SharedFunctionKeyVisitor(
+			const IR::Module& inModule,
+			ModuleInstance* inModuleInstance,
+			Uptr inFunctionDefIndex,
+			const std::vector<JITSharedFunction*>& inFunctionDefSharedFunctions,
+			std::string& inKey,
+			std::vector<JITSharedFunction*>& inSharedCallees)
+		: module(inModule)
+		, moduleInstance(inModuleInstance)
+		, functionDef(inModule.functions.defs[inFunctionDefIndex])
+		, functionDefIndex(inFunctionDefIndex)
+		, functionDefSharedFunctions(inFunctionDefSharedFunctions)
+		, key(inKey)
+		, sharedCallees(inSharedCallees)
+		{}
+
+		bool encode()
+		{
+			// FunctionType objects are unique for each type, so the type is identified by its address.
+			append(module.types[functionDef.type.index]);
+			append(Uptr(functionDef.nonParameterLocalTypes.size()));
+			for(auto localType : functionDef.nonParameterLocalTypes) { append(localType); }
+
+			OperatorDecoderStream decoder(functionDef.code);
+			while(decoder) { if(!decoder.decodeOp(*this)) { return false; } }
+			return true;
+		}
+
+		#define VISIT_OPCODE(_,name,nameString,Imm,...) bool name(Imm imm) { return encodeOperator(Opcode::name,imm); }
+		ENUM_OPERATORS(VISIT_OPCODE)
+		#undef VISIT_OPCODE
+		bool unknown(Opcode opcode) { return false; }
+
+	private:
+
+		template<typename Value> void append(const Value& value)
+		{
+			key.append(reinterpret_cast<const char*>(&value),sizeof(Value));
+		}
+
+		// The immediates are encoded a field at a time: appending a whole immediate struct would include its padding, which
+		// isn't initialized, and give identical functions different keys.
+		bool encodeOperator(Opcode opcode,NoImm) { append(opcode); return true; }
+		bool encodeOperator(Opcode opcode,ControlStructureImm imm) { append(opcode); append(imm.resultType); return true; }
+		bool encodeOperator(Opcode opcode,BranchImm imm) { append(opcode); append(imm.targetDepth); return true; }
+		template<typename Value> bool encodeOperator(Opcode opcode,LiteralImm<Value> imm)
+		{
+			append(opcode);
+			append(imm.value);
+			return true;
+		}
+		bool encodeOperator(Opcode opcode,GetOrSetVariableImm<false> imm) { append(opcode); append(imm.variableIndex); return true; }
+		#if ENABLE_SIMD_PROTOTYPE
+		bool encodeOperator(Opcode opcode,LiteralImm<V128> imm) { append(opcode); append(imm.value.u8); return true; }
+		template<Uptr numLanes> bool encodeOperator(Opcode opcode,LaneIndexImm<numLanes> imm)
+		{
+			append(opcode);
+			append(imm.laneIndex);
+			return true;
+		}
+		template<Uptr numLanes> bool encodeOperator(Opcode opcode,ShuffleImm<numLanes> imm)
+		{
+			append(opcode);
+			append(imm.laneIndices);
+			return true;
+		}
+		#endif
+
+		bool encodeOperator(Opcode opcode,BranchTableImm imm)
+		{
+			WAVM_ASSERT_THROW(imm.branchTableIndex < functionDef.branchTables.size());
+			const std::vector<U32>& targetDepths = functionDef.branchTables[imm.branchTableIndex];
+			append(opcode);
+			append(imm.defaultTargetDepth);
+			append(Uptr(targetDepths.size()));
+			key.append(reinterpret_cast<const char*>(targetDepths.data()),targetDepths.size() * sizeof(U32));
+			return true;
+		}
+
+		bool encodeOperator(Opcode opcode,CallImm imm)
+		{
+			append(opcode);
+			const Uptr numImportedFunctions = module.functions.imports.size();
+			if(imm.functionIndex < numImportedFunctions)
+			{
+				// Imported functions are identified by the address of their code. The 128-bit integer builtins are emitted
+				// inline, and access the instance's memory.
+				const FunctionInstance* callee = moduleInstance->functions[imm.functionIndex];
+				if(isInt128Builtin(module.functions.imports[imm.functionIndex],callee->type)) { return false; }
+				append(U8(0));
+				append(callee->nativeFunction);
+				append(callee->type);
+			}
+			else if(imm.functionIndex - numImportedFunctions == functionDefIndex) { append(U8(1)); }
+			else
+			{
+				JITSharedFunction* callee = functionDefSharedFunctions[imm.functionIndex - numImportedFunctions];
+				if(!callee) { return false; }
+				append(U8(2));
+				append(callee->id);
+				sharedCallees.push_back(callee);
+			}
+			return true;
+		}
+
+		// Operators that access the module instance's memory, tables, or globals.
+		bool encodeOperator(Opcode opcode,MemoryImm) { return false; }
+		bool encodeOperator(Opcode opcode,MemoryCopyImm) { return false; }
+		template<Uptr naturalAlignmentLog2> bool encodeOperator(Opcode opcode,LoadOrStoreImm<naturalAlignmentLog2>) { return false; }
+		bool encodeOperator(Opcode opcode,CallIndirectImm) { return false; }
+		bool encodeOperator(Opcode opcode,GetOrSetVariableImm<true>) { return false; }
+		#if ENABLE_THREADING_PROTOTYPE
+		template<Uptr naturalAlignmentLog2> bool encodeOperator(Opcode opcode,AtomicLoadOrStoreImm<naturalAlignmentLog2>) { return false; }
+		bool encodeOperator(Opcode opcode,LaunchThreadImm) { return false; }
+		#endif
+	};
 
-		// Construct the JIT compilation pipeline for this module.
+	void instantiateModule(const IR::Module& module,ModuleInstance* moduleInstance,ModuleProfile* profile,bool isCollectingProfile)
+	{
+		const Uptr numFunctionDefs = module.functions.defs.size();
 		auto jitModule = new JITModule(moduleInstance);
 		moduleInstance->jitModule = jitModule;
 
-		// Compile the module.
-		jitModule->compile(llvmModule);
+		// A module compiled with a profile, or collecting one, has code of its own for all its functions.
+		if(profile)
+		{
+			std::vector<bool> emitFunctionDefs(numFunctionDefs,true);
+			std::vector<void*> compiledFunctionDefs(numFunctionDefs,nullptr);
+			if(isCollectingProfile)
+			{
+				jitModule->profileCounters.functionDefs.resize(numFunctionDefs);
+				jitModule->collectingProfile = profile;
+				jitModule->compile(emitModule(module,moduleInstance,emitFunctionDefs,compiledFunctionDefs,&jitModule->profileCounters,nullptr));
+			}
+			else
+			{
+				ModuleProfile profileCopy;
+				{
+					Platform::Lock profileLock(profileMutex);
+					profileCopy = *profile;
+				}
+				profileCopy.functionDefs.resize(numFunctionDefs);
+				jitModule->compile(emitModule(module,moduleInstance,emitFunctionDefs,compiledFunctionDefs,nullptr,&profileCopy));
+			}
+			return;
+		}
+
+		// Functions that don't depend on the module instance are shared with any other module that defines the same
+		// function. Find the functions each function calls, so a function's callees can be shared before it is.
+		std::vector<std::vector<Uptr>> functionDefCalleeIndices(numFunctionDefs);
+		for(Uptr functionDefIndex = 0;functionDefIndex < numFunctionDefs;++functionDefIndex)
+		{
+			CalleeVisitor calleeVisitor(module.functions.imports.size(),functionDefCalleeIndices[functionDefIndex]);
+			OperatorDecoderStream decoder(module.functions.defs[functionDefIndex].code);
+			while(decoder) { decoder.decodeOp(calleeVisitor); }
+		}
+
+		std::vector<JITSharedFunction*> functionDefSharedFunctions(numFunctionDefs,nullptr);
+		JITSharedUnit* newSharedUnit = nullptr;
+		std::vector<bool> emitSharedFunctionDefs(numFunctionDefs,false);
+		{
+			Platform::Lock sharedFunctionMapLock(sharedFunctionMapMutex);
+
+			// Look up the key of each function in the shared function map, visiting callees before their callers. Functions
+			// called recursively through other functions can't be keyed, and aren't shared.
+			std::set<JITSharedUnit*> usedSharedUnits;
+			std::vector<U8> visitStates(numFunctionDefs,0);
+			std::vector<std::pair<Uptr,Uptr>> visitStack;
+			for(Uptr rootFunctionDefIndex = 0;rootFunctionDefIndex < numFunctionDefs;++rootFunctionDefIndex)
+			{
+				if(visitStates[rootFunctionDefIndex]) { continue; }
+				visitStates[rootFunctionDefIndex] = 1;
+				visitStack.push_back({rootFunctionDefIndex,0});
+				while(visitStack.size())
+				{
+					const Uptr functionDefIndex = visitStack.back().first;
+					const std::vector<Uptr>& calleeIndices = functionDefCalleeIndices[functionDefIndex];
+					if(visitStack.back().second < calleeIndices.size())
+					{
+						const Uptr calleeIndex = calleeIndices[visitStack.back().second++];
+						if(!visitStates[calleeIndex])
+						{
+							visitStates[calleeIndex] = 1;
+							visitStack.push_back({calleeIndex,0});
+						}
+						continue;
+					}
+					visitStack.pop_back();
+					visitStates[functionDefIndex] = 2;
+
+					std::string key;
+					std::vector<JITSharedFunction*> sharedCallees;
+					SharedFunctionKeyVisitor keyVisitor(module,moduleInstance,functionDefIndex,functionDefSharedFunctions,key,sharedCallees);
+					if(!keyVisitor.encode()) { continue; }
+
+					JITSharedFunction* sharedFunction = nullptr;
+					auto sharedFunctionIt = sharedFunctionMap.find(key);
+					if(sharedFunctionIt != sharedFunctionMap.end())
+					{
+						sharedFunction = sharedFunctionIt->second;
+
+						// A function that another module is still compiling isn't shared with this module, rather than
+						// waiting for it.
+						if(sharedFunction->unit != newSharedUnit && !sharedFunction->isCompiled) { continue; }
+					}
+					else
+					{
+						// The function hasn't been compiled yet: compile it in a new shared unit, which references the
+						// units of the functions it calls. Add its key to the map now, so other modules don't compile it too.
+						if(!newSharedUnit)
+						{
+							newSharedUnit = new JITSharedUnit;
+							newSharedUnit->functionDefSharedFunctions.resize(numFunctionDefs,nullptr);
+						}
+						sharedFunction = new JITSharedFunction {
+							nextSharedFunctionId++,
+							moduleInstance->functionDefs[functionDefIndex]->debugName,
+							newSharedUnit,
+							nullptr,
+							nullptr,
+							false};
+						newSharedUnit->sharedFunctions.push_back(sharedFunction);
+						sharedFunction->key = &sharedFunctionMap.emplace(std::move(key),sharedFunction).first->first;
+						for(auto sharedCallee : sharedCallees)
+						{
+							if(sharedCallee->unit != newSharedUnit) { newSharedUnit->calleeUnits.insert(sharedCallee->unit); }
+						}
+					}
+					functionDefSharedFunctions[functionDefIndex] = sharedFunction;
+					if(sharedFunction->unit == newSharedUnit)
+					{
+						newSharedUnit->functionDefSharedFunctions[functionDefIndex] = sharedFunction;
+						emitSharedFunctionDefs[functionDefIndex] = true;
+					}
+					else { usedSharedUnits.insert(sharedFunction->unit); }
+				}
+			}
+
+			// Take the references to the units the new unit calls now, so they aren't freed while it compiles.
+			if(newSharedUnit)
+			{
+				newSharedUnit->numReferences = 1;
+				for(auto calleeUnit : newSharedUnit->calleeUnits) { ++calleeUnit->numReferences; }
+			}
+
+			for(auto sharedUnit : usedSharedUnits)
+			{
+				++sharedUnit->numReferences;
+				jitModule->sharedUnits.push_back(sharedUnit);
+			}
+		}
+
+		if(newSharedUnit)
+		{
+			// Compile the new shared functions, calling the previously compiled ones. This doesn't hold the shared function
+			// map lock, so other modules can be compiled at the same time.
+			std::vector<void*> compiledFunctionDefs(numFunctionDefs,nullptr);
+			for(Uptr functionDefIndex = 0;functionDefIndex < numFunctionDefs;++functionDefIndex)
+			{
+				JITSharedFunction* sharedFunction = functionDefSharedFunctions[functionDefIndex];
+				if(sharedFunction && sharedFunction->unit != newSharedUnit) { compiledFunctionDefs[functionDefIndex] = sharedFunction->nativeFunction; }
+			}
+			try
+			{
+				newSharedUnit->compile(emitModule(module,moduleInstance,emitSharedFunctionDefs,compiledFunctionDefs,nullptr,nullptr));
+			}
+			catch(...)
+			{
+				// Remove the new functions' keys from the map, release the units they call, and free the unit.
+				Platform::Lock sharedFunctionMapLock(sharedFunctionMapMutex);
+				removeSharedUnitReference(newSharedUnit);
+				throw;
+			}
+			newSharedUnit->functionDefSharedFunctions.clear();
+
+			// Publish the new shared functions to other modules.
+			Platform::Lock sharedFunctionMapLock(sharedFunctionMapMutex);
+			for(auto sharedFunction : newSharedUnit->sharedFunctions)
+			{
+				WAVM_ASSERT_THROW(sharedFunction->nativeFunction);
+				sharedFunction->isCompiled = true;
+			}
+			jitModule->sharedUnits.push_back(newSharedUnit);
+		}
+
+		// Compile the functions that aren't shared, calling the shared functions' code.
+		std::vector<bool> emitFunctionDefs(numFunctionDefs,false);
+		std::vector<void*> compiledFunctionDefs(numFunctionDefs,nullptr);
+		Uptr& numSharedFunctionDefs = jitModule->numSharedFunctionDefs;
+		for(Uptr functionDefIndex = 0;functionDefIndex < numFunctionDefs;++functionDefIndex)
+		{
+			if(functionDefSharedFunctions[functionDefIndex])
+			{
+				compiledFunctionDefs[functionDefIndex] = functionDefSharedFunctions[functionDefIndex]->nativeFunction;
+				moduleInstance->functionDefs[functionDefIndex]->nativeFunction = compiledFunctionDefs[functionDefIndex];
+				++numSharedFunctionDefs;
+			}
+			else { emitFunctionDefs[functionDefIndex] = true; }
+		}
+		if(numSharedFunctionDefs < numFunctionDefs)
+		{
+			jitModule->compile(emitModule(module,moduleInstance,emitFunctionDefs,compiledFunctionDefs,nullptr,nullptr));
+		}
 	}
 
 	std::string getExternalFunctionName(ModuleInstance* moduleInstance,Uptr functionDefIndex)
@@ -669,18 +1302,22 @@ namespace LLVMJIT
 		case JITSymbol::Type::invokeThunk:
 			outDescription = "<invoke thunk : " + asString(symbol->invokeThunkType) + ">";
 			break;
+		case JITSymbol::Type::sharedFunction:
+			outDescription = symbol->sharedFunction->debugName;
+			if(!outDescription.size()) { outDescription = "<unnamed function>"; }
+			break;
 		default: Errors::unreachable();
 		};
 		
 		// Find the highest entry in the offsetToOpIndexMap whose offset is <= the symbol-relative IP.
 		U32 ipOffset = (U32)(ip - symbol->baseAddress);
-		Iptr opIndex = -1;
-		for(auto offsetMapIt : symbol->offsetToOpIndexMap)
+		auto offsetMapIt = std::upper_bound(
+			symbol->offsetToOpIndexMap.begin(),symbol->offsetToOpIndexMap.end(),ipOffset,
+			[](U32 offset,const OffsetToOpIndex& entry) { return offset < entry.offset; });
+		if(offsetMapIt != symbol->offsetToOpIndexMap.begin())
 		{
-			if(offsetMapIt.first <= ipOffset) { opIndex = offsetMapIt.second; }
-			else { break; }
+			outDescription += " (op " + std::to_string((--offsetMapIt)->opIndex) + ")";
 		}
-		if(opIndex >= 0) { outDescription += " (op " + std::to_string(opIndex) + ")"; }
 		return true;
 	}
 
@@ -775,6 +1412,7 @@ namespace LLVMJIT
 		llvmI16Type = llvm::Type::getInt16Ty(context);
 		llvmI32Type = llvm::Type::getInt32Ty(context);
 		llvmI64Type = llvm::Type::getInt64Ty(context);
+		llvmI128Type = llvm::Type::getInt128Ty(context);
 		llvmF32Type = llvm::Type::getFloatTy(context);
 		llvmF64Type = llvm::Type::getDoubleTy(context);
 		llvmVoidType = llvm::Type::getVoidTy(context);
@@ -35,6 +35,7 @@
 #include "llvm/IR/IRBuilder.h"
 #include "llvm/IR/LLVMContext.h"
 #include "llvm/IR/LegacyPassManager.h"
+#include "llvm/IR/MDBuilder.h"
 #include "llvm/IR/Module.h"
 #include "llvm/IR/Intrinsics.h"
 #include "llvm/IR/Verifier.h"
@@ -51,6 +52,7 @@
 #include "llvm/IR/DIBuilder.h"
 #include "llvm/DebugInfo/DIContext.h"
 #include "llvm/DebugInfo/DWARF/DWARFContext.h"
+#include <algorithm>
 #include <cctype>
 #include <string>
 #include <vector>
@@ -73,6 +75,7 @@ namespace LLVMJIT
 	extern llvm::Type* llvmI16Type;
 	extern llvm::Type* llvmI32Type;
 	extern llvm::Type* llvmI64Type;
+	extern llvm::Type* llvmI128Type;
 	extern llvm::Type* llvmF32Type;
 	extern llvm::Type* llvmF64Type;
 	extern llvm::Type* llvmVoidType;
@@ -125,6 +128,19 @@ namespace LLVMJIT
 	std::string getExternalFunctionName(ModuleInstance* moduleInstance,Uptr functionDefIndex);
 	bool getFunctionIndexFromExternalName(const char* externalName,Uptr& outFunctionDefIndex);
 
-	// Emits LLVM IR for a module.
-	llvm::Module* emitModule(const IR::Module& module,ModuleInstance* moduleInstance);
+	// Returns whether an imported function is a 128-bit integer builtin that emitModule emits inline, which it only does if
+	// setInlineInt128Builtins enabled it.
+	bool isInt128Builtin(const IR::Import<IR::IndexedFunctionType>& functionImport,const IR::FunctionType* calleeType);
+
+	// Emits LLVM IR for a module. Only the bodies of the functions with emitFunctionDefs set are emitted; calls to the
+	// module's other functions go to the code in compiledFunctionDefs, which must be non-null for any function they call.
+	// If profileCounters is non-null, the code counts how it runs in it; it must have an entry for each function, and
+	// must outlive the code. If profile is non-null, the code is optimized for the counts in it.
+	llvm::Module* emitModule(
+		const IR::Module& module,
+		ModuleInstance* moduleInstance,
+		const std::vector<bool>& emitFunctionDefs,
+		const std::vector<void*>& compiledFunctionDefs,
+		ModuleProfile* profileCounters,
+		const ModuleProfile* profile);
 }
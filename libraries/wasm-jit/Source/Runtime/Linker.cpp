@@ -17,6 +17,13 @@ namespace Runtime
 		// Make sure the wavmIntrinsics module can't be directly imported.
 		if(moduleName == "wavmIntrinsics") { return false; }
 
+		// Function imports are looked up in the frozen intrinsic function table.
+		if(type.kind == ObjectKind::function)
+		{
+			outObject = asObject(Intrinsics::findFunction(moduleName,exportName,asFunctionType(type)));
+			return outObject != nullptr;
+		}
+
 		outObject = Intrinsics::find(moduleName + "." + exportName,type);
 		return outObject != nullptr;
 	}
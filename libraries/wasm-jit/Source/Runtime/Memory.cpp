@@ -5,9 +5,78 @@
 
 namespace Runtime
 {
-	// Global lists of memories; used to query whether an address is reserved by one of them.
+	// Global lists of memories that aren't allocated from the slot pool; used to query whether an address is reserved by one of them.
 	std::vector<MemoryInstance*> memories;
 
+	// The number of WebAssembly pages that may be committed in a pooled slot, or 0 if memories aren't pooled.
+	static Uptr slotMaxPages = 0;
+
+	// A pool of fixed-size memory slots carved out of a single address-space reservation.
+	// Each slot has room for slotMaxPages, followed by a guard region, and the slot size is a power of two so the slot index
+	// of an address is a shift. Memories whose maximum size fits in a slot are allocated from the pool instead of reserving
+	// 8GB of address-space each; code generated for them bounds checks memory accesses.
+	struct MemorySlotPool
+	{
+		enum { slotSizeLog2 = 26 };
+		enum { maxNumSlots = 4096 };
+
+		static MemorySlotPool& get()
+		{
+			static MemorySlotPool pool;
+			return pool;
+		}
+
+		// The number of WebAssembly pages that may be committed in a slot.
+		static Uptr getSlotMaxPages() { return slotMaxPages; }
+
+		U8* allocateSlot()
+		{
+			Platform::Lock lock(mutex);
+			if(!baseAddress) { return nullptr; }
+			if(freeSlotIndices.size())
+			{
+				const Uptr slotIndex = freeSlotIndices.back();
+				freeSlotIndices.pop_back();
+				return baseAddress + (slotIndex << slotSizeLog2);
+			}
+			if(numUsedSlots == numSlots) { return nullptr; }
+			return baseAddress + (numUsedSlots++ << slotSizeLog2);
+		}
+
+		void freeSlot(U8* slotBaseAddress)
+		{
+			Platform::Lock lock(mutex);
+			WAVM_ASSERT_THROW(isAddressOwned(slotBaseAddress));
+			freeSlotIndices.push_back(Uptr(slotBaseAddress - baseAddress) >> slotSizeLog2);
+		}
+
+		bool isAddressOwned(U8* address) const
+		{
+			return Uptr(address - baseAddress) < (numSlots << slotSizeLog2);
+		}
+
+	private:
+
+		Platform::Mutex* mutex;
+		U8* baseAddress;
+		Uptr numSlots;
+		Uptr numUsedSlots;
+		std::vector<Uptr> freeSlotIndices;
+
+		MemorySlotPool(): mutex(Platform::createMutex()), baseAddress(nullptr), numSlots(0), numUsedSlots(0)
+		{
+			// Slots need the full address-space to be worth it, so don't bother on 32-bit runtimes.
+			if(!HAS_64BIT_ADDRESS_SPACE) { return; }
+
+			// Reserve address-space for the slots, halving the number of slots until the reservation succeeds.
+			for(numSlots = maxNumSlots;numSlots > 0;numSlots >>= 1)
+			{
+				baseAddress = Platform::allocateVirtualPages((numSlots << slotSizeLog2) >> Platform::getPageSizeLog2());
+				if(baseAddress) { break; }
+			}
+		}
+	};
+
 	static Uptr getPlatformPagesPerWebAssemblyPageLog2()
 	{
 		errorUnless(Platform::getPageSizeLog2() <= IR::numBytesPerPageLog2);
@@ -24,10 +93,31 @@ namespace Runtime
 		else { return (U8*)((Uptr)(outUnalignedBaseAddress + alignmentBytes - 1) & ~(alignmentBytes - 1)); }
 	}
 
+	void setMemorySlotMaxPages(Uptr maxPages)
+	{
+		errorUnless(maxPages < (Uptr(1) << (MemorySlotPool::slotSizeLog2 - IR::numBytesPerPageLog2)));
+		slotMaxPages = maxPages;
+	}
+
 	MemoryInstance* createMemory(MemoryType type)
 	{
 		MemoryInstance* memory = new MemoryInstance(type);
 
+		// If the memory's maximum size fits in a pooled slot, try to allocate one.
+		if(MemorySlotPool::getSlotMaxPages() && type.size.max <= MemorySlotPool::getSlotMaxPages())
+		{
+			memory->baseAddress = MemorySlotPool::get().allocateSlot();
+			if(memory->baseAddress)
+			{
+				memory->isPooled = true;
+				memory->reservedBaseAddress = memory->baseAddress;
+				memory->reservedNumPlatformPages = Uptr(1) << (MemorySlotPool::slotSizeLog2 - Platform::getPageSizeLog2());
+				memory->endOffset = MemorySlotPool::getSlotMaxPages() << IR::numBytesPerPageLog2;
+				if(growMemory(memory,Uptr(type.size.min)) == -1) { delete memory; return nullptr; }
+				return memory;
+			}
+		}
+
 		// On a 64-bit runtime, allocate 8GB of address space for the memory.
 		// This allows eliding bounds checks on memory accesses, since a 32-bit index + 32-bit offset will always be within the reserved address-space.
 		// On a 32-bit runtime, allocate 256MB.
@@ -55,8 +145,9 @@ namespace Runtime
 		// Decommit all default memory pages.
 		if(numPages > 0) { Platform::decommitVirtualPages(baseAddress,numPages << getPlatformPagesPerWebAssemblyPageLog2()); }
 
-		// Free the virtual address space.
-		if(reservedNumPlatformPages > 0) { Platform::freeVirtualPages(reservedBaseAddress,reservedNumPlatformPages); }
+		// Return the slot to the pool, or free the virtual address space.
+		if(isPooled) { MemorySlotPool::get().freeSlot(reservedBaseAddress); }
+		else if(reservedNumPlatformPages > 0) { Platform::freeVirtualPages(reservedBaseAddress,reservedNumPlatformPages); }
 		reservedBaseAddress = baseAddress = nullptr;
 		reservedNumPlatformPages = 0;
 
@@ -66,12 +157,20 @@ namespace Runtime
 			if(memories[memoryIndex] == this) { memories.erase(memories.begin() + memoryIndex); break; }
 		}
 
-		theMemoryInstance = nullptr;
+		if(theMemoryInstance == this) { theMemoryInstance = nullptr; }
 	}
 	
+	void freeMemoryIfUnused(MemoryInstance* memory)
+	{
+		if(memory && !memory->numModuleInstances && memory != theMemoryInstance) { delete memory; }
+	}
+
 	bool isAddressOwnedByMemory(U8* address)
 	{
-		// Iterate over all memories and check if the address is within the reserved address space for each.
+		// Pooled memories own their whole slot, including the guard region.
+		if(MemorySlotPool::getSlotMaxPages() && MemorySlotPool::get().isAddressOwned(address)) { return true; }
+
+		// Iterate over all other memories and check if the address is within the reserved address space for each.
 		for(auto memory : memories)
 		{
 			U8* startAddress = memory->reservedBaseAddress;
@@ -88,15 +187,32 @@ namespace Runtime
 		return Uptr(memory->type.size.max);
 	}
 
-	void resetMemory(MemoryInstance* memory, MemoryType& newMemoryType) {
-		memory->type.size.min = 1;
-		if(shrinkMemory(memory, memory->numPages - 1) == -1)
-			causeException(Exception::Cause::outOfMemory);
-		memset(memory->baseAddress, 0, 1<<IR::numBytesPerPageLog2);
+	void resetMemory(MemoryInstance* memory,MemoryType& newMemoryType)
+	{
+		const Uptr newNumPages = Uptr(newMemoryType.size.min);
+
+		// Decommit the pages beyond the new minimum size.
+		if(memory->numPages > newNumPages)
+		{
+			Platform::decommitVirtualPages(
+				memory->baseAddress + (newNumPages << IR::numBytesPerPageLog2),
+				(memory->numPages - newNumPages) << getPlatformPagesPerWebAssemblyPageLog2()
+				);
+			memory->numPages = newNumPages;
+		}
+
+		// Discard the contents of the pages that stay committed instead of writing zeroes to them. Only the pages that were
+		// dirtied since they were committed have physical memory behind them, so this costs time proportional to the number
+		// of pages the previous execution touched rather than to the memory's size.
+		if(memory->numPages > 0)
+		{
+			Platform::discardVirtualPages(memory->baseAddress,memory->numPages << getPlatformPagesPerWebAssemblyPageLog2());
+		}
+
+		// Grow the memory back to the new minimum size.
 		memory->type = newMemoryType;
-		if(growMemory(memory, memory->type.size.min - 1) == -1)
-			causeException(Exception::Cause::outOfMemory);
-   }
+		if(growMemory(memory,newNumPages - memory->numPages) == -1) { causeException(Exception::Cause::outOfMemory); }
+	}
 
 	Iptr growMemory(MemoryInstance* memory,Uptr numNewPages)
 	{
@@ -106,7 +222,11 @@ namespace Runtime
 			// If the number of pages to grow would cause the memory's size to exceed its maximum, return -1.
 			if(numNewPages > memory->type.size.max || memory->numPages > memory->type.size.max - numNewPages) { return -1; }
 
+			// Also return -1 if the new pages wouldn't fit in the memory's reserved address-space.
+			if(numNewPages > (memory->endOffset >> IR::numBytesPerPageLog2) - memory->numPages) { return -1; }
+
 			// Try to commit the new pages, and return -1 if the commit fails.
+			// Pages are decommitted when the memory shrinks, so newly committed pages are always zero and don't need to be cleared.
 			if(!Platform::commitVirtualPages(
 				memory->baseAddress + (memory->numPages << IR::numBytesPerPageLog2),
 				numNewPages << getPlatformPagesPerWebAssemblyPageLog2()
@@ -114,7 +234,6 @@ namespace Runtime
 			{
 				return -1;
 			}
-			memset(memory->baseAddress + (memory->numPages << IR::numBytesPerPageLog2), 0, numNewPages << IR::numBytesPerPageLog2);
 			memory->numPages += numNewPages;
 		}
 		return previousNumPages;
@@ -31,6 +31,11 @@ namespace Runtime
 	MemoryInstance* theMemoryInstance = nullptr;
 
 	ModuleInstance* instantiateModule(const IR::Module& module,ImportBindings&& imports)
+	{
+		return instantiateModule(module,std::move(imports),nullptr,false);
+	}
+
+	ModuleInstance* instantiateModule(const IR::Module& module,ImportBindings&& imports,ModuleProfile* profile,bool isCollectingProfile)
 	{
 		ModuleInstance* moduleInstance = new ModuleInstance(
 			std::move(imports.functions),
@@ -130,7 +135,7 @@ namespace Runtime
 		}
 
 		// Generate machine code for the module.
-		LLVMJIT::instantiateModule(module,moduleInstance);
+		LLVMJIT::instantiateModule(module,moduleInstance,profile,isCollectingProfile);
 
 		// Set up the instance's exports.
 		for(const Export& exportIt : module.exports)
@@ -172,6 +177,8 @@ namespace Runtime
 			moduleInstance->startFunctionIndex = module.startFunctionIndex;
 		}
 
+		for(MemoryInstance* memory : moduleInstance->memories) { ++memory->numModuleInstances; }
+
 		moduleInstances.push_back(moduleInstance);
 		return moduleInstance;
 	}
@@ -179,11 +186,44 @@ namespace Runtime
 	ModuleInstance::~ModuleInstance()
 	{
 		delete jitModule;
+
+		// Remove the instance from the global array.
+		for(Uptr moduleInstanceIndex = 0;moduleInstanceIndex < moduleInstances.size();++moduleInstanceIndex)
+		{
+			if(moduleInstances[moduleInstanceIndex] == this) { moduleInstances.erase(moduleInstances.begin() + moduleInstanceIndex); break; }
+		}
+	}
+
+	void addModuleInstanceReference(ModuleInstance* moduleInstance)
+	{
+		++moduleInstance->numReferences;
+	}
+
+	void removeModuleInstanceReference(ModuleInstance* moduleInstance)
+	{
+		WAVM_ASSERT_THROW(moduleInstance->numReferences > 0);
+		if(--moduleInstance->numReferences > 0) { return; }
+
+		// Free the objects the instance defined. The generated code is freed along with the instance.
+		for(FunctionInstance* functionInstance : moduleInstance->functionDefs) { delete functionInstance; }
+		for(Uptr tableIndex = moduleInstance->numTableImports;tableIndex < moduleInstance->tables.size();++tableIndex) { delete moduleInstance->tables[tableIndex]; }
+		for(Uptr globalIndex = moduleInstance->numGlobalImports;globalIndex < moduleInstance->globals.size();++globalIndex) { delete moduleInstance->globals[globalIndex]; }
+
+		// Release the instance's memories, which may be shared with other instances.
+		std::vector<MemoryInstance*> memories = std::move(moduleInstance->memories);
+		delete moduleInstance;
+		for(MemoryInstance* memory : memories)
+		{
+			--memory->numModuleInstances;
+			freeMemoryIfUnused(memory);
+		}
 	}
 
 	MemoryInstance* getDefaultMemory(ModuleInstance* moduleInstance) { return moduleInstance->defaultMemory; }
 	uint64_t getDefaultMemorySize(ModuleInstance* moduleInstance) { return moduleInstance->defaultMemory->numPages << IR::numBytesPerPageLog2; }
 	TableInstance* getDefaultTable(ModuleInstance* moduleInstance) { return moduleInstance->defaultTable; }
+	Uptr getInstanceCodeSize(ModuleInstance* moduleInstance) { return moduleInstance->jitModule->getNumCodeBytes(); }
+	Uptr getInstanceNumSharedFunctions(ModuleInstance* moduleInstance) { return moduleInstance->jitModule->getNumSharedFunctionDefs(); }
 
 	void runInstanceStartFunc(ModuleInstance* moduleInstance) {
 		if(moduleInstance->startFunctionIndex != UINTPTR_MAX)
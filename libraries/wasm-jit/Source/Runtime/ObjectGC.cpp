@@ -53,6 +53,16 @@ namespace Runtime
 			}
 		}
 
+		// Module instances with explicit references are also roots.
+		for(auto moduleInstance : moduleInstances)
+		{
+			if(moduleInstance->numReferences && !referencedObjects.count(moduleInstance))
+			{
+				referencedObjects.insert(moduleInstance);
+				pendingScanObjects.push_back(moduleInstance);
+			}
+		}
+
 		const std::vector<ObjectInstance*> intrinsicObjects = Intrinsics::getAllIntrinsicObjects();
 		for(auto object : intrinsicObjects)
 		{
@@ -113,6 +123,16 @@ namespace Runtime
 			}
 		};
 
+		// Module instances that are about to be deleted no longer use any memories that survive.
+		for(auto moduleInstance : moduleInstances)
+		{
+			if(referencedObjects.count(moduleInstance)) { continue; }
+			for(auto memory : moduleInstance->memories)
+			{
+				if(referencedObjects.count(memory)) { --memory->numModuleInstances; }
+			}
+		}
+
 		// Iterate over all objects, and delete objects that weren't referenced directly or indirectly by the root set.
 		GCGlobals& gcGlobals = GCGlobals::get();
 		auto objectIt = gcGlobals.allObjects.begin();
@@ -4,10 +4,13 @@
 #include "Runtime.h"
 #include "RuntimePrivate.h"
 
-#include <iostream>
-
 namespace Runtime
 {
+	THREAD_LOCAL U32 callDepthBudget = 0;
+	THREAD_LOCAL bool isInvokingFunction = false;
+	static U32 maxCallDepth = UINT32_MAX;
+	bool shouldInlineInt128Builtins = false;
+
 	void init()
 	{
 		LLVMJIT::init();
@@ -21,11 +24,12 @@ namespace Runtime
 	std::vector<std::string> describeCallStack(const Platform::CallStack& callStack)
 	{
 		std::vector<std::string> frameDescriptions;
-		for(auto frame : callStack.stackFrames)
+		for(Uptr frameIndex = 0;frameIndex < callStack.numStackFrames;++frameIndex)
 		{
+			const Uptr ip = callStack.stackFrames[frameIndex].ip;
 			std::string frameDescription;
-			if(	LLVMJIT::describeInstructionPointer(frame.ip,frameDescription)
-			||	Platform::describeInstructionPointer(frame.ip,frameDescription))
+			if(	LLVMJIT::describeInstructionPointer(ip,frameDescription)
+			||	Platform::describeInstructionPointer(ip,frameDescription))
 			{
 				frameDescriptions.push_back(frameDescription);
 			}
@@ -34,10 +38,17 @@ namespace Runtime
 		return frameDescriptions;
 	}
 
+	void setMaxCallDepth(U32 inMaxCallDepth)
+	{
+		maxCallDepth = inMaxCallDepth;
+	}
+
+	void setInlineInt128Builtins(bool enable) { shouldInlineInt128Builtins = enable; }
+	bool getInlineInt128Builtins() { return shouldInlineInt128Builtins; }
+
 	[[noreturn]] void causeException(Exception::Cause cause)
 	{
-		auto callStack = Platform::captureCallStack();
-		throw Exception {cause,describeCallStack(callStack)};
+		throw Exception {cause,Platform::captureCallStack()};
 	}
 
 	bool isA(ObjectInstance* object,const ObjectType& type)
@@ -56,28 +67,25 @@ namespace Runtime
 
 	[[noreturn]] void handleHardwareTrap(Platform::HardwareTrapType trapType,Platform::CallStack&& trapCallStack,Uptr trapOperand)
 	{
-      std::cerr << "handle hardware trap\n";
-		std::vector<std::string> callStackDescription = describeCallStack(trapCallStack);
-
 		switch(trapType)
 		{
 		case Platform::HardwareTrapType::accessViolation:
 		{
 			// If the access violation occured in a Table's reserved pages, treat it as an undefined table element runtime error.
-			if(isAddressOwnedByTable(reinterpret_cast<U8*>(trapOperand))) { throw Exception { Exception::Cause::undefinedTableElement, callStackDescription }; }
+			if(isAddressOwnedByTable(reinterpret_cast<U8*>(trapOperand))) { throw Exception { Exception::Cause::undefinedTableElement, trapCallStack }; }
 			// If the access violation occured in a Memory's reserved pages, treat it as an access violation runtime error.
-			else if(isAddressOwnedByMemory(reinterpret_cast<U8*>(trapOperand))) { throw Exception { Exception::Cause::accessViolation, callStackDescription }; }
+			else if(isAddressOwnedByMemory(reinterpret_cast<U8*>(trapOperand))) { throw Exception { Exception::Cause::accessViolation, trapCallStack }; }
 			else
 			{
 				// If the access violation occured outside of a Table or Memory, treat it as a bug (possibly a security hole)
 				// rather than a runtime error in the WebAssembly code.
 				Log::printf(Log::Category::error,"Access violation outside of table or memory reserved addresses. Call stack:\n");
-				for(auto calledFunction : callStackDescription) { Log::printf(Log::Category::error,"  %s\n",calledFunction.c_str()); }
+				for(auto calledFunction : describeCallStack(trapCallStack)) { Log::printf(Log::Category::error,"  %s\n",calledFunction.c_str()); }
 				Errors::fatalf("unsandboxed access violation");
 			}
 		}
-		case Platform::HardwareTrapType::stackOverflow: throw Exception { Exception::Cause::stackOverflow, callStackDescription };
-		case Platform::HardwareTrapType::intDivideByZeroOrOverflow: throw Exception { Exception::Cause::integerDivideByZeroOrIntegerOverflow, callStackDescription };
+		case Platform::HardwareTrapType::stackOverflow: throw Exception { Exception::Cause::stackOverflow, trapCallStack };
+		case Platform::HardwareTrapType::intDivideByZeroOrOverflow: throw Exception { Exception::Cause::integerDivideByZeroOrIntegerOverflow, trapCallStack };
 		default: Errors::unreachable();
 		};
 	}
@@ -107,6 +115,25 @@ namespace Runtime
 		// Get the invoke thunk for this function type.
 		LLVMJIT::InvokeFunctionPointer invokeFunctionPointer = LLVMJIT::getInvokeThunk(functionType);
 
+		// The outermost invocation on a thread starts with the full call depth budget, and nested invocations from
+		// intrinsics continue with what is left of it. Restore the budget when the invocation finishes, since a trap or
+		// exception skips the returns of the JITed functions it unwinds, which would otherwise have restored it.
+		struct CallDepthBudgetGuard
+		{
+			U32 savedCallDepthBudget;
+			bool wasInvokingFunction;
+			CallDepthBudgetGuard(): savedCallDepthBudget(callDepthBudget), wasInvokingFunction(isInvokingFunction)
+			{
+				if(!wasInvokingFunction) { callDepthBudget = maxCallDepth; }
+				isInvokingFunction = true;
+			}
+			~CallDepthBudgetGuard()
+			{
+				callDepthBudget = savedCallDepthBudget;
+				isInvokingFunction = wasInvokingFunction;
+			}
+		} callDepthBudgetGuard;
+
 		// Catch platform-specific runtime exceptions and turn them into Runtime::Values.
 		Result result;
 		Platform::HardwareTrapType trapType;
@@ -17,10 +17,12 @@ namespace LLVMJIT
 	struct JITModuleBase
 	{
 		virtual ~JITModuleBase() {}
+		virtual Uptr getNumCodeBytes() const = 0;
+		virtual Uptr getNumSharedFunctionDefs() const = 0;
 	};
 
 	void init();
-	void instantiateModule(const IR::Module& module,Runtime::ModuleInstance* moduleInstance);
+	void instantiateModule(const IR::Module& module,Runtime::ModuleInstance* moduleInstance,Runtime::ModuleProfile* profile,bool isCollectingProfile);
 	bool describeInstructionPointer(Uptr ip,std::string& outDescription);
 	
 	typedef void (*InvokeFunctionPointer)(void*,U64*);
@@ -88,7 +90,13 @@ namespace Runtime
 		U8* reservedBaseAddress;
 		Uptr reservedNumPlatformPages;
 
-		MemoryInstance(const MemoryType& inType): GCObject(ObjectKind::memory), type(inType), baseAddress(nullptr), numPages(0), endOffset(0), reservedBaseAddress(nullptr), reservedNumPlatformPages(0) {}
+		// True if the memory occupies a slot in the memory slot pool rather than its own reservation.
+		bool isPooled;
+
+		// The number of ModuleInstances that use the memory.
+		Uptr numModuleInstances;
+
+		MemoryInstance(const MemoryType& inType): GCObject(ObjectKind::memory), type(inType), baseAddress(nullptr), numPages(0), endOffset(0), reservedBaseAddress(nullptr), reservedNumPlatformPages(0), isPooled(false), numModuleInstances(0) {}
 		~MemoryInstance() override;
 	};
 
@@ -121,6 +129,13 @@ namespace Runtime
 
 		Uptr startFunctionIndex = UINTPTR_MAX;
 
+		// The number of tables and globals that were imported; the rest of each array was defined by the module.
+		const Uptr numTableImports;
+		const Uptr numGlobalImports;
+
+		// The number of explicit references to the instance.
+		Uptr numReferences;
+
 		ModuleInstance(
 			std::vector<FunctionInstance*>&& inFunctionImports,
 			std::vector<TableInstance*>&& inTableImports,
@@ -135,11 +150,25 @@ namespace Runtime
 		, defaultMemory(nullptr)
 		, defaultTable(nullptr)
 		, jitModule(nullptr)
+		, numTableImports(tables.size())
+		, numGlobalImports(globals.size())
+		, numReferences(0)
 		{}
 
 		~ModuleInstance() override;
 	};
 
+	// The ModuleInstances that haven't been freed.
+	extern std::vector<ModuleInstance*> moduleInstances;
+
+	// The number of calls that may still be nested in the current thread's invocation. Each JITed function traps on entry
+	// if it is zero, and otherwise decrements it until the function returns. JITed code is shared between threads, so it
+	// finds the budget through wavmIntrinsics.getCallDepthBudgetAddress rather than a literal address.
+	extern THREAD_LOCAL U32 callDepthBudget;
+
+	// Whether the JIT emits the 128-bit integer builtins inline; see setInlineInt128Builtins.
+	extern bool shouldInlineInt128Builtins;
+
 	// Initializes global state used by the WAVM intrinsics.
 	void initWAVMIntrinsics();
 
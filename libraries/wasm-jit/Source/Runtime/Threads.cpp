@@ -294,7 +294,7 @@ namespace Runtime
 		{
 			// Log that a runtime exception was handled by a thread error function.
 			Log::printf(Log::Category::error,"Runtime exception in thread: %s\n",describeExceptionCause(exception.cause));
-			for(auto calledFunction : exception.callStack) { Log::printf(Log::Category::error,"  %s\n",calledFunction.c_str()); }
+			for(auto calledFunction : describeCallStack(exception.callStack)) { Log::printf(Log::Category::error,"  %s\n",calledFunction.c_str()); }
 			Log::printf(Log::Category::error,"Passing exception on to thread error handler\n");
 
 			try
@@ -306,7 +306,7 @@ namespace Runtime
 			{
 				// Log that the thread error function caused a runtime exception, and exit with a fatal error.
 				Log::printf(Log::Category::error,"Runtime exception in thread error handler: %s\n",describeExceptionCause(secondException.cause));
-				for(auto calledFunction : secondException.callStack) { Log::printf(Log::Category::error,"  %s\n",calledFunction.c_str()); }
+				for(auto calledFunction : describeCallStack(secondException.callStack)) { Log::printf(Log::Category::error,"  %s\n",calledFunction.c_str()); }
 				Errors::fatalf("double fault");
 			}
 		}
@@ -138,6 +138,11 @@ namespace Runtime
 		causeException(Exception::Cause::accessViolation);
 	}
 
+	DEFINE_INTRINSIC_FUNCTION0(wavmIntrinsics,callStackExhaustedTrap,callStackExhaustedTrap,none)
+	{
+		causeException(Exception::Cause::callStackExhausted);
+	}
+
 	DEFINE_INTRINSIC_FUNCTION3(wavmIntrinsics,indirectCallSignatureMismatch,indirectCallSignatureMismatch,none,i32,index,i64,expectedSignatureBits,i64,tableBits)
 	{
 		TableInstance* table = reinterpret_cast<TableInstance*>(tableBits);
@@ -160,6 +165,17 @@ namespace Runtime
 		causeException(Exception::Cause::undefinedTableElement);
 	}
 
+	DEFINE_INTRINSIC_FUNCTION2(wavmIntrinsics,countIndirectCall,countIndirectCall,none,i32,index,i64,countsBits)
+	{
+		std::map<U32,U64>* counts = reinterpret_cast<std::map<U32,U64>*>(countsBits);
+		++(*counts)[U32(index)];
+	}
+
+	DEFINE_INTRINSIC_FUNCTION0(wavmIntrinsics,getCallDepthBudgetAddress,getCallDepthBudgetAddress,i64)
+	{
+		return reinterpret_cast<I64>(&callDepthBudget);
+	}
+
 	DEFINE_INTRINSIC_FUNCTION2(wavmIntrinsics,_growMemory,growMemory,i32,i32,deltaPages,i64,memoryBits)
 	{
 		MemoryInstance* memory = reinterpret_cast<MemoryInstance*>(memoryBits);
@@ -2,12 +2,15 @@
 #include "Inline/BasicTypes.h"
 #include "Inline/Serialization.h"
 #include "Inline/UTF8.h"
+#include "Platform/Platform.h"
 #include "WASM.h"
 #include "IR/Module.h"
 #include "IR/Operators.h"
 #include "IR/Types.h"
 #include "IR/Validate.h"
 
+#include <exception>
+
 using namespace Serialization;
 
 static void throwIfNotValidUTF8(const std::string& string)
@@ -290,7 +293,13 @@ namespace WASM
 	template<typename Stream>
 	void serialize(Stream& stream,MemoryImm& imm,const FunctionDef&)
 	{
-		serializeConstant(stream,"grow_memory/current_memory immediate reserved field must be 0",U8(0));
+		serializeConstant(stream,"grow_memory/current_memory/memory.fill immediate reserved field must be 0",U8(0));
+	}
+	template<typename Stream>
+	void serialize(Stream& stream,MemoryCopyImm& imm,const FunctionDef&)
+	{
+		serializeConstant(stream,"memory.copy immediate reserved field must be 0",U8(0));
+		serializeConstant(stream,"memory.copy immediate reserved field must be 0",U8(0));
 	}
 
 	#if ENABLE_SIMD_PROTOTYPE
@@ -478,13 +487,10 @@ namespace WASM
 		serialize(sectionStream,bodyBytes);
 	}
 	
-	void serializeFunctionBody(InputStream& sectionStream,Module& module,FunctionDef& functionDef)
+	void serializeFunctionBody(MemoryInputStream& bodyStream,Module& module,FunctionDef& functionDef)
 	{
-		Uptr numBodyBytes = 0;
-		serializeVarUInt32(sectionStream,numBodyBytes);
+		const Uptr numBodyBytes = bodyStream.capacity();
 
-		MemoryInputStream bodyStream(sectionStream.advance(numBodyBytes),numBodyBytes);
-		
 		// Deserialize local sets and unpack them into a linear array of local types.
 		Uptr numLocalSets = 0;
 		serializeVarUInt32(bodyStream,numLocalSets);
@@ -534,6 +540,38 @@ namespace WASM
 		codeValidationStream.finish();
 		functionDef.code = std::move(irCodeByteStream.getBytes());
 	}
+
+	void serializeFunctionBodies(OutputStream& sectionStream,Module& module)
+	{
+		for(FunctionDef& functionDef : module.functions.defs) { serializeFunctionBody(sectionStream,module,functionDef); }
+	}
+
+	void serializeFunctionBodies(InputStream& sectionStream,Module& module)
+	{
+		// Find the bytes of each function body. If the section ends before the last body, remember the error so it can be
+		// thrown after the bodies before it have been checked.
+		std::vector<std::pair<const U8*,Uptr>> functionBodies;
+		std::exception_ptr sectionException;
+		try
+		{
+			for(Uptr functionIndex = 0;functionIndex < module.functions.defs.size();++functionIndex)
+			{
+				Uptr numBodyBytes = 0;
+				serializeVarUInt32(sectionStream,numBodyBytes);
+				functionBodies.push_back({sectionStream.advance(numBodyBytes),numBodyBytes});
+			}
+		}
+		catch(const FatalSerializationException&) { sectionException = std::current_exception(); }
+
+		// Decode and validate the function bodies in parallel. Each body only writes to its own FunctionDef, and the rest of
+		// the module is only read. If several bodies are invalid, the error for the lowest function index is thrown.
+		Platform::parallelFor(functionBodies.size(),[&](Uptr functionIndex)
+		{
+			MemoryInputStream bodyStream(functionBodies[functionIndex].first,functionBodies[functionIndex].second);
+			serializeFunctionBody(bodyStream,module,module.functions.defs[functionIndex]);
+		});
+		if(sectionException) { std::rethrow_exception(sectionException); }
+	}
 	
 	template<typename Stream>
 	void serializeTypeSection(Stream& moduleStream,Module& module)
@@ -763,7 +801,7 @@ namespace WASM
 			serializeVarUInt32(sectionStream,numFunctionBodies);
 			if(Stream::isInput && numFunctionBodies != module.functions.defs.size())
 				{ throw FatalSerializationException("function and code sections have mismatched function counts"); }
-			for(FunctionDef& functionDef : module.functions.defs) { serializeFunctionBody(sectionStream,module,functionDef); }
+			serializeFunctionBodies(sectionStream,module);
 		});
 	}
 
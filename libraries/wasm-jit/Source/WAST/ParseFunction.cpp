@@ -136,6 +136,7 @@ static void parseAndValidateRedundantBranchTargetName(ParseState& state,Name bra
 
 static void parseImm(FunctionParseState& state,NoImm&) {}
 static void parseImm(FunctionParseState& state,MemoryImm& outImm) {}
+static void parseImm(FunctionParseState& state,MemoryCopyImm& outImm) {}
 
 static void parseImm(FunctionParseState& state,LiteralImm<I32>& outImm) { outImm.value = (I32)parseI32(state); }
 static void parseImm(FunctionParseState& state,LiteralImm<I64>& outImm) { outImm.value = (I64)parseI64(state); }
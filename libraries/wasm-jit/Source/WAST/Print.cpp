@@ -334,6 +334,7 @@ namespace WAST
 
 		void printImm(NoImm) {}
 		void printImm(MemoryImm) {}
+		void printImm(MemoryCopyImm) {}
 
 		void printImm(LiteralImm<I32> imm) { string += ' '; string += std::to_string(imm.value); }
 		void printImm(LiteralImm<I64> imm) { string += ' '; string += std::to_string(imm.value); }
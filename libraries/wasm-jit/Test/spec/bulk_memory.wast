@@ -0,0 +1,111 @@
+;; memory.copy and memory.fill
+
+(module
+  (memory 1)
+  (data (i32.const 0) "\00\01\02\03\04\05\06\07\08\09")
+
+  (func (export "load8_u") (param $addr i32) (result i32) (i32.load8_u (get_local $addr)))
+  (func (export "copy") (param $dest i32) (param $src i32) (param $n i32)
+    (memory.copy (get_local $dest) (get_local $src) (get_local $n)))
+  (func (export "fill") (param $dest i32) (param $value i32) (param $n i32)
+    (memory.fill (get_local $dest) (get_local $value) (get_local $n)))
+)
+
+;; Overlapping copy to a higher address.
+(invoke "copy" (i32.const 2) (i32.const 0) (i32.const 8))
+(assert_return (invoke "load8_u" (i32.const 0)) (i32.const 0))
+(assert_return (invoke "load8_u" (i32.const 1)) (i32.const 1))
+(assert_return (invoke "load8_u" (i32.const 2)) (i32.const 0))
+(assert_return (invoke "load8_u" (i32.const 3)) (i32.const 1))
+(assert_return (invoke "load8_u" (i32.const 4)) (i32.const 2))
+(assert_return (invoke "load8_u" (i32.const 5)) (i32.const 3))
+(assert_return (invoke "load8_u" (i32.const 6)) (i32.const 4))
+(assert_return (invoke "load8_u" (i32.const 7)) (i32.const 5))
+(assert_return (invoke "load8_u" (i32.const 8)) (i32.const 6))
+(assert_return (invoke "load8_u" (i32.const 9)) (i32.const 7))
+
+;; Overlapping copy to a lower address.
+(invoke "copy" (i32.const 0) (i32.const 2) (i32.const 8))
+(assert_return (invoke "load8_u" (i32.const 0)) (i32.const 0))
+(assert_return (invoke "load8_u" (i32.const 1)) (i32.const 1))
+(assert_return (invoke "load8_u" (i32.const 2)) (i32.const 2))
+(assert_return (invoke "load8_u" (i32.const 3)) (i32.const 3))
+(assert_return (invoke "load8_u" (i32.const 4)) (i32.const 4))
+(assert_return (invoke "load8_u" (i32.const 5)) (i32.const 5))
+(assert_return (invoke "load8_u" (i32.const 6)) (i32.const 6))
+(assert_return (invoke "load8_u" (i32.const 7)) (i32.const 7))
+(assert_return (invoke "load8_u" (i32.const 8)) (i32.const 6))
+(assert_return (invoke "load8_u" (i32.const 9)) (i32.const 7))
+
+;; Copying a range onto itself leaves it unchanged.
+(invoke "copy" (i32.const 0) (i32.const 0) (i32.const 10))
+(assert_return (invoke "load8_u" (i32.const 0)) (i32.const 0))
+(assert_return (invoke "load8_u" (i32.const 9)) (i32.const 7))
+
+;; Fill, truncating the value to a byte.
+(invoke "fill" (i32.const 0x100) (i32.const 0x1aa) (i32.const 3))
+(assert_return (invoke "load8_u" (i32.const 0xff)) (i32.const 0))
+(assert_return (invoke "load8_u" (i32.const 0x100)) (i32.const 0xaa))
+(assert_return (invoke "load8_u" (i32.const 0x101)) (i32.const 0xaa))
+(assert_return (invoke "load8_u" (i32.const 0x102)) (i32.const 0xaa))
+(assert_return (invoke "load8_u" (i32.const 0x103)) (i32.const 0))
+
+;; Zero-length operations are in bounds up to and including the end of the memory.
+(assert_return (invoke "copy" (i32.const 0x10000) (i32.const 0) (i32.const 0)))
+(assert_return (invoke "copy" (i32.const 0) (i32.const 0x10000) (i32.const 0)))
+(assert_return (invoke "copy" (i32.const 0x10000) (i32.const 0x10000) (i32.const 0)))
+(assert_return (invoke "fill" (i32.const 0x10000) (i32.const 0x55) (i32.const 0)))
+(assert_trap (invoke "copy" (i32.const 0x10001) (i32.const 0) (i32.const 0)) "out of bounds memory access")
+(assert_trap (invoke "copy" (i32.const 0) (i32.const 0x10001) (i32.const 0)) "out of bounds memory access")
+(assert_trap (invoke "fill" (i32.const 0x10001) (i32.const 0x55) (i32.const 0)) "out of bounds memory access")
+
+;; Operations that end exactly at the end of the memory are in bounds.
+(invoke "fill" (i32.const 0xfffe) (i32.const 0x11) (i32.const 2))
+(assert_return (invoke "load8_u" (i32.const 0xfffd)) (i32.const 0))
+(assert_return (invoke "load8_u" (i32.const 0xfffe)) (i32.const 0x11))
+(assert_return (invoke "load8_u" (i32.const 0xffff)) (i32.const 0x11))
+(invoke "copy" (i32.const 0xfffe) (i32.const 2) (i32.const 2))
+(assert_return (invoke "load8_u" (i32.const 0xfffe)) (i32.const 2))
+(assert_return (invoke "load8_u" (i32.const 0xffff)) (i32.const 3))
+
+;; Operations that go out of bounds trap without writing any of their bytes, even those that are in bounds.
+(assert_trap (invoke "fill" (i32.const 0xfff8) (i32.const 0x55) (i32.const 9)) "out of bounds memory access")
+(assert_return (invoke "load8_u" (i32.const 0xfff8)) (i32.const 0))
+(assert_return (invoke "load8_u" (i32.const 0xfffd)) (i32.const 0))
+(assert_return (invoke "load8_u" (i32.const 0xfffe)) (i32.const 2))
+(assert_return (invoke "load8_u" (i32.const 0xffff)) (i32.const 3))
+
+(assert_trap (invoke "copy" (i32.const 0xfff8) (i32.const 0) (i32.const 9)) "out of bounds memory access")
+(assert_return (invoke "load8_u" (i32.const 0xfff8)) (i32.const 0))
+(assert_return (invoke "load8_u" (i32.const 0xfff9)) (i32.const 0))
+(assert_return (invoke "load8_u" (i32.const 0xfffe)) (i32.const 2))
+(assert_return (invoke "load8_u" (i32.const 0xffff)) (i32.const 3))
+
+(assert_trap (invoke "copy" (i32.const 0) (i32.const 0xfff8) (i32.const 9)) "out of bounds memory access")
+(assert_return (invoke "load8_u" (i32.const 0)) (i32.const 0))
+(assert_return (invoke "load8_u" (i32.const 1)) (i32.const 1))
+(assert_return (invoke "load8_u" (i32.const 8)) (i32.const 6))
+
+;; The index and length don't wrap around.
+(assert_trap (invoke "fill" (i32.const 1) (i32.const 0x55) (i32.const -1)) "out of bounds memory access")
+(assert_trap (invoke "copy" (i32.const -1) (i32.const 0) (i32.const 1)) "out of bounds memory access")
+(assert_trap (invoke "copy" (i32.const 0) (i32.const -1) (i32.const 1)) "out of bounds memory access")
+(assert_return (invoke "load8_u" (i32.const 1)) (i32.const 1))
+(assert_return (invoke "load8_u" (i32.const 2)) (i32.const 2))
+
+;; The bounds are those of the memory's current size.
+(module
+  (memory 0 2)
+
+  (func (export "grow") (param $delta i32) (result i32) (grow_memory (get_local $delta)))
+  (func (export "load8_u") (param $addr i32) (result i32) (i32.load8_u (get_local $addr)))
+  (func (export "fill") (param $dest i32) (param $value i32) (param $n i32)
+    (memory.fill (get_local $dest) (get_local $value) (get_local $n)))
+)
+
+(assert_return (invoke "fill" (i32.const 0) (i32.const 0x55) (i32.const 0)))
+(assert_trap (invoke "fill" (i32.const 0) (i32.const 0x55) (i32.const 1)) "out of bounds memory access")
+(assert_return (invoke "grow" (i32.const 1)) (i32.const 0))
+(invoke "fill" (i32.const 0xffff) (i32.const 0x55) (i32.const 1))
+(assert_return (invoke "load8_u" (i32.const 0xffff)) (i32.const 0x55))
+(assert_trap (invoke "fill" (i32.const 0xffff) (i32.const 0x55) (i32.const 2)) "out of bounds memory access")
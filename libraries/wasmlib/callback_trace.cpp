@@ -0,0 +1,719 @@
+#include "callback_trace.hpp"
+#include "exceptions.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <mutex>
+#include <string.h>
+
+namespace ftl {
+
+    //a trace is the magic, the version, which of the optional callbacks the host provided, the inputs, then a record
+    //per callback and an end record. integers are LEB128, byte strings their length followed by their bytes
+    static const char trace_magic[4] = {'F', 'T', 'R', 'C'};
+    static const uint64_t trace_version = 1;
+
+    enum record_kind : uint8_t {
+        store_record,
+        load_record,
+        has_key_record,
+        remove_key_record,
+        has_table_record,
+        remove_table_record,
+        current_time_record,
+        current_height_record,
+        current_hash_record,
+        add_log_record,
+        transfer_record,
+        call_action_record,
+        call_result_record,
+        set_result_record,
+        sha256_record,
+        enter_action_record,
+        load_code_record,
+        leave_action_record,
+        apply_effects_record,
+        end_record,
+    };
+
+    static const char *record_names[] = {
+            "store",
+            "load",
+            "has_key",
+            "remove_key",
+            "has_table",
+            "remove_table",
+            "current_time",
+            "current_height",
+            "current_hash",
+            "add_log",
+            "transfer",
+            "call_action",
+            "call_result",
+            "set_result",
+            "sha256",
+            "enter_action",
+            "load_code",
+            "leave_action",
+            "apply_effects",
+            "end",
+    };
+    static_assert(sizeof(record_names) / sizeof(record_names[0]) == end_record + 1, "a record has no name");
+
+    enum optional_callback : uint8_t {
+        has_enter_action = 1,
+        has_load_code = 2,
+        has_leave_action = 4,
+        has_apply_effects = 8,
+    };
+
+    static thread_local callback_recorder *active_recorder = nullptr;
+    static thread_local callback_replayer *active_replayer = nullptr;
+
+    //g_sha256 is shared by all threads, so it may reach a recording callback on a thread that isn't recording
+    static c_sha256 *host_sha256 = nullptr;
+
+    //the length of what a callback wrote into a buffer of capacity bytes, going by what it returned
+    static size_t written(int ret, int capacity) {
+        return std::max(0, std::min(ret, capacity));
+    }
+
+    struct recording_callbacks {
+        static void store(uint64_t callbackParamKey, uint64_t table, char *key, int keyLength, char *value,
+                          int valueLength) {
+            callback_recorder &r = *active_recorder;
+            r._host.cb_store(callbackParamKey, table, key, keyLength, value, valueLength);
+            r.put(store_record);
+            r.put(callbackParamKey);
+            r.put(table);
+            r.put(key, keyLength);
+            r.put(value, valueLength);
+        }
+
+        static int load(uint64_t callbackParamKey, uint64_t table, char *key, int keyLength, char *value,
+                        int valueLength) {
+            callback_recorder &r = *active_recorder;
+            int ret = r._host.cb_load(callbackParamKey, table, key, keyLength, value, valueLength);
+            r.put(load_record);
+            r.put(callbackParamKey);
+            r.put(table);
+            r.put(key, keyLength);
+            r.put(valueLength);
+            r.put(ret);
+            r.put(value, written(ret, valueLength));
+            return ret;
+        }
+
+        static int has_key(uint64_t callbackParamKey, uint64_t table, char *key, int keyLength) {
+            callback_recorder &r = *active_recorder;
+            int ret = r._host.cb_has_key(callbackParamKey, table, key, keyLength);
+            r.put(has_key_record);
+            r.put(callbackParamKey);
+            r.put(table);
+            r.put(key, keyLength);
+            r.put(ret);
+            return ret;
+        }
+
+        static void remove_key(uint64_t callbackParamKey, uint64_t table, char *key, int keyLength) {
+            callback_recorder &r = *active_recorder;
+            r._host.cb_remove_key(callbackParamKey, table, key, keyLength);
+            r.put(remove_key_record);
+            r.put(callbackParamKey);
+            r.put(table);
+            r.put(key, keyLength);
+        }
+
+        static int has_table(uint64_t callbackParamKey, uint64_t table) {
+            callback_recorder &r = *active_recorder;
+            int ret = r._host.cb_has_table(callbackParamKey, table);
+            r.put(has_table_record);
+            r.put(callbackParamKey);
+            r.put(table);
+            r.put(ret);
+            return ret;
+        }
+
+        static void remove_table(uint64_t callbackParamKey, uint64_t table) {
+            callback_recorder &r = *active_recorder;
+            r._host.cb_remove_table(callbackParamKey, table);
+            r.put(remove_table_record);
+            r.put(callbackParamKey);
+            r.put(table);
+        }
+
+        static uint64_t current_time(uint64_t callbackParamKey) {
+            callback_recorder &r = *active_recorder;
+            uint64_t ret = r._host.cb_current_time(callbackParamKey);
+            r.put(current_time_record);
+            r.put(callbackParamKey);
+            r.put(ret);
+            return ret;
+        }
+
+        static uint64_t current_height(uint64_t callbackParamKey) {
+            callback_recorder &r = *active_recorder;
+            uint64_t ret = r._host.cb_current_height(callbackParamKey);
+            r.put(current_height_record);
+            r.put(callbackParamKey);
+            r.put(ret);
+            return ret;
+        }
+
+        static void current_hash(uint64_t callbackParamKey, char *simple_hash, char *full_hash) {
+            callback_recorder &r = *active_recorder;
+            r._host.cb_current_hash(callbackParamKey, simple_hash, full_hash);
+            r.put(current_hash_record);
+            r.put(callbackParamKey);
+            r.put(simple_hash, 32);
+            r.put(full_hash, 32);
+        }
+
+        static void add_log(uint64_t callbackParamKey, char *topics, int topicNum, const char *data, int dataLength) {
+            callback_recorder &r = *active_recorder;
+            r._host.cb_add_log(callbackParamKey, topics, topicNum, data, dataLength);
+            r.put(add_log_record);
+            r.put(callbackParamKey);
+            r.put(topics, topicNum * 32);
+            r.put(data, dataLength);
+        }
+
+        static void transfer(uint64_t callbackParamKey, char *to, uint64_t amount) {
+            callback_recorder &r = *active_recorder;
+            r._host.cb_transfer(callbackParamKey, to, amount);
+            r.put(transfer_record);
+            r.put(callbackParamKey);
+            r.put(to, 20);
+            r.put(amount);
+        }
+
+        static int call_action(uint64_t callbackParamKey, char *to, char *action, int actionLength, uint64_t amount,
+                               int storageDelegate, int userDelegate) {
+            callback_recorder &r = *active_recorder;
+            //the host runs the callee as an execution of its own, which mustn't record into this trace
+            active_recorder = nullptr;
+            int ret = r._host.cb_call_action(callbackParamKey, to, action, actionLength, amount, storageDelegate,
+                                             userDelegate);
+            active_recorder = &r;
+            r.put(call_action_record);
+            r.put(callbackParamKey);
+            r.put(to, 20);
+            r.put(action, actionLength);
+            r.put(amount);
+            r.put(storageDelegate);
+            r.put(userDelegate);
+            r.put(ret);
+            return ret;
+        }
+
+        static int call_result(uint64_t callbackParamKey, char *result, int resultLength) {
+            callback_recorder &r = *active_recorder;
+            int ret = r._host.cb_call_result(callbackParamKey, result, resultLength);
+            r.put(call_result_record);
+            r.put(callbackParamKey);
+            r.put(resultLength);
+            r.put(ret);
+            r.put(result, written(ret, resultLength));
+            return ret;
+        }
+
+        static int set_result(uint64_t callbackParamKey, char *result, int resultLength) {
+            callback_recorder &r = *active_recorder;
+            int ret = r._host.cb_set_result(callbackParamKey, result, resultLength);
+            r.put(set_result_record);
+            r.put(callbackParamKey);
+            r.put(result, resultLength);
+            r.put(ret);
+            return ret;
+        }
+
+        static int sha256(char *input, int length, char *hash) {
+            if (!active_recorder)
+                return host_sha256(input, length, hash);
+            callback_recorder &r = *active_recorder;
+            int ret = r._host.cb_sha256(input, length, hash);
+            r.put(sha256_record);
+            r.put(input, length);
+            r.put(ret);
+            r.put(hash, 32);
+            return ret;
+        }
+
+        static uint64_t enter_action(uint64_t callbackParamKey, char *to, uint64_t amount, int storageDelegate,
+                                     int userDelegate, char *ownerAddr, char *userAddr) {
+            callback_recorder &r = *active_recorder;
+            uint64_t ret = r._host.cb_enter_action(callbackParamKey, to, amount, storageDelegate, userDelegate,
+                                                   ownerAddr, userAddr);
+            r.put(enter_action_record);
+            r.put(callbackParamKey);
+            r.put(to, 20);
+            r.put(amount);
+            r.put(storageDelegate);
+            r.put(userDelegate);
+            r.put(ret);
+            r.put(ownerAddr, ret ? 20 : 0);
+            r.put(userAddr, ret ? 20 : 0);
+            return ret;
+        }
+
+        static int load_code(uint64_t callbackParamKey, char *code, int codeLength) {
+            callback_recorder &r = *active_recorder;
+            int ret = r._host.cb_load_code(callbackParamKey, code, codeLength);
+            r.put(load_code_record);
+            r.put(callbackParamKey);
+            r.put(codeLength);
+            r.put(ret);
+            r.put(code, written(ret, codeLength));
+            return ret;
+        }
+
+        static void leave_action(uint64_t callbackParamKey, int failed) {
+            callback_recorder &r = *active_recorder;
+            r._host.cb_leave_action(callbackParamKey, failed);
+            r.put(leave_action_record);
+            r.put(callbackParamKey);
+            r.put(failed);
+        }
+
+        static void apply_effects(uint64_t callbackParamKey, const char *journal, int journalLength) {
+            callback_recorder &r = *active_recorder;
+            r._host.cb_apply_effects(callbackParamKey, journal, journalLength);
+            r.put(apply_effects_record);
+            r.put(callbackParamKey);
+            r.put(journal, journalLength);
+        }
+    };
+
+    callback_recorder::callback_recorder(const trace_inputs &inputs, const Callbacks &host)
+            : _host(host), _previous(active_recorder) {
+        _trace.insert(_trace.end(), trace_magic, trace_magic + sizeof(trace_magic));
+        put(trace_version);
+        put((host.cb_enter_action ? has_enter_action : 0) | (host.cb_load_code ? has_load_code : 0) |
+            (host.cb_leave_action ? has_leave_action : 0) | (host.cb_apply_effects ? has_apply_effects : 0));
+        put(inputs.code.data(), inputs.code.size());
+        put(inputs.action.data(), inputs.action.size());
+        put(inputs.from, sizeof(inputs.from));
+        put(inputs.to, sizeof(inputs.to));
+        put(inputs.owner, sizeof(inputs.owner));
+        put(inputs.user, sizeof(inputs.user));
+        put(inputs.transfer_amount);
+        put(inputs.gas);
+        put(inputs.state_key);
+        put(inputs.timeout_microseconds);
+
+        //the optional callbacks stay missing, since the execution takes another path without them
+        _callbacks.cb_store = &recording_callbacks::store;
+        _callbacks.cb_load = &recording_callbacks::load;
+        _callbacks.cb_has_key = &recording_callbacks::has_key;
+        _callbacks.cb_remove_key = &recording_callbacks::remove_key;
+        _callbacks.cb_has_table = &recording_callbacks::has_table;
+        _callbacks.cb_remove_table = &recording_callbacks::remove_table;
+        _callbacks.cb_current_time = &recording_callbacks::current_time;
+        _callbacks.cb_current_height = &recording_callbacks::current_height;
+        _callbacks.cb_current_hash = &recording_callbacks::current_hash;
+        _callbacks.cb_add_log = &recording_callbacks::add_log;
+        _callbacks.cb_transfer = &recording_callbacks::transfer;
+        _callbacks.cb_call_action = &recording_callbacks::call_action;
+        _callbacks.cb_call_result = &recording_callbacks::call_result;
+        _callbacks.cb_set_result = &recording_callbacks::set_result;
+        _callbacks.cb_sha256 = &recording_callbacks::sha256;
+        _callbacks.cb_enter_action = host.cb_enter_action ? &recording_callbacks::enter_action : nullptr;
+        _callbacks.cb_load_code = host.cb_load_code ? &recording_callbacks::load_code : nullptr;
+        _callbacks.cb_leave_action = host.cb_leave_action ? &recording_callbacks::leave_action : nullptr;
+        _callbacks.cb_apply_effects = host.cb_apply_effects ? &recording_callbacks::apply_effects : nullptr;
+
+        host_sha256 = host.cb_sha256;
+        active_recorder = this;
+    }
+
+    callback_recorder::~callback_recorder() {
+        active_recorder = _previous;
+    }
+
+    void callback_recorder::finish(int ret, uint64_t remained_gas) {
+        put(end_record);
+        put(int64_t(ret));
+        put(remained_gas);
+    }
+
+    void callback_recorder::save(const std::string &path) const {
+        std::ofstream file(path, std::ios::binary | std::ios::trunc);
+        file.write((const char *) _trace.data(), _trace.size());
+        if (!file)
+            std::cout << "err: can't write trace to " << path << std::endl;
+    }
+
+    void callback_recorder::put(uint64_t value) {
+        do {
+            uint8_t byte = value & 0x7f;
+            value >>= 7;
+            _trace.push_back(value ? byte | 0x80 : byte);
+        } while (value);
+    }
+
+    void callback_recorder::put(const void *data, size_t size) {
+        put(size);
+        _trace.insert(_trace.end(), (const uint8_t *) data, (const uint8_t *) data + size);
+    }
+
+    struct replaying_callbacks {
+        static void store(uint64_t callbackParamKey, uint64_t table, char *key, int keyLength, char *value,
+                          int valueLength) {
+            callback_replayer &r = *active_replayer;
+            r.expect(store_record);
+            r.expect(callbackParamKey, "callback key");
+            r.expect(table, "table");
+            r.expect(key, keyLength, "key");
+            r.expect(value, valueLength, "value");
+        }
+
+        static int load(uint64_t callbackParamKey, uint64_t table, char *key, int keyLength, char *value,
+                        int valueLength) {
+            callback_replayer &r = *active_replayer;
+            r.expect(load_record);
+            r.expect(callbackParamKey, "callback key");
+            r.expect(table, "table");
+            r.expect(key, keyLength, "key");
+            r.expect(valueLength, "buffer length");
+            int ret = r.get();
+            r.output(value, valueLength);
+            return ret;
+        }
+
+        static int has_key(uint64_t callbackParamKey, uint64_t table, char *key, int keyLength) {
+            callback_replayer &r = *active_replayer;
+            r.expect(has_key_record);
+            r.expect(callbackParamKey, "callback key");
+            r.expect(table, "table");
+            r.expect(key, keyLength, "key");
+            return r.get();
+        }
+
+        static void remove_key(uint64_t callbackParamKey, uint64_t table, char *key, int keyLength) {
+            callback_replayer &r = *active_replayer;
+            r.expect(remove_key_record);
+            r.expect(callbackParamKey, "callback key");
+            r.expect(table, "table");
+            r.expect(key, keyLength, "key");
+        }
+
+        static int has_table(uint64_t callbackParamKey, uint64_t table) {
+            callback_replayer &r = *active_replayer;
+            r.expect(has_table_record);
+            r.expect(callbackParamKey, "callback key");
+            r.expect(table, "table");
+            return r.get();
+        }
+
+        static void remove_table(uint64_t callbackParamKey, uint64_t table) {
+            callback_replayer &r = *active_replayer;
+            r.expect(remove_table_record);
+            r.expect(callbackParamKey, "callback key");
+            r.expect(table, "table");
+        }
+
+        static uint64_t current_time(uint64_t callbackParamKey) {
+            callback_replayer &r = *active_replayer;
+            r.expect(current_time_record);
+            r.expect(callbackParamKey, "callback key");
+            return r.get();
+        }
+
+        static uint64_t current_height(uint64_t callbackParamKey) {
+            callback_replayer &r = *active_replayer;
+            r.expect(current_height_record);
+            r.expect(callbackParamKey, "callback key");
+            return r.get();
+        }
+
+        static void current_hash(uint64_t callbackParamKey, char *simple_hash, char *full_hash) {
+            callback_replayer &r = *active_replayer;
+            r.expect(current_hash_record);
+            r.expect(callbackParamKey, "callback key");
+            r.output(simple_hash, 32);
+            r.output(full_hash, 32);
+        }
+
+        static void add_log(uint64_t callbackParamKey, char *topics, int topicNum, const char *data, int dataLength) {
+            callback_replayer &r = *active_replayer;
+            r.expect(add_log_record);
+            r.expect(callbackParamKey, "callback key");
+            r.expect(topics, topicNum * 32, "topics");
+            r.expect(data, dataLength, "data");
+        }
+
+        static void transfer(uint64_t callbackParamKey, char *to, uint64_t amount) {
+            callback_replayer &r = *active_replayer;
+            r.expect(transfer_record);
+            r.expect(callbackParamKey, "callback key");
+            r.expect(to, 20, "recipient");
+            r.expect(amount, "amount");
+        }
+
+        static int call_action(uint64_t callbackParamKey, char *to, char *action, int actionLength, uint64_t amount,
+                               int storageDelegate, int userDelegate) {
+            callback_replayer &r = *active_replayer;
+            r.expect(call_action_record);
+            r.expect(callbackParamKey, "callback key");
+            r.expect(to, 20, "callee");
+            r.expect(action, actionLength, "action");
+            r.expect(amount, "amount");
+            r.expect(storageDelegate, "storage delegate");
+            r.expect(userDelegate, "user delegate");
+            return r.get();
+        }
+
+        static int call_result(uint64_t callbackParamKey, char *result, int resultLength) {
+            callback_replayer &r = *active_replayer;
+            r.expect(call_result_record);
+            r.expect(callbackParamKey, "callback key");
+            r.expect(resultLength, "buffer length");
+            int ret = r.get();
+            r.output(result, resultLength);
+            return ret;
+        }
+
+        static int set_result(uint64_t callbackParamKey, char *result, int resultLength) {
+            callback_replayer &r = *active_replayer;
+            r.expect(set_result_record);
+            r.expect(callbackParamKey, "callback key");
+            r.expect(result, resultLength, "result");
+            return r.get();
+        }
+
+        static int sha256(char *input, int length, char *hash) {
+            if (!active_replayer)
+                throw trace_divergence_exception("sha256 outside of a replay");
+            callback_replayer &r = *active_replayer;
+            r.expect(sha256_record);
+            r.expect(input, length, "input");
+            int ret = r.get();
+            r.output(hash, 32);
+            return ret;
+        }
+
+        static uint64_t enter_action(uint64_t callbackParamKey, char *to, uint64_t amount, int storageDelegate,
+                                     int userDelegate, char *ownerAddr, char *userAddr) {
+            callback_replayer &r = *active_replayer;
+            r.expect(enter_action_record);
+            r.expect(callbackParamKey, "callback key");
+            r.expect(to, 20, "callee");
+            r.expect(amount, "amount");
+            r.expect(storageDelegate, "storage delegate");
+            r.expect(userDelegate, "user delegate");
+            uint64_t ret = r.get();
+            r.output(ownerAddr, 20);
+            r.output(userAddr, 20);
+            return ret;
+        }
+
+        static int load_code(uint64_t callbackParamKey, char *code, int codeLength) {
+            callback_replayer &r = *active_replayer;
+            r.expect(load_code_record);
+            r.expect(callbackParamKey, "callback key");
+            r.expect(codeLength, "buffer length");
+            int ret = r.get();
+            r.output(code, codeLength);
+            return ret;
+        }
+
+        static void leave_action(uint64_t callbackParamKey, int failed) {
+            callback_replayer &r = *active_replayer;
+            r.expect(leave_action_record);
+            r.expect(callbackParamKey, "callback key");
+            r.expect(failed, "failure");
+        }
+
+        static void apply_effects(uint64_t callbackParamKey, const char *journal, int journalLength) {
+            callback_replayer &r = *active_replayer;
+            r.expect(apply_effects_record);
+            r.expect(callbackParamKey, "callback key");
+            r.expect(journal, journalLength, "journal");
+        }
+    };
+
+    callback_replayer::callback_replayer(const bytes &trace) : _trace(trace), _previous(active_replayer) {
+        active_replayer = this;
+        if (_trace.size() < sizeof(trace_magic) || memcmp(_trace.data(), trace_magic, sizeof(trace_magic))) {
+            active_replayer = _previous;
+            throw trace_divergence_exception("not a trace");
+        }
+        _position = sizeof(trace_magic);
+
+        uint8_t optional_callbacks;
+        try {
+            if (get() != trace_version)
+                diverge("unsupported trace version");
+            optional_callbacks = get();
+            get(_inputs.code);
+            get(_inputs.action);
+            get(_inputs.from, sizeof(_inputs.from));
+            get(_inputs.to, sizeof(_inputs.to));
+            get(_inputs.owner, sizeof(_inputs.owner));
+            get(_inputs.user, sizeof(_inputs.user));
+            _inputs.transfer_amount = get();
+            _inputs.gas = get();
+            _inputs.state_key = get();
+            _inputs.timeout_microseconds = get();
+        } catch (...) {
+            active_replayer = _previous;
+            throw;
+        }
+
+        _callbacks.cb_store = &replaying_callbacks::store;
+        _callbacks.cb_load = &replaying_callbacks::load;
+        _callbacks.cb_has_key = &replaying_callbacks::has_key;
+        _callbacks.cb_remove_key = &replaying_callbacks::remove_key;
+        _callbacks.cb_has_table = &replaying_callbacks::has_table;
+        _callbacks.cb_remove_table = &replaying_callbacks::remove_table;
+        _callbacks.cb_current_time = &replaying_callbacks::current_time;
+        _callbacks.cb_current_height = &replaying_callbacks::current_height;
+        _callbacks.cb_current_hash = &replaying_callbacks::current_hash;
+        _callbacks.cb_add_log = &replaying_callbacks::add_log;
+        _callbacks.cb_transfer = &replaying_callbacks::transfer;
+        _callbacks.cb_call_action = &replaying_callbacks::call_action;
+        _callbacks.cb_call_result = &replaying_callbacks::call_result;
+        _callbacks.cb_set_result = &replaying_callbacks::set_result;
+        _callbacks.cb_sha256 = &replaying_callbacks::sha256;
+        _callbacks.cb_enter_action = optional_callbacks & has_enter_action ? &replaying_callbacks::enter_action
+                                                                           : nullptr;
+        _callbacks.cb_load_code = optional_callbacks & has_load_code ? &replaying_callbacks::load_code : nullptr;
+        _callbacks.cb_leave_action = optional_callbacks & has_leave_action ? &replaying_callbacks::leave_action
+                                                                           : nullptr;
+        _callbacks.cb_apply_effects = optional_callbacks & has_apply_effects ? &replaying_callbacks::apply_effects
+                                                                             : nullptr;
+    }
+
+    callback_replayer::~callback_replayer() {
+        active_replayer = _previous;
+    }
+
+    std::string callback_replayer::finish(int ret, uint64_t remained_gas) {
+        if (!_divergence.empty())
+            return _divergence;
+
+        try {
+            expect(end_record);
+            expect(int64_t(ret), "return code");
+            expect(remained_gas, "remained gas");
+            if (_position != _trace.size())
+                diverge("trace goes on after its end");
+        } catch (const trace_divergence_exception &) {
+        }
+        return _divergence;
+    }
+
+    bool callback_replayer::replaying() {
+        return active_replayer != nullptr;
+    }
+
+    uint64_t callback_replayer::get() {
+        uint64_t value = 0;
+        for (int shift = 0;; shift += 7) {
+            if (_position == _trace.size() || shift > 63)
+                diverge("trace is truncated");
+            uint8_t byte = _trace[_position++];
+            value |= uint64_t(byte & 0x7f) << shift;
+            if (!(byte & 0x80))
+                return value;
+        }
+    }
+
+    void callback_replayer::get(bytes &data) {
+        uint64_t size = get();
+        if (size > _trace.size() - _position)
+            diverge("trace is truncated");
+        data.assign(_trace.begin() + _position, _trace.begin() + _position + size);
+        _position += size;
+    }
+
+    void callback_replayer::get(void *data, size_t size) {
+        if (get() != size || size > _trace.size() - _position)
+            diverge("trace is truncated");
+        memcpy(data, _trace.data() + _position, size);
+        _position += size;
+    }
+
+    void callback_replayer::diverge(const std::string &what) {
+        if (_divergence.empty())
+            _divergence = what + " at offset " + std::to_string(_position) + " of the trace";
+        throw trace_divergence_exception(_divergence);
+    }
+
+    void callback_replayer::expect(uint8_t kind) {
+        //a replay that diverged doesn't go on, even if the execution caught the divergence
+        if (!_divergence.empty())
+            throw trace_divergence_exception(_divergence);
+        if (_position == _trace.size())
+            diverge(std::string("callback to ") + record_names[kind] + " after the last recorded one");
+        uint8_t recorded = _trace[_position];
+        if (recorded != kind)
+            diverge(std::string("callback to ") + record_names[kind] + " instead of to " +
+                    (recorded <= end_record ? record_names[recorded] : "an unknown callback"));
+        _position++;
+    }
+
+    void callback_replayer::expect(uint64_t value, const char *what) {
+        size_t position = _position;
+        uint64_t recorded = get();
+        if (recorded != value) {
+            _position = position;
+            diverge(std::string(what) + " is " + std::to_string(value) + " instead of " + std::to_string(recorded));
+        }
+    }
+
+    void callback_replayer::expect(const void *data, size_t size, const char *what) {
+        size_t position = _position;
+        uint64_t recorded_size = get();
+        if (recorded_size > _trace.size() - _position)
+            diverge("trace is truncated");
+        if (recorded_size != size || memcmp(data, _trace.data() + _position, size)) {
+            _position = position;
+            diverge(std::string(what) + " differs");
+        }
+        _position += size;
+    }
+
+    void callback_replayer::output(void *buffer, size_t capacity) {
+        uint64_t size = get();
+        if (size > _trace.size() - _position)
+            diverge("trace is truncated");
+        memcpy(buffer, _trace.data() + _position, std::min(size, uint64_t(capacity)));
+        _position += size;
+    }
+
+    //checked without the lock, so executions pay nothing for recording while it's off
+    static std::atomic<bool> recording_on(false);
+    static std::mutex recording_lock;
+    static std::string recording_directory;
+    static uint64_t recording_started;
+    static uint64_t recorded_traces;
+
+    void start_recording(const std::string &directory) {
+        std::lock_guard<std::mutex> l(recording_lock);
+        recording_directory = directory;
+        //traces of an earlier recording into the same directory are kept
+        recording_started = std::chrono::duration_cast<std::chrono::seconds>(
+                std::chrono::system_clock::now().time_since_epoch()).count();
+        recorded_traces = 0;
+        recording_on.store(!directory.empty(), std::memory_order_relaxed);
+    }
+
+    void stop_recording() {
+        std::lock_guard<std::mutex> l(recording_lock);
+        recording_on.store(false, std::memory_order_relaxed);
+        recording_directory.clear();
+    }
+
+    std::string next_trace_path() {
+        if (!recording_on.load(std::memory_order_relaxed))
+            return std::string();
+        std::lock_guard<std::mutex> l(recording_lock);
+        if (recording_directory.empty())
+            return std::string();
+        return recording_directory + "/" + std::to_string(recording_started) + "-" +
+               std::to_string(recorded_traces++) + ".trace";
+    }
+
+}
@@ -0,0 +1,73 @@
+#include "deadline.hpp"
+#include <condition_variable>
+#include <map>
+#include <mutex>
+#include <thread>
+
+namespace ftl {
+
+    //one thread sleeps until the earliest armed deadline and expires every deadline that has passed when it wakes
+    class deadline_watchdog {
+    public:
+        static deadline_watchdog &get() {
+            //the thread is detached and never stops, so the watchdog is never destroyed either
+            static deadline_watchdog *watchdog = new deadline_watchdog();
+            return *watchdog;
+        }
+
+        void arm(deadline *d) {
+            std::lock_guard<std::mutex> l(_lock);
+            auto it = _deadlines.emplace(d->_at, d);
+            if (it == _deadlines.begin())
+                _changed.notify_one();
+        }
+
+        void disarm(deadline *d) {
+            std::lock_guard<std::mutex> l(_lock);
+            auto range = _deadlines.equal_range(d->_at);
+            for (auto it = range.first; it != range.second; ++it) {
+                if (it->second == d) {
+                    _deadlines.erase(it);
+                    break;
+                }
+            }
+        }
+
+    private:
+        deadline_watchdog() {
+            std::thread(&deadline_watchdog::run, this).detach();
+        }
+
+        void run() {
+            std::unique_lock<std::mutex> l(_lock);
+            while (true) {
+                if (_deadlines.empty()) {
+                    _changed.wait(l);
+                    continue;
+                }
+
+                auto now = std::chrono::steady_clock::now();
+                while (!_deadlines.empty() && _deadlines.begin()->first <= now) {
+                    _deadlines.begin()->second->_expired.store(true, std::memory_order_relaxed);
+                    _deadlines.erase(_deadlines.begin());
+                }
+                if (!_deadlines.empty())
+                    _changed.wait_until(l, _deadlines.begin()->first);
+            }
+        }
+
+        std::mutex _lock;
+        std::condition_variable _changed;
+        std::multimap<std::chrono::steady_clock::time_point, deadline *> _deadlines;
+    };
+
+    deadline::deadline(std::chrono::microseconds timeout)
+            : _at(std::chrono::steady_clock::now() + timeout), _expired(false) {
+        deadline_watchdog::get().arm(this);
+    }
+
+    deadline::~deadline() {
+        deadline_watchdog::get().disarm(this);
+    }
+
+}
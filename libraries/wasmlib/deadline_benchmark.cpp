@@ -0,0 +1,64 @@
+#include "deadline.hpp"
+
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+
+using namespace ftl;
+
+//the check wasm_context::use_gas makes at every metering point, without the rest of the context
+static bool __attribute__((noinline)) use_gas(const deadline *execution_deadline, int64_t &remained_gas, int64_t gas) {
+    if (execution_deadline && execution_deadline->expired())
+        return false;
+    if (remained_gas < gas)
+        return false;
+    remained_gas -= gas;
+    return true;
+}
+
+static double meter_seconds(const deadline *execution_deadline, size_t num_metering_points) {
+    int64_t remained_gas = num_metering_points;
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < num_metering_points; i++) {
+        if (!use_gas(execution_deadline, remained_gas, 1)) {
+            std::cerr << "metering stopped early" << std::endl;
+            std::exit(EXIT_FAILURE);
+        }
+    }
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+int main(int argc, char **argv) {
+    const size_t num_metering_points = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 100000000;
+    const size_t num_deadlines = 100000;
+
+    const double unarmed_seconds = meter_seconds(nullptr, num_metering_points);
+    double armed_seconds;
+    {
+        deadline execution_deadline(std::chrono::hours(1));
+        armed_seconds = meter_seconds(&execution_deadline, num_metering_points);
+    }
+
+    //what every execution with a deadline pays to arm and disarm it
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < num_deadlines; i++)
+        deadline execution_deadline(std::chrono::seconds(1));
+    const double arm_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    //how late after its deadline an execution that's metering sees it expire
+    const std::chrono::microseconds timeout(1000);
+    start = std::chrono::steady_clock::now();
+    deadline execution_deadline(timeout);
+    while (!execution_deadline.expired())
+        ;
+    const double expiry_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() -
+                                  std::chrono::duration<double>(timeout).count();
+
+    std::cout << std::fixed << std::setprecision(2)
+              << "metering without deadline: " << unarmed_seconds * 1e9 / num_metering_points << " ns/point" << std::endl
+              << "metering with deadline: " << armed_seconds * 1e9 / num_metering_points << " ns/point" << std::endl
+              << "arm and disarm: " << arm_seconds * 1e9 / num_deadlines << " ns" << std::endl
+              << "expiry latency: " << expiry_seconds * 1e6 << " us" << std::endl;
+    return EXIT_SUCCESS;
+}
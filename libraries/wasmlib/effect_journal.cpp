@@ -0,0 +1,83 @@
+#include "effect_journal.hpp"
+#include "metrics.hpp"
+#include <string.h>
+
+namespace ftl {
+
+    void effect_journal::append_log(uint64_t callback_param_key, const char *topics, uint32_t topic_num,
+                                    const char *data, uint32_t data_length) {
+        _buffer.reserve(_buffer.size() + sizeof(uint8_t) + sizeof(uint64_t) + 2 * sizeof(uint32_t) + topic_num * 32 +
+                        data_length);
+        append(uint8_t(log));
+        append(callback_param_key);
+        append(topic_num);
+        append(topics, topic_num * 32);
+        append(data_length);
+        append(data, data_length);
+    }
+
+    void effect_journal::append_transfer(uint64_t callback_param_key, const char *to, uint64_t amount) {
+        append(uint8_t(transfer));
+        append(callback_param_key);
+        append(to, 20);
+        append(amount);
+    }
+
+    size_t effect_journal::read(size_t offset, entry &e) const {
+        const char *p = data() + offset;
+        auto take = [&p](void *value, size_t size) {
+            memcpy(value, p, size);
+            p += size;
+        };
+
+        take(&e.kind, sizeof(e.kind));
+        take(&e.callback_param_key, sizeof(e.callback_param_key));
+        if (e.kind == log) {
+            take(&e.topic_num, sizeof(e.topic_num));
+            e.topics = p;
+            p += e.topic_num * 32;
+            take(&e.data_length, sizeof(e.data_length));
+            e.data = p;
+            p += e.data_length;
+            e.amount = 0;
+        } else {
+            e.topic_num = 0;
+            e.topics = p;
+            p += 20;
+            e.data_length = 0;
+            e.data = nullptr;
+            take(&e.amount, sizeof(e.amount));
+        }
+        return p - data();
+    }
+
+    void effect_journal::retag(uint64_t callback_param_key) {
+        entry e;
+        for (size_t offset = 0; offset < size();) {
+            memcpy(&_buffer[offset + sizeof(uint8_t)], &callback_param_key, sizeof(callback_param_key));
+            offset = read(offset, e);
+        }
+    }
+
+    void effect_journal::apply(Callbacks &callbacks, uint64_t callback_param_key) const {
+        if (!size())
+            return;
+
+        if (callbacks.cb_apply_effects) {
+            metrics::timer timer(metrics::host_apply_effects);
+            callbacks.cb_apply_effects(callback_param_key, data(), size());
+            return;
+        }
+
+        entry e;
+        for (size_t offset = 0; offset < size();) {
+            offset = read(offset, e);
+            metrics::timer timer(e.kind == log ? metrics::host_add_log : metrics::host_transfer);
+            if (e.kind == log)
+                callbacks.cb_add_log(e.callback_param_key, (char *) e.topics, e.topic_num, e.data, e.data_length);
+            else
+                callbacks.cb_transfer(e.callback_param_key, (char *) e.topics, e.amount);
+        }
+    }
+
+}
@@ -0,0 +1,678 @@
+#include "callbacks.hpp"
+#include "secp256k1.hpp"
+#include "wasm_binary_ops.hpp"
+#include "IR/Module.h"
+#include "WAST/WAST.h"
+#include "WASM/WASM.h"
+#include "Inline/Serialization.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+//measures what every opcode and intrinsic costs on this machine and proposes the gas for it. each one runs as a
+//microkernel through execute(), so through the same injection, JIT and gas metering as on chain, with the host mocked:
+//a loop doing some instances of it per iteration, against the same loop without them. the difference is the time of
+//the instances alone, and the difference in gas used is what the chain charges for them. prints a report of how
+//each is priced against its time, and the constants of wasm_gas_table.hpp it measures:
+//  GAS_CALIBRATION_GAS_PER_NS     the gas a nanosecond should cost, 3 by default, the rate the comments in
+//                                 wasm_gas_table.hpp assume
+//  GAS_CALIBRATION_RUNS           samples per kernel, at least 2, 10 by default
+//  GAS_CALIBRATION_MS             time a sample runs the kernel for, 20 by default
+//  GAS_CALIBRATION_FILTER         only measures the kernels whose name contains this
+//given a file name, writes the proposed gas_table there, in the form of wasm_gas_table.cpp. storage, logs and
+//transfers are priced for what the host does, which a mock can't tell, so they aren't measured
+
+extern int32_t gas_table[];
+#if ENABLE_SIMD_PROTOTYPE
+extern int32_t simd_gas_table[];
+#endif
+
+extern "C" int execute(uint8_t *codeBytes, int codeLength,
+                       uint8_t *actionBytes, int actionLength,
+                       uint8_t *fromAddrBytes, uint8_t *toAddrBytes, uint8_t *ownerAddrBytes, uint8_t *userAddrBytes,
+                       uint64_t transferAmount, uint64_t *remainedGas, uint64_t stateKey, ftl::Callbacks *callbacks);
+
+namespace {
+
+    //a host that answers without doing anything; none of the kernels touch storage
+    namespace mock {
+        uint64_t current_time(uint64_t) { return 0; }
+
+        //only has to tell codes apart
+        int sha256(char *input, int length, char *hash) {
+            uint64_t h = 0xcbf29ce484222325ull;
+            for (int i = 0; i < length; i++) {
+                h ^= uint8_t(input[i]);
+                h *= 0x100000001b3ull;
+            }
+            for (int i = 0; i < 4; i++)
+                memcpy(hash + i * 8, &h, 8);
+            return 0;
+        }
+
+        ftl::Callbacks callbacks() {
+            ftl::Callbacks c;
+            memset(&c, 0, sizeof(c));
+            c.cb_current_time = current_time;
+            c.cb_sha256 = (ftl::c_sha256 *) sha256;
+            return c;
+        }
+    }
+
+    enum value_type {
+        i32, i64, f32, f64
+    };
+
+    const char *type_name(value_type type) {
+        static const char *names[] = {"i32", "i64", "f32", "f64"};
+        return names[type];
+    }
+
+    //every iteration of a kernel loads four operands of each type from a slot of the first 16KiB; the rest of the
+    //memory is for stores and intrinsics
+    const uint32_t num_slots = 128;
+    const uint32_t slot_size = 128;
+    const uint32_t store_base = 0x4000;
+    const uint32_t recover_digest = 0x9000;
+    const uint32_t recover_signature = 0x9020;
+    const uint32_t recover_public_key = 0x9100;
+    const uint32_t copy_destination = 0xa000;
+    const uint32_t copy_source = 0xc000;
+    const uint32_t hash_destination = 0xe000;
+    const uint32_t results = 0xf000;
+    const uint32_t max_length = 4096;
+
+    std::string accumulator(value_type type) {
+        static const char *names[] = {"$x", "$X", "$f", "$d"};
+        return std::string("(get_local ") + names[type] + ")";
+    }
+
+    std::string set_accumulator(value_type type, const std::string &value) {
+        static const char *names[] = {"$x", "$X", "$f", "$d"};
+        return std::string("(set_local ") + names[type] + " " + value + ")\n";
+    }
+
+    std::string operand(value_type type, size_t instance) {
+        static const char *names[] = {"$a", "$b", "$g", "$e"};
+        return std::string("(get_local ") + names[type] + std::to_string(instance % 4) + ")";
+    }
+
+    //turns a value back into the type of the accumulator it came from, with the reinterpretations, wraps and
+    //extensions that compile to moves, so a chain of instances can't be folded or computed out of order
+    std::string convert(value_type from, value_type to, const std::string &value) {
+        if (from == to)
+            return value;
+        switch (from) {
+            case i32:
+                if (to == i64)
+                    return "(i64.extend_u/i32 " + value + ")";
+                if (to == f32)
+                    return "(f32.reinterpret/i32 " + value + ")";
+                return convert(i64, to, convert(i32, i64, value));
+            case i64:
+                if (to == i32)
+                    return "(i32.wrap/i64 " + value + ")";
+                if (to == f64)
+                    return "(f64.reinterpret/i64 " + value + ")";
+                return convert(i32, to, convert(i64, i32, value));
+            case f32:
+                return convert(i32, to, "(i32.reinterpret/f32 " + value + ")");
+            case f64:
+                return convert(i64, to, "(i64.reinterpret/f64 " + value + ")");
+        }
+        return value;
+    }
+
+    struct kernel {
+        std::string name;
+        //the gas_table entry the kernel prices, or -1 for an intrinsic
+        int opcode;
+        //the WAST of the i-th instance in an iteration
+        std::function<std::string(size_t)> instance;
+        size_t instances_per_iteration;
+    };
+
+    kernel unary(const std::string &op, int opcode, value_type type, value_type result) {
+        return {op, opcode, [=](size_t) {
+            return set_accumulator(type, convert(result, type,
+                                                 "(" + op + " " + accumulator(type) + ")"));
+        }, 16};
+    }
+
+    kernel binary(const std::string &op, int opcode, value_type type, value_type result) {
+        return {op, opcode, [=](size_t i) {
+            return set_accumulator(type, convert(result, type, "(" + op + " " + accumulator(type) +
+                                                               " " + operand(type, i) + ")"));
+        }, 16};
+    }
+
+    //the accumulator is the divisor, forced odd so it's never zero; the operands are positive, so never the minimum
+    //either, and a signed division can't overflow
+    kernel divide(const std::string &op, int opcode, value_type type) {
+        return {op, opcode, [=](size_t i) {
+            return set_accumulator(type, "(" + op + " " + operand(type, i) + " (" + type_name(type) +
+                                         ".or " + accumulator(type) + " (" + type_name(type) + ".const 1)))");
+        }, 16};
+    }
+
+    //each load's address comes from the value the one before loaded, like walking a list
+    kernel load(const std::string &op, int opcode, value_type result) {
+        return {op, opcode, [=](size_t) {
+            return set_accumulator(i32, convert(result, i32, "(" + op + " (i32.and " +
+                                                             accumulator(i32) + " (i32.const " +
+                                                             std::to_string(num_slots * slot_size - 8) + ")))"));
+        }, 16};
+    }
+
+    //every instance stores to a different address, so none of the stores is dead
+    kernel store(const std::string &op, int opcode, value_type type) {
+        return {op, opcode, [=](size_t i) {
+            return "(" + op + " offset=" + std::to_string(store_base + i * 8) + " (get_local $p) " +
+                   operand(type, i) + ")\n";
+        }, 16};
+    }
+
+    kernel custom(const std::string &name, int opcode, std::function<std::string(size_t)> instance,
+                  size_t instances_per_iteration = 16) {
+        return {name, opcode, instance, instances_per_iteration};
+    }
+
+    //the intrinsics that take a length run once with none and once with max_length, which tells the price of a
+    //call from the price of a byte
+    kernel intrinsic(const std::string &name, const std::string &call) {
+        return {name, -1, [=](size_t) { return call + "\n"; }, 4};
+    }
+
+    std::vector<kernel> kernels() {
+        std::vector<kernel> k;
+
+        k.push_back(custom("br", 0x0C, [](size_t) { return std::string("(block (br 0))\n"); }));
+        k.push_back(custom("br_if", 0x0D, [](size_t i) {
+            return "(block (br_if 0 " + operand(i32, i) + ") " +
+                   set_accumulator(i32, "(i32.add " + accumulator(i32) + " (i32.const 1))") + ")\n";
+        }));
+        k.push_back(custom("br_table", 0x0E, [](size_t i) {
+            return "(block (block (br_table 0 1 (i32.and " + operand(i32, i) + " (i32.const 1)))))\n";
+        }));
+        k.push_back(custom("call", 0x10, [](size_t) {
+            return set_accumulator(i32, "(call $identity " + accumulator(i32) + ")");
+        }));
+        k.push_back(custom("call_indirect", 0x11, [](size_t) {
+            return set_accumulator(i32, "(call_indirect $unary " + accumulator(i32) + " (i32.const 0))");
+        }));
+        k.push_back(custom("select", 0x1B, [](size_t i) {
+            return set_accumulator(i32, "(select " + accumulator(i32) + " " + operand(i32, i) + " " +
+                                        operand(i32, i + 1) + ")");
+        }));
+
+        k.push_back(load("i32.load", 0x28, i32));
+        k.push_back(load("i64.load", 0x29, i64));
+        k.push_back(load("f32.load", 0x2A, f32));
+        k.push_back(load("f64.load", 0x2B, f64));
+        k.push_back(load("i32.load8_s", 0x2C, i32));
+        k.push_back(load("i32.load8_u", 0x2D, i32));
+        k.push_back(load("i32.load16_s", 0x2E, i32));
+        k.push_back(load("i32.load16_u", 0x2F, i32));
+        k.push_back(load("i64.load8_s", 0x30, i64));
+        k.push_back(load("i64.load8_u", 0x31, i64));
+        k.push_back(load("i64.load16_s", 0x32, i64));
+        k.push_back(load("i64.load16_u", 0x33, i64));
+        k.push_back(load("i64.load32_s", 0x34, i64));
+        k.push_back(load("i64.load32_u", 0x35, i64));
+        k.push_back(store("i32.store", 0x36, i32));
+        k.push_back(store("i64.store", 0x37, i64));
+        k.push_back(store("f32.store", 0x38, f32));
+        k.push_back(store("f64.store", 0x39, f64));
+        k.push_back(store("i32.store8", 0x3A, i32));
+        k.push_back(store("i32.store16", 0x3B, i32));
+        k.push_back(store("i64.store8", 0x3C, i64));
+        k.push_back(store("i64.store16", 0x3D, i64));
+        k.push_back(store("i64.store32", 0x3E, i64));
+        k.push_back(custom("current_memory", 0x3F, [](size_t) {
+            return set_accumulator(i32, "(i32.xor " + accumulator(i32) + " (current_memory))");
+        }));
+        k.push_back(custom("grow_memory", 0x40, [](size_t) {
+            return set_accumulator(i32, "(i32.xor " + accumulator(i32) + " (grow_memory (i32.const 0)))");
+        }));
+
+        k.push_back(unary("i32.eqz", 0x45, i32, i32));
+        const char *relops[] = {"eq", "ne", "lt_s", "lt_u", "gt_s", "gt_u", "le_s", "le_u", "ge_s", "ge_u"};
+        for (int i = 0; i < 10; i++)
+            k.push_back(binary(std::string("i32.") + relops[i], 0x46 + i, i32, i32));
+        k.push_back(unary("i64.eqz", 0x50, i64, i32));
+        for (int i = 0; i < 10; i++)
+            k.push_back(binary(std::string("i64.") + relops[i], 0x51 + i, i64, i32));
+        const char *float_relops[] = {"eq", "ne", "lt", "gt", "le", "ge"};
+        for (int i = 0; i < 6; i++)
+            k.push_back(binary(std::string("f32.") + float_relops[i], 0x5B + i, f32, i32));
+        for (int i = 0; i < 6; i++)
+            k.push_back(binary(std::string("f64.") + float_relops[i], 0x61 + i, f64, i32));
+
+        const char *bitops[] = {"clz", "ctz", "popcnt"};
+        const char *intops[] = {"add", "sub", "mul", "div_s", "div_u", "rem_s", "rem_u", "and", "or", "xor", "shl",
+                                "shr_s", "shr_u", "rotl", "rotr"};
+        const int int_bases[] = {0x67, 0x79};
+        const value_type int_types[] = {i32, i64};
+        for (int t = 0; t < 2; t++) {
+            for (int i = 0; i < 3; i++) {
+                k.push_back(unary(std::string(type_name(int_types[t])) + "." + bitops[i],
+                                  int_bases[t] + i, int_types[t], int_types[t]));
+            }
+            for (int i = 0; i < 15; i++) {
+                const std::string op = std::string(type_name(int_types[t])) + "." + intops[i];
+                if (i >= 3 && i <= 6)
+                    k.push_back(divide(op, int_bases[t] + 3 + i, int_types[t]));
+                else
+                    k.push_back(binary(op, int_bases[t] + 3 + i, int_types[t], int_types[t]));
+            }
+        }
+
+        const char *float_unops[] = {"abs", "neg", "ceil", "floor", "trunc", "nearest", "sqrt"};
+        const char *float_binops[] = {"add", "sub", "mul", "div", "min", "max", "copysign"};
+        const int float_bases[] = {0x8B, 0x99};
+        const value_type float_types[] = {f32, f64};
+        for (int t = 0; t < 2; t++) {
+            for (int i = 0; i < 7; i++) {
+                k.push_back(unary(std::string(type_name(float_types[t])) + "." + float_unops[i],
+                                  float_bases[t] + i, float_types[t], float_types[t]));
+            }
+            for (int i = 0; i < 7; i++) {
+                k.push_back(binary(std::string(type_name(float_types[t])) + "." + float_binops[i],
+                                   float_bases[t] + 7 + i, float_types[t], float_types[t]));
+            }
+        }
+
+        //the accumulators of the conversions from floats only ever hold values the truncations can't trap on: they
+        //start at the operands, which are small and positive, and go on as what the truncations return
+        k.push_back(unary("i32.wrap/i64", 0xA7, i64, i32));
+        k.push_back(unary("i32.trunc_s/f32", 0xA8, f32, i32));
+        k.push_back(unary("i32.trunc_u/f32", 0xA9, f32, i32));
+        k.push_back(unary("i32.trunc_s/f64", 0xAA, f64, i32));
+        k.push_back(unary("i32.trunc_u/f64", 0xAB, f64, i32));
+        k.push_back(unary("i64.extend_s/i32", 0xAC, i32, i64));
+        k.push_back(unary("i64.extend_u/i32", 0xAD, i32, i64));
+        k.push_back(unary("i64.trunc_s/f32", 0xAE, f32, i64));
+        k.push_back(unary("i64.trunc_u/f32", 0xAF, f32, i64));
+        k.push_back(unary("i64.trunc_s/f64", 0xB0, f64, i64));
+        k.push_back(unary("i64.trunc_u/f64", 0xB1, f64, i64));
+        k.push_back(unary("f32.convert_s/i32", 0xB2, i32, f32));
+        k.push_back(unary("f32.convert_u/i32", 0xB3, i32, f32));
+        k.push_back(unary("f32.convert_s/i64", 0xB4, i64, f32));
+        k.push_back(unary("f32.convert_u/i64", 0xB5, i64, f32));
+        k.push_back(unary("f32.demote/f64", 0xB6, f64, f32));
+        k.push_back(unary("f64.convert_s/i32", 0xB7, i32, f64));
+        k.push_back(unary("f64.convert_u/i32", 0xB8, i32, f64));
+        k.push_back(unary("f64.convert_s/i64", 0xB9, i64, f64));
+        k.push_back(unary("f64.convert_u/i64", 0xBA, i64, f64));
+        k.push_back(unary("f64.promote/f32", 0xBB, f32, f64));
+        k.push_back(unary("i32.reinterpret/f32", 0xBC, f32, i32));
+        k.push_back(unary("i64.reinterpret/f64", 0xBD, f64, i64));
+        k.push_back(unary("f32.reinterpret/i32", 0xBE, i32, f32));
+        k.push_back(unary("f64.reinterpret/i64", 0xBF, i64, f64));
+
+        for (uint32_t length : {uint32_t(0), max_length}) {
+            const std::string n = std::to_string(length);
+            const std::string l = " (i32.const " + n + ")";
+            const std::string destination = " (i32.const " + std::to_string(copy_destination) + ")";
+            const std::string source = " (i32.const " + std::to_string(copy_source) + ")";
+            k.push_back(intrinsic("memcpy/" + n, "(drop (call $memcpy" + destination + source + l + "))"));
+            k.push_back(intrinsic("memmove/" + n, "(drop (call $memmove" + destination + source + l + "))"));
+            k.push_back(intrinsic("memset/" + n, "(drop (call $memset" + destination + " (i32.const 0)" + l + "))"));
+            k.push_back(intrinsic("memcmp/" + n, "(drop (call $memcmp" + destination + source + l + "))"));
+            k.push_back(intrinsic("sha256/" + n, "(call $sha256" + source + l + " (i32.const " +
+                                                 std::to_string(hash_destination) + "))"));
+        }
+        k.push_back(intrinsic("recover_key", "(drop (call $recover_key (i32.const " + std::to_string(recover_digest) +
+                                             ") (i32.const " + std::to_string(recover_signature) +
+                                             ") (i32.const 65) (i32.const " + std::to_string(recover_public_key) +
+                                             ") (i32.const 65)))"));
+        k.push_back(intrinsic("current_time", "(drop (call $current_time))"));
+        return k;
+    }
+
+    //the operands, and a signature to recover the key of
+    std::string data_segments() {
+        std::mt19937_64 random(1);
+        std::vector<uint8_t> operands(num_slots * slot_size);
+        for (uint32_t slot = 0; slot < num_slots; slot++) {
+            uint8_t *s = &operands[slot * slot_size];
+            for (int i = 0; i < 4; i++) {
+                const uint32_t a = (uint32_t(random()) & 0x7fffffff) | 1;
+                const uint64_t b = (random() & 0x7fffffffffffffffull) | 1;
+                const float g = float(1 + random() % 1000) + 0.5f;
+                const double e = double(1 + random() % 1000) + 0.5;
+                memcpy(s + i * 4, &a, 4);
+                memcpy(s + 16 + i * 8, &b, 8);
+                memcpy(s + 48 + i * 4, &g, 4);
+                memcpy(s + 64 + i * 8, &e, 8);
+            }
+        }
+
+        //recovery costs the same whether or not anyone knows the private key
+        uint8_t digest[32], signature[ftl::secp256k1::signature_size], public_key[ftl::secp256k1::public_key_size];
+        do {
+            for (uint8_t &byte : digest)
+                byte = uint8_t(random());
+            for (uint8_t &byte : signature)
+                byte = uint8_t(random());
+            signature[0] &= 0x7f;
+            signature[32] &= 0x7f;
+            signature[64] = uint8_t(27 + (random() & 1));
+        } while (!ftl::secp256k1::recover(digest, signature, public_key));
+
+        auto segment = [](uint32_t address, const uint8_t *data, size_t size) {
+            std::ostringstream out;
+            out << "  (data (i32.const " << address << ") \"" << std::hex << std::setfill('0');
+            for (size_t i = 0; i < size; i++)
+                out << "\\" << std::setw(2) << int(data[i]);
+            out << "\")\n";
+            return out.str();
+        };
+        //the deserializer takes segments of less than 8KiB
+        std::string segments;
+        for (uint32_t offset = 0; offset < operands.size(); offset += 4096)
+            segments += segment(offset, &operands[offset], 4096);
+        return segments + segment(recover_digest, digest, sizeof(digest)) +
+               segment(recover_signature, signature, sizeof(signature));
+    }
+
+    //the iteration count is the action name, so a kernel compiles once for any count. the accumulators are stored
+    //when the loop ends, which keeps every instance live
+    std::string kernel_wast(const kernel &k, const std::string &data) {
+        std::ostringstream wast;
+        wast << "(module\n"
+             << "  (import \"env\" \"memcpy\" (func $memcpy (param i32 i32 i32) (result i32)))\n"
+             << "  (import \"env\" \"memmove\" (func $memmove (param i32 i32 i32) (result i32)))\n"
+             << "  (import \"env\" \"memset\" (func $memset (param i32 i32 i32) (result i32)))\n"
+             << "  (import \"env\" \"memcmp\" (func $memcmp (param i32 i32 i32) (result i32)))\n"
+             << "  (import \"env\" \"sha256\" (func $sha256 (param i32 i32 i32)))\n"
+             << "  (import \"env\" \"recover_key\" (func $recover_key (param i32 i32 i32 i32 i32) (result i32)))\n"
+             << "  (import \"env\" \"current_time\" (func $current_time (result i64)))\n"
+             << "  (memory 1)\n"
+             << data
+             << "  (table anyfunc (elem $identity))\n"
+             << "  (type $unary (func (param i32) (result i32)))\n"
+             << "  (func $identity (param $v i32) (result i32) (get_local $v))\n"
+             << "  (func (export \"apply\") (param $name i64)\n"
+             << "    (local $n i32) (local $p i32) (local $x i32) (local $X i64) (local $f f32) (local $d f64)\n";
+        for (value_type type : {i32, i64, f32, f64}) {
+            static const char *prefixes[] = {"$a", "$b", "$g", "$e"};
+            wast << "   ";
+            for (int i = 0; i < 4; i++)
+                wast << " (local " << prefixes[type] << i << " " << type_name(type) << ")";
+            wast << "\n";
+        }
+        wast << "(set_local $n (i32.wrap/i64 (get_local $name)))\n"
+             << "(set_local $x (i32.load (i32.const 0)))\n"
+             << "(set_local $X (i64.load (i32.const 16)))\n"
+             << "(set_local $f (f32.load (i32.const 48)))\n"
+             << "(set_local $d (f64.load (i32.const 64)))\n"
+             << "(block (loop\n"
+             << "(br_if 1 (i32.eqz (get_local $n)))\n"
+             << "(set_local $n (i32.sub (get_local $n) (i32.const 1)))\n"
+             << "(set_local $p (i32.mul (i32.and (get_local $n) (i32.const " << num_slots - 1 << ")) (i32.const "
+             << slot_size << ")))\n";
+        for (int i = 0; i < 4; i++) {
+            wast << "(set_local $a" << i << " (i32.load offset=" << i * 4 << " (get_local $p)))\n"
+                 << "(set_local $b" << i << " (i64.load offset=" << 16 + i * 8 << " (get_local $p)))\n"
+                 << "(set_local $g" << i << " (f32.load offset=" << 48 + i * 4 << " (get_local $p)))\n"
+                 << "(set_local $e" << i << " (f64.load offset=" << 64 + i * 8 << " (get_local $p)))\n";
+        }
+        for (size_t i = 0; i < k.instances_per_iteration; i++)
+            wast << k.instance(i);
+        //the operands go into the integer accumulators in the baseline as well, so loading them is never part of
+        //what the instances cost
+        for (int i = 0; i < 4; i++) {
+            wast << "(set_local $x (i32.xor (get_local $x) (i32.xor (get_local $a" << i
+                 << ") (i32.reinterpret/f32 (get_local $g" << i << ")))))\n"
+                 << "(set_local $X (i64.xor (get_local $X) (i64.xor (get_local $b" << i
+                 << ") (i64.reinterpret/f64 (get_local $e" << i << ")))))\n";
+        }
+        wast << "(br 0)))\n"
+             << "(i32.store (i32.const " << results << ") (get_local $x))\n"
+             << "(i64.store (i32.const " << results + 8 << ") (get_local $X))\n"
+             << "(f32.store (i32.const " << results + 16 << ") (get_local $f))\n"
+             << "(f64.store (i32.const " << results + 24 << ") (get_local $d))\n"
+             << "  )\n)\n";
+        return wast.str();
+    }
+
+    std::vector<uint8_t> compile(const std::string &wast) {
+        IR::Module module;
+        std::vector<WAST::Error> errors;
+        if (!WAST::parseModule(wast.c_str(), wast.size(), module, errors)) {
+            for (const WAST::Error &error : errors)
+                std::cerr << error.locus.describe() << ": " << error.message << std::endl;
+            std::exit(EXIT_FAILURE);
+        }
+        //the names section the parser adds can't be written back out; wasm_interface drops user sections as well
+        module.userSections.clear();
+        Serialization::ArrayOutputStream stream;
+        WASM::serialize(stream, module);
+        return stream.getBytes();
+    }
+
+    uint64_t environment(const char *name, uint64_t default_value) {
+        const char *value = getenv(name);
+        return value ? std::strtoull(value, nullptr, 10) : default_value;
+    }
+
+    //nanoseconds an execution of the kernel takes, and the gas it uses
+    double run(std::vector<uint8_t> &code, uint32_t iterations, uint64_t &gas_used) {
+        ftl::Callbacks callbacks = mock::callbacks();
+        uint8_t action[8] = {0};
+        uint8_t address[20] = {0};
+        memcpy(action, &iterations, sizeof(iterations));
+
+        const uint64_t gas_limit = 1ull << 60;
+        uint64_t remained_gas = gas_limit;
+        auto start = std::chrono::steady_clock::now();
+        int ret = execute(code.data(), code.size(), action, sizeof(action), address, address, address, address, 0,
+                          &remained_gas, 1, &callbacks);
+        double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+        if (ret) {
+            std::cerr << "kernel failed with " << ret << std::endl;
+            std::exit(EXIT_FAILURE);
+        }
+        gas_used = gas_limit - remained_gas;
+        return ns;
+    }
+
+    //two sided 95% quantiles of Student's t distribution
+    double t_quantile(size_t degrees_of_freedom) {
+        static const double quantiles[] = {12.71, 4.30, 3.18, 2.78, 2.57, 2.45, 2.36, 2.31, 2.26, 2.23, 2.20, 2.18,
+                                           2.16, 2.14, 2.13, 2.12, 2.11, 2.10, 2.09, 2.09, 2.08, 2.07, 2.07, 2.06,
+                                           2.06, 2.06, 2.05, 2.05, 2.05, 2.04};
+        if (degrees_of_freedom == 0)
+            return INFINITY;
+        if (degrees_of_freedom <= 30)
+            return quantiles[degrees_of_freedom - 1];
+        return 1.96;
+    }
+
+    struct measurement {
+        const kernel *k;
+        double ns;
+        //half the width of the 95% confidence interval of ns
+        double confidence;
+        double gas_charged;
+    };
+
+    measurement measure(const kernel &k, const std::string &data) {
+        const kernel baseline = custom("baseline", -1, [](size_t) { return std::string(); }, 0);
+        std::vector<uint8_t> with = compile(kernel_wast(k, data));
+        std::vector<uint8_t> without = compile(kernel_wast(baseline, data));
+
+        //what an execution does besides the loop, parsing, injection, compilation and instantiation, is timed by
+        //running no iterations; the fastest of a few runs is the closest to its cost
+        uint64_t gas_with_setup, gas_without_setup, gas_with, gas_without;
+        double setup_with = 0, setup_without = 0;
+        for (int i = 0; i < 3; i++) {
+            double w = run(with, 0, gas_with_setup);
+            double wo = run(without, 0, gas_without_setup);
+            setup_with = i ? std::min(setup_with, w) : w;
+            setup_without = i ? std::min(setup_without, wo) : wo;
+        }
+
+        //enough iterations for a sample to run about GAS_CALIBRATION_MS
+        const uint32_t trial_iterations = 100;
+        const double trial_ns = std::max(run(with, trial_iterations, gas_with) - setup_with, 1.0);
+        const double target_ns = environment("GAS_CALIBRATION_MS", 20) * 1e6;
+        const uint32_t iterations = uint32_t(std::min(std::max(target_ns / trial_ns * trial_iterations, 10.0),
+                                                      double(1 << 30)));
+
+        //the kernel and its baseline alternate, so a change in the machine's speed hits both alike
+        std::vector<double> samples;
+        const double instances = double(k.instances_per_iteration) * iterations;
+        const uint64_t runs = std::max(environment("GAS_CALIBRATION_RUNS", 10), uint64_t(2));
+        for (uint64_t i = 0; i < runs; i++) {
+            const double w = run(with, iterations, gas_with) - setup_with;
+            const double wo = run(without, iterations, gas_without) - setup_without;
+            samples.push_back((w - wo) / instances);
+        }
+
+        double mean = 0;
+        for (double sample : samples)
+            mean += sample;
+        mean /= samples.size();
+        double variance = 0;
+        for (double sample : samples)
+            variance += (sample - mean) * (sample - mean);
+        variance /= std::max(samples.size() - 1, size_t(1));
+
+        const double gas_charged = (double(gas_with - gas_with_setup) - double(gas_without - gas_without_setup)) /
+                                   instances;
+        return {&k, mean, t_quantile(samples.size() - 1) * std::sqrt(variance / samples.size()), gas_charged};
+    }
+
+    const measurement *find(const std::vector<measurement> &measurements, const std::string &name) {
+        for (const measurement &m : measurements) {
+            if (m.k->name == name)
+                return &m;
+        }
+        return nullptr;
+    }
+
+    void print_constant(const char *name, double ns, double gas_per_ns) {
+        ns = std::max(ns, 0.0);
+        std::cout << "const int32_t " << name << " = " << std::max(1ll, std::llround(ns * gas_per_ns)) << ";  // about "
+                  << std::setprecision(ns < 10 ? 2 : 0) << ns << "ns" << std::endl;
+    }
+
+}
+
+int main(int argc, char **argv) {
+    const double gas_per_ns = environment("GAS_CALIBRATION_GAS_PER_NS", 3);
+    const char *filter = getenv("GAS_CALIBRATION_FILTER");
+    const std::string data = data_segments();
+
+    const std::vector<kernel> all = kernels();
+    std::vector<measurement> measurements;
+    std::cout << std::fixed << std::left << std::setw(20) << "kernel" << std::right << std::setw(10) << "gas"
+              << std::setw(12) << "charged" << std::setw(20) << "ns" << std::setw(12) << "fair"
+              << std::setw(10) << "ratio" << std::endl;
+    for (const kernel &k : all) {
+        if (filter && k.name.find(filter) == std::string::npos)
+            continue;
+        measurements.push_back(measure(k, data));
+        const measurement &m = measurements.back();
+
+        //the ratio is what the chain charges for an instance against what its time is worth; below 1 it's
+        //underpriced. the locals an instance uses are in registers once compiled, so its time is the opcode's
+        const double fair = std::max(m.ns, 0.0) * gas_per_ns;
+        std::ostringstream ns;
+        ns << std::fixed << std::setprecision(2) << m.ns << " +- " << m.confidence;
+        std::cout << std::left << std::setw(20) << k.name << std::right << std::setw(10)
+                  << (k.opcode >= 0 ? std::to_string(gas_table[k.opcode]) : std::string("-"))
+                  << std::setw(12) << std::setprecision(1) << m.gas_charged << std::setw(20) << ns.str()
+                  << std::setw(12) << fair << std::setw(10) << std::setprecision(2)
+                  << (fair > 0 ? m.gas_charged / fair : INFINITY)
+                  << (m.confidence > std::abs(m.ns) / 10 ? "  noisy" : "") << std::endl;
+    }
+
+    std::vector<const measurement *> by_ratio;
+    for (const measurement &m : measurements) {
+        if (m.ns > m.confidence)
+            by_ratio.push_back(&m);
+    }
+    std::sort(by_ratio.begin(), by_ratio.end(), [&](const measurement *a, const measurement *b) {
+        return a->gas_charged / a->ns < b->gas_charged / b->ns;
+    });
+    std::cout << std::endl << "most underpriced:";
+    for (size_t i = 0; i < std::min(by_ratio.size(), size_t(10)); i++)
+        std::cout << " " << by_ratio[i]->k->name;
+    std::cout << std::endl << "most overpriced:";
+    for (size_t i = 0; i < std::min(by_ratio.size(), size_t(10)); i++)
+        std::cout << " " << by_ratio[by_ratio.size() - 1 - i]->k->name;
+    std::cout << std::endl;
+
+    //the constants of wasm_gas_table.hpp: a call is the price of one with no bytes to go through, and a byte the
+    //price of the most expensive of the memory operations
+    std::cout << std::endl << std::fixed;
+    const measurement *memset_0 = find(measurements, "memset/0");
+    if (memset_0)
+        print_constant("GAS_CALL_BASE", memset_0->ns, gas_per_ns);
+    if (const measurement *recover_key = find(measurements, "recover_key"))
+        print_constant("GAS_RECOVER_KEY", recover_key->ns, gas_per_ns);
+    const measurement *sha256_0 = find(measurements, "sha256/0");
+    const measurement *sha256_max = find(measurements, "sha256/" + std::to_string(max_length));
+    if (sha256_0 && sha256_max) {
+        print_constant("GAS_SHA256_BASE", sha256_0->ns, gas_per_ns);
+        print_constant("GAS_SHA256_BYTE", (sha256_max->ns - sha256_0->ns) / max_length, gas_per_ns);
+    }
+    double memop_byte_ns = -1;
+    for (const char *op : {"memcpy", "memmove", "memset", "memcmp"}) {
+        const measurement *none = find(measurements, std::string(op) + "/0");
+        const measurement *most = find(measurements, std::string(op) + "/" + std::to_string(max_length));
+        if (none && most)
+            memop_byte_ns = std::max(memop_byte_ns, (most->ns - none->ns) / max_length);
+    }
+    if (memop_byte_ns >= 0)
+        print_constant("GAS_MEMOP_BYTE", memop_byte_ns, gas_per_ns);
+
+    if (argc > 1) {
+        std::ofstream table(argv[1]);
+        table << "\n#include <stdint.h>\n\nint32_t gas_table[] = {\n";
+        for (int opcode = 0; opcode <= 0xBF; opcode++) {
+            const measurement *m = nullptr;
+            for (const measurement &candidate : measurements) {
+                if (candidate.k->opcode == opcode)
+                    m = &candidate;
+            }
+            std::ostringstream hex;
+            hex << "0x" << std::uppercase << std::hex << std::setw(2) << std::setfill('0') << opcode;
+            if (m) {
+                table << "   " << std::max(1ll, std::llround(std::max(m->ns, 0.0) * gas_per_ns)) << ", //"
+                      << std::left << std::setw(26) << m->k->name << " = " << hex.str() << ", was "
+                      << gas_table[opcode] << "\n" << std::right;
+            } else {
+                table << "   " << gas_table[opcode] << ", //" << std::left << std::setw(26) << "not measured"
+                      << " = " << hex.str() << "\n" << std::right;
+            }
+        }
+        table << "}; // gas_table\n";
+#if ENABLE_SIMD_PROTOTYPE
+        //the SIMD operators have no kernels yet, so their table is written as it is
+        table << "\n#if ENABLE_SIMD_PROTOTYPE\nint32_t simd_gas_table[] = {\n";
+        for (size_t index = 0; index < ftl::wasm_ops::num_simd_ops; index++) {
+            table << "   " << simd_gas_table[index] << ", //" << std::left << std::setw(26) << "not measured"
+                  << " = 0xFD" << std::right << std::uppercase << std::hex << std::setw(2) << std::setfill('0') << index
+                  << std::dec << std::setfill(' ') << "\n";
+        }
+        table << "}; // simd_gas_table\n#endif\n";
+#endif
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,487 @@
+#include "callbacks.hpp"
+#include "metrics.hpp"
+#include "wasm_gas_table.hpp"
+#include "IR/Module.h"
+#include "Runtime/Runtime.h"
+#include "WAST/WAST.h"
+#include "WASM/WASM.h"
+#include "Inline/Serialization.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+//fuzzing target that looks for contracts which take a long time for the gas they pay for. the input drives a
+//generator that only writes valid contracts, which run through execute(), so through the same injection, JIT and gas
+//metering as on chain, with the host mocked. the fitness is wall time per unit of gas:
+//  GAS_FUZZ_WORST_DIR             keeps the contract with the worst ratio seen so far in this directory
+//  GAS_FUZZ_ABORT_NS_PER_GAS      aborts on a ratio above this, so AFL keeps the input as a crash and afl-tmin can
+//                                 minimize it
+//  GAS_FUZZ_GAS                   gas limit of a run, 10000000 by default
+//  GAS_FUZZ_RUNS                  runs to take the fastest of, 3 by default
+//gas_fuzz --check instead runs fixed contracts that check the metering of the operators the generator emits
+
+extern "C" int execute(uint8_t *codeBytes, int codeLength,
+                       uint8_t *actionBytes, int actionLength,
+                       uint8_t *fromAddrBytes, uint8_t *toAddrBytes, uint8_t *ownerAddrBytes, uint8_t *userAddrBytes,
+                       uint64_t transferAmount, uint64_t *remainedGas, uint64_t stateKey, ftl::Callbacks *callbacks);
+
+namespace {
+
+    //a host that keeps storage in memory and drops everything else
+    namespace mock {
+        std::map<std::string, std::string> storage;
+
+        std::string storage_key(uint64_t table, const char *key, int key_length) {
+            return std::string((const char *) &table, sizeof(table)) + std::string(key, key_length);
+        }
+
+        void store(uint64_t, uint64_t table, char *key, int key_length, char *value, int value_length) {
+            storage[storage_key(table, key, key_length)] = std::string(value, value_length);
+        }
+
+        int load(uint64_t, uint64_t table, char *key, int key_length, char *value, int value_length) {
+            auto it = storage.find(storage_key(table, key, key_length));
+            if (it == storage.end())
+                return 0;
+            memcpy(value, it->second.data(), std::min(size_t(value_length), it->second.size()));
+            return it->second.size();
+        }
+
+        int has_key(uint64_t, uint64_t table, char *key, int key_length) {
+            return storage.count(storage_key(table, key, key_length));
+        }
+
+        void remove_key(uint64_t, uint64_t table, char *key, int key_length) {
+            storage.erase(storage_key(table, key, key_length));
+        }
+
+        int has_table(uint64_t, uint64_t) { return 1; }
+
+        void remove_table(uint64_t, uint64_t) {}
+
+        uint64_t current_time(uint64_t) { return 0; }
+
+        uint64_t current_height(uint64_t) { return 0; }
+
+        void current_hash(uint64_t, char *simple_hash, char *full_hash) {
+            memset(simple_hash, 0, 32);
+            memset(full_hash, 0, 32);
+        }
+
+        void add_log(uint64_t, char *, int, const char *, int) {}
+
+        void transfer(uint64_t, char *, uint64_t) {}
+
+        int call_action(uint64_t, char *, char *, int, uint64_t, int, int) { return 0; }
+
+        int call_result(uint64_t, char *, int) { return 0; }
+
+        int set_result(uint64_t, char *, int) { return 0; }
+
+        //only has to tell codes apart
+        int sha256(char *input, int length, char *hash) {
+            uint64_t h = 0xcbf29ce484222325ull;
+            for (int i = 0; i < length; i++) {
+                h ^= uint8_t(input[i]);
+                h *= 0x100000001b3ull;
+            }
+            for (int i = 0; i < 4; i++)
+                memcpy(hash + i * 8, &h, 8);
+            return 0;
+        }
+
+        ftl::Callbacks callbacks() {
+            ftl::Callbacks c;
+            memset(&c, 0, sizeof(c));
+            c.cb_store = store;
+            c.cb_load = load;
+            c.cb_has_key = has_key;
+            c.cb_remove_key = remove_key;
+            c.cb_has_table = has_table;
+            c.cb_remove_table = remove_table;
+            c.cb_current_time = current_time;
+            c.cb_current_height = current_height;
+            c.cb_current_hash = current_hash;
+            c.cb_add_log = add_log;
+            c.cb_transfer = transfer;
+            c.cb_call_action = call_action;
+            c.cb_call_result = call_result;
+            c.cb_set_result = set_result;
+            c.cb_sha256 = (ftl::c_sha256 *) sha256;
+            return c;
+        }
+    }
+
+    //writes the apply function of a contract from the fuzzer's input. every snippet leaves the operand stack as it
+    //found it, addresses are masked into the first half of the memory, and loops count down, so whatever the input,
+    //the contract is valid and stops
+    class contract_generator {
+    public:
+        contract_generator(const std::vector<uint8_t> &input) : _input(input) {}
+
+        std::string generate() {
+            std::ostringstream body;
+            size_t num_snippets = 0;
+            while (_position < _input.size() && num_snippets++ < max_snippets)
+                snippet(body);
+            while (_depth)
+                end_loop(body);
+
+            std::ostringstream wast;
+            wast << "(module\n"
+                 << "  (import \"env\" \"memcpy\" (func $memcpy (param i32 i32 i32) (result i32)))\n"
+                 << "  (import \"env\" \"memset\" (func $memset (param i32 i32 i32) (result i32)))\n"
+                 << "  (import \"env\" \"memcmp\" (func $memcmp (param i32 i32 i32) (result i32)))\n"
+                 << "  (import \"env\" \"sha256\" (func $sha256 (param i32 i32 i32)))\n"
+                 << "  (import \"env\" \"db_store\" (func $db_store (param i64 i32 i32 i32 i32)))\n"
+                 << "  (import \"env\" \"db_load\" (func $db_load (param i64 i32 i32 i32 i32) (result i32)))\n"
+                 << "  (import \"env\" \"db_has_key\" (func $db_has_key (param i64 i32 i32) (result i32)))\n"
+                 << "  (import \"env\" \"db_remove_key\" (func $db_remove_key (param i64 i32 i32)))\n"
+                 << "  (import \"env\" \"log_0\" (func $log_0 (param i32 i32 i32)))\n"
+                 << "  (import \"env\" \"prints_l\" (func $prints_l (param i32 i32)))\n"
+                 << "  (import \"env\" \"printi\" (func $printi (param i64)))\n"
+                 << "  (import \"env\" \"recover_key\" (func $recover_key (param i32 i32 i32 i32 i32) (result i32)))\n"
+                 << "  (import \"env\" \"current_time\" (func $current_time (result i64)))\n"
+                 << "  (import \"env\" \"read_action_data\" (func $read_action_data (param i32 i32) (result i32)))\n"
+                 << "  (memory 1)\n"
+                 << "  (table anyfunc (elem $double $mix))\n"
+                 << "  (type $binary (func (param i32) (result i32)))\n"
+                 << "  (func $double (param $x i32) (result i32) (i32.shl (get_local $x) (i32.const 1)))\n"
+                 << "  (func $mix (param $x i32) (result i32) (i32.xor (i32.mul (get_local $x) (i32.const 16777619))"
+                 << " (i32.const 2166136261)))\n"
+                 << "  (func (export \"apply\") (param $name i64)\n"
+                 << "    (local $a i32) (local $b i64) (local $d f64) (local $f f32)";
+            for (size_t i = 0; i < max_depth; i++)
+                wast << " (local $n" << i << " i32)";
+            wast << "\n" << body.str() << "  )\n)\n";
+            return wast.str();
+        }
+
+    private:
+        static constexpr size_t max_snippets = 256;
+        static constexpr size_t max_depth = 3;
+
+        uint8_t byte() { return _position < _input.size() ? _input[_position++] : 0; }
+
+        uint32_t word() {
+            uint32_t w = byte();
+            w |= uint32_t(byte()) << 8;
+            return w;
+        }
+
+        //an address that leaves room for a 4KiB access in the first 36KiB of the memory
+        std::string address() {
+            return "(i32.const " + std::to_string(word() & 0x7ff8) + ")";
+        }
+
+        std::string length() {
+            return "(i32.const " + std::to_string(word() & 0xfff) + ")";
+        }
+
+        void snippet(std::ostringstream &out) {
+            static const char *i32_binops[] = {"add", "sub", "mul", "div_u", "rem_u", "and", "or", "xor", "shl",
+                                               "shr_u", "rotl"};
+            static const char *i64_binops[] = {"add", "sub", "mul", "div_s", "rem_s", "and", "or", "xor", "shl",
+                                               "shr_s", "rotr"};
+            static const char *f64_ops[] = {"add", "sub", "mul", "div", "min", "max"};
+            static const char *f32_unops[] = {"sqrt", "ceil", "floor", "nearest", "trunc"};
+            static const char *loads[] = {"i32.load", "i32.load8_u", "i64.load", "i64.load16_s"};
+
+            switch (byte() % 16) {
+                case 0:
+                    //divisors are forced odd, so never zero
+                    out << "(set_local $a (i32." << i32_binops[byte() % 11] << " (get_local $a) (i32.const "
+                        << (word() | 1) << ")))\n";
+                    break;
+                case 1:
+                    out << "(set_local $b (i64." << i64_binops[byte() % 11] << " (get_local $b) (i64.const "
+                        << (word() | 1) << ")))\n";
+                    break;
+                case 2:
+                    out << "(set_local $d (f64." << f64_ops[byte() % 6] << " (get_local $d) (f64.const " << word()
+                        << ")))\n";
+                    break;
+                case 3:
+                    out << "(set_local $f (f32." << f32_unops[byte() % 5] << " (f32.convert_u/i32 (get_local $a))))\n";
+                    break;
+                case 4: {
+                    const char *load = loads[byte() % 4];
+                    out << "(set_local " << (load[1] == '3' ? "$a" : "$b") << " (" << load << " " << address()
+                        << "))\n";
+                    break;
+                }
+                case 5:
+                    out << "(i64.store " << address() << " (get_local $b))\n";
+                    break;
+                case 6:
+                    out << "(drop (grow_memory (i32.const " << (byte() & 1) << ")))\n";
+                    break;
+                case 7:
+                    switch (byte() % 4) {
+                        case 0:
+                            out << "(drop (call $memcpy " << address() << " " << address() << " " << length()
+                                << "))\n";
+                            break;
+                        case 1:
+                            out << "(drop (call $memset " << address() << " (i32.const " << int(byte()) << ") "
+                                << length() << "))\n";
+                            break;
+                        case 2:
+                            out << "(memory.copy " << address() << " " << address() << " " << length() << ")\n";
+                            break;
+                        default:
+                            out << "(memory.fill " << address() << " (i32.const " << int(byte()) << ") " << length()
+                                << ")\n";
+                            break;
+                    }
+                    break;
+                case 8:
+                    out << "(set_local $a (call $memcmp " << address() << " " << address() << " " << length()
+                        << "))\n";
+                    break;
+                case 9:
+                    out << "(call $sha256 " << address() << " " << length() << " " << address() << ")\n";
+                    break;
+                case 10:
+                    switch (byte() % 4) {
+                        case 0:
+                            out << "(call $db_store (i64.const " << int(byte()) << ") " << address() << " (i32.const 8) "
+                                << address() << " " << length() << ")\n";
+                            break;
+                        case 1:
+                            out << "(set_local $a (call $db_load (i64.const " << int(byte()) << ") " << address()
+                                << " (i32.const 8) " << address() << " " << length() << "))\n";
+                            break;
+                        case 2:
+                            out << "(set_local $a (call $db_has_key (i64.const " << int(byte()) << ") " << address()
+                                << " (i32.const 8)))\n";
+                            break;
+                        case 3:
+                            out << "(call $db_remove_key (i64.const " << int(byte()) << ") " << address()
+                                << " (i32.const 8))\n";
+                            break;
+                    }
+                    break;
+                case 11:
+                    switch (byte() % 4) {
+                        case 0:
+                            out << "(call $log_0 " << address() << " " << length() << " " << address() << ")\n";
+                            break;
+                        case 1:
+                            out << "(call $prints_l " << address() << " " << length() << ")\n";
+                            break;
+                        case 2:
+                            out << "(call $printi (get_local $b))\n";
+                            break;
+                        case 3:
+                            out << "(set_local $b (call $current_time))\n";
+                            break;
+                    }
+                    break;
+                case 12:
+                    out << "(set_local $a (call $recover_key " << address() << " " << address()
+                        << " (i32.const 65) " << address() << " (i32.const 65)))\n";
+                    break;
+                case 13:
+                    out << "(set_local $a (call_indirect $binary (get_local $a) (i32.const " << (byte() % 2)
+                        << ")))\n";
+                    break;
+                case 14:
+                    if (_depth < max_depth)
+                        begin_loop(out);
+                    break;
+                case 15:
+                    if (_depth)
+                        end_loop(out);
+                    break;
+            }
+        }
+
+        void begin_loop(std::ostringstream &out) {
+            const std::string counter = "$n" + std::to_string(_depth);
+            out << "(set_local " << counter << " (i32.const " << (word() & 0x3ff) << "))\n"
+                << "(block (loop\n"
+                << "(br_if 1 (i32.eqz (get_local " << counter << ")))\n"
+                << "(set_local " << counter << " (i32.sub (get_local " << counter << ") (i32.const 1)))\n";
+            _depth++;
+        }
+
+        void end_loop(std::ostringstream &out) {
+            out << "(br 0)))\n";
+            _depth--;
+        }
+
+        const std::vector<uint8_t> &_input;
+        size_t _position = 0;
+        size_t _depth = 0;
+    };
+
+    uint64_t environment(const char *name, uint64_t default_value) {
+        const char *value = getenv(name);
+        return value ? std::strtoull(value, nullptr, 10) : default_value;
+    }
+
+    //the binary of a contract written in the text format
+    std::vector<uint8_t> compile(const std::string &wast) {
+        IR::Module module;
+        std::vector<WAST::Error> errors;
+        if (!WAST::parseModule(wast.c_str(), wast.size(), module, errors)) {
+            //a generator bug rather than an interesting input; crash so it gets noticed
+            for (const WAST::Error &error : errors)
+                std::cerr << error.locus.describe() << ": " << error.message << std::endl;
+            std::cerr << wast;
+            abort();
+        }
+        //the names section the parser adds can't be written back out; wasm_interface drops user sections as well
+        module.userSections.clear();
+        Serialization::ArrayOutputStream stream;
+        WASM::serialize(stream, module);
+        return stream.getBytes();
+    }
+
+    //the fastest of a few runs, in nanoseconds, and the gas the run used
+    double run(std::vector<uint8_t> &code, uint64_t gas_limit, uint64_t &gas_used) {
+        ftl::Callbacks callbacks = mock::callbacks();
+        uint8_t action[8] = {0};
+        uint8_t address[20] = {0};
+
+        double fastest = 0;
+        for (uint64_t i = 0; i < environment("GAS_FUZZ_RUNS", 3); i++) {
+            mock::storage.clear();
+            uint64_t remained_gas = gas_limit;
+            auto start = std::chrono::steady_clock::now();
+            execute(code.data(), code.size(), action, sizeof(action), address, address, address, address, 0,
+                    &remained_gas, 1, &callbacks);
+            double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+            if (i == 0 || ns < fastest)
+                fastest = ns;
+            gas_used = gas_limit - remained_gas;
+        }
+        return fastest;
+    }
+
+    //runs a contract whose apply function is body once, and returns the error code with the gas it used and whether
+    //it ran out of gas or hit an out of bounds access
+    int run_once(const std::string &body, uint64_t gas_limit, uint64_t &gas_used, bool &out_of_gas,
+                 bool &out_of_bounds) {
+        std::vector<uint8_t> code = compile("(module (memory 1) (func (export \"apply\") (param $name i64) " + body +
+                                            "))");
+        ftl::Callbacks callbacks = mock::callbacks();
+        uint8_t action[8] = {0};
+        uint8_t address[20] = {0};
+        uint64_t remained_gas = gas_limit;
+        const size_t out_of_bounds_trap = ftl::metrics::traps + size_t(Runtime::Exception::Cause::accessViolation);
+
+        const ftl::metrics::snapshot before = ftl::metrics::read();
+        int ret = execute(code.data(), code.size(), action, sizeof(action), address, address, address, address, 0,
+                          &remained_gas, 1, &callbacks);
+        const ftl::metrics::snapshot after = ftl::metrics::read();
+
+        gas_used = gas_limit - remained_gas;
+        out_of_gas = after.counters[ftl::metrics::out_of_gas] != before.counters[ftl::metrics::out_of_gas];
+        out_of_bounds = after.counters[out_of_bounds_trap] != before.counters[out_of_bounds_trap];
+        return ret;
+    }
+
+    //memory.copy and memory.fill pay for their bytes before they go through them: without the gas for its bytes, an
+    //out of bounds operation runs out of gas rather than trapping, and with it, the trap comes after the bytes were paid
+    //for. the bytes cost the same in bounds
+    bool check_bulk_memory_gas() {
+        const uint64_t num_bytes = 0x10000;
+        const std::string operations[] = {
+                "(memory.copy (i32.const 0x10000) (i32.const 0) (i32.const " + std::to_string(num_bytes) + "))",
+                "(memory.fill (i32.const 0x10000) (i32.const 0) (i32.const " + std::to_string(num_bytes) + "))",
+        };
+        bool passed = true;
+        for (const std::string &operation : operations) {
+            uint64_t gas_used;
+            bool out_of_gas, out_of_bounds;
+            if (!run_once(operation, num_bytes * GAS_MEMOP_BYTE - 1, gas_used, out_of_gas, out_of_bounds) ||
+                !out_of_gas || out_of_bounds) {
+                std::cerr << operation << " went through its bytes before paying for them" << std::endl;
+                passed = false;
+            }
+            if (!run_once(operation, 10000000, gas_used, out_of_gas, out_of_bounds) || out_of_gas || !out_of_bounds ||
+                gas_used < num_bytes * GAS_MEMOP_BYTE) {
+                std::cerr << operation << " trapped without paying for its bytes" << std::endl;
+                passed = false;
+            }
+        }
+
+        uint64_t empty_gas, copy_gas, fill_gas;
+        bool out_of_gas, out_of_bounds;
+        const bool ran = !run_once("(memory.copy (i32.const 0) (i32.const 8) (i32.const 0))", 10000000, empty_gas,
+                                   out_of_gas, out_of_bounds) &&
+                         !run_once("(memory.copy (i32.const 0) (i32.const 8) (i32.const 0x1000))", 10000000,
+                                   copy_gas, out_of_gas, out_of_bounds) &&
+                         !run_once("(memory.fill (i32.const 0) (i32.const 8) (i32.const 0x1000))", 10000000,
+                                   fill_gas, out_of_gas, out_of_bounds);
+        if (!ran || copy_gas != empty_gas + 0x1000 * GAS_MEMOP_BYTE || fill_gas != copy_gas) {
+            std::cerr << "in bounds bulk memory operations aren't charged " << GAS_MEMOP_BYTE << " gas per byte"
+                      << std::endl;
+            passed = false;
+        }
+        return passed;
+    }
+
+    void keep_if_worst(const std::vector<uint8_t> &input, const std::string &wast, double ns_per_gas) {
+        const char *worst_dir = getenv("GAS_FUZZ_WORST_DIR");
+        if (!worst_dir)
+            return;
+
+        const std::string dir(worst_dir);
+        double worst = 0;
+        std::ifstream(dir + "/worst") >> worst;
+        if (ns_per_gas <= worst)
+            return;
+
+        std::ofstream(dir + "/worst.input", std::ios::binary).write((const char *) input.data(), input.size());
+        std::ofstream(dir + "/worst.wast") << wast;
+        //written last and renamed into place, so the ratio never points at a half written contract
+        std::ofstream(dir + "/worst.tmp") << ns_per_gas << std::endl;
+        std::rename((dir + "/worst.tmp").c_str(), (dir + "/worst").c_str());
+    }
+
+}
+
+int main(int argc, char **argv) {
+    if (argc < 2) {
+        std::cerr << "usage: gas_fuzz <input file> | --check" << std::endl;
+        return EXIT_FAILURE;
+    }
+    if (!strcmp(argv[1], "--check"))
+        return check_bulk_memory_gas() ? EXIT_SUCCESS : EXIT_FAILURE;
+
+    std::ifstream file(argv[1], std::ios::binary);
+    const std::vector<uint8_t> input((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+    const std::string wast = contract_generator(input).generate();
+    std::vector<uint8_t> code = compile(wast);
+
+    //a run without gas stops at the first metering point, which times everything an execution does before the
+    //contract runs: parsing, injection, compilation and instantiation
+    uint64_t gas_used;
+    const double setup_ns = run(code, 0, gas_used);
+    const double total_ns = run(code, environment("GAS_FUZZ_GAS", 10000000), gas_used);
+    if (!gas_used)
+        return EXIT_SUCCESS;
+
+    const double ns_per_gas = std::max(total_ns - setup_ns, 0.0) / gas_used;
+    std::cerr << "gas used: " << gas_used << ", ns/gas: " << ns_per_gas << std::endl;
+    keep_if_worst(input, wast, ns_per_gas);
+
+    const char *abort_ns_per_gas = getenv("GAS_FUZZ_ABORT_NS_PER_GAS");
+    if (abort_ns_per_gas && ns_per_gas > std::strtod(abort_ns_per_gas, nullptr))
+        abort();
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,129 @@
+#pragma once
+
+#include "types.hpp"
+#include "callbacks.hpp"
+#include <string>
+
+namespace ftl {
+
+    //what an execution was given, as its trace records it
+    struct trace_inputs {
+        bytes code;
+        bytes action;
+        uint8_t from[20];
+        uint8_t to[20];
+        uint8_t owner[20];
+        uint8_t user[20];
+        uint64_t transfer_amount;
+        uint64_t gas;
+        uint64_t state_key;
+        uint64_t timeout_microseconds;
+    };
+
+    /**
+     * @class callback_recorder
+     *
+     * records an execution into a trace: its inputs, every callback it makes with the arguments and what the host
+     * answered, and how it ended. the callbacks it hands out forward to the host's and record into the newest recorder
+     * alive on the thread. a call the host runs through cb_call_action isn't part of the trace; it's an execution of
+     * its own, and is recorded as one
+     */
+    class callback_recorder {
+    public:
+        callback_recorder(const trace_inputs &inputs, const Callbacks &host);
+
+        ~callback_recorder();
+
+        callback_recorder(const callback_recorder &) = delete;
+
+        callback_recorder &operator=(const callback_recorder &) = delete;
+
+        Callbacks *callbacks() { return &_callbacks; }
+
+        void finish(int ret, uint64_t remained_gas);
+
+        const bytes &trace() const { return _trace; }
+
+        void save(const std::string &path) const;
+
+    private:
+        friend struct recording_callbacks;
+
+        void put(uint64_t value);
+
+        void put(const void *data, size_t size);
+
+        Callbacks _host;
+        Callbacks _callbacks;
+        bytes _trace;
+        callback_recorder *_previous;
+    };
+
+    /**
+     * @class callback_replayer
+     *
+     * runs an execution again from its trace. the callbacks it hands out answer from the trace instead of a host, and
+     * throw a trace_divergence_exception at the first callback that isn't the recorded one, or is made with other
+     * arguments; storage writes, logs, transfers and results are arguments too, so the effects are checked as well
+     */
+    class callback_replayer {
+    public:
+        //trace has to outlive the replayer
+        explicit callback_replayer(const bytes &trace);
+
+        ~callback_replayer();
+
+        callback_replayer(const callback_replayer &) = delete;
+
+        callback_replayer &operator=(const callback_replayer &) = delete;
+
+        const trace_inputs &inputs() const { return _inputs; }
+
+        Callbacks *callbacks() { return &_callbacks; }
+
+        //empty if the execution made all recorded callbacks, ended the same and left the same gas; what differed first
+        //otherwise
+        std::string finish(int ret, uint64_t remained_gas);
+
+        //true while a replayer is alive on the thread
+        static bool replaying();
+
+    private:
+        friend struct replaying_callbacks;
+
+        uint64_t get();
+
+        void get(bytes &data);
+
+        void get(void *data, size_t size);
+
+        //records the first divergence and throws it
+        [[noreturn]] void diverge(const std::string &what);
+
+        void expect(uint8_t kind);
+
+        void expect(uint64_t value, const char *what);
+
+        void expect(const void *data, size_t size, const char *what);
+
+        //copies the recorded output into buffer, which holds capacity bytes
+        void output(void *buffer, size_t capacity);
+
+        const bytes &_trace;
+        size_t _position = 0;
+        trace_inputs _inputs;
+        Callbacks _callbacks;
+        std::string _divergence;
+        callback_replayer *_previous;
+    };
+
+    //while recording is on, every execution that doesn't run speculatively writes its trace into a new file in
+    //directory
+    void start_recording(const std::string &directory);
+
+    void stop_recording();
+
+    //the file the next trace goes into, or empty if recording is off
+    std::string next_trace_path();
+
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+#include "types.hpp"
+
+namespace ftl {
+
+    typedef void c_db_store(uint64_t callbackParamKey, uint64_t table, char *key, int keyLength,
+                            char *value, int valueLength);
+
+    typedef int c_db_load(uint64_t callbackParamKey, uint64_t table, char *key, int keyLength,
+                          char *value, int valueLength);
+
+    typedef int c_db_has_key(uint64_t callbackParamKey, uint64_t table, char *key, int keyLength);
+
+    typedef void c_db_remove_key(uint64_t callbackParamKey, uint64_t table, char *key, int keyLength);
+
+    typedef int c_db_has_table(uint64_t callbackParamKey, uint64_t table);
+
+    typedef void c_db_remove_table(uint64_t callbackParamKey, uint64_t table);
+
+    typedef uint64_t c_chain_current_time(uint64_t callbackParamKey);
+
+    typedef uint64_t c_chain_current_height(uint64_t callbackParamKey);
+
+    typedef void c_chain_current_hash(uint64_t callbackParamKey, char *simple_hash, char *full_hash);
+
+    typedef void c_add_log(uint64_t callbackParamKey, char *topics, int topicNum, const char *data, int dataLength);
+
+    typedef void c_transfer(uint64_t callbackParamKey, char *to, uint64_t amount);
+
+    typedef int c_call_action(uint64_t callbackParamKey, char *to, char *action, int actionLength, uint64_t amount,
+                              int storageDelegate, int userDelegate);
+
+    typedef int c_call_result(uint64_t callbackParamKey, char *result, int resultLength);
+
+    typedef int c_set_result(uint64_t callbackParamKey, char *result, int resultLength);
+
+    //prepares the state a nested call runs against: moves amount to `to` and picks the storage and user the callee sees
+    //from the delegate flags. fills in the callee's owner and user addresses and returns the key the callee's callbacks
+    //are made with, or 0 if there's no contract at `to`
+    typedef uint64_t c_enter_action(uint64_t callbackParamKey, char *to, uint64_t amount, int storageDelegate,
+                                    int userDelegate, char *ownerAddr, char *userAddr);
+
+    //copies up to codeLength bytes of the code a nested call runs and returns the code's length
+    typedef int c_load_code(uint64_t callbackParamKey, char *code, int codeLength);
+
+    //keeps the state changes a nested call made, or drops them if it failed, and releases its key. the key of a call
+    //that succeeded has to stay valid until cb_apply_effects, since its logs are tagged with it
+    typedef void c_leave_action(uint64_t callbackParamKey, int failed);
+
+    //hands over the logs of a successful execution, and the transfers of a committed speculative one, laid out as
+    //described in effect_journal
+    typedef void c_apply_effects(uint64_t callbackParamKey, const char *journal, int journalLength);
+
+    typedef struct {
+        c_db_store *cb_store;
+        c_db_load *cb_load;
+        c_db_has_key *cb_has_key;
+        c_db_remove_key *cb_remove_key;
+        c_db_has_table *cb_has_table;
+        c_db_remove_table *cb_remove_table;
+        c_chain_current_time *cb_current_time;
+        c_chain_current_height *cb_current_height;
+        c_chain_current_hash *cb_current_hash;
+        c_add_log *cb_add_log;
+        c_transfer *cb_transfer;
+        c_call_action *cb_call_action;
+        c_call_result *cb_call_result;
+        c_set_result *cb_set_result;
+        c_sha256 *cb_sha256;
+        //nested calls run in-process when the host provides these, and go through cb_call_action otherwise
+        c_enter_action *cb_enter_action;
+        c_load_code *cb_load_code;
+        c_leave_action *cb_leave_action;
+        //effects are replayed through cb_add_log and cb_transfer when the host doesn't provide this
+        c_apply_effects *cb_apply_effects;
+    } Callbacks;
+
+}
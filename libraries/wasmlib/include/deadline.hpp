@@ -0,0 +1,34 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+namespace ftl {
+
+    /**
+     * @class deadline
+     *
+     * a wall clock deadline for an execution. a watchdog thread shared by all deadlines marks it expired once it
+     * passes, so checking it is a single relaxed load; the gas metering points poll it
+     */
+    class deadline {
+    public:
+        explicit deadline(std::chrono::microseconds timeout);
+
+        ~deadline();
+
+        deadline(const deadline &) = delete;
+
+        deadline &operator=(const deadline &) = delete;
+
+        bool expired() const { return _expired.load(std::memory_order_relaxed); }
+
+    private:
+        friend class deadline_watchdog;
+
+        std::chrono::steady_clock::time_point _at;
+        std::atomic<bool> _expired;
+    };
+
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#include "types.hpp"
+#include "callbacks.hpp"
+
+namespace ftl {
+
+    /**
+     * @class effect_journal
+     *
+     * logs of an execution, and the transfers of a speculative one, in the order they were made. they're handed to the
+     * host in one go once the top level action succeeds, and dropped with it if it fails. a nested call that goes through
+     * cb_call_action hands the entries before it over early, so the host drops those itself if the action fails. every
+     * entry is laid out back to back, in host byte order and without padding, as
+     *
+     *   uint8_t kind, uint64_t callbackParamKey, then for a
+     *   log:      uint32_t topicNum, topicNum 32 byte topics, uint32_t dataLength, dataLength bytes of data
+     *   transfer: 20 byte address, uint64_t amount
+     */
+    class effect_journal {
+    public:
+        enum entry_kind : uint8_t {
+            log = 0,
+            transfer = 1,
+        };
+
+        struct entry {
+            uint8_t kind;
+            uint64_t callback_param_key;
+            uint32_t topic_num;
+            const char *topics;   ///< topic_num 32 byte topics of a log, or the 20 byte address of a transfer
+            uint32_t data_length;
+            const char *data;
+            uint64_t amount;
+        };
+
+        void append_log(uint64_t callback_param_key, const char *topics, uint32_t topic_num, const char *data,
+                        uint32_t data_length);
+
+        void append_transfer(uint64_t callback_param_key, const char *to, uint64_t amount);
+
+        //the journal can be cut back to an earlier size to drop the effects of a nested call that failed
+        size_t size() const { return _buffer.size(); }
+
+        void truncate(size_t size) { _buffer.resize(size); }
+
+        const char *data() const { return (const char *) _buffer.data(); }
+
+        //reads the entry at offset and returns the offset of the next one
+        size_t read(size_t offset, entry &e) const;
+
+        //tags every entry with callback_param_key
+        void retag(uint64_t callback_param_key);
+
+        //hands the entries to the host through cb_apply_effects, or replays them through cb_add_log and cb_transfer
+        //if the host doesn't provide it
+        void apply(Callbacks &callbacks, uint64_t callback_param_key) const;
+
+    private:
+        template<typename T>
+        void append(const T &value) {
+            append((const char *) &value, sizeof(T));
+        }
+
+        void append(const char *bytes, size_t size) {
+            _buffer.insert(_buffer.end(), (const uint8_t *) bytes, (const uint8_t *) bytes + size);
+        }
+
+        bytes _buffer;
+    };
+
+}
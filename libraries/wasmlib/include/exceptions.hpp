@@ -61,4 +61,10 @@ namespace ftl {
 
     FTL_DECLARE_DERIVED_EXCEPTION(arithmetic_exception, exception,
                                  20007, "arithmetic exception")
+
+    FTL_DECLARE_DERIVED_EXCEPTION(deadline_exceeded_exception, exception,
+                                 20008, "deadline exceeded exception")
+
+    FTL_DECLARE_DERIVED_EXCEPTION(trace_divergence_exception, exception,
+                                 20009, "trace divergence exception")
 }
@@ -0,0 +1,146 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+namespace ftl {
+    namespace metrics {
+
+        enum counter : uint8_t {
+            executions,
+            failed_executions,
+            reverted_executions,
+            gas_used,
+            out_of_gas,
+            deadlines_exceeded,
+            module_cache_hits,
+            module_cache_misses,
+            module_cache_evictions,
+            //bytes the modules put into and evicted from the caches take up, as their footprint() reports
+            module_cache_added_bytes,
+            module_cache_evicted_bytes,
+            //bytes of linear memory committed when it's reset before a call, whether the previous call touched them or not
+            memory_reset_committed_bytes,
+            profile_guided_compilations,
+            //function definitions of the instantiated modules, and how many of them use code shared with other modules
+            instantiated_functions,
+            shared_functions,
+            //one counter per Runtime::Exception::Cause, in its order
+            traps,
+            num_counters = traps + 15
+        };
+
+        enum histogram : uint8_t {
+            execution,
+            nested_call,
+            parse,
+            inject,
+            jit,
+            host_store,
+            host_load,
+            host_has_key,
+            host_remove_key,
+            host_has_table,
+            host_remove_table,
+            host_current_time,
+            host_current_height,
+            host_current_hash,
+            host_add_log,
+            host_transfer,
+            host_apply_effects,
+            host_call_action,
+            host_call_result,
+            host_set_result,
+            host_enter_action,
+            host_load_code,
+            host_leave_action,
+            host_sha256,
+            num_histograms
+        };
+
+        //latencies in nanoseconds, in buckets of four per power of two, so a percentile is off by at most a quarter
+        const size_t num_buckets = 252;
+
+        /**
+         * @struct thread_metrics
+         *
+         * the metrics of one thread. only the thread itself writes them, with relaxed atomics, so recording takes no
+         * lock; readers add up the metrics of all threads
+         */
+        struct thread_metrics {
+            struct histogram_data {
+                std::atomic<uint64_t> buckets[num_buckets];
+                std::atomic<uint64_t> sum;
+            };
+
+            std::atomic<uint64_t> counters[num_counters];
+            histogram_data histograms[num_histograms];
+        };
+
+        thread_metrics &this_thread();
+
+        size_t bucket(uint64_t ns);
+
+        inline void add(counter c, uint64_t n = 1) {
+            std::atomic<uint64_t> &value = this_thread().counters[c];
+            value.store(value.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+        }
+
+        inline void add_trap(uint8_t cause) {
+            add(counter(traps + cause));
+        }
+
+        inline void record(histogram h, uint64_t ns) {
+            thread_metrics::histogram_data &data = this_thread().histograms[h];
+            std::atomic<uint64_t> &count = data.buckets[bucket(ns)];
+            count.store(count.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+            data.sum.store(data.sum.load(std::memory_order_relaxed) + ns, std::memory_order_relaxed);
+        }
+
+        //records the time from its construction to its destruction
+        class timer {
+        public:
+            explicit timer(histogram h) : _histogram(h), _start(std::chrono::steady_clock::now()) {}
+
+            ~timer() {
+                record(_histogram, std::chrono::duration_cast<std::chrono::nanoseconds>(
+                        std::chrono::steady_clock::now() - _start).count());
+            }
+
+            timer(const timer &) = delete;
+
+            timer &operator=(const timer &) = delete;
+
+        private:
+            histogram _histogram;
+            std::chrono::steady_clock::time_point _start;
+        };
+
+        /**
+         * @struct snapshot
+         *
+         * the metrics of all threads, those that exited included, added up at one point
+         */
+        struct snapshot {
+            uint64_t counters[num_counters];
+            uint64_t buckets[num_histograms][num_buckets];
+            uint64_t sums[num_histograms];
+
+            uint64_t count(histogram h) const;
+
+            //the latency below which the given fraction of the recorded ones are, interpolated within its bucket
+            double percentile(histogram h, double fraction) const;
+
+            //in the Prometheus text format
+            std::string format() const;
+        };
+
+        snapshot read();
+
+        //zeroes the metrics of all threads. a thread recording meanwhile may keep a value it recorded or lose it
+        void reset();
+
+    }
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace ftl {
+    namespace secp256k1 {
+
+        //r and s (32 bytes each, big endian) followed by the recovery id (0-3, or 27-30)
+        constexpr size_t signature_size = 65;
+
+        //0x04 followed by x and y (32 bytes each, big endian)
+        constexpr size_t public_key_size = 65;
+
+        //0x02 or 0x03 (the parity of y) followed by x
+        constexpr size_t compressed_public_key_size = 33;
+
+        struct recovery {
+            const uint8_t *digest;
+            const uint8_t *signature;
+            uint8_t *public_key;
+            bool valid;
+        };
+
+        //recovers the uncompressed public key that produced signature over the 32 byte digest; returns false and leaves
+        //public_key untouched if the signature is malformed or doesn't correspond to any key
+        //the digest is reduced mod n, so a zero digest or one >= n is recovered like any other. high-s signatures are
+        //accepted, as by fc's recovery without its canonical check: (r, s) and (r, n - s) with the other recovery id
+        //recover the same key, so a contract that needs non-malleable signatures must require s <= n / 2 itself
+        bool recover(const uint8_t *digest, const uint8_t *signature, uint8_t *public_key);
+
+        //recovers the public keys of many signatures; the field and scalar inversions are shared between them and
+        //the work is spread over the worker pool. sets valid on each recovery, and zeroes the public key of invalid ones
+        //the public keys may overlap any of the digests and signatures; they are written in order after all are read
+        void recover_batch(recovery *recoveries, size_t count);
+
+        //converts an uncompressed public key to its compressed form; the two may be the same buffer
+        void compress(const uint8_t *public_key, uint8_t *compressed_public_key);
+    }
+}
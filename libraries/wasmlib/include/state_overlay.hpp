@@ -0,0 +1,94 @@
+#pragma once
+
+#include "types.hpp"
+#include "callbacks.hpp"
+#include "effect_journal.hpp"
+#include <map>
+#include <string>
+#include <tuple>
+
+namespace ftl {
+
+    /**
+     * @class state_overlay
+     *
+     * storage changes of a speculative execution, layered over the host's state. writes stay in the overlay, and
+     * reads it can't answer go to the host and are fingerprinted, so the changes can be checked against the host's
+     * state again before they're committed
+     */
+    class state_overlay {
+    public:
+        void store(uint64_t table, const char *key, size_t key_size, const char *value, size_t value_size);
+
+        //loads return the length of the value, and 0 for a missing key
+        int load(Callbacks &callbacks, uint64_t state_key, uint64_t table, const char *key, size_t key_size,
+                 char *buffer, size_t buffer_size);
+
+        int has_key(Callbacks &callbacks, uint64_t state_key, uint64_t table, const char *key, size_t key_size);
+
+        void remove_key(uint64_t table, const char *key, size_t key_size);
+
+        int has_table(Callbacks &callbacks, uint64_t state_key, uint64_t table);
+
+        void remove_table(uint64_t table);
+
+        //true if one of the host reads the changes depend on comes back different now
+        bool is_stale(Callbacks &callbacks, uint64_t state_key) const;
+
+        //writes the changes through to the host; removed tables go first, then the final value of every key
+        void commit(Callbacks &callbacks, uint64_t state_key) const;
+
+    private:
+        struct value_change {
+            bool removed;
+            std::string value;
+        };
+
+        struct table_changes {
+            bool removed = false;
+            std::map<std::string, value_change> values;
+        };
+
+        enum read_kind : uint8_t {
+            load_read,
+            has_key_read,
+            has_table_read,
+        };
+
+        struct read {
+            read_kind kind;
+            uint64_t table;
+            std::string key;
+            size_t buffer_size;
+
+            bool operator<(const read &other) const {
+                return std::tie(kind, table, key, buffer_size) <
+                       std::tie(other.kind, other.table, other.key, other.buffer_size);
+            }
+        };
+
+        //reads from the host into buffer, which is resized to the read's buffer size, and returns the fingerprint of
+        //what came back
+        static uint64_t read_host(Callbacks &callbacks, uint64_t state_key, const read &r, int &ret, bytes &buffer);
+
+        int record_read(Callbacks &callbacks, uint64_t state_key, read &&r, char *buffer);
+
+        std::map<uint64_t, table_changes> _tables;
+        std::map<read, uint64_t> _reads;
+    };
+
+    //what a speculative execution would have done to the host
+    struct change_set {
+        state_overlay state;
+        effect_journal effects;
+        bytes result;
+
+        bool is_stale(Callbacks &callbacks, uint64_t state_key) const {
+            return state.is_stale(callbacks, state_key);
+        }
+
+        //applies the storage changes, then the logs and transfers, then the result
+        void commit(Callbacks &callbacks, uint64_t state_key);
+    };
+
+}
@@ -9,6 +9,7 @@
 #include <boost/preprocessor/seq/subseq.hpp>
 #include <boost/preprocessor/seq/remove.hpp>
 #include <boost/preprocessor/seq/push_back.hpp>
+#include <boost/preprocessor/seq/size.hpp>
 #include <cstdint>
 #include <functional>
 #include <iterator>
@@ -83,6 +84,18 @@ namespace ftl { namespace wasm_ops {
     struct voidtype {
     };
 
+    struct laneidxtype {
+        uint8_t lane;
+    };
+
+    struct shuffletype {
+        uint8_t lanes[16];
+    };
+
+    struct v128type {
+        uint8_t bytes[16];
+    };
+
 
     inline std::string to_string(uint32_t field) {
         return std::string("i32 : ") + std::to_string(field);
@@ -109,6 +122,24 @@ namespace ftl { namespace wasm_ops {
                std::to_string(field.table_index);
     }
 
+    inline std::string to_string(laneidxtype field) {
+        return std::string("laneidxtype : ") + std::to_string((uint32_t) field.lane);
+    }
+
+    inline std::string to_string(shuffletype field) {
+        std::string ret("shuffletype :");
+        for (uint8_t lane : field.lanes)
+            ret += std::string(" ") + std::to_string((uint32_t) lane);
+        return ret;
+    }
+
+    inline std::string to_string(v128type field) {
+        std::string ret("v128 :");
+        for (uint8_t byte : field.bytes)
+            ret += std::string(" ") + std::to_string((uint32_t) byte);
+        return ret;
+    }
+
     inline void pack(instruction_stream *stream, uint32_t field) {
         const char packed[] = {char(field), char(field >> 8), char(field >> 16), char(field >> 24)};
         stream->set(sizeof(packed), packed);
@@ -149,6 +180,19 @@ namespace ftl { namespace wasm_ops {
         stream->set(sizeof(packed), packed);
     }
 
+    inline void pack(instruction_stream *stream, laneidxtype field) {
+        const char packed[] = {char(field.lane)};
+        stream->set(sizeof(packed), packed);
+    }
+
+    inline void pack(instruction_stream *stream, shuffletype field) {
+        stream->set(sizeof(field.lanes), (const char *) field.lanes);
+    }
+
+    inline void pack(instruction_stream *stream, v128type field) {
+        stream->set(sizeof(field.bytes), (const char *) field.bytes);
+    }
+
     template<typename Field>
     struct field_specific_params {
         static constexpr int skip_ahead = sizeof(uint16_t) + sizeof(Field);
@@ -326,6 +370,8 @@ struct OP final : instr_base<Mutators...> {
                      (f64_reinterpret_i64)  \
                      (grow_memory)          \
                      (current_memory)       \
+                     (memory_copy)          \
+                     (memory_fill)          \
 /* BLOCK TYPE OPS */                        \
                      (block)                \
                      (loop)                 \
@@ -372,6 +418,156 @@ struct OP final : instr_base<Mutators...> {
 /* branchtable op */                        \
                      (br_table)             \
 
+#if ENABLE_SIMD_PROTOTYPE
+//the operators of the SIMD proposal, in a sequence of their own since a preprocessor sequence holds at most 256
+#define WASM_SIMD_OP_SEQ                        \
+                     (i8x16_splat)              \
+                     (i16x8_splat)              \
+                     (i32x4_splat)              \
+                     (i64x2_splat)              \
+                     (f32x4_splat)              \
+                     (f64x2_splat)              \
+                     (i8x16_add)                \
+                     (i16x8_add)                \
+                     (i32x4_add)                \
+                     (i64x2_add)                \
+                     (i8x16_sub)                \
+                     (i16x8_sub)                \
+                     (i32x4_sub)                \
+                     (i64x2_sub)                \
+                     (i8x16_mul)                \
+                     (i16x8_mul)                \
+                     (i32x4_mul)                \
+                     (i8x16_neg)                \
+                     (i16x8_neg)                \
+                     (i32x4_neg)                \
+                     (i64x2_neg)                \
+                     (i8x16_add_saturate_s)     \
+                     (i8x16_add_saturate_u)     \
+                     (i16x8_add_saturate_s)     \
+                     (i16x8_add_saturate_u)     \
+                     (i8x16_sub_saturate_s)     \
+                     (i8x16_sub_saturate_u)     \
+                     (i16x8_sub_saturate_s)     \
+                     (i16x8_sub_saturate_u)     \
+                     (i8x16_shl)                \
+                     (i16x8_shl)                \
+                     (i32x4_shl)                \
+                     (i64x2_shl)                \
+                     (i8x16_shr_s)              \
+                     (i8x16_shr_u)              \
+                     (i16x8_shr_s)              \
+                     (i16x8_shr_u)              \
+                     (i32x4_shr_s)              \
+                     (i32x4_shr_u)              \
+                     (i64x2_shr_s)              \
+                     (i64x2_shr_u)              \
+                     (v128_and)                 \
+                     (v128_or)                  \
+                     (v128_xor)                 \
+                     (v128_not)                 \
+                     (v128_bitselect)           \
+                     (i8x16_any_true)           \
+                     (i16x8_any_true)           \
+                     (i32x4_any_true)           \
+                     (i64x2_any_true)           \
+                     (i8x16_all_true)           \
+                     (i16x8_all_true)           \
+                     (i32x4_all_true)           \
+                     (i64x2_all_true)           \
+                     (i8x16_eq)                 \
+                     (i16x8_eq)                 \
+                     (i32x4_eq)                 \
+                     (f32x4_eq)                 \
+                     (f64x2_eq)                 \
+                     (i8x16_ne)                 \
+                     (i16x8_ne)                 \
+                     (i32x4_ne)                 \
+                     (f32x4_ne)                 \
+                     (f64x2_ne)                 \
+                     (i8x16_lt_s)               \
+                     (i8x16_lt_u)               \
+                     (i16x8_lt_s)               \
+                     (i16x8_lt_u)               \
+                     (i32x4_lt_s)               \
+                     (i32x4_lt_u)               \
+                     (f32x4_lt)                 \
+                     (f64x2_lt)                 \
+                     (i8x16_le_s)               \
+                     (i8x16_le_u)               \
+                     (i16x8_le_s)               \
+                     (i16x8_le_u)               \
+                     (i32x4_le_s)               \
+                     (i32x4_le_u)               \
+                     (f32x4_le)                 \
+                     (f64x2_le)                 \
+                     (i8x16_gt_s)               \
+                     (i8x16_gt_u)               \
+                     (i16x8_gt_s)               \
+                     (i16x8_gt_u)               \
+                     (i32x4_gt_s)               \
+                     (i32x4_gt_u)               \
+                     (f32x4_gt)                 \
+                     (f64x2_gt)                 \
+                     (i8x16_ge_s)               \
+                     (i8x16_ge_u)               \
+                     (i16x8_ge_s)               \
+                     (i16x8_ge_u)               \
+                     (i32x4_ge_s)               \
+                     (i32x4_ge_u)               \
+                     (f32x4_ge)                 \
+                     (f64x2_ge)                 \
+                     (f32x4_neg)                \
+                     (f64x2_neg)                \
+                     (f32x4_abs)                \
+                     (f64x2_abs)                \
+                     (f32x4_min)                \
+                     (f64x2_min)                \
+                     (f32x4_max)                \
+                     (f64x2_max)                \
+                     (f32x4_add)                \
+                     (f64x2_add)                \
+                     (f32x4_sub)                \
+                     (f64x2_sub)                \
+                     (f32x4_div)                \
+                     (f64x2_div)                \
+                     (f32x4_mul)                \
+                     (f64x2_mul)                \
+                     (f32x4_sqrt)               \
+                     (f64x2_sqrt)               \
+                     (f32x4_convert_s_i32x4)    \
+                     (f32x4_convert_u_i32x4)    \
+                     (f64x2_convert_s_i64x2)    \
+                     (f64x2_convert_u_i64x2)    \
+                     (i32x4_trunc_s_f32x4_sat)  \
+                     (i32x4_trunc_u_f32x4_sat)  \
+                     (i64x2_trunc_s_f64x2_sat)  \
+                     (i64x2_trunc_u_f64x2_sat)  \
+/* v128 OPS */                                  \
+                     (v128_const)               \
+/* memarg OPS */                                \
+                     (v128_load)                \
+                     (v128_store)               \
+/* lane index OPS */                            \
+                     (i8x16_extract_lane_s)     \
+                     (i8x16_extract_lane_u)     \
+                     (i16x8_extract_lane_s)     \
+                     (i16x8_extract_lane_u)     \
+                     (i32x4_extract_lane)       \
+                     (i64x2_extract_lane)       \
+                     (f32x4_extract_lane)       \
+                     (f64x2_extract_lane)       \
+                     (i8x16_replace_lane)       \
+                     (i16x8_replace_lane)       \
+                     (i32x4_replace_lane)       \
+                     (i64x2_replace_lane)       \
+                     (f32x4_replace_lane)       \
+                     (f64x2_replace_lane)       \
+/* shuffle OP */                                \
+                     (v8x16_shuffle)            \
+
+#endif
+
     enum code {
         unreachable_code = 0x00,
         nop_code = 0x01,
@@ -546,8 +742,173 @@ struct OP final : instr_base<Mutators...> {
         f32_reinterpret_i32_code = 0xBE,
         f64_reinterpret_i64_code = 0xBF,
         error_code = 0xFF,
+        memory_copy_code = 0xFC0A,
+        memory_fill_code = 0xFC0B,
+#if ENABLE_SIMD_PROTOTYPE
+        v128_const_code = 0xFD00,
+        v128_load_code = 0xFD01,
+        v128_store_code = 0xFD02,
+        i8x16_splat_code = 0xFD03,
+        i16x8_splat_code = 0xFD04,
+        i32x4_splat_code = 0xFD05,
+        i64x2_splat_code = 0xFD06,
+        f32x4_splat_code = 0xFD07,
+        f64x2_splat_code = 0xFD08,
+        i8x16_extract_lane_s_code = 0xFD09,
+        i8x16_extract_lane_u_code = 0xFD0A,
+        i16x8_extract_lane_s_code = 0xFD0B,
+        i16x8_extract_lane_u_code = 0xFD0C,
+        i32x4_extract_lane_code = 0xFD0D,
+        i64x2_extract_lane_code = 0xFD0E,
+        f32x4_extract_lane_code = 0xFD0F,
+        f64x2_extract_lane_code = 0xFD10,
+        i8x16_replace_lane_code = 0xFD11,
+        i16x8_replace_lane_code = 0xFD12,
+        i32x4_replace_lane_code = 0xFD13,
+        i64x2_replace_lane_code = 0xFD14,
+        f32x4_replace_lane_code = 0xFD15,
+        f64x2_replace_lane_code = 0xFD16,
+        v8x16_shuffle_code = 0xFD17,
+        i8x16_add_code = 0xFD18,
+        i16x8_add_code = 0xFD19,
+        i32x4_add_code = 0xFD1A,
+        i64x2_add_code = 0xFD1B,
+        i8x16_sub_code = 0xFD1C,
+        i16x8_sub_code = 0xFD1D,
+        i32x4_sub_code = 0xFD1E,
+        i64x2_sub_code = 0xFD1F,
+        i8x16_mul_code = 0xFD20,
+        i16x8_mul_code = 0xFD21,
+        i32x4_mul_code = 0xFD22,
+        i8x16_neg_code = 0xFD23,
+        i16x8_neg_code = 0xFD24,
+        i32x4_neg_code = 0xFD25,
+        i64x2_neg_code = 0xFD26,
+        i8x16_add_saturate_s_code = 0xFD27,
+        i8x16_add_saturate_u_code = 0xFD28,
+        i16x8_add_saturate_s_code = 0xFD29,
+        i16x8_add_saturate_u_code = 0xFD2A,
+        i8x16_sub_saturate_s_code = 0xFD2B,
+        i8x16_sub_saturate_u_code = 0xFD2C,
+        i16x8_sub_saturate_s_code = 0xFD2D,
+        i16x8_sub_saturate_u_code = 0xFD2E,
+        i8x16_shl_code = 0xFD2F,
+        i16x8_shl_code = 0xFD30,
+        i32x4_shl_code = 0xFD31,
+        i64x2_shl_code = 0xFD32,
+        i8x16_shr_s_code = 0xFD33,
+        i8x16_shr_u_code = 0xFD34,
+        i16x8_shr_s_code = 0xFD35,
+        i16x8_shr_u_code = 0xFD36,
+        i32x4_shr_s_code = 0xFD37,
+        i32x4_shr_u_code = 0xFD38,
+        i64x2_shr_s_code = 0xFD39,
+        i64x2_shr_u_code = 0xFD3A,
+        v128_and_code = 0xFD3B,
+        v128_or_code = 0xFD3C,
+        v128_xor_code = 0xFD3D,
+        v128_not_code = 0xFD3E,
+        v128_bitselect_code = 0xFD3F,
+        i8x16_any_true_code = 0xFD40,
+        i16x8_any_true_code = 0xFD41,
+        i32x4_any_true_code = 0xFD42,
+        i64x2_any_true_code = 0xFD43,
+        i8x16_all_true_code = 0xFD44,
+        i16x8_all_true_code = 0xFD45,
+        i32x4_all_true_code = 0xFD46,
+        i64x2_all_true_code = 0xFD47,
+        i8x16_eq_code = 0xFD48,
+        i16x8_eq_code = 0xFD49,
+        i32x4_eq_code = 0xFD4A,
+        f32x4_eq_code = 0xFD4B,
+        f64x2_eq_code = 0xFD4C,
+        i8x16_ne_code = 0xFD4D,
+        i16x8_ne_code = 0xFD4E,
+        i32x4_ne_code = 0xFD4F,
+        f32x4_ne_code = 0xFD50,
+        f64x2_ne_code = 0xFD51,
+        i8x16_lt_s_code = 0xFD52,
+        i8x16_lt_u_code = 0xFD53,
+        i16x8_lt_s_code = 0xFD54,
+        i16x8_lt_u_code = 0xFD55,
+        i32x4_lt_s_code = 0xFD56,
+        i32x4_lt_u_code = 0xFD57,
+        f32x4_lt_code = 0xFD58,
+        f64x2_lt_code = 0xFD59,
+        i8x16_le_s_code = 0xFD5A,
+        i8x16_le_u_code = 0xFD5B,
+        i16x8_le_s_code = 0xFD5C,
+        i16x8_le_u_code = 0xFD5D,
+        i32x4_le_s_code = 0xFD5E,
+        i32x4_le_u_code = 0xFD5F,
+        f32x4_le_code = 0xFD60,
+        f64x2_le_code = 0xFD61,
+        i8x16_gt_s_code = 0xFD62,
+        i8x16_gt_u_code = 0xFD63,
+        i16x8_gt_s_code = 0xFD64,
+        i16x8_gt_u_code = 0xFD65,
+        i32x4_gt_s_code = 0xFD66,
+        i32x4_gt_u_code = 0xFD67,
+        f32x4_gt_code = 0xFD68,
+        f64x2_gt_code = 0xFD69,
+        i8x16_ge_s_code = 0xFD6A,
+        i8x16_ge_u_code = 0xFD6B,
+        i16x8_ge_s_code = 0xFD6C,
+        i16x8_ge_u_code = 0xFD6D,
+        i32x4_ge_s_code = 0xFD6E,
+        i32x4_ge_u_code = 0xFD6F,
+        f32x4_ge_code = 0xFD70,
+        f64x2_ge_code = 0xFD71,
+        f32x4_neg_code = 0xFD72,
+        f64x2_neg_code = 0xFD73,
+        f32x4_abs_code = 0xFD74,
+        f64x2_abs_code = 0xFD75,
+        f32x4_min_code = 0xFD76,
+        f64x2_min_code = 0xFD77,
+        f32x4_max_code = 0xFD78,
+        f64x2_max_code = 0xFD79,
+        f32x4_add_code = 0xFD7A,
+        f64x2_add_code = 0xFD7B,
+        f32x4_sub_code = 0xFD7C,
+        f64x2_sub_code = 0xFD7D,
+        f32x4_div_code = 0xFD7E,
+        f64x2_div_code = 0xFD7F,
+        f32x4_mul_code = 0xFD80,
+        f64x2_mul_code = 0xFD81,
+        f32x4_sqrt_code = 0xFD82,
+        f64x2_sqrt_code = 0xFD83,
+        f32x4_convert_s_i32x4_code = 0xFD84,
+        f32x4_convert_u_i32x4_code = 0xFD85,
+        f64x2_convert_s_i64x2_code = 0xFD86,
+        f64x2_convert_u_i64x2_code = 0xFD87,
+        i32x4_trunc_s_f32x4_sat_code = 0xFD88,
+        i32x4_trunc_u_f32x4_sat_code = 0xFD89,
+        i64x2_trunc_s_f64x2_sat_code = 0xFD8A,
+        i64x2_trunc_u_f64x2_sat_code = 0xFD8B,
+#endif
     }; // code
 
+#if ENABLE_SIMD_PROTOTYPE
+    const size_t num_simd_ops = BOOST_PP_SEQ_SIZE(WASM_SIMD_OP_SEQ);
+#else
+    const size_t num_simd_ops = 0;
+#endif
+
+    //the 0xFCxx opcodes up to memory.fill
+    const size_t num_misc_ops = 0x0C;
+
+    //the index of an opcode in the tables that have an entry per opcode: the 0xFCxx opcodes follow the single byte ones,
+    //and the SIMD opcodes, 0xFDxx, follow those
+    inline size_t op_index(uint16_t code) {
+        if (code < 0x100)
+            return code;
+        if (code < 0xFD00)
+            return 0x100 + (code & 0xFF);
+        return 0x100 + num_misc_ops + (code & 0xFF);
+    }
+
+    const size_t num_op_indices = 0x100 + num_misc_ops + num_simd_ops;
+
     struct visitor_arg {
         IR::Module *module;
         instruction_stream *new_code;
@@ -607,17 +968,29 @@ struct OP final : instr_base<Mutators...> {
 //CONSTRUCT_OP_HAS_DATA(0, voidtype, error)
 
 // construct the instructions
-    BOOST_PP_SEQ_FOR_EACH(CONSTRUCT_OP_HAS_DATA, voidtype, BOOST_PP_SEQ_SUBSEQ(WASM_OP_SEQ, 0, 133))
+    BOOST_PP_SEQ_FOR_EACH(CONSTRUCT_OP_HAS_DATA, voidtype, BOOST_PP_SEQ_SUBSEQ(WASM_OP_SEQ, 0, 135))
+
+    BOOST_PP_SEQ_FOR_EACH(CONSTRUCT_OP_HAS_DATA, blocktype, BOOST_PP_SEQ_SUBSEQ(WASM_OP_SEQ, 135, 3))
 
-    BOOST_PP_SEQ_FOR_EACH(CONSTRUCT_OP_HAS_DATA, blocktype, BOOST_PP_SEQ_SUBSEQ(WASM_OP_SEQ, 133, 3))
+    BOOST_PP_SEQ_FOR_EACH(CONSTRUCT_OP_HAS_DATA, uint32_t, BOOST_PP_SEQ_SUBSEQ(WASM_OP_SEQ, 138, 11))
 
-    BOOST_PP_SEQ_FOR_EACH(CONSTRUCT_OP_HAS_DATA, uint32_t, BOOST_PP_SEQ_SUBSEQ(WASM_OP_SEQ, 136, 11))
+    BOOST_PP_SEQ_FOR_EACH(CONSTRUCT_OP_HAS_DATA, memarg, BOOST_PP_SEQ_SUBSEQ(WASM_OP_SEQ, 149, 23))
 
-    BOOST_PP_SEQ_FOR_EACH(CONSTRUCT_OP_HAS_DATA, memarg, BOOST_PP_SEQ_SUBSEQ(WASM_OP_SEQ, 147, 23))
+    BOOST_PP_SEQ_FOR_EACH(CONSTRUCT_OP_HAS_DATA, uint64_t, BOOST_PP_SEQ_SUBSEQ(WASM_OP_SEQ, 172, 2))
 
-    BOOST_PP_SEQ_FOR_EACH(CONSTRUCT_OP_HAS_DATA, uint64_t, BOOST_PP_SEQ_SUBSEQ(WASM_OP_SEQ, 170, 2))
+    BOOST_PP_SEQ_FOR_EACH(CONSTRUCT_OP_HAS_DATA, branchtabletype, BOOST_PP_SEQ_SUBSEQ(WASM_OP_SEQ, 174, 1))
 
-    BOOST_PP_SEQ_FOR_EACH(CONSTRUCT_OP_HAS_DATA, branchtabletype, BOOST_PP_SEQ_SUBSEQ(WASM_OP_SEQ, 172, 1))
+#if ENABLE_SIMD_PROTOTYPE
+    BOOST_PP_SEQ_FOR_EACH(CONSTRUCT_OP_HAS_DATA, voidtype, BOOST_PP_SEQ_SUBSEQ(WASM_SIMD_OP_SEQ, 0, 122))
+
+    BOOST_PP_SEQ_FOR_EACH(CONSTRUCT_OP_HAS_DATA, v128type, BOOST_PP_SEQ_SUBSEQ(WASM_SIMD_OP_SEQ, 122, 1))
+
+    BOOST_PP_SEQ_FOR_EACH(CONSTRUCT_OP_HAS_DATA, memarg, BOOST_PP_SEQ_SUBSEQ(WASM_SIMD_OP_SEQ, 123, 2))
+
+    BOOST_PP_SEQ_FOR_EACH(CONSTRUCT_OP_HAS_DATA, laneidxtype, BOOST_PP_SEQ_SUBSEQ(WASM_SIMD_OP_SEQ, 125, 14))
+
+    BOOST_PP_SEQ_FOR_EACH(CONSTRUCT_OP_HAS_DATA, shuffletype, BOOST_PP_SEQ_SUBSEQ(WASM_SIMD_OP_SEQ, 139, 1))
+#endif
 
 #undef CONSTRUCT_OP_HAS_DATA
 
@@ -636,29 +1009,39 @@ struct OP final : instr_base<Mutators...> {
 #define GEN_TYPE(r, T, OP) \
    using BOOST_PP_CAT( OP, _t ) = OP < T , BOOST_PP_CAT(T, s) ...>;
         BOOST_PP_SEQ_FOR_EACH(GEN_TYPE, Mutator, WASM_OP_SEQ)
+#if ENABLE_SIMD_PROTOTYPE
+        BOOST_PP_SEQ_FOR_EACH(GEN_TYPE, Mutator, WASM_SIMD_OP_SEQ)
+#endif
 #undef GEN_TYPE
     }; // op_types
 
 
 /** 
  * Section for cached ops
+ * decoding unpacks immediates into the cached instances, so each thread has its own
  */
     template<class Op_Types>
     class cached_ops {
 #define GEN_FIELD(r, P, OP) \
-   static std::unique_ptr<typename Op_Types::BOOST_PP_CAT(OP,_t)> BOOST_PP_CAT(P, OP);
+   static thread_local std::unique_ptr<typename Op_Types::BOOST_PP_CAT(OP,_t)> BOOST_PP_CAT(P, OP);
         BOOST_PP_SEQ_FOR_EACH(GEN_FIELD, cached_, WASM_OP_SEQ)
+#if ENABLE_SIMD_PROTOTYPE
+        BOOST_PP_SEQ_FOR_EACH(GEN_FIELD, cached_, WASM_SIMD_OP_SEQ)
+#endif
 #undef GEN_FIELD
 
-        static std::vector<instr *> _cached_ops;
+        static thread_local std::vector<instr *> _cached_ops;
     public:
         static std::vector<instr *> *get_cached_ops() {
 #define PUSH_BACK_OP(r, T, OP) \
-         _cached_ops[BOOST_PP_CAT(OP,_code)] = BOOST_PP_CAT(T, OP).get();
+         _cached_ops[op_index(BOOST_PP_CAT(OP,_code))] = BOOST_PP_CAT(T, OP).get();
             if (_cached_ops.empty()) {
                 // prefill with error
-                _cached_ops.resize(256, cached_error.get());
+                _cached_ops.resize(num_op_indices, cached_error.get());
                 BOOST_PP_SEQ_FOR_EACH(PUSH_BACK_OP, cached_, WASM_OP_SEQ)
+#if ENABLE_SIMD_PROTOTYPE
+                BOOST_PP_SEQ_FOR_EACH(PUSH_BACK_OP, cached_, WASM_SIMD_OP_SEQ)
+#endif
             }
 #undef PUSH_BACK_OP
             return &_cached_ops;
@@ -666,28 +1049,37 @@ struct OP final : instr_base<Mutators...> {
     };
 
     template<class Op_Types>
-    std::vector<instr *> cached_ops<Op_Types>::_cached_ops;
+    thread_local std::vector<instr *> cached_ops<Op_Types>::_cached_ops;
 
 #define INIT_FIELD(r, P, OP) \
    template <class Op_Types>   \
-   std::unique_ptr<typename Op_Types::BOOST_PP_CAT(OP,_t)> cached_ops<Op_Types>::BOOST_PP_CAT(P, OP) = std::make_unique<typename Op_Types::BOOST_PP_CAT(OP,_t)>();
+   thread_local std::unique_ptr<typename Op_Types::BOOST_PP_CAT(OP,_t)> cached_ops<Op_Types>::BOOST_PP_CAT(P, OP) = std::make_unique<typename Op_Types::BOOST_PP_CAT(OP,_t)>();
     BOOST_PP_SEQ_FOR_EACH(INIT_FIELD, cached_, WASM_OP_SEQ)
+#if ENABLE_SIMD_PROTOTYPE
+    BOOST_PP_SEQ_FOR_EACH(INIT_FIELD, cached_, WASM_SIMD_OP_SEQ)
+#endif
 
     template<class Op_Types>
     std::vector<instr *> *get_cached_ops_vec() {
 #define GEN_FIELD(r, P, OP) \
    static std::unique_ptr<typename Op_Types::BOOST_PP_CAT(OP,_t)> BOOST_PP_CAT(P, OP) = std::make_unique<typename Op_Types::BOOST_PP_CAT(OP,_t)>();
         BOOST_PP_SEQ_FOR_EACH(GEN_FIELD, cached_, WASM_OP_SEQ)
+#if ENABLE_SIMD_PROTOTYPE
+        BOOST_PP_SEQ_FOR_EACH(GEN_FIELD, cached_, WASM_SIMD_OP_SEQ)
+#endif
 #undef GEN_FIELD
         static std::vector<instr *> _cached_ops;
 
 #define PUSH_BACK_OP(r, T, OP) \
-      _cached_ops[BOOST_PP_CAT(OP,_code)] = BOOST_PP_CAT(T, OP).get();
+      _cached_ops[op_index(BOOST_PP_CAT(OP,_code))] = BOOST_PP_CAT(T, OP).get();
 
         if (_cached_ops.empty()) {
             // prefill with error
-            _cached_ops.resize(256, cached_error.get());
+            _cached_ops.resize(num_op_indices, cached_error.get());
             BOOST_PP_SEQ_FOR_EACH(PUSH_BACK_OP, cached_, WASM_OP_SEQ)
+#if ENABLE_SIMD_PROTOTYPE
+            BOOST_PP_SEQ_FOR_EACH(PUSH_BACK_OP, cached_, WASM_SIMD_OP_SEQ)
+#endif
         }
 #undef PUSH_BACK_OP
         return &_cached_ops;
@@ -700,10 +1092,8 @@ struct OP final : instr_base<Mutators...> {
     template<class Op_Types>
     struct EOSIO_OperatorDecoderStream {
         EOSIO_OperatorDecoderStream(const std::vector<U8> &codeBytes)
-                : start(codeBytes.data()), nextByte(codeBytes.data()), end(codeBytes.data() + codeBytes.size()) {
-            if (!_cached_ops)
-                _cached_ops = cached_ops<Op_Types>::get_cached_ops();
-        }
+                : _cached_ops(cached_ops<Op_Types>::get_cached_ops()), start(codeBytes.data()),
+                  nextByte(codeBytes.data()), end(codeBytes.data() + codeBytes.size()) {}
 
         operator bool() const { return nextByte < end; }
 
@@ -717,7 +1107,7 @@ struct OP final : instr_base<Mutators...> {
             FTL_ASSERT(nextByte + sizeof(IR::OpcodeAndImm<IR::Imm>) <= end, wasm_runtime_exception, ""); \
             IR::OpcodeAndImm<IR::Imm>* encodedOperator = (IR::OpcodeAndImm<IR::Imm>*)nextByte; \
             nextByte += sizeof(IR::OpcodeAndImm<IR::Imm>); \
-            auto op = _cached_ops->at(BOOST_PP_CAT(name, _code)); \
+            auto op = _cached_ops->at(op_index(BOOST_PP_CAT(name, _code))); \
             op->unpack( reinterpret_cast<char*>(&(encodedOperator->imm)) ); \
             return op;  \
          }
@@ -739,14 +1129,11 @@ struct OP final : instr_base<Mutators...> {
         inline uint32_t index() { return nextByte - start; }
 
     private:
-        // cached ops to take the address of
-        static const std::vector<instr *> *_cached_ops;
+        // cached ops to take the address of; these belong to the thread that created the decoder
+        const std::vector<instr *> *_cached_ops;
         const U8 *start;
         const U8 *nextByte;
         const U8 *end;
     };
 
-    template<class Op_Types>
-    const std::vector<instr *> *EOSIO_OperatorDecoderStream<Op_Types>::_cached_ops;
-
 } }
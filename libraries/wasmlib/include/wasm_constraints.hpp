@@ -16,6 +16,7 @@ namespace ftl {
         constexpr unsigned maximum_linear_memory_init = 64 * 1024;     //bytes
         constexpr unsigned maximum_func_local_bytes = 8192;        //bytes
         constexpr unsigned maximum_call_depth = 250;         //nested calls
+        constexpr unsigned maximum_action_depth = 16;        //nested call_actions
         constexpr unsigned maximum_code_size = 20 * 1024 * 1024;
 
         static constexpr unsigned wasm_page_size = 64 * 1024;
@@ -2,6 +2,11 @@
 
 #include "wasm_action.hpp"
 #include "wasm_interface.hpp"
+#include "effect_journal.hpp"
+#include "state_overlay.hpp"
+#include "callbacks.hpp"
+#include "deadline.hpp"
+#include "metrics.hpp"
 #include "Runtime/Runtime.h"
 #include <sstream>
 #include <algorithm>
@@ -9,55 +14,6 @@
 
 namespace ftl {
 
-    typedef void c_db_store(uint64_t callbackParamKey, uint64_t table, char *key, int keyLength,
-                            char *value, int valueLength);
-
-    typedef int c_db_load(uint64_t callbackParamKey, uint64_t table, char *key, int keyLength,
-                          char *value, int valueLength);
-
-    typedef int c_db_has_key(uint64_t callbackParamKey, uint64_t table, char *key, int keyLength);
-
-    typedef void c_db_remove_key(uint64_t callbackParamKey, uint64_t table, char *key, int keyLength);
-
-    typedef int c_db_has_table(uint64_t callbackParamKey, uint64_t table);
-
-    typedef void c_db_remove_table(uint64_t callbackParamKey, uint64_t table);
-
-    typedef uint64_t c_chain_current_time(uint64_t callbackParamKey);
-
-    typedef uint64_t c_chain_current_height(uint64_t callbackParamKey);
-
-    typedef void c_chain_current_hash(uint64_t callbackParamKey, char *simple_hash, char *full_hash);
-
-    typedef void c_add_log(uint64_t callbackParamKey, char *topics, int topicNum, const char *data, int dataLength);
-
-    typedef void c_transfer(uint64_t callbackParamKey, char *to, uint64_t amount);
-
-    typedef int c_call_action(uint64_t callbackParamKey, char *to, char *action, int actionLength, uint64_t amount,
-                              int storageDelegate, int userDelegate);
-
-    typedef int c_call_result(uint64_t callbackParamKey, char *result, int resultLength);
-
-    typedef int c_set_result(uint64_t callbackParamKey, char *result, int resultLength);
-
-    typedef struct {
-        c_db_store *cb_store;
-        c_db_load *cb_load;
-        c_db_has_key *cb_has_key;
-        c_db_remove_key *cb_remove_key;
-        c_db_has_table *cb_has_table;
-        c_db_remove_table *cb_remove_table;
-        c_chain_current_time *cb_current_time;
-        c_chain_current_height *cb_current_height;
-        c_chain_current_hash *cb_current_hash;
-        c_add_log *cb_add_log;
-        c_transfer *cb_transfer;
-        c_call_action *cb_call_action;
-        c_call_result *cb_call_result;
-        c_set_result *cb_set_result;
-        c_sha256 *cb_sha256;
-    } Callbacks;
-
     class wasm_context {
         /// Constructor
     public:
@@ -69,7 +25,7 @@ namespace ftl {
                   user_addr_bytes(userAddrBytes),
                   transfer_amount(transferAmount), remained_gas(remainedGas), state_key(stateKey),
                   callbacks(callbacks),
-                  recurse_depth(0) {
+                  recurse_depth(0), journal(&_journal) {
             _pending_console_output = std::ostringstream();
             _pending_console_output.setf(std::ios::scientific, std::ios::floatfield);
         }
@@ -79,6 +35,18 @@ namespace ftl {
 
         void exec();
 
+        /// Revert methods:
+    public:
+
+        //records why the contract reverted and leaves the running wasm without unwinding its frames. the message is a
+        //slice of the contract's memory, which isn't touched again until the next execution, so it's only copied and
+        //formatted if someone asks for revert_message()
+        void revert(uint64_t error_code, const char *message, size_t message_size);
+
+        bool has_reverted() const { return _reverted; }
+
+        std::string revert_message() const;
+
         /// Console methods:
     public:
 
@@ -97,87 +65,126 @@ namespace ftl {
 
         /// Database methods:
     public:
+        //a speculative execution keeps its writes in the overlay and only reads from the host
         void db_store(uint64_t table, const char *key, size_t key_size, const char *buffer, size_t buffer_size) {
+            if (overlay)
+                return overlay->store(table, key, key_size, buffer, buffer_size);
+            metrics::timer timer(metrics::host_store);
             callbacks->cb_store(state_key, table, (char *) key, key_size, (char *) buffer,
                                 buffer_size);
         }
 
         int db_load(uint64_t table, const char *key, size_t key_size, char *buffer, size_t buffer_size) {
+            if (overlay)
+                return overlay->load(*callbacks, state_key, table, key, key_size, buffer, buffer_size);
+            metrics::timer timer(metrics::host_load);
             return callbacks->cb_load(state_key, table, (char *) key, key_size, buffer,
                                       buffer_size);
         }
 
         int db_has_key(uint64_t table, const char *key, size_t key_size) {
+            if (overlay)
+                return overlay->has_key(*callbacks, state_key, table, key, key_size);
+            metrics::timer timer(metrics::host_has_key);
             return callbacks->cb_has_key(state_key, table, (char *) key, key_size);
         }
 
         void db_remove_key(uint64_t table, const char *key, size_t key_size) {
+            if (overlay)
+                return overlay->remove_key(table, key, key_size);
+            metrics::timer timer(metrics::host_remove_key);
             callbacks->cb_remove_key(state_key, table, (char *) key, key_size);
         }
 
         int db_has_table(uint64_t table) {
+            if (overlay)
+                return overlay->has_table(*callbacks, state_key, table);
+            metrics::timer timer(metrics::host_has_table);
             return callbacks->cb_has_table(state_key, table);
         }
 
         void db_remove_table(uint64_t table) {
+            if (overlay)
+                return overlay->remove_table(table);
+            metrics::timer timer(metrics::host_remove_table);
             callbacks->cb_remove_table(state_key, table);
         }
 
         uint64_t chain_current_time() {
+            metrics::timer timer(metrics::host_current_time);
             return callbacks->cb_current_time(state_key);
         }
 
         uint64_t chain_current_height() {
+            metrics::timer timer(metrics::host_current_height);
             return callbacks->cb_current_height(state_key);
         }
 
         void chain_current_hash(sha256 &simple_hash, sha256 &full_hash) {
+            metrics::timer timer(metrics::host_current_hash);
             callbacks->cb_current_hash(state_key, simple_hash.data(), full_hash.data());
         }
 
+        //logs are journaled rather than passed to the host right away; see apply_effects()
         void log0(const char *data, size_t data_size, const sha256 &name) {
-            char topics[32] = {0};
-            memcpy(topics, name.data(), 32);
-            callbacks->cb_add_log(state_key, &(topics[0]), 1, data, data_size);
+            journal->append_log(state_key, name.data(), 1, data, data_size);
         }
 
         void log1(const char *data, size_t data_size, const sha256 &name, const sha256 &param1) {
-            char topics[64] = {0};
+            char topics[64];
             memcpy(topics, name.data(), 32);
             memcpy(&(topics[32]), param1.data(), 32);
-            callbacks->cb_add_log(state_key, &(topics[0]), 2, data, data_size);
+            journal->append_log(state_key, &(topics[0]), 2, data, data_size);
         }
 
         void log2(const char *data, size_t data_size, const sha256 &name, const sha256 &param1, const sha256 &param2) {
-            char topics[96] = {0};
+            char topics[96];
             memcpy(topics, name.data(), 32);
             memcpy(&(topics[32]), param1.data(), 32);
             memcpy(&(topics[64]), param2.data(), 32);
-            callbacks->cb_add_log(state_key, &(topics[0]), 3, data, data_size);
+            journal->append_log(state_key, &(topics[0]), 3, data, data_size);
         }
 
+        //a transfer reaches the host right away, so balances change in order with the transfers cb_enter_action makes
+        //and are dropped with the state of an action that fails. a speculative execution, which can't make nested
+        //calls, journals it into its change set instead
         void transfer(const char *to, uint64_t amount) {
+            if (overlay) {
+                journal->append_transfer(state_key, to, amount);
+                return;
+            }
+            metrics::timer timer(metrics::host_transfer);
             callbacks->cb_transfer(state_key, (char *) to, amount);
         }
 
+        //hands the journaled effects to the host and clears the journal. called once the top level action succeeded,
+        //and before a nested call that goes through cb_call_action
+        void apply_effects();
+
+        /// Nested call methods:
+    public:
+
+        //runs action on the contract at `to` and returns 0, or the code of the exception the callee failed with. the
+        //callee runs in-process on a module cached for its depth, shares this context's gas and hands its result back
+        //directly; the host is only asked to set up and tear down the callee's state
         int call_action(const char *to, const char *action, size_t action_size, uint64_t amount, int storage_delegate,
-                        int user_delegate) {
-            int ret = callbacks->cb_call_action(state_key, (char *) to, (char *) action, action_size, amount,
-                                                storage_delegate, user_delegate);
-            return ret;
-        }
+                        int user_delegate);
 
-        int call_result(char *result, size_t result_size) {
-            return callbacks->cb_call_result(state_key, result, result_size);
-        }
+        //copies up to result_size bytes of the last nested call's result and returns its length
+        int call_result(char *result, size_t result_size);
 
-        int set_result(char *result, size_t result_size) {
-            return callbacks->cb_set_result(state_key, result, result_size);
-        }
+        //sets the result of this action; a top level action hands it to the host, a nested or speculative one keeps it
+        int set_result(char *result, size_t result_size);
 
     public:
+        //the metering points injected into every block double as the points an execution that ran out of time stops at
         void use_gas(int64_t gas) {
+            if (execution_deadline && execution_deadline->expired()) {
+                metrics::add(metrics::deadlines_exceeded);
+                FTL_THROW(deadline_exceeded_exception, "deadline exceeded");
+            }
             if (*(this->remained_gas) < gas) {
+                metrics::add(metrics::out_of_gas);
                 FTL_THROW(wasm_runtime_exception, "gas limit exceeded");
             }
             *(this->remained_gas) -= gas;
@@ -205,12 +212,29 @@ namespace ftl {
         Callbacks *callbacks;
 
         uint32_t recurse_depth; ///< how deep inline actions can recurse
+        bytes result;           ///< result set by a nested action
+        bytes call_result_bytes; ///< result of the last nested call run in-process
+        effect_journal *journal; ///< shared by the nested actions run in-process
+        state_overlay *overlay = nullptr; ///< storage of a speculative execution
+        const deadline *execution_deadline = nullptr; ///< shared by the nested actions run in-process
 
         Runtime::MemoryInstance *memory;
 
     private:
 
+        bytes load_code(uint64_t callee_state_key);
+
+        int call_action_on_host(const char *to, const char *action, size_t action_size, uint64_t amount,
+                                int storage_delegate, int user_delegate);
+
         std::ostringstream _pending_console_output;
+
+        effect_journal _journal;
+
+        bool _reverted = false;
+        uint64_t _revert_code = 0;
+        const char *_revert_message = nullptr;
+        size_t _revert_message_size = 0;
     };
 
     using apply_handler = std::function<void(wasm_context &)>;
@@ -4,6 +4,10 @@
 
 extern int32_t gas_table[];
 
+#if ENABLE_SIMD_PROTOTYPE
+extern int32_t simd_gas_table[];
+#endif
+
 const int32_t GAS_CALL_BASE = 100;
 
 const int32_t GAS_RECOVER_KEY = 450000;  // about 150us
@@ -16,6 +20,8 @@ const int32_t GAS_LOG_2 = 100000;
 const int32_t GAS_LOG_DATA = 1000;
 
 const int32_t GAS_MEMOP_BYTE = 3;
+//memory.copy and memory.fill, besides GAS_MEMOP_BYTE for each byte they go through
+const int32_t GAS_BULK_MEMORY_BASE = 20;  // about 7ns
 
 const int32_t GAS_TRANSFER = 1000000;
 
@@ -25,3 +31,14 @@ const int32_t GAS_DBLOAD_BASE = 1000000;
 const int32_t GAS_DBLOAD_BYTE = 100000;
 const int32_t GAS_DB_HAS = 500000;
 const int32_t GAS_DB_RMV = 500000;
+
+//the gas an operator costs, by the opcode wasm_ops decodes it with
+inline int32_t op_gas(uint16_t code) {
+    if (code >= 0xFC00 && code < 0xFD00)
+        return GAS_BULK_MEMORY_BASE;
+#if ENABLE_SIMD_PROTOTYPE
+    if (code >= 0xFD00)
+        return simd_gas_table[code & 0xFF];
+#endif
+    return gas_table[code];
+}
@@ -7,12 +7,14 @@
 #include "exceptions.hpp"
 #include "IR/Module.h"
 #include "IR/Operators.h"
+#include "Runtime/Runtime.h"
 #include "WASM/WASM.h"
 #include <type_traits>
 #include <string>
 #include <vector>
 #include <map>
 #include <queue>
+#include <set>
 
 namespace ftl {
     namespace wasm_injections {
@@ -108,6 +110,13 @@ namespace ftl {
             }
         };
 
+        //the 128-bit integer builtins that the JIT emits inline instead of calling the host implementation, if that's
+        //enabled; the gas the host implementations charge is charged with the rest of the calling block instead
+        inline bool is_inline_int128_builtin(const IR::Import<IR::IndexedFunctionType> &import) {
+            static const std::set<std::string> builtins = {"__multi3", "__divti3", "__udivti3", "__modti3", "__umodti3"};
+            return Runtime::getInlineInt128Builtins() && import.moduleName == "env" && builtins.count(import.exportName);
+        }
+
         struct noop_injection_visitor {
             static void inject(IR::Module &m);
 
@@ -742,6 +751,14 @@ namespace ftl {
             }
 
             void inject() {
+                //find the calls to inlined builtins before any imports are injected, while the indices in the code
+                //still refer to the original imports
+                std::set<uint32_t> inline_builtin_indices;
+                for (uint32_t i = 0; i < _module->functions.imports.size(); i++) {
+                    if (is_inline_int128_builtin(_module->functions.imports[i]))
+                        inline_builtin_indices.insert(i);
+                }
+
                 _module_injectors.inject(*_module);
 
                 // inject use_gas first
@@ -759,10 +776,16 @@ namespace ftl {
 
                     wasm_ops::instruction_stream tmp_stream(0);
                     int64_t gas = 0;
+                    //a local the length of a bulk memory operation is kept in while its gas is charged, added the
+                    //first time the function needs it
+                    int64_t length_local = -1;
                     while (usegas_decoder) {
                         auto op = usegas_decoder.decodeOp();
                         uint16_t code = op->get_code();
-                        gas += gas_table[code];
+                        gas += op_gas(code);
+                        if (code == wasm_ops::call_code && inline_builtin_indices.count(
+                                reinterpret_cast<wasm_ops::op_types<>::call_t *>(op)->field))
+                            gas += GAS_CALL_BASE;
                         switch (code) {
                             case wasm_ops::end_code:
                             case wasm_ops::br_code:
@@ -785,6 +808,29 @@ namespace ftl {
                                 tmp_stream.idx = 0;
                                 op->pack(&usegas_code);
                                 break;
+                            case wasm_ops::memory_copy_code:
+                            case wasm_ops::memory_fill_code: {
+                                //charge for the bytes before the operation goes through them; the length is on top
+                                //of the stack
+                                if (length_local < 0) {
+                                    length_local = _module->types[fd.type.index]->parameters.size() +
+                                                   fd.nonParameterLocalTypes.size();
+                                    fd.nonParameterLocalTypes.push_back(ValueType::i32);
+                                }
+                                wasm_ops::op_types<>::tee_local_t tee_length;
+                                tee_length.field = length_local;
+                                tee_length.pack(&tmp_stream);
+                                wasm_ops::op_types<>::i64_extend_u_i32_t{}.pack(&tmp_stream);
+                                const_inst.field = GAS_MEMOP_BYTE;
+                                const_inst.pack(&tmp_stream);
+                                wasm_ops::op_types<>::i64_mul_t{}.pack(&tmp_stream);
+                                call_usegas.pack(&tmp_stream);
+                                wasm_ops::op_types<>::get_local_t get_length;
+                                get_length.field = length_local;
+                                get_length.pack(&tmp_stream);
+                                op->pack(&tmp_stream);
+                                break;
+                            }
                             default:
                                 op->pack(&tmp_stream);
                                 break;
@@ -4,6 +4,7 @@
 #include "types.hpp"
 #include "wavm.hpp"
 #include "wasm_injection.hpp"
+#include "metrics.hpp"
 #include "Runtime/Linker.h"
 #include "Runtime/Runtime.h"
 #include "IR/Module.h"
@@ -67,14 +68,20 @@ namespace ftl {
                 //validates code -- does a WASM validation pass and checks the wasm against EOSIO specific constraints
                 static void validate(const std::vector<uint8_t> &code);
 
+                //validates an already parsed module against EOSIO specific constraints
+                static void validate(Module &module);
+
+                //parses code into a module; the WASM validation pass runs as part of the parse
+                static std::unique_ptr<Module> parse_module(const std::vector<uint8_t> &code);
+
                 //Calls apply or error on a given code
                 void apply(const sha256 &code_id, const std::vector<uint8_t> &code, wasm_context &context);
 
                 //Immediately exits currently running wasm. UB is called when no wasm running
                 void exit();
 
-                std::vector<uint8_t> parse_initial_memory(const Module &module) {
-                    std::vector<uint8_t> mem_image;
+                memory_image parse_initial_memory(const Module &module) {
+                    memory_image mem_image;
 
                     for (const DataSegment &data_segment : module.dataSegments) {
                         FTL_ASSERT(data_segment.baseOffset.type == InitializerExpression::Type::i32_const,
@@ -84,52 +91,109 @@ namespace ftl {
                         const Uptr memory_size = (module.memories.defs[0].type.size.min << IR::numBytesPerPageLog2);
                         if (base_offset >= memory_size || base_offset + data_segment.data.size() > memory_size)
                             FTL_THROW(wasm_runtime_exception, "WASM data segment outside of valid memory range");
-                        if (base_offset + data_segment.data.size() > mem_image.size())
-                            mem_image.resize(base_offset + data_segment.data.size(), 0x00);
-                        memcpy(mem_image.data() + base_offset, data_segment.data.data(), data_segment.data.size());
+                        mem_image.set(base_offset, data_segment.data.data(), data_segment.data.size());
                     }
 
                     return mem_image;
                 }
 
+                //instantiates code for the given depth of nested call_action, unless it already is. every depth has a
+                //cache of its own, and the modules of a depth share a memory that's distinct from the other depths', so
+                //a callee never runs in the memory of the action that called it
                 std::unique_ptr<ftl::wasm_instantiated_module> &
                 get_instantiated_module(const sha256 &code_id,
-                                        const bytes &code) {
-                    auto it = instantiation_cache.find(code_id);
-                    if (it == instantiation_cache.end()) {
-                        IR::Module module;
-                        try {
-                            Serialization::MemoryInputStream stream((const U8 *) code.data(), code.size());
-                            WASM::serialize(stream, module);
-                            module.userSections.clear();
-                        } catch (const Serialization::FatalSerializationException &e) {
-                            FTL_ASSERT(false, wasm_serialization_exception, e.message.c_str());
-                        } catch (const IR::ValidationException &e) {
-                            FTL_ASSERT(false, wasm_serialization_exception, e.message.c_str());
+                                        const bytes &code,
+                                        uint32_t depth = 0) {
+                    if (depth >= instantiation_levels.size())
+                        instantiation_levels.resize(depth + 1);
+                    instantiation_level &level = instantiation_levels[depth];
+
+                    auto it = level.modules.find(code_id);
+                    if (it == level.modules.end()) {
+                        metrics::add(metrics::module_cache_misses);
+                        std::unique_ptr<Module> module;
+                        {
+                            metrics::timer timer(metrics::parse);
+                            module = parse_module(code);
                         }
+                        module->userSections.clear();
 
-                        wasm_injections::wasm_binary_injection injector(module);
-                        injector.inject();
-
-                        std::vector<U8> bytes;
-                        try {
-                            Serialization::ArrayOutputStream outstream;
-                            WASM::serialize(outstream, module);
-                            bytes = outstream.getBytes();
-                        } catch (const Serialization::FatalSerializationException &e) {
-                            FTL_ASSERT(false, wasm_serialization_exception, e.message.c_str());
-                        } catch (const IR::ValidationException &e) {
-                            FTL_ASSERT(false, wasm_serialization_exception, e.message.c_str());
+                        {
+                            metrics::timer timer(metrics::inject);
+                            wasm_injections::wasm_binary_injection injector(*module);
+                            injector.inject();
                         }
-                        it = instantiation_cache.emplace(code_id, runtime_interface->instantiate_module(
-                                (const char *) bytes.data(), bytes.size(), parse_initial_memory(module))).first;
+
+                        //the injected module is handed to the runtime as is instead of being serialized and parsed again
+                        memory_image initial_memory = parse_initial_memory(*module);
+
+                        //the top level runs in theMemoryInstance, which outlives the interface; deeper levels pin their
+                        //own memory as theMemoryInstance while they instantiate
+                        memory_pin pin(depth ? &level.memory : nullptr);
+                        metrics::timer timer(metrics::jit);
+                        it = level.modules.emplace(code_id, runtime_interface->instantiate_module(code_id,
+                                std::move(module), std::move(initial_memory))).first;
+                        metrics::add(metrics::module_cache_added_bytes, it->second->footprint());
                     }
                     return it->second;
                 }
 
+                //the bytes the modules in the caches of all depths take up
+                size_t cache_footprint() const {
+                    size_t bytes = 0;
+                    for (const instantiation_level &level : instantiation_levels) {
+                        for (const auto &entry : level.modules)
+                            bytes += entry.second->footprint();
+                    }
+                    return bytes;
+                }
+
+                bool has_instantiated_module(const sha256 &code_id, uint32_t depth) const {
+                    return depth < instantiation_levels.size() && instantiation_levels[depth].modules.count(code_id);
+                }
+
+                //code ids of the contracts nested calls entered, by address
+                bool find_code_id(const uint8_t *address, sha256 &code_id) const {
+                    auto it = code_ids.find(std::string((const char *) address, 20));
+                    if (it == code_ids.end())
+                        return false;
+                    code_id = it->second;
+                    return true;
+                }
+
+                void set_code_id(const uint8_t *address, const sha256 &code_id) {
+                    code_ids[std::string((const char *) address, 20)] = code_id;
+                }
+
             private:
+                struct instantiation_level {
+                    Runtime::MemoryInstance *memory = nullptr;
+                    std::map<sha256, std::unique_ptr<ftl::wasm_instantiated_module>> modules;
+                };
+
+                //makes *memory theMemoryInstance until destroyed, and stores back the memory instantiation created
+                //if it was null
+                struct memory_pin {
+                    memory_pin(Runtime::MemoryInstance **memory) : memory(memory),
+                                                                   outer_memory(Runtime::theMemoryInstance) {
+                        if (memory)
+                            Runtime::theMemoryInstance = *memory;
+                    }
+
+                    ~memory_pin() {
+                        if (memory) {
+                            *memory = Runtime::theMemoryInstance;
+                            Runtime::theMemoryInstance = outer_memory;
+                        }
+                    }
+
+                    Runtime::MemoryInstance **memory;
+                    Runtime::MemoryInstance *outer_memory;
+                };
+
                 std::unique_ptr<ftl::wavm_runtime> runtime_interface;
-                std::map<sha256, std::unique_ptr<ftl::wasm_instantiated_module>> instantiation_cache;
+                std::vector<instantiation_level> instantiation_levels;
+                std::map<std::string, sha256> code_ids;
             };
 
         }
@@ -2,12 +2,14 @@
 
 #include "exceptions.hpp"
 #include "wasm_binary_ops.hpp"
+#include <exception>
 #include <functional>
 #include <vector>
 #include <iostream>
 #include "IR/Module.h"
 #include "IR/Operators.h"
 #include "WASM/WASM.h"
+#include "Platform/Platform.h"
 
 namespace ftl {
     namespace wasm_validations {
@@ -105,22 +107,25 @@ namespace ftl {
             }
         };
 
+        //the depth carries over from one function to the next, so while the function bodies are checked in parallel
+        //they only record their block, loop, if, else and end operators; the depth is followed through them in
+        //function order afterwards
         struct nested_validator {
             static constexpr bool kills = false;
             static constexpr bool post = false;
-            static bool disabled;
-            static uint16_t depth;
+            //the operators of the function the thread is checking, true for each end
+            static thread_local std::vector<bool> *ends;
 
-            static void init(bool disable) {
-                disabled = disable;
-                depth = 0;
+            static void accept(wasm_ops::instr *inst, wasm_ops::visitor_arg &arg) {
+                ends->push_back(inst->get_code() == wasm_ops::end_code);
             }
 
-            static void accept(wasm_ops::instr *inst, wasm_ops::visitor_arg &arg) {
-                if (!disabled) {
-                    if (inst->get_code() == wasm_ops::end_code && depth > 0) {
+            //follows depth through a function's operators as if each were checked when it was decoded
+            static void follow(const std::vector<bool> &function_ends, uint16_t &depth) {
+                for (bool end : function_ends) {
+                    if (end && depth > 0) {
                         depth--;
-                        return;
+                        continue;
                     }
                     depth++;
                     FTL_ASSERT(depth < 1024, wasm_runtime_exception, "Nested depth exceeded");
@@ -155,6 +160,8 @@ namespace ftl {
 
             using grow_memory_t     = wasm_ops::grow_memory<whitelist_validator>;
             using current_memory_t  = wasm_ops::current_memory<whitelist_validator>;
+            using memory_copy_t     = wasm_ops::memory_copy<whitelist_validator>;
+            using memory_fill_t     = wasm_ops::memory_fill<whitelist_validator>;
 
             using nop_t             = wasm_ops::nop<whitelist_validator>;
             using i32_load_t        = wasm_ops::i32_load<large_offset_validator<wasm_ops::op_types<>::i32_load_t>, whitelist_validator>;
@@ -319,6 +326,108 @@ namespace ftl {
             using i64_reinterpret_f64_t = wasm_ops::i64_reinterpret_f64<whitelist_validator>;
             using f64_reinterpret_i64_t = wasm_ops::f64_reinterpret_i64<whitelist_validator>;
 
+#if ENABLE_SIMD_PROTOTYPE
+            //the SIMD operators on integer lanes, in the prototype's encoding; see ENABLE_SIMD_PROTOTYPE, which is off by
+            //default. those on float lanes have no deterministic counterpart the way the scalar ones do in softfloat, so
+            //they stay blacklisted, and so do the conversions between the two
+            using v128_const_t            = wasm_ops::v128_const<whitelist_validator>;
+            using v128_load_t             = wasm_ops::v128_load<large_offset_validator<wasm_ops::op_types<>::v128_load_t>, whitelist_validator>;
+            using v128_store_t            = wasm_ops::v128_store<large_offset_validator<wasm_ops::op_types<>::v128_store_t>, whitelist_validator>;
+            using i8x16_splat_t           = wasm_ops::i8x16_splat<whitelist_validator>;
+            using i16x8_splat_t           = wasm_ops::i16x8_splat<whitelist_validator>;
+            using i32x4_splat_t           = wasm_ops::i32x4_splat<whitelist_validator>;
+            using i64x2_splat_t           = wasm_ops::i64x2_splat<whitelist_validator>;
+            using i8x16_extract_lane_s_t  = wasm_ops::i8x16_extract_lane_s<whitelist_validator>;
+            using i8x16_extract_lane_u_t  = wasm_ops::i8x16_extract_lane_u<whitelist_validator>;
+            using i16x8_extract_lane_s_t  = wasm_ops::i16x8_extract_lane_s<whitelist_validator>;
+            using i16x8_extract_lane_u_t  = wasm_ops::i16x8_extract_lane_u<whitelist_validator>;
+            using i32x4_extract_lane_t    = wasm_ops::i32x4_extract_lane<whitelist_validator>;
+            using i64x2_extract_lane_t    = wasm_ops::i64x2_extract_lane<whitelist_validator>;
+            using i8x16_replace_lane_t    = wasm_ops::i8x16_replace_lane<whitelist_validator>;
+            using i16x8_replace_lane_t    = wasm_ops::i16x8_replace_lane<whitelist_validator>;
+            using i32x4_replace_lane_t    = wasm_ops::i32x4_replace_lane<whitelist_validator>;
+            using i64x2_replace_lane_t    = wasm_ops::i64x2_replace_lane<whitelist_validator>;
+            using v8x16_shuffle_t         = wasm_ops::v8x16_shuffle<whitelist_validator>;
+            using i8x16_add_t             = wasm_ops::i8x16_add<whitelist_validator>;
+            using i16x8_add_t             = wasm_ops::i16x8_add<whitelist_validator>;
+            using i32x4_add_t             = wasm_ops::i32x4_add<whitelist_validator>;
+            using i64x2_add_t             = wasm_ops::i64x2_add<whitelist_validator>;
+            using i8x16_sub_t             = wasm_ops::i8x16_sub<whitelist_validator>;
+            using i16x8_sub_t             = wasm_ops::i16x8_sub<whitelist_validator>;
+            using i32x4_sub_t             = wasm_ops::i32x4_sub<whitelist_validator>;
+            using i64x2_sub_t             = wasm_ops::i64x2_sub<whitelist_validator>;
+            using i8x16_mul_t             = wasm_ops::i8x16_mul<whitelist_validator>;
+            using i16x8_mul_t             = wasm_ops::i16x8_mul<whitelist_validator>;
+            using i32x4_mul_t             = wasm_ops::i32x4_mul<whitelist_validator>;
+            using i8x16_neg_t             = wasm_ops::i8x16_neg<whitelist_validator>;
+            using i16x8_neg_t             = wasm_ops::i16x8_neg<whitelist_validator>;
+            using i32x4_neg_t             = wasm_ops::i32x4_neg<whitelist_validator>;
+            using i64x2_neg_t             = wasm_ops::i64x2_neg<whitelist_validator>;
+            using i8x16_add_saturate_s_t  = wasm_ops::i8x16_add_saturate_s<whitelist_validator>;
+            using i8x16_add_saturate_u_t  = wasm_ops::i8x16_add_saturate_u<whitelist_validator>;
+            using i16x8_add_saturate_s_t  = wasm_ops::i16x8_add_saturate_s<whitelist_validator>;
+            using i16x8_add_saturate_u_t  = wasm_ops::i16x8_add_saturate_u<whitelist_validator>;
+            using i8x16_sub_saturate_s_t  = wasm_ops::i8x16_sub_saturate_s<whitelist_validator>;
+            using i8x16_sub_saturate_u_t  = wasm_ops::i8x16_sub_saturate_u<whitelist_validator>;
+            using i16x8_sub_saturate_s_t  = wasm_ops::i16x8_sub_saturate_s<whitelist_validator>;
+            using i16x8_sub_saturate_u_t  = wasm_ops::i16x8_sub_saturate_u<whitelist_validator>;
+            using i8x16_shl_t             = wasm_ops::i8x16_shl<whitelist_validator>;
+            using i16x8_shl_t             = wasm_ops::i16x8_shl<whitelist_validator>;
+            using i32x4_shl_t             = wasm_ops::i32x4_shl<whitelist_validator>;
+            using i64x2_shl_t             = wasm_ops::i64x2_shl<whitelist_validator>;
+            using i8x16_shr_s_t           = wasm_ops::i8x16_shr_s<whitelist_validator>;
+            using i8x16_shr_u_t           = wasm_ops::i8x16_shr_u<whitelist_validator>;
+            using i16x8_shr_s_t           = wasm_ops::i16x8_shr_s<whitelist_validator>;
+            using i16x8_shr_u_t           = wasm_ops::i16x8_shr_u<whitelist_validator>;
+            using i32x4_shr_s_t           = wasm_ops::i32x4_shr_s<whitelist_validator>;
+            using i32x4_shr_u_t           = wasm_ops::i32x4_shr_u<whitelist_validator>;
+            using i64x2_shr_s_t           = wasm_ops::i64x2_shr_s<whitelist_validator>;
+            using i64x2_shr_u_t           = wasm_ops::i64x2_shr_u<whitelist_validator>;
+            using v128_and_t              = wasm_ops::v128_and<whitelist_validator>;
+            using v128_or_t               = wasm_ops::v128_or<whitelist_validator>;
+            using v128_xor_t              = wasm_ops::v128_xor<whitelist_validator>;
+            using v128_not_t              = wasm_ops::v128_not<whitelist_validator>;
+            using v128_bitselect_t        = wasm_ops::v128_bitselect<whitelist_validator>;
+            using i8x16_any_true_t        = wasm_ops::i8x16_any_true<whitelist_validator>;
+            using i16x8_any_true_t        = wasm_ops::i16x8_any_true<whitelist_validator>;
+            using i32x4_any_true_t        = wasm_ops::i32x4_any_true<whitelist_validator>;
+            using i64x2_any_true_t        = wasm_ops::i64x2_any_true<whitelist_validator>;
+            using i8x16_all_true_t        = wasm_ops::i8x16_all_true<whitelist_validator>;
+            using i16x8_all_true_t        = wasm_ops::i16x8_all_true<whitelist_validator>;
+            using i32x4_all_true_t        = wasm_ops::i32x4_all_true<whitelist_validator>;
+            using i64x2_all_true_t        = wasm_ops::i64x2_all_true<whitelist_validator>;
+            using i8x16_eq_t              = wasm_ops::i8x16_eq<whitelist_validator>;
+            using i16x8_eq_t              = wasm_ops::i16x8_eq<whitelist_validator>;
+            using i32x4_eq_t              = wasm_ops::i32x4_eq<whitelist_validator>;
+            using i8x16_ne_t              = wasm_ops::i8x16_ne<whitelist_validator>;
+            using i16x8_ne_t              = wasm_ops::i16x8_ne<whitelist_validator>;
+            using i32x4_ne_t              = wasm_ops::i32x4_ne<whitelist_validator>;
+            using i8x16_lt_s_t            = wasm_ops::i8x16_lt_s<whitelist_validator>;
+            using i8x16_lt_u_t            = wasm_ops::i8x16_lt_u<whitelist_validator>;
+            using i16x8_lt_s_t            = wasm_ops::i16x8_lt_s<whitelist_validator>;
+            using i16x8_lt_u_t            = wasm_ops::i16x8_lt_u<whitelist_validator>;
+            using i32x4_lt_s_t            = wasm_ops::i32x4_lt_s<whitelist_validator>;
+            using i32x4_lt_u_t            = wasm_ops::i32x4_lt_u<whitelist_validator>;
+            using i8x16_le_s_t            = wasm_ops::i8x16_le_s<whitelist_validator>;
+            using i8x16_le_u_t            = wasm_ops::i8x16_le_u<whitelist_validator>;
+            using i16x8_le_s_t            = wasm_ops::i16x8_le_s<whitelist_validator>;
+            using i16x8_le_u_t            = wasm_ops::i16x8_le_u<whitelist_validator>;
+            using i32x4_le_s_t            = wasm_ops::i32x4_le_s<whitelist_validator>;
+            using i32x4_le_u_t            = wasm_ops::i32x4_le_u<whitelist_validator>;
+            using i8x16_gt_s_t            = wasm_ops::i8x16_gt_s<whitelist_validator>;
+            using i8x16_gt_u_t            = wasm_ops::i8x16_gt_u<whitelist_validator>;
+            using i16x8_gt_s_t            = wasm_ops::i16x8_gt_s<whitelist_validator>;
+            using i16x8_gt_u_t            = wasm_ops::i16x8_gt_u<whitelist_validator>;
+            using i32x4_gt_s_t            = wasm_ops::i32x4_gt_s<whitelist_validator>;
+            using i32x4_gt_u_t            = wasm_ops::i32x4_gt_u<whitelist_validator>;
+            using i8x16_ge_s_t            = wasm_ops::i8x16_ge_s<whitelist_validator>;
+            using i8x16_ge_u_t            = wasm_ops::i8x16_ge_u<whitelist_validator>;
+            using i16x8_ge_s_t            = wasm_ops::i16x8_ge_s<whitelist_validator>;
+            using i16x8_ge_u_t            = wasm_ops::i16x8_ge_u<whitelist_validator>;
+            using i32x4_ge_s_t            = wasm_ops::i32x4_ge_s<whitelist_validator>;
+            using i32x4_ge_u_t            = wasm_ops::i32x4_ge_u<whitelist_validator>;
+#endif
+
         }; // op_constrainers
 
 
@@ -340,20 +449,36 @@ namespace ftl {
                     maximum_function_stack_visitor,
                     ensure_apply_exported_visitor>;
         public:
-            wasm_binary_validation(IR::Module &mod) : _module(&mod) {
-                // initialize validators here
-                nested_validator::init(false);
-            }
+            wasm_binary_validation(IR::Module &mod) : _module(&mod) {}
 
             void validate() {
                 _module_validators.validate(*_module);
-                for (auto &fd : _module->functions.defs) {
-                    wasm_ops::EOSIO_OperatorDecoderStream <op_constrainers> decoder(fd.code);
-                    while (decoder) {
-                        wasm_ops::instruction_stream new_code(0);
-                        auto op = decoder.decodeOp();
-                        op->visit({_module, &new_code, &fd, decoder.index()});
+
+                //the function bodies are checked in parallel, each up to its first error
+                const size_t num_functions = _module->functions.defs.size();
+                std::vector<std::vector<bool>> function_ends(num_functions);
+                std::vector<std::exception_ptr> function_errors(num_functions);
+                Platform::parallelFor(num_functions, [&](Uptr function_index) {
+                    nested_validator::ends = &function_ends[function_index];
+                    try {
+                        IR::FunctionDef &fd = _module->functions.defs[function_index];
+                        wasm_ops::EOSIO_OperatorDecoderStream <op_constrainers> decoder(fd.code);
+                        while (decoder) {
+                            wasm_ops::instruction_stream new_code(0);
+                            auto op = decoder.decodeOp();
+                            op->visit({_module, &new_code, &fd, decoder.index()});
+                        }
+                    } catch (...) {
+                        function_errors[function_index] = std::current_exception();
                     }
+                });
+
+                //the error reported is the one checking the functions one after the other would have found first
+                uint16_t depth = 0;
+                for (size_t function_index = 0; function_index < num_functions; function_index++) {
+                    nested_validator::follow(function_ends[function_index], depth);
+                    if (function_errors[function_index])
+                        std::rethrow_exception(function_errors[function_index]);
                 }
             }
 
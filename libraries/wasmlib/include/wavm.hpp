@@ -4,6 +4,7 @@
 #include "common.hpp"
 #include "exceptions.hpp"
 #include "softfloat.hpp"
+#include "types.hpp"
 #include "Runtime/Runtime.h"
 #include "IR/Types.h"
 
@@ -13,21 +14,56 @@ namespace ftl {
     using namespace IR;
     using namespace Runtime;
 
+    /**
+     * @class memory_image
+     *
+     * the bytes a module's data segments set in its memory, as runs at their offsets; everything else starts zeroed.
+     * the runs are sorted by offset and don't overlap, and long stretches of zeros are left out of them, so a module
+     * that sets a few bytes high up in its memory only holds those bytes
+     */
+    class memory_image {
+    public:
+        //sets the size bytes at offset to data; where they overlap bytes that were set before, data wins
+        void set(uint32_t offset, const uint8_t *data, size_t size);
+
+        //copies the runs into memory, which has to be zeroed
+        void copy_to(uint8_t *memory) const;
+
+        //the bytes the image holds besides itself
+        size_t footprint() const;
+
+    private:
+        struct run {
+            uint32_t offset;
+            bytes data;
+        };
+        std::vector<run> _runs;
+    };
+
     class wasm_instantiated_module {
     public:
-        wasm_instantiated_module(ModuleInstance *instance, std::unique_ptr<Module> module,
-                                 std::vector<uint8_t> initial_mem);
+        //only keeps what resetting the instance needs of module, which can be freed once the instance is compiled
+        wasm_instantiated_module(ModuleInstance *instance, const Module &module, memory_image initial_memory,
+                                 std::shared_ptr<ModuleProfile> collecting_profile = nullptr);
+
+        ~wasm_instantiated_module();
 
         void apply(ftl::wasm_context &context);
 
+        //the bytes the module takes up: its initial memory and the code compiled for it, not counting code it shares
+        //with other modules
+        size_t footprint() const;
+
     private:
         void call(const std::string &entry_point, const std::vector<Value> &args, ftl::wasm_context &context);
 
-        std::vector<uint8_t> _initial_memory;
+        memory_image _initial_memory;
+        MemoryType _memory_type;
+        //the profile _instance adds its counts to when it's freed
+        std::shared_ptr<ModuleProfile> _collecting_profile;
         //naked pointer because ModuleInstance is opaque
-        //_instance is deleted via WAVM's object garbage collection when wavm_rutime is deleted
+        //_instance holds a reference that is removed when this is deleted, which frees the instance and its code
         ModuleInstance *_instance;
-        std::unique_ptr<Module> _module;
     };
 
     class wavm_runtime {
@@ -37,11 +73,20 @@ namespace ftl {
         ~wavm_runtime();
 
         std::unique_ptr<wasm_instantiated_module>
-        instantiate_module(const char *code_bytes, size_t code_size,
-                           std::vector<uint8_t> initial_memory);
+        instantiate_module(const sha256 &code_id, std::unique_ptr<Module> module, memory_image initial_memory);
 
         void immediately_exit_currently_running_module();
 
+        //the first instantiations times a code is instantiated, its code counts how its branches and indirect calls
+        //run; later instantiations are compiled with those counts. 0, the default, turns it off
+        static void set_profile_guided_compilation(uint32_t instantiations);
+
+        //emits the 128-bit integer division, remainder and multiplication builtins inline, and charges their gas with the
+        //rest of the calling block instead of when they're called. an execution that fails partway through a block then
+        //used different gas, so every node has to turn it on at the same point. off by default; has to be set before any
+        //contract is instantiated
+        static void set_inline_int128_builtins(bool enable);
+
         struct runtime_guard {
             runtime_guard();
 
@@ -0,0 +1,249 @@
+#include "metrics.hpp"
+#include <cmath>
+#include <iomanip>
+#include <mutex>
+#include <set>
+#include <sstream>
+#include <string.h>
+
+namespace ftl {
+    namespace metrics {
+
+        static const char *counter_names[] = {
+                "wasm_executions_total",
+                "wasm_failed_executions_total",
+                "wasm_reverted_executions_total",
+                "wasm_gas_used_total",
+                "wasm_out_of_gas_total",
+                "wasm_deadlines_exceeded_total",
+                "wasm_module_cache_hits_total",
+                "wasm_module_cache_misses_total",
+                "wasm_module_cache_evictions_total",
+                "wasm_module_cache_added_bytes_total",
+                "wasm_module_cache_evicted_bytes_total",
+                "wasm_memory_reset_committed_bytes_total",
+                "wasm_profile_guided_compilations_total",
+                "wasm_instantiated_functions_total",
+                "wasm_shared_functions_total",
+        };
+        static_assert(sizeof(counter_names) / sizeof(counter_names[0]) == traps, "a counter has no name");
+
+        static const char *trap_causes[] = {
+                "unknown",
+                "accessViolation",
+                "stackOverflow",
+                "integerDivideByZeroOrIntegerOverflow",
+                "invalidFloatOperation",
+                "invokeSignatureMismatch",
+                "reachedUnreachable",
+                "indirectCallSignatureMismatch",
+                "undefinedTableElement",
+                "calledAbort",
+                "calledUnimplementedIntrinsic",
+                "outOfMemory",
+                "invalidSegmentOffset",
+                "misalignedAtomicMemoryAccess",
+                "callStackExhausted",
+        };
+        static_assert(sizeof(trap_causes) / sizeof(trap_causes[0]) == num_counters - traps, "a trap has no cause");
+
+        static const char *histogram_names[] = {
+                "wasm_execution_seconds",
+                "wasm_nested_call_seconds",
+                "wasm_parse_seconds",
+                "wasm_inject_seconds",
+                "wasm_jit_seconds",
+        };
+
+        static const char *host_callbacks[] = {
+                "store",
+                "load",
+                "has_key",
+                "remove_key",
+                "has_table",
+                "remove_table",
+                "current_time",
+                "current_height",
+                "current_hash",
+                "add_log",
+                "transfer",
+                "apply_effects",
+                "call_action",
+                "call_result",
+                "set_result",
+                "enter_action",
+                "load_code",
+                "leave_action",
+                "sha256",
+        };
+        static_assert(sizeof(histogram_names) / sizeof(histogram_names[0]) == host_store &&
+                      sizeof(host_callbacks) / sizeof(host_callbacks[0]) == num_histograms - host_store,
+                      "a histogram has no name");
+
+        static void zero(thread_metrics &m) {
+            for (auto &value : m.counters)
+                value.store(0, std::memory_order_relaxed);
+            for (auto &h : m.histograms) {
+                for (auto &count : h.buckets)
+                    count.store(0, std::memory_order_relaxed);
+                h.sum.store(0, std::memory_order_relaxed);
+            }
+        }
+
+        static void add_to(snapshot &s, const thread_metrics &m) {
+            for (size_t i = 0; i < num_counters; i++)
+                s.counters[i] += m.counters[i].load(std::memory_order_relaxed);
+            for (size_t h = 0; h < num_histograms; h++) {
+                for (size_t i = 0; i < num_buckets; i++)
+                    s.buckets[h][i] += m.histograms[h].buckets[i].load(std::memory_order_relaxed);
+                s.sums[h] += m.histograms[h].sum.load(std::memory_order_relaxed);
+            }
+        }
+
+        //the metrics of the running threads, and the sum of those of the threads that exited
+        struct registry {
+            std::mutex lock;
+            std::set<thread_metrics *> threads;
+            thread_metrics retired;
+
+            static registry &get() {
+                //threads may exit after static destructors ran, so the registry is never destroyed
+                static registry *r = new registry();
+                return *r;
+            }
+
+        private:
+            registry() {
+                zero(retired);
+            }
+        };
+
+        struct thread_registration {
+            thread_metrics metrics;
+
+            thread_registration() {
+                zero(metrics);
+                registry &r = registry::get();
+                std::lock_guard<std::mutex> l(r.lock);
+                r.threads.insert(&metrics);
+            }
+
+            ~thread_registration() {
+                registry &r = registry::get();
+                std::lock_guard<std::mutex> l(r.lock);
+                for (size_t i = 0; i < num_counters; i++)
+                    r.retired.counters[i] += metrics.counters[i].load(std::memory_order_relaxed);
+                for (size_t h = 0; h < num_histograms; h++) {
+                    for (size_t i = 0; i < num_buckets; i++)
+                        r.retired.histograms[h].buckets[i] += metrics.histograms[h].buckets[i].load(
+                                std::memory_order_relaxed);
+                    r.retired.histograms[h].sum += metrics.histograms[h].sum.load(std::memory_order_relaxed);
+                }
+                r.threads.erase(&metrics);
+            }
+        };
+
+        thread_metrics &this_thread() {
+            thread_local thread_registration registration;
+            return registration.metrics;
+        }
+
+        size_t bucket(uint64_t ns) {
+            if (ns < 4)
+                return ns;
+            const int exponent = 63 - __builtin_clzll(ns);
+            return (exponent - 1) * 4 + ((ns >> (exponent - 2)) & 3);
+        }
+
+        static double bucket_start(size_t bucket) {
+            if (bucket < 4)
+                return bucket;
+            return std::ldexp(4 + bucket % 4, int(bucket / 4) - 1);
+        }
+
+        uint64_t snapshot::count(histogram h) const {
+            uint64_t n = 0;
+            for (uint64_t c : buckets[h])
+                n += c;
+            return n;
+        }
+
+        double snapshot::percentile(histogram h, double fraction) const {
+            const double rank = fraction * count(h);
+            double below = 0;
+            for (size_t i = 0; i < num_buckets; i++) {
+                if (buckets[h][i] && below + buckets[h][i] >= rank) {
+                    const double start = bucket_start(i);
+                    return start + (bucket_start(i + 1) - start) * (rank - below) / buckets[h][i];
+                }
+                below += buckets[h][i];
+            }
+            return 0;
+        }
+
+        std::string snapshot::format() const {
+            std::ostringstream out;
+            for (size_t i = 0; i < traps; i++) {
+                out << "# TYPE " << counter_names[i] << " counter\n"
+                    << counter_names[i] << " " << counters[i] << "\n";
+            }
+            out << "# TYPE wasm_traps_total counter\n";
+            for (size_t i = traps; i < num_counters; i++)
+                out << "wasm_traps_total{cause=\"" << trap_causes[i - traps] << "\"} " << counters[i] << "\n";
+
+            //gas per second the contracts ran, rather than per second of wall time, which the scraper has
+            const double execution_seconds = sums[execution] / 1e9;
+            out << "# TYPE wasm_gas_per_second gauge\n"
+                << "wasm_gas_per_second " << (execution_seconds > 0 ? counters[gas_used] / execution_seconds : 0)
+                << "\n";
+
+            //bytes the caches hold right now. the threads' counters aren't read at the same instant, so the evictions
+            //can be ahead of the modules they evicted
+            const uint64_t added = counters[module_cache_added_bytes], evicted = counters[module_cache_evicted_bytes];
+            out << "# TYPE wasm_module_cache_bytes gauge\n"
+                << "wasm_module_cache_bytes " << (added > evicted ? added - evicted : 0) << "\n";
+
+            out << std::setprecision(9);
+            for (size_t h = 0; h < num_histograms; h++) {
+                std::string name, labels;
+                if (h < host_store) {
+                    name = histogram_names[h];
+                } else {
+                    name = "wasm_host_callback_seconds";
+                    labels = std::string("callback=\"") + host_callbacks[h - host_store] + "\",";
+                }
+                if (h <= host_store)
+                    out << "# TYPE " << name << " summary\n";
+                for (double quantile : {0.5, 0.9, 0.99, 0.999}) {
+                    out << name << "{" << labels << "quantile=\"" << quantile << "\"} "
+                        << percentile(histogram(h), quantile) / 1e9 << "\n";
+                }
+                if (!labels.empty())
+                    labels = "{" + labels.substr(0, labels.size() - 1) + "}";
+                out << name << "_sum" << labels << " " << sums[h] / 1e9 << "\n"
+                    << name << "_count" << labels << " " << count(histogram(h)) << "\n";
+            }
+            return out.str();
+        }
+
+        snapshot read() {
+            snapshot s;
+            memset(&s, 0, sizeof(s));
+            registry &r = registry::get();
+            std::lock_guard<std::mutex> l(r.lock);
+            add_to(s, r.retired);
+            for (const thread_metrics *m : r.threads)
+                add_to(s, *m);
+            return s;
+        }
+
+        void reset() {
+            registry &r = registry::get();
+            std::lock_guard<std::mutex> l(r.lock);
+            zero(r.retired);
+            for (thread_metrics *m : r.threads)
+                zero(*m);
+        }
+
+    }
+}
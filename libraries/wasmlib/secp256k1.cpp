@@ -0,0 +1,666 @@
+#include "secp256k1.hpp"
+#include "Platform/Platform.h"
+
+#include <algorithm>
+#include <cstring>
+#include <mutex>
+#include <vector>
+
+namespace ftl {
+    namespace secp256k1 {
+        namespace {
+            typedef unsigned __int128 uint128_t;
+
+            //a 256-bit unsigned integer as four 64-bit limbs, least significant first
+            struct u256 {
+                uint64_t v[4];
+            };
+
+            const u256 zero = {{0, 0, 0, 0}};
+            const u256 one = {{1, 0, 0, 0}};
+
+            //the field prime p, and 2^256 - p
+            const u256 field_prime = {{0xFFFFFFFEFFFFFC2FULL, 0xFFFFFFFFFFFFFFFFULL, 0xFFFFFFFFFFFFFFFFULL,
+                                       0xFFFFFFFFFFFFFFFFULL}};
+            const uint64_t field_complement = 0x1000003D1ULL;
+
+            //the group order n, and 2^256 - n
+            const u256 group_order = {{0xBFD25E8CD0364141ULL, 0xBAAEDCE6AF48A03BULL, 0xFFFFFFFFFFFFFFFEULL,
+                                       0xFFFFFFFFFFFFFFFFULL}};
+            const u256 order_complement = {{0x402DA1732FC9BEBFULL, 0x4551231950B75FC4ULL, 0x1ULL, 0}};
+
+            inline bool is_zero(const u256 &a) {
+                return !(a.v[0] | a.v[1] | a.v[2] | a.v[3]);
+            }
+
+            inline bool equal(const u256 &a, const u256 &b) {
+                return a.v[0] == b.v[0] && a.v[1] == b.v[1] && a.v[2] == b.v[2] && a.v[3] == b.v[3];
+            }
+
+            inline bool less(const u256 &a, const u256 &b) {
+                for (int i = 3; i >= 0; i--) {
+                    if (a.v[i] != b.v[i])
+                        return a.v[i] < b.v[i];
+                }
+                return false;
+            }
+
+            //r = a + b mod 2^256; returns the carry
+            inline uint64_t add(u256 &r, const u256 &a, const u256 &b) {
+                uint128_t carry = 0;
+                for (int i = 0; i < 4; i++) {
+                    carry += (uint128_t) a.v[i] + b.v[i];
+                    r.v[i] = (uint64_t) carry;
+                    carry >>= 64;
+                }
+                return (uint64_t) carry;
+            }
+
+            //r = a - b mod 2^256; returns the borrow
+            inline uint64_t sub(u256 &r, const u256 &a, const u256 &b) {
+                uint64_t borrow = 0;
+                for (int i = 0; i < 4; i++) {
+                    const uint128_t difference = (uint128_t) a.v[i] - b.v[i] - borrow;
+                    r.v[i] = (uint64_t) difference;
+                    borrow = (uint64_t) (difference >> 64) ? 1 : 0;
+                }
+                return borrow;
+            }
+
+            inline void shift_right_one(u256 &a, uint64_t top_bit) {
+                for (int i = 0; i < 3; i++)
+                    a.v[i] = (a.v[i] >> 1) | (a.v[i + 1] << 63);
+                a.v[3] = (a.v[3] >> 1) | (top_bit << 63);
+            }
+
+            inline void add_mod(u256 &r, const u256 &a, const u256 &b, const u256 &m) {
+                if (add(r, a, b) || !less(r, m))
+                    sub(r, r, m);
+            }
+
+            inline void sub_mod(u256 &r, const u256 &a, const u256 &b, const u256 &m) {
+                if (sub(r, a, b))
+                    add(r, r, m);
+            }
+
+            //the 512-bit product of a and b
+            inline void mul_wide(uint64_t (&t)[8], const u256 &a, const u256 &b) {
+                //column by column, keeping a 192-bit accumulator
+                uint128_t low = 0;
+                uint64_t high = 0;
+                for (int k = 0; k < 7; k++) {
+                    for (int i = k < 4 ? 0 : k - 3; i <= k && i < 4; i++) {
+                        const uint128_t product = (uint128_t) a.v[i] * b.v[k - i];
+                        low += product;
+                        high += low < product;
+                    }
+                    t[k] = (uint64_t) low;
+                    low = (low >> 64) | ((uint128_t) high << 64);
+                    high = 0;
+                }
+                t[7] = (uint64_t) low;
+            }
+
+            //a^-1 mod m for an odd m, using the binary extended Euclidean algorithm. this isn't constant time, which is
+            //fine since recovery only operates on public data
+            u256 inverse(const u256 &a, const u256 &m) {
+                if (is_zero(a))
+                    return zero;
+
+                u256 u = a, v = m, x1 = one, x2 = zero;
+                while (!equal(u, one) && !equal(v, one)) {
+                    while (!(u.v[0] & 1)) {
+                        shift_right_one(u, 0);
+                        shift_right_one(x1, (x1.v[0] & 1) ? add(x1, x1, m) : 0);
+                    }
+                    while (!(v.v[0] & 1)) {
+                        shift_right_one(v, 0);
+                        shift_right_one(x2, (x2.v[0] & 1) ? add(x2, x2, m) : 0);
+                    }
+                    if (!less(u, v)) {
+                        sub(u, u, v);
+                        sub_mod(x1, x1, x2, m);
+                    } else {
+                        sub(v, v, u);
+                        sub_mod(x2, x2, x1, m);
+                    }
+                }
+                return equal(u, one) ? x1 : x2;
+            }
+
+            //
+            // field elements: integers mod p
+            //
+
+            void field_mul(u256 &r, const u256 &a, const u256 &b) {
+                uint64_t t[8];
+                mul_wide(t, a, b);
+
+                //2^256 = 2^32 + 977 mod p, so fold the high half back in multiplied by that
+                uint64_t w[4];
+                uint128_t carry = 0;
+                for (int i = 0; i < 4; i++) {
+                    carry += (uint128_t) t[i + 4] * field_complement + t[i];
+                    w[i] = (uint64_t) carry;
+                    carry >>= 64;
+                }
+
+                //then fold the remaining few bits the same way; if that carries out again, the rest is tiny, so adding
+                //the complement once more can't carry
+                carry = (uint128_t) (uint64_t) carry * field_complement;
+                for (int i = 0; i < 4; i++) {
+                    carry += w[i];
+                    w[i] = (uint64_t) carry;
+                    carry >>= 64;
+                }
+                if (carry) {
+                    carry = field_complement;
+                    for (int i = 0; i < 4; i++) {
+                        carry += w[i];
+                        w[i] = (uint64_t) carry;
+                        carry >>= 64;
+                    }
+                }
+
+                memcpy(r.v, w, sizeof(w));
+                if (!less(r, field_prime))
+                    sub(r, r, field_prime);
+            }
+
+            inline void field_sqr(u256 &r, const u256 &a) {
+                field_mul(r, a, a);
+            }
+
+            inline void field_sqr_n(u256 &r, const u256 &a, int n) {
+                r = a;
+                for (int i = 0; i < n; i++)
+                    field_sqr(r, r);
+            }
+
+            inline void field_add(u256 &r, const u256 &a, const u256 &b) {
+                add_mod(r, a, b, field_prime);
+            }
+
+            inline void field_sub(u256 &r, const u256 &a, const u256 &b) {
+                sub_mod(r, a, b, field_prime);
+            }
+
+            //computes a square root of a as a^((p+1)/4), which works because p = 3 mod 4; returns false if a isn't a
+            //square. the exponent is built from runs of ones: x<n> = a^(2^n - 1)
+            bool field_sqrt(u256 &r, const u256 &a) {
+                u256 x2, x3, x6, x9, x11, x22, x44, x88, x176, x220, x223, t;
+                field_sqr(x2, a);
+                field_mul(x2, x2, a);
+                field_sqr(x3, x2);
+                field_mul(x3, x3, a);
+                field_sqr_n(x6, x3, 3);
+                field_mul(x6, x6, x3);
+                field_sqr_n(x9, x6, 3);
+                field_mul(x9, x9, x3);
+                field_sqr_n(x11, x9, 2);
+                field_mul(x11, x11, x2);
+                field_sqr_n(x22, x11, 11);
+                field_mul(x22, x22, x11);
+                field_sqr_n(x44, x22, 22);
+                field_mul(x44, x44, x22);
+                field_sqr_n(x88, x44, 44);
+                field_mul(x88, x88, x44);
+                field_sqr_n(x176, x88, 88);
+                field_mul(x176, x176, x88);
+                field_sqr_n(x220, x176, 44);
+                field_mul(x220, x220, x44);
+                field_sqr_n(x223, x220, 3);
+                field_mul(x223, x223, x3);
+
+                field_sqr_n(t, x223, 23);
+                field_mul(t, t, x22);
+                field_sqr_n(t, t, 6);
+                field_mul(t, t, x2);
+                field_sqr_n(t, t, 2);
+
+                field_sqr(x2, t);
+                if (!equal(x2, a))
+                    return false;
+                r = t;
+                return true;
+            }
+
+            //
+            // scalars: integers mod n
+            //
+
+            void scalar_mul(u256 &r, const u256 &a, const u256 &b) {
+                uint64_t w[9];
+                mul_wide(reinterpret_cast<uint64_t (&)[8]>(w), a, b);
+                w[8] = 0;
+
+                //2^256 = 2^256 - n mod n, so fold the bits above 2^256 back in multiplied by that until none are left
+                while (w[4] | w[5] | w[6] | w[7] | w[8]) {
+                    uint64_t high[5] = {w[4], w[5], w[6], w[7], w[8]};
+                    w[4] = w[5] = w[6] = w[7] = w[8] = 0;
+                    for (int i = 0; i < 5; i++) {
+                        if (!high[i])
+                            continue;
+                        uint128_t carry = 0;
+                        for (int j = 0; j < 4; j++) {
+                            carry += (uint128_t) high[i] * order_complement.v[j] + w[i + j];
+                            w[i + j] = (uint64_t) carry;
+                            carry >>= 64;
+                        }
+                        for (int k = i + 4; carry && k < 9; k++) {
+                            carry += w[k];
+                            w[k] = (uint64_t) carry;
+                            carry >>= 64;
+                        }
+                    }
+                }
+
+                memcpy(r.v, w, sizeof(r.v));
+                if (!less(r, group_order))
+                    sub(r, r, group_order);
+            }
+
+            inline uint32_t scalar_nibble(const u256 &a, int index) {
+                return (a.v[index / 16] >> ((index % 16) * 4)) & 15;
+            }
+
+            //
+            // points
+            //
+
+            struct affine_point {
+                u256 x, y;
+                bool infinity;
+            };
+
+            struct jacobian_point {
+                u256 x, y, z;
+                bool infinity;
+            };
+
+            const affine_point generator = {
+                    {{0x59F2815B16F81798ULL, 0x029BFCDB2DCE28D9ULL, 0x55A06295CE870B07ULL, 0x79BE667EF9DCBBACULL}},
+                    {{0x9C47D08FFB10D4B8ULL, 0xFD17B448A6855419ULL, 0x5DA4FBFC0E1108A8ULL, 0x483ADA7726A3C465ULL}},
+                    false};
+
+            inline jacobian_point to_jacobian(const affine_point &a) {
+                return {a.x, a.y, one, a.infinity};
+            }
+
+            void point_double(jacobian_point &r, const jacobian_point &a) {
+                if (a.infinity) {
+                    r = a;
+                    return;
+                }
+
+                //dbl-2009-l; secp256k1 has no points of order 2, so y is never zero
+                u256 xx, yy, yyyy, d, e, f, t;
+                field_sqr(xx, a.x);
+                field_sqr(yy, a.y);
+                field_sqr(yyyy, yy);
+                field_add(t, a.x, yy);
+                field_sqr(d, t);
+                field_sub(d, d, xx);
+                field_sub(d, d, yyyy);
+                field_add(d, d, d);
+                field_add(e, xx, xx);
+                field_add(e, e, xx);
+                field_sqr(f, e);
+
+                jacobian_point result;
+                result.infinity = false;
+                field_mul(result.z, a.y, a.z);
+                field_add(result.z, result.z, result.z);
+                field_sub(result.x, f, d);
+                field_sub(result.x, result.x, d);
+                field_sub(t, d, result.x);
+                field_mul(result.y, e, t);
+                field_add(yyyy, yyyy, yyyy);
+                field_add(yyyy, yyyy, yyyy);
+                field_add(yyyy, yyyy, yyyy);
+                field_sub(result.y, result.y, yyyy);
+                r = result;
+            }
+
+            void point_add(jacobian_point &r, const jacobian_point &a, const jacobian_point &b) {
+                if (a.infinity) {
+                    r = b;
+                    return;
+                }
+                if (b.infinity) {
+                    r = a;
+                    return;
+                }
+
+                //add-2007-bl
+                u256 z1z1, z2z2, u1, u2, s1, s2, h, i, j, rr, v, t;
+                field_sqr(z1z1, a.z);
+                field_sqr(z2z2, b.z);
+                field_mul(u1, a.x, z2z2);
+                field_mul(u2, b.x, z1z1);
+                field_mul(s1, a.y, b.z);
+                field_mul(s1, s1, z2z2);
+                field_mul(s2, b.y, a.z);
+                field_mul(s2, s2, z1z1);
+                field_sub(h, u2, u1);
+                field_sub(rr, s2, s1);
+                if (is_zero(h)) {
+                    if (is_zero(rr)) {
+                        point_double(r, a);
+                    } else {
+                        r.infinity = true;
+                    }
+                    return;
+                }
+                field_add(i, h, h);
+                field_sqr(i, i);
+                field_mul(j, h, i);
+                field_add(rr, rr, rr);
+                field_mul(v, u1, i);
+
+                jacobian_point result;
+                result.infinity = false;
+                field_add(t, a.z, b.z);
+                field_sqr(t, t);
+                field_sub(t, t, z1z1);
+                field_sub(t, t, z2z2);
+                field_mul(result.z, t, h);
+                field_sqr(result.x, rr);
+                field_sub(result.x, result.x, j);
+                field_sub(result.x, result.x, v);
+                field_sub(result.x, result.x, v);
+                field_sub(t, v, result.x);
+                field_mul(result.y, rr, t);
+                field_mul(t, s1, j);
+                field_add(t, t, t);
+                field_sub(result.y, result.y, t);
+                r = result;
+            }
+
+            void point_add_affine(jacobian_point &r, const jacobian_point &a, const affine_point &b) {
+                if (b.infinity) {
+                    r = a;
+                    return;
+                }
+                if (a.infinity) {
+                    r = to_jacobian(b);
+                    return;
+                }
+
+                //madd-2007-bl
+                u256 z1z1, u2, s2, h, hh, i, j, rr, v, t;
+                field_sqr(z1z1, a.z);
+                field_mul(u2, b.x, z1z1);
+                field_mul(s2, b.y, a.z);
+                field_mul(s2, s2, z1z1);
+                field_sub(h, u2, a.x);
+                field_sub(rr, s2, a.y);
+                if (is_zero(h)) {
+                    if (is_zero(rr)) {
+                        point_double(r, a);
+                    } else {
+                        r.infinity = true;
+                    }
+                    return;
+                }
+                field_sqr(hh, h);
+                field_add(i, hh, hh);
+                field_add(i, i, i);
+                field_mul(j, h, i);
+                field_add(rr, rr, rr);
+                field_mul(v, a.x, i);
+
+                jacobian_point result;
+                result.infinity = false;
+                field_add(t, a.z, h);
+                field_sqr(t, t);
+                field_sub(t, t, z1z1);
+                field_sub(result.z, t, hh);
+                field_sqr(result.x, rr);
+                field_sub(result.x, result.x, j);
+                field_sub(result.x, result.x, v);
+                field_sub(result.x, result.x, v);
+                field_sub(t, v, result.x);
+                field_mul(result.y, rr, t);
+                field_mul(t, a.y, j);
+                field_add(t, t, t);
+                field_sub(result.y, result.y, t);
+                r = result;
+            }
+
+            //converts points to affine coordinates with a single field inversion (Montgomery's trick)
+            void normalize(const jacobian_point *points, affine_point *affine_points, size_t count) {
+                std::vector<u256> prefix_products(count);
+                u256 product = one;
+                for (size_t i = 0; i < count; i++) {
+                    prefix_products[i] = product;
+                    if (!points[i].infinity)
+                        field_mul(product, product, points[i].z);
+                }
+
+                u256 product_inverse = inverse(product, field_prime);
+                for (size_t i = count; i-- > 0;) {
+                    affine_point &affine = affine_points[i];
+                    affine.infinity = points[i].infinity;
+                    if (affine.infinity)
+                        continue;
+
+                    u256 z_inverse, z_inverse2, z_inverse3;
+                    field_mul(z_inverse, product_inverse, prefix_products[i]);
+                    field_mul(product_inverse, product_inverse, points[i].z);
+                    field_sqr(z_inverse2, z_inverse);
+                    field_mul(z_inverse3, z_inverse2, z_inverse);
+                    field_mul(affine.x, points[i].x, z_inverse2);
+                    field_mul(affine.y, points[i].y, z_inverse3);
+                }
+            }
+
+            //inverts scalars with a single scalar inversion (Montgomery's trick); none of them may be zero
+            void invert_scalars(u256 *scalars, size_t count) {
+                std::vector<u256> prefix_products(count);
+                u256 product = one;
+                for (size_t i = 0; i < count; i++) {
+                    prefix_products[i] = product;
+                    scalar_mul(product, product, scalars[i]);
+                }
+
+                u256 product_inverse = inverse(product, group_order);
+                for (size_t i = count; i-- > 0;) {
+                    u256 scalar_inverse;
+                    scalar_mul(scalar_inverse, product_inverse, prefix_products[i]);
+                    scalar_mul(product_inverse, product_inverse, scalars[i]);
+                    scalars[i] = scalar_inverse;
+                }
+            }
+
+            //generator_table[i][j - 1] = j * 16^i * G, so a multiple of G takes at most one mixed addition for each
+            //nibble of the scalar and no doublings
+            typedef affine_point generator_table_t[64][15];
+
+            const generator_table_t &get_generator_table() {
+                static generator_table_t generator_table;
+                static std::once_flag generator_table_once;
+                std::call_once(generator_table_once, [] {
+                    std::vector<jacobian_point> points(64 * 15);
+                    jacobian_point base = to_jacobian(generator);
+                    for (size_t i = 0; i < 64; i++) {
+                        points[i * 15] = base;
+                        for (size_t j = 1; j < 15; j++)
+                            point_add(points[i * 15 + j], points[i * 15 + j - 1], base);
+                        for (int k = 0; k < 4; k++)
+                            point_double(base, base);
+                    }
+                    normalize(points.data(), &generator_table[0][0], points.size());
+                });
+                return generator_table;
+            }
+
+            inline void from_bytes(u256 &r, const uint8_t *bytes) {
+                for (int i = 0; i < 4; i++) {
+                    uint64_t limb = 0;
+                    for (int j = 0; j < 8; j++)
+                        limb = (limb << 8) | bytes[i * 8 + j];
+                    r.v[3 - i] = limb;
+                }
+            }
+
+            inline void to_bytes(uint8_t *bytes, const u256 &a) {
+                for (int i = 0; i < 4; i++) {
+                    for (int j = 0; j < 8; j++)
+                        bytes[i * 8 + j] = uint8_t(a.v[3 - i] >> (56 - j * 8));
+                }
+            }
+
+            //the state of a recovery between the batched inversions
+            struct recovery_state {
+                affine_point r_point;
+                u256 e, r, s;
+                jacobian_point q;
+            };
+
+            //parses the signature and finds the point R it commits to; returns false if the signature is malformed
+            bool parse_signature(recovery_state &state, const uint8_t *digest, const uint8_t *signature) {
+                uint8_t recovery_id = signature[64];
+                if (recovery_id >= 27)
+                    recovery_id -= 27;
+                if (recovery_id > 3)
+                    return false;
+
+                from_bytes(state.r, signature);
+                from_bytes(state.s, signature + 32);
+                if (is_zero(state.r) || !less(state.r, group_order) || is_zero(state.s) || !less(state.s, group_order))
+                    return false;
+
+                //R's x coordinate is r, or r + n if the recovery id says it overflowed the group order
+                u256 x = state.r;
+                if (recovery_id & 2) {
+                    if (add(x, x, group_order) || !less(x, field_prime))
+                        return false;
+                }
+
+                //y^2 = x^3 + 7, choosing the root with the parity given by the recovery id
+                u256 y2, y;
+                field_sqr(y2, x);
+                field_mul(y2, y2, x);
+                field_add(y2, y2, u256{{7, 0, 0, 0}});
+                if (!field_sqrt(y, y2))
+                    return false;
+                if ((y.v[0] & 1) != (recovery_id & 1))
+                    field_sub(y, zero, y);
+                state.r_point = {x, y, false};
+
+                from_bytes(state.e, digest);
+                if (!less(state.e, group_order))
+                    sub(state.e, state.e, group_order);
+                return true;
+            }
+
+            //computes Q = r^-1 (s R - e G) given r^-1
+            void compute_public_key(recovery_state &state, const u256 &r_inverse) {
+                u256 u1, u2;
+                scalar_mul(u1, state.e, r_inverse);
+                sub_mod(u1, zero, u1, group_order);
+                scalar_mul(u2, state.s, r_inverse);
+
+                //u2 R with a 4-bit fixed window
+                jacobian_point r_multiples[16];
+                r_multiples[1] = to_jacobian(state.r_point);
+                for (int i = 2; i < 16; i++)
+                    point_add_affine(r_multiples[i], r_multiples[i - 1], state.r_point);
+
+                jacobian_point q;
+                q.infinity = true;
+                for (int i = 63; i >= 0; i--) {
+                    for (int k = 0; k < 4; k++)
+                        point_double(q, q);
+                    const uint32_t nibble = scalar_nibble(u2, i);
+                    if (nibble)
+                        point_add(q, q, r_multiples[nibble]);
+                }
+
+                //u1 G from the precomputed table
+                const generator_table_t &generator_table = get_generator_table();
+                for (int i = 0; i < 64; i++) {
+                    const uint32_t nibble = scalar_nibble(u1, i);
+                    if (nibble)
+                        point_add_affine(q, q, generator_table[i][nibble - 1]);
+                }
+                state.q = q;
+            }
+
+            void recover_chunk(recovery *recoveries, size_t count) {
+                std::vector<recovery_state> states(count);
+                std::vector<size_t> parsed_indices;
+                for (size_t i = 0; i < count; i++) {
+                    recoveries[i].valid = parse_signature(states[i], recoveries[i].digest, recoveries[i].signature);
+                    if (recoveries[i].valid)
+                        parsed_indices.push_back(i);
+                }
+
+                std::vector<u256> r_inverses(parsed_indices.size());
+                for (size_t i = 0; i < parsed_indices.size(); i++)
+                    r_inverses[i] = states[parsed_indices[i]].r;
+                invert_scalars(r_inverses.data(), r_inverses.size());
+
+                std::vector<jacobian_point> public_keys(parsed_indices.size());
+                for (size_t i = 0; i < parsed_indices.size(); i++) {
+                    compute_public_key(states[parsed_indices[i]], r_inverses[i]);
+                    public_keys[i] = states[parsed_indices[i]].q;
+                }
+
+                std::vector<affine_point> affine_public_keys(public_keys.size());
+                normalize(public_keys.data(), affine_public_keys.data(), public_keys.size());
+                for (size_t i = 0; i < parsed_indices.size(); i++) {
+                    recovery &recovery = recoveries[parsed_indices[i]];
+                    if (affine_public_keys[i].infinity) {
+                        recovery.valid = false;
+                        continue;
+                    }
+                    recovery.public_key[0] = 0x04;
+                    to_bytes(recovery.public_key + 1, affine_public_keys[i].x);
+                    to_bytes(recovery.public_key + 33, affine_public_keys[i].y);
+                }
+            }
+        }
+
+        bool recover(const uint8_t *digest, const uint8_t *signature, uint8_t *public_key) {
+            recovery single = {digest, signature, public_key, false};
+            recover_chunk(&single, 1);
+            return single.valid;
+        }
+
+        void recover_batch(recovery *recoveries, size_t count) {
+            //the public keys may overlap the digests and signatures of other recoveries (a contract passes both in its
+            //own memory), so the chunks work on copies and the keys are only written back once every chunk is done
+            const size_t input_size = 32 + signature_size;
+            std::vector<uint8_t> inputs(count * input_size);
+            std::vector<uint8_t> public_keys(count * public_key_size, 0);
+            std::vector<recovery> copies(count);
+            for (size_t i = 0; i < count; i++) {
+                uint8_t *input = &inputs[i * input_size];
+                memcpy(input, recoveries[i].digest, 32);
+                memcpy(input + 32, recoveries[i].signature, signature_size);
+                copies[i] = {input, input + 32, &public_keys[i * public_key_size], false};
+            }
+
+            //big enough chunks that the shared inversions are amortized, small enough to spread a batch over the pool
+            const size_t chunk_size = 16;
+            const size_t num_chunks = (count + chunk_size - 1) / chunk_size;
+            Platform::parallelFor(num_chunks, [&](Uptr chunk_index) {
+                const size_t begin = chunk_index * chunk_size;
+                recover_chunk(copies.data() + begin, std::min(chunk_size, count - begin));
+            });
+
+            //invalid recoveries leave their copy zeroed
+            for (size_t i = 0; i < count; i++) {
+                recoveries[i].valid = copies[i].valid;
+                memcpy(recoveries[i].public_key, &public_keys[i * public_key_size], public_key_size);
+            }
+        }
+
+        void compress(const uint8_t *public_key, uint8_t *compressed_public_key) {
+            compressed_public_key[0] = uint8_t(0x02 | (public_key[64] & 1));
+            memmove(compressed_public_key + 1, public_key + 1, 32);
+        }
+    }
+}
@@ -0,0 +1,62 @@
+#include "secp256k1.hpp"
+
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <vector>
+
+using namespace ftl;
+
+int main(int argc, char **argv) {
+    const size_t num_signatures = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 1024;
+
+    //recovery costs the same whether or not anyone knows the private key, so random signatures whose r is a valid x
+    //coordinate are as good as real ones
+    std::mt19937_64 random(1);
+    std::vector<uint8_t> digests, signatures;
+    while (digests.size() < num_signatures * 32) {
+        uint8_t digest[32], signature[secp256k1::signature_size], public_key[secp256k1::public_key_size];
+        for (uint8_t &byte : digest)
+            byte = uint8_t(random());
+        for (uint8_t &byte : signature)
+            byte = uint8_t(random());
+        signature[0] &= 0x7f;
+        signature[32] &= 0x7f;
+        signature[64] = uint8_t(27 + (random() & 1));
+        if (!secp256k1::recover(digest, signature, public_key))
+            continue;
+        digests.insert(digests.end(), digest, digest + 32);
+        signatures.insert(signatures.end(), signature, signature + secp256k1::signature_size);
+    }
+    std::vector<uint8_t> public_keys(num_signatures * secp256k1::public_key_size);
+
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < num_signatures; i++) {
+        secp256k1::recover(&digests[i * 32], &signatures[i * secp256k1::signature_size],
+                           &public_keys[i * secp256k1::public_key_size]);
+    }
+    const double single_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    std::vector<secp256k1::recovery> recoveries(num_signatures);
+    for (size_t i = 0; i < num_signatures; i++) {
+        recoveries[i] = {&digests[i * 32], &signatures[i * secp256k1::signature_size],
+                         &public_keys[i * secp256k1::public_key_size], false};
+    }
+    start = std::chrono::steady_clock::now();
+    secp256k1::recover_batch(recoveries.data(), recoveries.size());
+    const double batch_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    for (const secp256k1::recovery &recovery : recoveries) {
+        if (!recovery.valid) {
+            std::cerr << "batch recovery rejected a signature that recovered on its own" << std::endl;
+            return EXIT_FAILURE;
+        }
+    }
+
+    std::cout << std::fixed << std::setprecision(2)
+              << "recover: " << num_signatures / single_seconds << " signatures/s" << std::endl
+              << "recover_batch: " << num_signatures / batch_seconds << " signatures/s" << std::endl;
+    return EXIT_SUCCESS;
+}
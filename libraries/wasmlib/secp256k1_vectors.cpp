@@ -0,0 +1,194 @@
+#include "secp256k1.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+using namespace ftl;
+
+namespace {
+
+    //known answers for secp256k1::recover, in hex. the valid signatures were made with the private keys
+    //0x4c0883a69102937d6231471b5dbb6204fe5129617082792ae468d01a3f362318 and 1; a null public key means the signature
+    //must be rejected
+    struct vector {
+        const char *name;
+        const char *digest;
+        const char *signature;
+        const char *public_key;
+    };
+
+    const vector vectors[] = {
+            {"valid, recovery id 0-3",
+             "60f4bf5ace62198c520bfa05b494b46d9afa334af09a31d086c5dd1a511929ad",
+             "f973a0b87062c389d125d8199e803b832b6ac6bf7867a4f6cd87506060fc4c58"
+             "590482114d0fe7c5e14624e3aae6e41274dcfaddedef6673ba3834e293a3e7ba01",
+             "044e3b81af9c2234cad09d679ce6035ed1392347ce64ce405f5dcd36228a25de6e"
+             "47fd35c4215d1edf53e6f83de344615ce719bdb0fd878f6ed76f06dd277956de"},
+            {"valid, recovery id 27-30",
+             "60f4bf5ace62198c520bfa05b494b46d9afa334af09a31d086c5dd1a511929ad",
+             "f973a0b87062c389d125d8199e803b832b6ac6bf7867a4f6cd87506060fc4c58"
+             "590482114d0fe7c5e14624e3aae6e41274dcfaddedef6673ba3834e293a3e7ba1c",
+             "044e3b81af9c2234cad09d679ce6035ed1392347ce64ce405f5dcd36228a25de6e"
+             "47fd35c4215d1edf53e6f83de344615ce719bdb0fd878f6ed76f06dd277956de"},
+            {"high s, the same key as its low s twin",
+             "60f4bf5ace62198c520bfa05b494b46d9afa334af09a31d086c5dd1a511929ad",
+             "f973a0b87062c389d125d8199e803b832b6ac6bf7867a4f6cd87506060fc4c58"
+             "a6fb7deeb2f0183a1eb9db1c55191bec45d1e208c15939c8059a29aa3c9259871b",
+             "044e3b81af9c2234cad09d679ce6035ed1392347ce64ce405f5dcd36228a25de6e"
+             "47fd35c4215d1edf53e6f83de344615ce719bdb0fd878f6ed76f06dd277956de"},
+            {"private key 1 recovers the generator",
+             "9123dcbb0b42652b0e105956c68d3ca2ff34584f324fa41a29aedd32b883e131",
+             "76d2fdf1302d1fa9556f4df94ec84cefba6d482e54f47c6c2a238c1baa560f0e"
+             "20bfec9176aa7c103b122342d34c819d2d4f872bdc96779f9c29865f59ee4c7c1b",
+             "0479be667ef9dcbbac55a06295ce870b07029bfcdb2dce28d959f2815b16f81798"
+             "483ada7726a3c4655da4fbfc0e1108a8fd17b448a68554199c47d08ffb10d4b8"},
+            {"zero digest",
+             "0000000000000000000000000000000000000000000000000000000000000000",
+             "f7eb5a7530926f4bf8c110759859ca2eedc783c083a4d6bb6cec9a134098c604"
+             "d64e63af203ce348628814c51c8c59761bea2d3e9215de9a3042ccf380dca5231b",
+             "044e3b81af9c2234cad09d679ce6035ed1392347ce64ce405f5dcd36228a25de6e"
+             "47fd35c4215d1edf53e6f83de344615ce719bdb0fd878f6ed76f06dd277956de"},
+            {"digest above n is reduced mod n",
+             "ffffffffffffffffffffffffffffffffffffffffffffffffffffffffffffffff",
+             "2a5bbcb0eede528e6abe5f2ec50ad7887eb5677af383a460b05ee23bf892dfe5"
+             "f4341cddba0af864b596417a817598e5d1d06207fda3859ca364be6adf5dc6651c",
+             "044e3b81af9c2234cad09d679ce6035ed1392347ce64ce405f5dcd36228a25de6e"
+             "47fd35c4215d1edf53e6f83de344615ce719bdb0fd878f6ed76f06dd277956de"},
+            {"digest equal to n is reduced to zero",
+             "fffffffffffffffffffffffffffffffebaaedce6af48a03bbfd25e8cd0364141",
+             "12faae608bd6562562b8f85564664cd1fdcd667f6b24b2b221ef86b9231f4d74"
+             "7f2b3055b436ceeb390c6c8b5a82056fc8e5954d35b439fda6d50162012fb5c01c",
+             "044e3b81af9c2234cad09d679ce6035ed1392347ce64ce405f5dcd36228a25de6e"
+             "47fd35c4215d1edf53e6f83de344615ce719bdb0fd878f6ed76f06dd277956de"},
+            {"r zero",
+             "60f4bf5ace62198c520bfa05b494b46d9afa334af09a31d086c5dd1a511929ad",
+             "0000000000000000000000000000000000000000000000000000000000000000"
+             "590482114d0fe7c5e14624e3aae6e41274dcfaddedef6673ba3834e293a3e7ba1c",
+             nullptr},
+            {"r equal to n",
+             "60f4bf5ace62198c520bfa05b494b46d9afa334af09a31d086c5dd1a511929ad",
+             "fffffffffffffffffffffffffffffffebaaedce6af48a03bbfd25e8cd0364141"
+             "590482114d0fe7c5e14624e3aae6e41274dcfaddedef6673ba3834e293a3e7ba1c",
+             nullptr},
+            {"r above n",
+             "60f4bf5ace62198c520bfa05b494b46d9afa334af09a31d086c5dd1a511929ad",
+             "fffffffffffffffffffffffffffffffebaaedce6af48a03bbfd25e8cd0364142"
+             "590482114d0fe7c5e14624e3aae6e41274dcfaddedef6673ba3834e293a3e7ba1c",
+             nullptr},
+            {"s zero",
+             "60f4bf5ace62198c520bfa05b494b46d9afa334af09a31d086c5dd1a511929ad",
+             "f973a0b87062c389d125d8199e803b832b6ac6bf7867a4f6cd87506060fc4c58"
+             "00000000000000000000000000000000000000000000000000000000000000001c",
+             nullptr},
+            {"s equal to n",
+             "60f4bf5ace62198c520bfa05b494b46d9afa334af09a31d086c5dd1a511929ad",
+             "f973a0b87062c389d125d8199e803b832b6ac6bf7867a4f6cd87506060fc4c58"
+             "fffffffffffffffffffffffffffffffebaaedce6af48a03bbfd25e8cd03641411c",
+             nullptr},
+            {"s above n",
+             "60f4bf5ace62198c520bfa05b494b46d9afa334af09a31d086c5dd1a511929ad",
+             "f973a0b87062c389d125d8199e803b832b6ac6bf7867a4f6cd87506060fc4c58"
+             "ffffffffffffffffffffffffffffffffffffffffffffffffffffffffffffffff1c",
+             nullptr},
+            {"recovery id 4",
+             "60f4bf5ace62198c520bfa05b494b46d9afa334af09a31d086c5dd1a511929ad",
+             "f973a0b87062c389d125d8199e803b832b6ac6bf7867a4f6cd87506060fc4c58"
+             "590482114d0fe7c5e14624e3aae6e41274dcfaddedef6673ba3834e293a3e7ba04",
+             nullptr},
+            {"recovery id 26",
+             "60f4bf5ace62198c520bfa05b494b46d9afa334af09a31d086c5dd1a511929ad",
+             "f973a0b87062c389d125d8199e803b832b6ac6bf7867a4f6cd87506060fc4c58"
+             "590482114d0fe7c5e14624e3aae6e41274dcfaddedef6673ba3834e293a3e7ba1a",
+             nullptr},
+            {"recovery id 31",
+             "60f4bf5ace62198c520bfa05b494b46d9afa334af09a31d086c5dd1a511929ad",
+             "f973a0b87062c389d125d8199e803b832b6ac6bf7867a4f6cd87506060fc4c58"
+             "590482114d0fe7c5e14624e3aae6e41274dcfaddedef6673ba3834e293a3e7ba1f",
+             nullptr},
+            {"recovery id 2 with r + n past the field",
+             "60f4bf5ace62198c520bfa05b494b46d9afa334af09a31d086c5dd1a511929ad",
+             "f973a0b87062c389d125d8199e803b832b6ac6bf7867a4f6cd87506060fc4c58"
+             "590482114d0fe7c5e14624e3aae6e41274dcfaddedef6673ba3834e293a3e7ba1e",
+             nullptr},
+            {"r is not the x coordinate of a point",
+             "60f4bf5ace62198c520bfa05b494b46d9afa334af09a31d086c5dd1a511929ad",
+             "0000000000000000000000000000000000000000000000000000000000000005"
+             "590482114d0fe7c5e14624e3aae6e41274dcfaddedef6673ba3834e293a3e7ba1c",
+             nullptr},
+            {"the recovered point is at infinity",
+             "60f4bf5ace62198c520bfa05b494b46d9afa334af09a31d086c5dd1a511929ad",
+             "8e7df8c0de88903e71224c973a8ca65a0923f872841f2dccbcd69e64b1dce1eb"
+             "74bb2354fa9d96fcdbbd4b262e943d2db1de7fc51422ec7d8910ae5ba7f35dcc1b",
+             nullptr},
+    };
+
+    std::vector<uint8_t> from_hex(const char *hex) {
+        std::vector<uint8_t> bytes(strlen(hex) / 2);
+        for (size_t i = 0; i < bytes.size(); i++)
+            bytes[i] = uint8_t(std::stoul(std::string(hex + i * 2, 2), nullptr, 16));
+        return bytes;
+    }
+
+}
+
+int main() {
+    const size_t num_vectors = sizeof(vectors) / sizeof(vectors[0]);
+    const size_t pair_size = 32 + secp256k1::signature_size;
+    std::vector<std::vector<uint8_t>> digests, signatures, expected_public_keys;
+    std::vector<bool> failed(num_vectors, false);
+
+    for (size_t i = 0; i < num_vectors; i++) {
+        const vector &v = vectors[i];
+        digests.push_back(from_hex(v.digest));
+        signatures.push_back(from_hex(v.signature));
+        expected_public_keys.push_back(v.public_key ? from_hex(v.public_key)
+                                                    : std::vector<uint8_t>(secp256k1::public_key_size, 0));
+
+        //a rejected signature leaves the public key untouched
+        std::vector<uint8_t> public_key(secp256k1::public_key_size, 0);
+        const bool valid = secp256k1::recover(digests[i].data(), signatures[i].data(), public_key.data());
+        if (valid != (v.public_key != nullptr) || public_key != expected_public_keys[i]) {
+            std::cerr << "recover: " << v.name << ": " << (valid ? "recovered the wrong key" : "rejected")
+                      << std::endl;
+            failed[i] = true;
+        }
+    }
+
+    //the batch has to agree with the single recoveries and zero the keys it rejects. it is checked once writing to a
+    //separate buffer, and once with every vector twice and the keys written from the 16th (digest, signature) pair on,
+    //so that each chunk of 16 the batch is split into overwrites pairs that another chunk reads, as recover_keys allows
+    const size_t aliased_offset = 16 * pair_size;
+    for (bool aliased : {false, true}) {
+        const size_t batch_size = aliased ? 2 * num_vectors : num_vectors;
+        std::vector<uint8_t> pairs(aliased_offset + batch_size * pair_size);
+        std::vector<uint8_t> separate_public_keys(batch_size * secp256k1::public_key_size, 0xff);
+        uint8_t *public_keys = aliased ? pairs.data() + aliased_offset : separate_public_keys.data();
+        std::vector<secp256k1::recovery> recoveries;
+        for (size_t i = 0; i < batch_size; i++) {
+            uint8_t *pair = &pairs[i * pair_size];
+            memcpy(pair, digests[i % num_vectors].data(), 32);
+            memcpy(pair + 32, signatures[i % num_vectors].data(), secp256k1::signature_size);
+            recoveries.push_back({pair, pair + 32, public_keys + i * secp256k1::public_key_size, false});
+        }
+        secp256k1::recover_batch(recoveries.data(), recoveries.size());
+
+        for (size_t i = 0; i < batch_size; i++) {
+            const vector &v = vectors[i % num_vectors];
+            if (recoveries[i].valid != (v.public_key != nullptr) ||
+                memcmp(recoveries[i].public_key, expected_public_keys[i % num_vectors].data(),
+                       secp256k1::public_key_size) != 0) {
+                std::cerr << (aliased ? "recover_batch in place: " : "recover_batch: ") << v.name << ": "
+                          << (recoveries[i].valid ? "recovered the wrong key" : "rejected") << std::endl;
+                failed[i % num_vectors] = true;
+            }
+        }
+    }
+
+    const size_t num_failed = std::count(failed.begin(), failed.end(), true);
+    std::cout << num_vectors - num_failed << " of " << num_vectors << " vectors passed" << std::endl;
+    return num_failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,154 @@
+#include "state_overlay.hpp"
+#include "metrics.hpp"
+#include <algorithm>
+#include <string.h>
+
+namespace ftl {
+
+    //64 bit FNV-1a; fingerprints only have to tell a changed read from an unchanged one
+    static uint64_t fingerprint(uint64_t hash, const uint8_t *data, size_t size) {
+        for (size_t i = 0; i < size; i++) {
+            hash ^= data[i];
+            hash *= 0x100000001b3ull;
+        }
+        return hash;
+    }
+
+    void state_overlay::store(uint64_t table, const char *key, size_t key_size, const char *value,
+                              size_t value_size) {
+        _tables[table].values[std::string(key, key_size)] = {false, std::string(value, value_size)};
+    }
+
+    int state_overlay::load(Callbacks &callbacks, uint64_t state_key, uint64_t table, const char *key,
+                            size_t key_size, char *buffer, size_t buffer_size) {
+        auto table_it = _tables.find(table);
+        if (table_it != _tables.end()) {
+            auto it = table_it->second.values.find(std::string(key, key_size));
+            if (it != table_it->second.values.end()) {
+                if (it->second.removed)
+                    return 0;
+                memcpy(buffer, it->second.value.data(), std::min(buffer_size, it->second.value.size()));
+                return it->second.value.size();
+            }
+            if (table_it->second.removed)
+                return 0;
+        }
+        return record_read(callbacks, state_key, {load_read, table, std::string(key, key_size), buffer_size},
+                           buffer);
+    }
+
+    int state_overlay::has_key(Callbacks &callbacks, uint64_t state_key, uint64_t table, const char *key,
+                               size_t key_size) {
+        auto table_it = _tables.find(table);
+        if (table_it != _tables.end()) {
+            auto it = table_it->second.values.find(std::string(key, key_size));
+            if (it != table_it->second.values.end())
+                return !it->second.removed;
+            if (table_it->second.removed)
+                return 0;
+        }
+        return record_read(callbacks, state_key, {has_key_read, table, std::string(key, key_size), 0}, nullptr);
+    }
+
+    void state_overlay::remove_key(uint64_t table, const char *key, size_t key_size) {
+        _tables[table].values[std::string(key, key_size)] = {true, std::string()};
+    }
+
+    int state_overlay::has_table(Callbacks &callbacks, uint64_t state_key, uint64_t table) {
+        auto table_it = _tables.find(table);
+        if (table_it != _tables.end()) {
+            for (auto &value : table_it->second.values) {
+                if (!value.second.removed)
+                    return 1;
+            }
+            if (table_it->second.removed)
+                return 0;
+        }
+        return record_read(callbacks, state_key, {has_table_read, table, std::string(), 0}, nullptr);
+    }
+
+    void state_overlay::remove_table(uint64_t table) {
+        table_changes &changes = _tables[table];
+        changes.removed = true;
+        changes.values.clear();
+    }
+
+    uint64_t state_overlay::read_host(Callbacks &callbacks, uint64_t state_key, const read &r, int &ret,
+                                      bytes &buffer) {
+        //the buffer starts zeroed so bytes the host doesn't write can't make a fingerprint differ
+        buffer.assign(r.buffer_size, 0);
+        switch (r.kind) {
+            case load_read: {
+                metrics::timer timer(metrics::host_load);
+                ret = callbacks.cb_load(state_key, r.table, (char *) r.key.data(), r.key.size(),
+                                        (char *) buffer.data(), buffer.size());
+                break;
+            }
+            case has_key_read: {
+                metrics::timer timer(metrics::host_has_key);
+                ret = callbacks.cb_has_key(state_key, r.table, (char *) r.key.data(), r.key.size());
+                break;
+            }
+            case has_table_read: {
+                metrics::timer timer(metrics::host_has_table);
+                ret = callbacks.cb_has_table(state_key, r.table);
+                break;
+            }
+        }
+
+        uint64_t hash = fingerprint(0xcbf29ce484222325ull, (const uint8_t *) &ret, sizeof(ret));
+        return fingerprint(hash, buffer.data(), buffer.size());
+    }
+
+    int state_overlay::record_read(Callbacks &callbacks, uint64_t state_key, read &&r, char *buffer) {
+        int ret;
+        bytes read_buffer;
+        uint64_t hash = read_host(callbacks, state_key, r, ret, read_buffer);
+        if (buffer)
+            memcpy(buffer, read_buffer.data(), read_buffer.size());
+        _reads.emplace(std::move(r), hash);
+        return ret;
+    }
+
+    bool state_overlay::is_stale(Callbacks &callbacks, uint64_t state_key) const {
+        int ret;
+        bytes buffer;
+        for (auto &r : _reads) {
+            if (read_host(callbacks, state_key, r.first, ret, buffer) != r.second)
+                return true;
+        }
+        return false;
+    }
+
+    void state_overlay::commit(Callbacks &callbacks, uint64_t state_key) const {
+        for (auto &table : _tables) {
+            if (table.second.removed) {
+                metrics::timer timer(metrics::host_remove_table);
+                callbacks.cb_remove_table(state_key, table.first);
+            }
+            for (auto &value : table.second.values) {
+                metrics::timer timer(value.second.removed ? metrics::host_remove_key : metrics::host_store);
+                if (value.second.removed)
+                    callbacks.cb_remove_key(state_key, table.first, (char *) value.first.data(),
+                                            value.first.size());
+                else
+                    callbacks.cb_store(state_key, table.first, (char *) value.first.data(), value.first.size(),
+                                       (char *) value.second.value.data(), value.second.value.size());
+            }
+        }
+    }
+
+    void change_set::commit(Callbacks &callbacks, uint64_t state_key) {
+        state.commit(callbacks, state_key);
+
+        //the effects were tagged with the key the speculation ran with
+        effects.retag(state_key);
+        effects.apply(callbacks, state_key);
+
+        if (!result.empty()) {
+            metrics::timer timer(metrics::host_set_result);
+            callbacks.cb_set_result(state_key, (char *) result.data(), result.size());
+        }
+    }
+
+}
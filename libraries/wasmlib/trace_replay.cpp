@@ -0,0 +1,55 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <iterator>
+#include <vector>
+
+//replays traces that executions wrote while recording was on, each against the callbacks recorded in it, and checks
+//that it makes the same callbacks and ends with the same gas left. that runs an execution from a production node on a
+//machine without its state, so it can be profiled there:
+//  TRACE_REPLAY_RUNS              times to replay each trace, 1 by default; the fastest and the mean run are reported
+
+extern "C" int replay_trace(uint8_t *trace, int traceLength);
+
+int main(int argc, char **argv) {
+    if (argc < 2) {
+        std::cerr << "usage: " << argv[0] << " <trace>..." << std::endl;
+        return EXIT_FAILURE;
+    }
+    const char *runs_value = getenv("TRACE_REPLAY_RUNS");
+    const uint64_t runs = std::max<uint64_t>(runs_value ? std::strtoull(runs_value, nullptr, 10) : 1, 1);
+
+    size_t num_diverged = 0;
+    for (int i = 1; i < argc; i++) {
+        std::ifstream file(argv[i], std::ios::binary);
+        if (!file) {
+            std::cerr << "can't read " << argv[i] << std::endl;
+            return EXIT_FAILURE;
+        }
+        std::vector<uint8_t> trace((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+        double fastest = 0, total = 0;
+        int ret = 0;
+        for (uint64_t run = 0; run < runs && ret == 0; run++) {
+            auto start = std::chrono::steady_clock::now();
+            ret = replay_trace(trace.data(), trace.size());
+            const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            fastest = run == 0 ? seconds : std::min(fastest, seconds);
+            total += seconds;
+        }
+
+        if (ret) {
+            num_diverged++;
+            std::cout << argv[i] << ": diverged" << std::endl;
+            continue;
+        }
+        std::cout << std::fixed << std::setprecision(1)
+                  << argv[i] << ": identical, fastest " << fastest * 1e6 << " us, mean " << total / runs * 1e6
+                  << " us" << std::endl;
+    }
+    return num_diverged ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -1,9 +1,11 @@
 #include "types.hpp"
 #include "wasm_context.hpp"
+#include "metrics.hpp"
 
 namespace ftl {
     sha256 hash(const bytes &input) {
         sha256 hash;
+        metrics::timer timer(metrics::host_sha256);
         g_sha256((char *)&input[0], input.size(), (char *)&hash._hash[0]);
         return hash;
     }
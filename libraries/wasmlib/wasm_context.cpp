@@ -1,6 +1,7 @@
 #include "wasm_context.hpp"
 #include "wasm_interface.hpp"
 #include "exceptions.hpp"
+#include "wasm_constraints.hpp"
 
 namespace ftl {
 
@@ -20,6 +21,14 @@ namespace ftl {
         }
 
         std::string console = _pending_console_output.str();
+        if (_reverted) {
+            if (!console.empty()) {
+                std::cout << "PENDING CONSOLE OUTPUT BEGIN =====================" << std::endl;
+                std::cout << console << std::endl;
+                std::cout << "PENDING CONSOLE OUTPUT END   =====================" << std::endl;
+            }
+            return;
+        }
         if (!console.empty()) {
             std::cout << "CONSOLE OUTPUT BEGIN =====================" << std::endl;
             std::cout << console << std::endl;
@@ -28,4 +37,160 @@ namespace ftl {
             std::cout << "empty console log" << std::endl;
         }
     }
+
+    void wasm_context::revert(uint64_t error_code, const char *message, size_t message_size) {
+        _reverted = true;
+        _revert_code = error_code;
+        _revert_message = message;
+        _revert_message_size = message_size;
+        get_wasm_interface().exit();
+    }
+
+    std::string wasm_context::revert_message() const {
+        if (_revert_message)
+            return "assertion failure with message: " + std::string(_revert_message, _revert_message_size);
+        return "assertion failure with error code: " + std::to_string(_revert_code);
+    }
+
+    int wasm_context::call_action(const char *to, const char *action, size_t action_size, uint64_t amount,
+                                  int storage_delegate, int user_delegate) {
+        //entering a call moves funds on the host, which a speculative execution mustn't do
+        FTL_ASSERT(!overlay, wasm_runtime_exception, "nested calls can't run speculatively");
+        if (!callbacks->cb_enter_action)
+            return call_action_on_host(to, action, action_size, amount, storage_delegate, user_delegate);
+
+        FTL_ASSERT(recurse_depth < wasm_constraints::maximum_action_depth, wasm_runtime_exception,
+                   "max action depth exceeded");
+        FTL_ASSERT(action_size >= sizeof(uint64_t), wasm_runtime_exception, "action is missing its name");
+        metrics::timer call_timer(metrics::nested_call);
+
+        //to and action point into this action's memory, which the callee doesn't run in
+        uint8_t callee_to[20], callee_owner[20], callee_user[20];
+        memcpy(callee_to, to, sizeof(callee_to));
+
+        call_result_bytes.clear();
+        uint64_t callee_state_key;
+        {
+            metrics::timer timer(metrics::host_enter_action);
+            callee_state_key = callbacks->cb_enter_action(state_key, (char *) callee_to, amount, storage_delegate,
+                                                          user_delegate, (char *) callee_owner, (char *) callee_user);
+        }
+        if (!callee_state_key) {
+            const invalid_address_exception e("no contract to call at address");
+            std::cout << "err: " << e.name() << ": " << e.what() << std::endl;
+            return e.code();
+        }
+
+        //the callee's action carries no code; its module is instantiated below, so exec() finds it in the cache
+        uint64_t action_name;
+        memcpy(&action_name, action, sizeof(uint64_t));
+        wasm_action callee_act;
+        callee_act.name = name(action_name);
+        callee_act.data.assign(action + sizeof(uint64_t), action + action_size);
+
+        wasm_context callee(wasmif, callee_act, to_addr_bytes, callee_to, callee_owner, callee_user, amount,
+                            remained_gas, callee_state_key, callbacks);
+        callee.recurse_depth = recurse_depth + 1;
+        callee.journal = journal;
+        callee.execution_deadline = execution_deadline;
+        size_t journal_size = journal->size();
+
+        int ret = 0;
+        try {
+            //the code at an address doesn't change while the top level action runs, so it's only loaded and
+            //hashed again if the callee isn't instantiated at this depth yet
+            if (!wasmif.find_code_id(callee_to, callee_act.code_id) ||
+                !wasmif.has_instantiated_module(callee_act.code_id, callee.recurse_depth)) {
+                bytes code = load_code(callee_state_key);
+                callee_act.code_id = hash(code);
+                wasmif.set_code_id(callee_to, callee_act.code_id);
+                wasmif.get_instantiated_module(callee_act.code_id, code, callee.recurse_depth);
+            } else {
+                metrics::add(metrics::module_cache_hits);
+            }
+            callee.exec();
+
+            if (callee.has_reverted()) {
+                const wasm_runtime_exception e(callee.revert_message());
+                std::cout << "err: " << e.name() << ": " << e.what() << std::endl;
+                ret = e.code();
+            }
+        } catch (const exception &e) {
+            std::cout << "err: " << e.name() << ": " << e.what() << std::endl;
+            ret = e.code();
+        }
+
+        {
+            metrics::timer timer(metrics::host_leave_action);
+            callbacks->cb_leave_action(callee_state_key, ret != 0);
+        }
+        if (ret == 0)
+            call_result_bytes = std::move(callee.result);
+        else
+            journal->truncate(journal_size);
+
+        //the callee pointed the intrinsics at its own memory and context
+        the_running_instance_context.memory = memory;
+        the_running_instance_context.apply_ctx = this;
+        return ret;
+    }
+
+    bytes wasm_context::load_code(uint64_t callee_state_key) {
+        metrics::timer timer(metrics::host_load_code);
+        int code_size = callbacks->cb_load_code(callee_state_key, nullptr, 0);
+        FTL_ASSERT(code_size > 0 && code_size <= int(wasm_constraints::maximum_code_size), wasm_runtime_exception,
+                   "invalid code size of called contract");
+
+        bytes code(code_size);
+        callbacks->cb_load_code(callee_state_key, (char *) code.data(), code_size);
+        return code;
+    }
+
+    int wasm_context::call_action_on_host(const char *to, const char *action, size_t action_size, uint64_t amount,
+                                          int storage_delegate, int user_delegate) {
+        //the host runs the callee, and applies its effects, on its own; this action's logs so far go first, so the host
+        //sees them in order. they're no longer dropped with the journal if this action fails afterwards: the host drops
+        //them when execute() fails, together with the callee's effects, as it did before logs were journaled
+        apply_effects();
+
+        Runtime::theMemoryInstance = NULL;
+        int ret;
+        {
+            metrics::timer timer(metrics::host_call_action);
+            ret = callbacks->cb_call_action(state_key, (char *) to, (char *) action, action_size, amount,
+                                            storage_delegate, user_delegate);
+        }
+        //the callee's modules are released by the time it returns, so the memory it ran in can be freed
+        Runtime::MemoryInstance *callee_memory = Runtime::theMemoryInstance;
+        Runtime::theMemoryInstance = memory;
+        Runtime::freeMemoryIfUnused(callee_memory);
+        the_running_instance_context.memory = memory;
+        the_running_instance_context.apply_ctx = this;
+        return ret;
+    }
+
+    int wasm_context::call_result(char *result, size_t result_size) {
+        if (!callbacks->cb_enter_action) {
+            metrics::timer timer(metrics::host_call_result);
+            return callbacks->cb_call_result(state_key, result, result_size);
+        }
+
+        memcpy(result, call_result_bytes.data(), std::min(result_size, call_result_bytes.size()));
+        return call_result_bytes.size();
+    }
+
+    int wasm_context::set_result(char *result, size_t result_size) {
+        if (recurse_depth == 0 && !overlay) {
+            metrics::timer timer(metrics::host_set_result);
+            return callbacks->cb_set_result(state_key, result, result_size);
+        }
+
+        this->result.assign(result, result + result_size);
+        return 0;
+    }
+
+    void wasm_context::apply_effects() {
+        journal->apply(*callbacks, state_key);
+        journal->truncate(0);
+    }
 }
@@ -179,3 +179,150 @@ int32_t gas_table[] = {
    100, //f32_reinterpret_i32_code   = 0xBE, TBD
    100, //f64_reinterpret_i64_code   = 0xBF, TBD
 }; // gas_table
+
+#if ENABLE_SIMD_PROTOTYPE
+//by the low byte of the opcode. a shift by a vector of counts has no instruction on x86 for the narrow lanes, and is
+//priced as the shifts of the lanes one by one
+int32_t simd_gas_table[] = {
+   0, //v128_const_code            = 0xFD00,
+   3, //v128_load_code             = 0xFD01,
+   3, //v128_store_code            = 0xFD02,
+   1, //i8x16_splat_code           = 0xFD03,
+   1, //i16x8_splat_code           = 0xFD04,
+   1, //i32x4_splat_code           = 0xFD05,
+   1, //i64x2_splat_code           = 0xFD06,
+   0, //f32x4_splat_code           = 0xFD07, not allowed
+   0, //f64x2_splat_code           = 0xFD08, not allowed
+   1, //i8x16_extract_lane_s_code  = 0xFD09,
+   1, //i8x16_extract_lane_u_code  = 0xFD0A,
+   1, //i16x8_extract_lane_s_code  = 0xFD0B,
+   1, //i16x8_extract_lane_u_code  = 0xFD0C,
+   1, //i32x4_extract_lane_code    = 0xFD0D,
+   1, //i64x2_extract_lane_code    = 0xFD0E,
+   0, //f32x4_extract_lane_code    = 0xFD0F, not allowed
+   0, //f64x2_extract_lane_code    = 0xFD10, not allowed
+   2, //i8x16_replace_lane_code    = 0xFD11,
+   2, //i16x8_replace_lane_code    = 0xFD12,
+   2, //i32x4_replace_lane_code    = 0xFD13,
+   2, //i64x2_replace_lane_code    = 0xFD14,
+   0, //f32x4_replace_lane_code    = 0xFD15, not allowed
+   0, //f64x2_replace_lane_code    = 0xFD16, not allowed
+   3, //v8x16_shuffle_code         = 0xFD17,
+   1, //i8x16_add_code             = 0xFD18,
+   1, //i16x8_add_code             = 0xFD19,
+   1, //i32x4_add_code             = 0xFD1A,
+   1, //i64x2_add_code             = 0xFD1B,
+   1, //i8x16_sub_code             = 0xFD1C,
+   1, //i16x8_sub_code             = 0xFD1D,
+   1, //i32x4_sub_code             = 0xFD1E,
+   1, //i64x2_sub_code             = 0xFD1F,
+   6, //i8x16_mul_code             = 0xFD20,
+   2, //i16x8_mul_code             = 0xFD21,
+   4, //i32x4_mul_code             = 0xFD22,
+   1, //i8x16_neg_code             = 0xFD23,
+   1, //i16x8_neg_code             = 0xFD24,
+   1, //i32x4_neg_code             = 0xFD25,
+   1, //i64x2_neg_code             = 0xFD26,
+   2, //i8x16_add_saturate_s_code  = 0xFD27,
+   2, //i8x16_add_saturate_u_code  = 0xFD28,
+   2, //i16x8_add_saturate_s_code  = 0xFD29,
+   2, //i16x8_add_saturate_u_code  = 0xFD2A,
+   2, //i8x16_sub_saturate_s_code  = 0xFD2B,
+   2, //i8x16_sub_saturate_u_code  = 0xFD2C,
+   2, //i16x8_sub_saturate_s_code  = 0xFD2D,
+   2, //i16x8_sub_saturate_u_code  = 0xFD2E,
+   20, //i8x16_shl_code             = 0xFD2F,
+   10, //i16x8_shl_code             = 0xFD30,
+   5, //i32x4_shl_code             = 0xFD31,
+   3, //i64x2_shl_code             = 0xFD32,
+   20, //i8x16_shr_s_code           = 0xFD33,
+   20, //i8x16_shr_u_code           = 0xFD34,
+   10, //i16x8_shr_s_code           = 0xFD35,
+   10, //i16x8_shr_u_code           = 0xFD36,
+   5, //i32x4_shr_s_code           = 0xFD37,
+   5, //i32x4_shr_u_code           = 0xFD38,
+   3, //i64x2_shr_s_code           = 0xFD39,
+   3, //i64x2_shr_u_code           = 0xFD3A,
+   1, //v128_and_code              = 0xFD3B,
+   1, //v128_or_code               = 0xFD3C,
+   1, //v128_xor_code              = 0xFD3D,
+   1, //v128_not_code              = 0xFD3E,
+   2, //v128_bitselect_code        = 0xFD3F,
+   2, //i8x16_any_true_code        = 0xFD40,
+   2, //i16x8_any_true_code        = 0xFD41,
+   2, //i32x4_any_true_code        = 0xFD42,
+   2, //i64x2_any_true_code        = 0xFD43,
+   4, //i8x16_all_true_code        = 0xFD44,
+   4, //i16x8_all_true_code        = 0xFD45,
+   4, //i32x4_all_true_code        = 0xFD46,
+   4, //i64x2_all_true_code        = 0xFD47,
+   1, //i8x16_eq_code              = 0xFD48,
+   1, //i16x8_eq_code              = 0xFD49,
+   1, //i32x4_eq_code              = 0xFD4A,
+   0, //f32x4_eq_code              = 0xFD4B, not allowed
+   0, //f64x2_eq_code              = 0xFD4C, not allowed
+   1, //i8x16_ne_code              = 0xFD4D,
+   1, //i16x8_ne_code              = 0xFD4E,
+   1, //i32x4_ne_code              = 0xFD4F,
+   0, //f32x4_ne_code              = 0xFD50, not allowed
+   0, //f64x2_ne_code              = 0xFD51, not allowed
+   1, //i8x16_lt_s_code            = 0xFD52,
+   2, //i8x16_lt_u_code            = 0xFD53,
+   1, //i16x8_lt_s_code            = 0xFD54,
+   2, //i16x8_lt_u_code            = 0xFD55,
+   1, //i32x4_lt_s_code            = 0xFD56,
+   2, //i32x4_lt_u_code            = 0xFD57,
+   0, //f32x4_lt_code              = 0xFD58, not allowed
+   0, //f64x2_lt_code              = 0xFD59, not allowed
+   1, //i8x16_le_s_code            = 0xFD5A,
+   2, //i8x16_le_u_code            = 0xFD5B,
+   1, //i16x8_le_s_code            = 0xFD5C,
+   2, //i16x8_le_u_code            = 0xFD5D,
+   1, //i32x4_le_s_code            = 0xFD5E,
+   2, //i32x4_le_u_code            = 0xFD5F,
+   0, //f32x4_le_code              = 0xFD60, not allowed
+   0, //f64x2_le_code              = 0xFD61, not allowed
+   1, //i8x16_gt_s_code            = 0xFD62,
+   2, //i8x16_gt_u_code            = 0xFD63,
+   1, //i16x8_gt_s_code            = 0xFD64,
+   2, //i16x8_gt_u_code            = 0xFD65,
+   1, //i32x4_gt_s_code            = 0xFD66,
+   2, //i32x4_gt_u_code            = 0xFD67,
+   0, //f32x4_gt_code              = 0xFD68, not allowed
+   0, //f64x2_gt_code              = 0xFD69, not allowed
+   1, //i8x16_ge_s_code            = 0xFD6A,
+   2, //i8x16_ge_u_code            = 0xFD6B,
+   1, //i16x8_ge_s_code            = 0xFD6C,
+   2, //i16x8_ge_u_code            = 0xFD6D,
+   1, //i32x4_ge_s_code            = 0xFD6E,
+   2, //i32x4_ge_u_code            = 0xFD6F,
+   0, //f32x4_ge_code              = 0xFD70, not allowed
+   0, //f64x2_ge_code              = 0xFD71, not allowed
+   0, //f32x4_neg_code             = 0xFD72, not allowed
+   0, //f64x2_neg_code             = 0xFD73, not allowed
+   0, //f32x4_abs_code             = 0xFD74, not allowed
+   0, //f64x2_abs_code             = 0xFD75, not allowed
+   0, //f32x4_min_code             = 0xFD76, not allowed
+   0, //f64x2_min_code             = 0xFD77, not allowed
+   0, //f32x4_max_code             = 0xFD78, not allowed
+   0, //f64x2_max_code             = 0xFD79, not allowed
+   0, //f32x4_add_code             = 0xFD7A, not allowed
+   0, //f64x2_add_code             = 0xFD7B, not allowed
+   0, //f32x4_sub_code             = 0xFD7C, not allowed
+   0, //f64x2_sub_code             = 0xFD7D, not allowed
+   0, //f32x4_div_code             = 0xFD7E, not allowed
+   0, //f64x2_div_code             = 0xFD7F, not allowed
+   0, //f32x4_mul_code             = 0xFD80, not allowed
+   0, //f64x2_mul_code             = 0xFD81, not allowed
+   0, //f32x4_sqrt_code            = 0xFD82, not allowed
+   0, //f64x2_sqrt_code            = 0xFD83, not allowed
+   0, //f32x4_convert_s_i32x4_code = 0xFD84, not allowed
+   0, //f32x4_convert_u_i32x4_code = 0xFD85, not allowed
+   0, //f64x2_convert_s_i64x2_code = 0xFD86, not allowed
+   0, //f64x2_convert_u_i64x2_code = 0xFD87, not allowed
+   0, //i32x4_trunc_s_f32x4_sat_code = 0xFD88, not allowed
+   0, //i32x4_trunc_u_f32x4_sat_code = 0xFD89, not allowed
+   0, //i64x2_trunc_s_f64x2_sat_code = 0xFD8A, not allowed
+   0, //i64x2_trunc_u_f64x2_sat_code = 0xFD8B, not allowed
+}; // simd_gas_table
+#endif
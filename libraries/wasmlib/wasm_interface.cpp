@@ -4,6 +4,7 @@
 #include "wasm_validation.hpp"
 #include "wasm_injection.hpp"
 #include "wavm.hpp"
+#include "secp256k1.hpp"
 #include "Runtime/Runtime.h"
 #include <softfloat.hpp>
 #include <compiler_builtins.hpp>
@@ -22,32 +23,50 @@ namespace ftl {
         runtime_interface = std::make_unique<wavm_runtime>();
     }
 
-    wasm_interface::~wasm_interface() {}
+    wasm_interface::~wasm_interface() {
+        //the module caches only live as long as the execution, so whatever they hold is evicted with them
+        for (const instantiation_level &level : instantiation_levels)
+            metrics::add(metrics::module_cache_evictions, level.modules.size());
+        metrics::add(metrics::module_cache_evicted_bytes, cache_footprint());
+
+        //a nested level's memory stays pinned while its modules are released, so it's freed exactly once, after them
+        for (size_t depth = instantiation_levels.size(); depth-- > 1;) {
+            instantiation_level &level = instantiation_levels[depth];
+            {
+                memory_pin pin(&level.memory);
+                level.modules.clear();
+            }
+            Runtime::freeMemoryIfUnused(level.memory);
+        }
+    }
 
-    void wasm_interface::validate(const bytes &code) {
-        Module module;
+    std::unique_ptr<Module> wasm_interface::parse_module(const bytes &code) {
+        std::unique_ptr<Module> module = std::make_unique<Module>();
         try {
-            Serialization::MemoryInputStream stream((U8 *) code.data(), code.size());
-            WASM::serialize(stream, module);
+            Serialization::MemoryInputStream stream((const U8 *) code.data(), code.size());
+            WASM::serialize(stream, *module);
         } catch (const Serialization::FatalSerializationException &e) {
             FTL_ASSERT(false, wasm_serialization_exception, e.message.c_str());
         } catch (const IR::ValidationException &e) {
             FTL_ASSERT(false, wasm_serialization_exception, e.message.c_str());
         }
+        return module;
+    }
 
+    void wasm_interface::validate(const bytes &code) {
+        validate(*parse_module(code));
+    }
+
+    void wasm_interface::validate(Module &module) {
         wasm_validations::wasm_binary_validation validator(module);
         validator.validate();
 
         root_resolver resolver(true);
         LinkResult link_result = linkModule(module, resolver);
-
-        //there are a couple opportunties for improvement here--
-        //Easy: Cache the Module created here so it can be reused for instantiaion
-        //Hard: Kick off instantiation in a separate thread at this location
     }
 
     void wasm_interface::apply(const sha256 &code_id, const bytes &code, wasm_context &context) {
-        get_instantiated_module(code_id, code)->apply(context);
+        get_instantiated_module(code_id, code, context.recurse_depth)->apply(context);
     }
 
     void wasm_interface::exit() {
@@ -589,37 +608,69 @@ namespace ftl {
                                 array_ptr<char> pub, size_t publen) {
             context.use_gas(GAS_RECOVER_KEY);
 
-            //TODO
-            /*
-            fc::crypto::signature s;
-            fc::crypto::public_key p;
-            datastream<const char *> ds(sig, siglen);
-            datastream<const char *> pubds(pub, publen);
+            FTL_ASSERT(siglen == secp256k1::signature_size, crypto_api_exception, "invalid signature size");
+            FTL_ASSERT(publen == secp256k1::public_key_size || publen == secp256k1::compressed_public_key_size,
+                       crypto_api_exception, "invalid public key size");
 
-            fc::raw::unpack(ds, s);
-            fc::raw::unpack(pubds, p);
-
-            auto check = fc::crypto::public_key(s, digest, false);
-            EOS_ASSERT(check == p, crypto_api_exception, "Error expected key different than recovered key");
-             */
+            uint8_t public_key[secp256k1::public_key_size];
+            FTL_ASSERT(secp256k1::recover(digest._hash, (const uint8_t *) sig.value, public_key),
+                       crypto_api_exception, "unable to recover key from signature");
+            if (publen == secp256k1::compressed_public_key_size)
+                secp256k1::compress(public_key, public_key);
+            FTL_ASSERT(memcmp(public_key, pub.value, publen) == 0, crypto_api_exception,
+                       "Error expected key different than recovered key");
         }
 
+        /**
+         * writes the recovered key uncompressed, or compressed if pub is too small for that, and returns its size.
+         * high-s signatures are accepted (see secp256k1::recover)
+         */
         int recover_key(const sha256 &digest,
                         array_ptr<char> sig, size_t siglen,
                         array_ptr<char> pub, size_t publen) {
             context.use_gas(GAS_RECOVER_KEY);
 
-            //TODO
-            /*
-            fc::crypto::signature s;
-            datastream<const char *> ds(sig, siglen);
-            datastream<char *> pubds(pub, publen);
+            FTL_ASSERT(siglen == secp256k1::signature_size, crypto_api_exception, "invalid signature size");
+            FTL_ASSERT(publen >= secp256k1::compressed_public_key_size, crypto_api_exception,
+                       "public key buffer too small");
 
-            fc::raw::unpack(ds, s);
-            fc::raw::pack(pubds, fc::crypto::public_key(s, digest, false));
-            return pubds.tellp();
-             */
-            return 0;
+            uint8_t public_key[secp256k1::public_key_size];
+            FTL_ASSERT(secp256k1::recover(digest._hash, (const uint8_t *) sig.value, public_key),
+                       crypto_api_exception, "unable to recover key from signature");
+            if (publen < secp256k1::public_key_size) {
+                secp256k1::compress(public_key, (uint8_t *) pub.value);
+                return secp256k1::compressed_public_key_size;
+            }
+            memcpy(pub.value, public_key, secp256k1::public_key_size);
+            return secp256k1::public_key_size;
+        }
+
+        /**
+         * sigs holds (digest, signature) pairs of 32 + 65 bytes; writes an uncompressed key for each pair to pubs, or
+         * zeroes if the pair doesn't recover, and returns the number of keys recovered. pubs may overlap sigs: every
+         * pair is read before any key is written, so the result doesn't depend on how the batch is scheduled
+         */
+        int recover_keys(array_ptr<char> sigs, size_t sigslen,
+                         array_ptr<char> pubs, size_t pubslen) {
+            const size_t pair_size = sizeof(ftl::sha256) + secp256k1::signature_size;
+            FTL_ASSERT(sigslen % pair_size == 0, crypto_api_exception, "invalid signature list size");
+            const size_t count = sigslen / pair_size;
+            FTL_ASSERT(pubslen >= count * secp256k1::public_key_size, crypto_api_exception,
+                       "public key buffer too small");
+            context.use_gas(GAS_RECOVER_KEY * count);
+
+            std::vector<secp256k1::recovery> recoveries(count);
+            for (size_t i = 0; i < count; i++) {
+                const uint8_t *pair = (const uint8_t *) sigs.value + i * pair_size;
+                recoveries[i] = {pair, pair + sizeof(ftl::sha256),
+                                 (uint8_t *) pubs.value + i * secp256k1::public_key_size, false};
+            }
+            secp256k1::recover_batch(recoveries.data(), count);
+
+            int num_recovered = 0;
+            for (const secp256k1::recovery &recovery : recoveries)
+                num_recovered += recovery.valid;
+            return num_recovered;
         }
 
         template<class Encoder>
@@ -711,26 +762,21 @@ namespace ftl {
         void ftl_assert(bool condition, null_terminated_ptr msg) {
             context.use_gas(GAS_CALL_BASE);
             if (BOOST_UNLIKELY(!condition)) {
-                const size_t sz = strnlen(msg, max_assert_message);
-                std::string message(msg, sz);
-                FTL_THROW(wasm_runtime_exception, "assertion failure with message: ${0}", message);
+                context.revert(0, msg, strnlen(msg, max_assert_message));
             }
         }
 
         void ftl_assert_message(bool condition, array_ptr<const char> msg, size_t msg_len) {
             context.use_gas(GAS_CALL_BASE);
             if (BOOST_UNLIKELY(!condition)) {
-                const size_t sz = msg_len > max_assert_message ? max_assert_message : msg_len;
-                std::string message(msg, sz);
-                FTL_THROW(wasm_runtime_exception, "assertion failure with message: ${0}", message);
+                context.revert(0, msg, msg_len > max_assert_message ? max_assert_message : msg_len);
             }
         }
 
         void ftl_assert_code(bool condition, uint64_t error_code) {
             context.use_gas(GAS_CALL_BASE);
             if (BOOST_UNLIKELY(!condition)) {
-                FTL_THROW(wasm_runtime_exception,
-                          "assertion failure with error code: ${0}", error_code);
+                context.revert(error_code, nullptr, 0);
             }
         }
 
@@ -812,12 +858,7 @@ namespace ftl {
                 FTL_THROW(invalid_address_exception, "address exception");
             }
 
-            Runtime::theMemoryInstance = NULL;
-            int ret = context.call_action(address, action, action_size, amount, storage_delegate, user_delegate);
-            the_running_instance_context.memory = context.memory;
-            the_running_instance_context.apply_ctx = &context;
-            Runtime::theMemoryInstance = context.memory;
-            return ret;
+            return context.call_action(address, action, action_size, amount, storage_delegate, user_delegate);
         }
 
         int call_result(array_ptr<char> result, size_t result_size) {
@@ -1018,6 +1059,8 @@ namespace ftl {
         wasm_context &context;
     };
 
+    //when the JIT emits the division, remainder and multiplication builtins inline, their gas is charged with the rest of
+    //the calling block by the gas injection, and they're only called here when they fail
     class compiler_builtins {
     public:
         compiler_builtins(wasm_context &ctx) : context(ctx) {}
@@ -1053,7 +1096,7 @@ namespace ftl {
         }
 
         void __divti3(__int128 &ret, uint64_t la, uint64_t ha, uint64_t lb, uint64_t hb) {
-            context.use_gas(GAS_CALL_BASE);
+            use_builtin_gas();
             __int128 lhs = ha;
             __int128 rhs = hb;
 
@@ -1071,7 +1114,7 @@ namespace ftl {
         }
 
         void __udivti3(unsigned __int128 &ret, uint64_t la, uint64_t ha, uint64_t lb, uint64_t hb) {
-            context.use_gas(GAS_CALL_BASE);
+            use_builtin_gas();
             unsigned __int128 lhs = ha;
             unsigned __int128 rhs = hb;
 
@@ -1088,7 +1131,7 @@ namespace ftl {
         }
 
         void __multi3(__int128 &ret, uint64_t la, uint64_t ha, uint64_t lb, uint64_t hb) {
-            context.use_gas(GAS_CALL_BASE);
+            use_builtin_gas();
             __int128 lhs = ha;
             __int128 rhs = hb;
 
@@ -1103,7 +1146,7 @@ namespace ftl {
         }
 
         void __modti3(__int128 &ret, uint64_t la, uint64_t ha, uint64_t lb, uint64_t hb) {
-            context.use_gas(GAS_CALL_BASE);
+            use_builtin_gas();
             __int128 lhs = ha;
             __int128 rhs = hb;
 
@@ -1120,7 +1163,7 @@ namespace ftl {
         }
 
         void __umodti3(unsigned __int128 &ret, uint64_t la, uint64_t ha, uint64_t lb, uint64_t hb) {
-            context.use_gas(GAS_CALL_BASE);
+            use_builtin_gas();
             unsigned __int128 lhs = ha;
             unsigned __int128 rhs = hb;
 
@@ -1346,6 +1389,11 @@ namespace ftl {
         static constexpr uint32_t SHIFT_WIDTH = (sizeof(uint64_t) * 8) - 1;
 
     protected:
+        void use_builtin_gas() {
+            if (!Runtime::getInlineInt128Builtins())
+                context.use_gas(GAS_CALL_BASE);
+        }
+
         wasm_context &context;
     };
 
@@ -1361,6 +1409,7 @@ namespace ftl {
     REGISTER_INTRINSICS(crypto_api,
                         (assert_recover_key, void(int, int, int, int, int))
                                 (recover_key, int(int, int, int, int, int))
+                                (recover_keys, int(int, int, int, int))
                                 (assert_sha256, void(int, int, int))
                                 (sha256, void(int, int, int))
     );
@@ -45,6 +45,10 @@ void globals_validation_visitor::validate( const Module& m ) {
          case ValueType::any:
          case ValueType::num:
             FTL_THROW(wasm_runtime_exception, "Smart contract has unexpected global definition value type");
+#if ENABLE_SIMD_PROTOTYPE
+         case ValueType::v128:
+            mutable_globals_total_size += 8;
+#endif
          case ValueType::i64:
          case ValueType::f64:
             mutable_globals_total_size += 4;
@@ -90,6 +94,5 @@ void ensure_apply_exported_visitor::validate( const IR::Module& m ) {
       FTL_THROW(wasm_runtime_exception, "Smart contract's apply function not exported; non-existent; or wrong type");
 }
 
-uint16_t nested_validator::depth = 0;
-bool     nested_validator::disabled = false;
+thread_local std::vector<bool> *nested_validator::ends = nullptr;
 }}
@@ -3,22 +3,29 @@
 #include "types.hpp"
 #include "wasm_interface.hpp"
 #include "wasm_context.hpp"
+#include "metrics.hpp"
+#include "callback_trace.hpp"
 #include <stdio.h>
 #include <sstream>
 #include <algorithm>
 #include <set>
 
-extern "C" {
-
-int execute(uint8_t *codeBytes, int codeLength,
-            uint8_t *actionBytes, int actionLength,
-            uint8_t *fromAddrBytes, uint8_t *toAddrBytes, uint8_t *ownerAddrBytes, uint8_t *userAddrBytes,
-            uint64_t transferAmount, uint64_t *remainedGas, uint64_t stateKey, ftl::Callbacks *callbacks) {
+//runs an action; its effects reach the host when it succeeds, unless it runs speculatively into changes. a non zero
+//timeout stops it with a deadline_exceeded_exception once that many microseconds have passed
+static int run_action(uint8_t *codeBytes, int codeLength,
+                      uint8_t *actionBytes, int actionLength,
+                      uint8_t *fromAddrBytes, uint8_t *toAddrBytes, uint8_t *ownerAddrBytes, uint8_t *userAddrBytes,
+                      uint64_t transferAmount, uint64_t *remainedGas, uint64_t stateKey, ftl::Callbacks *callbacks,
+                      ftl::change_set *changes, uint64_t timeoutMicroseconds) {
 
     // set global method
     ftl::g_sha256 = callbacks->cb_sha256;
 
     try {
+        std::unique_ptr<ftl::deadline> deadline;
+        if (timeoutMicroseconds)
+            deadline = std::make_unique<ftl::deadline>(std::chrono::microseconds(timeoutMicroseconds));
+
         ftl::webassembly::common::wasm_interface wasmif;
 
         // code
@@ -40,7 +47,28 @@ int execute(uint8_t *codeBytes, int codeLength,
         auto act = ftl::wasm_action(ftl::name(action_name), code_bytes, action_bytes);
 
         ftl::wasm_context ctx(wasmif, act, fromAddrBytes, toAddrBytes, ownerAddrBytes, userAddrBytes, transferAmount, remainedGas, stateKey, callbacks);
+        if (changes)
+            ctx.overlay = &changes->state;
+        ctx.execution_deadline = deadline.get();
         ctx.exec();
+
+        //a revert leaves the contract without throwing, but the host sees it the same as an assertion exception
+        if (ctx.has_reverted()) {
+            ftl::metrics::add(ftl::metrics::reverted_executions);
+            const ftl::wasm_runtime_exception e(ctx.revert_message());
+            std::cout << "err: " << e.name() << ": " << e.what() << std::endl;
+            return e.code();
+        }
+
+        if (changes) {
+            changes->effects = std::move(*ctx.journal);
+            changes->result = std::move(ctx.result);
+            return 0;
+        }
+
+        //logs reach the host only once the whole action, nested calls included, succeeded, unless a nested call through
+        //cb_call_action handed over the ones before it
+        ctx.apply_effects();
     }
     catch (const ftl::exception &e) {
         std::cout << "err: " << e.name() << ": " << e.what() << std::endl;
@@ -50,4 +78,172 @@ int execute(uint8_t *codeBytes, int codeLength,
     return 0;
 }
 
+//runs an action through run_action and records its metrics, and its trace while recording is on
+static int run(uint8_t *codeBytes, int codeLength,
+               uint8_t *actionBytes, int actionLength,
+               uint8_t *fromAddrBytes, uint8_t *toAddrBytes, uint8_t *ownerAddrBytes, uint8_t *userAddrBytes,
+               uint64_t transferAmount, uint64_t *remainedGas, uint64_t stateKey, ftl::Callbacks *callbacks,
+               ftl::change_set *changes, uint64_t timeoutMicroseconds) {
+    const uint64_t gas_limit = *remainedGas;
+
+    //speculative executions leave their effects to the host, so their callbacks alone can't be replayed
+    std::unique_ptr<ftl::callback_recorder> recorder;
+    const std::string trace_path =
+            changes || ftl::callback_replayer::replaying() ? std::string() : ftl::next_trace_path();
+    if (!trace_path.empty()) {
+        ftl::trace_inputs inputs;
+        inputs.code.assign(codeBytes, codeBytes + codeLength);
+        inputs.action.assign(actionBytes, actionBytes + actionLength);
+        memcpy(inputs.from, fromAddrBytes, sizeof(inputs.from));
+        memcpy(inputs.to, toAddrBytes, sizeof(inputs.to));
+        memcpy(inputs.owner, ownerAddrBytes, sizeof(inputs.owner));
+        memcpy(inputs.user, userAddrBytes, sizeof(inputs.user));
+        inputs.transfer_amount = transferAmount;
+        inputs.gas = gas_limit;
+        inputs.state_key = stateKey;
+        inputs.timeout_microseconds = timeoutMicroseconds;
+        recorder = std::make_unique<ftl::callback_recorder>(inputs, *callbacks);
+        callbacks = recorder->callbacks();
+    }
+
+    int ret;
+    {
+        ftl::metrics::timer timer(ftl::metrics::execution);
+        ret = run_action(codeBytes, codeLength, actionBytes, actionLength, fromAddrBytes, toAddrBytes, ownerAddrBytes,
+                         userAddrBytes, transferAmount, remainedGas, stateKey, callbacks, changes,
+                         timeoutMicroseconds);
+    }
+
+    ftl::metrics::add(ftl::metrics::executions);
+    ftl::metrics::add(ftl::metrics::gas_used, gas_limit - *remainedGas);
+    if (ret)
+        ftl::metrics::add(ftl::metrics::failed_executions);
+
+    if (recorder) {
+        recorder->finish(ret, *remainedGas);
+        recorder->save(trace_path);
+    }
+    return ret;
+}
+
+extern "C" {
+
+int execute(uint8_t *codeBytes, int codeLength,
+            uint8_t *actionBytes, int actionLength,
+            uint8_t *fromAddrBytes, uint8_t *toAddrBytes, uint8_t *ownerAddrBytes, uint8_t *userAddrBytes,
+            uint64_t transferAmount, uint64_t *remainedGas, uint64_t stateKey, ftl::Callbacks *callbacks) {
+    return run(codeBytes, codeLength, actionBytes, actionLength, fromAddrBytes, toAddrBytes, ownerAddrBytes,
+               userAddrBytes, transferAmount, remainedGas, stateKey, callbacks, nullptr, 0);
+}
+
+//runs an action like execute, but fails it with a deadline_exceeded_exception if it's still running after
+//timeoutMicroseconds
+int execute_with_deadline(uint8_t *codeBytes, int codeLength,
+                          uint8_t *actionBytes, int actionLength,
+                          uint8_t *fromAddrBytes, uint8_t *toAddrBytes, uint8_t *ownerAddrBytes,
+                          uint8_t *userAddrBytes, uint64_t transferAmount, uint64_t *remainedGas, uint64_t stateKey,
+                          ftl::Callbacks *callbacks, uint64_t timeoutMicroseconds) {
+    return run(codeBytes, codeLength, actionBytes, actionLength, fromAddrBytes, toAddrBytes, ownerAddrBytes,
+               userAddrBytes, transferAmount, remainedGas, stateKey, callbacks, nullptr, timeoutMicroseconds);
+}
+
+//runs an action like execute, but against an overlay of the host's state: the host is only read from, and storage
+//writes, logs, transfers and the result are collected into a change set. on success *changeSet is set to it, for
+//the host to check with is_change_set_stale and then commit or discard
+int speculate(uint8_t *codeBytes, int codeLength,
+              uint8_t *actionBytes, int actionLength,
+              uint8_t *fromAddrBytes, uint8_t *toAddrBytes, uint8_t *ownerAddrBytes, uint8_t *userAddrBytes,
+              uint64_t transferAmount, uint64_t *remainedGas, uint64_t stateKey, ftl::Callbacks *callbacks,
+              ftl::change_set **changeSet) {
+    std::unique_ptr<ftl::change_set> changes = std::make_unique<ftl::change_set>();
+    int ret = run(codeBytes, codeLength, actionBytes, actionLength, fromAddrBytes, toAddrBytes, ownerAddrBytes,
+                  userAddrBytes, transferAmount, remainedGas, stateKey, callbacks, changes.get(), 0);
+    *changeSet = ret == 0 ? changes.release() : nullptr;
+    return ret;
+}
+
+//returns 1 if a value the speculation read from the host has changed since
+int is_change_set_stale(ftl::change_set *changeSet, uint64_t stateKey, ftl::Callbacks *callbacks) {
+    return changeSet->is_stale(*callbacks, stateKey);
+}
+
+//applies the change set through the callbacks and frees it
+void commit_change_set(ftl::change_set *changeSet, uint64_t stateKey, ftl::Callbacks *callbacks) {
+    changeSet->commit(*callbacks, stateKey);
+    delete changeSet;
+}
+
+void discard_change_set(ftl::change_set *changeSet) {
+    delete changeSet;
+}
+
+//writes the metrics of all executions so far in the Prometheus text format, as much of them as fits into buffer, and
+//returns their full length
+int read_metrics(char *buffer, int bufferLength) {
+    const std::string text = ftl::metrics::read().format();
+    memcpy(buffer, text.data(), std::min(size_t(std::max(bufferLength, 0)), text.size()));
+    return text.size();
+}
+
+//the latency in nanoseconds below which the given fraction of those of a ftl::metrics::histogram are
+double read_metrics_percentile(int histogram, double fraction) {
+    if (histogram < 0 || histogram >= ftl::metrics::num_histograms)
+        return 0;
+    return ftl::metrics::read().percentile(ftl::metrics::histogram(histogram), fraction);
+}
+
+void reset_metrics() {
+    ftl::metrics::reset();
+}
+
+//while recording is on, every execution but the speculative ones writes a trace of its inputs and of the callbacks it
+//made into a new file in directory, for replay_trace
+void start_recording(const char *directory) {
+    ftl::start_recording(directory);
+}
+
+void stop_recording() {
+    ftl::stop_recording();
+}
+
+//once a contract was instantiated instantiations times, compiles it with the profile those instantiations collected: its
+//branches are laid out for the way they went, and its indirect calls call the function they mostly called directly.
+//the profile doesn't change what the contract does or the gas it uses. 0, the default, turns it off
+void set_profile_guided_compilation(int instantiations) {
+    ftl::wavm_runtime::set_profile_guided_compilation(std::max(instantiations, 0));
+}
+
+//emits the 128-bit integer division, remainder and multiplication builtins inline, charging their gas with the rest of
+//the calling block. that changes the gas used by executions that fail partway through a block, so it's a consensus
+//change that every node has to turn on at the same point, before any contract is instantiated. off by default
+void set_inline_int128_builtins(int enable) {
+    ftl::wavm_runtime::set_inline_int128_builtins(enable != 0);
+}
+
+//runs an execution again from its trace, against callbacks that answer from it, and returns 0 if it made the recorded
+//callbacks with the same arguments and ended the same, with the same gas left. the deadline it had isn't armed again,
+//so an execution that ran out of time diverges
+int replay_trace(uint8_t *trace, int traceLength) {
+    const ftl::bytes recorded(trace, trace + traceLength);
+    std::string divergence;
+    try {
+        ftl::callback_replayer replayer(recorded);
+        ftl::trace_inputs inputs = replayer.inputs();
+        uint64_t remained_gas = inputs.gas;
+        int ret = run(inputs.code.data(), inputs.code.size(), inputs.action.data(), inputs.action.size(),
+                      inputs.from, inputs.to, inputs.owner, inputs.user, inputs.transfer_amount, &remained_gas,
+                      inputs.state_key, replayer.callbacks(), nullptr, 0);
+        divergence = replayer.finish(ret, remained_gas);
+    }
+    catch (const ftl::exception &e) {
+        divergence = e.what();
+    }
+
+    if (divergence.empty())
+        return 0;
+    const ftl::trace_divergence_exception e(divergence);
+    std::cout << "err: " << e.name() << ": " << e.what() << std::endl;
+    return e.code();
+}
+
 }
@@ -3,6 +3,7 @@
 #include "wasm_injection.hpp"
 #include "wasm_context.hpp"
 #include "exceptions.hpp"
+#include "metrics.hpp"
 #include "IR/Module.h"
 #include "Platform/Platform.h"
 #include "WAST/WAST.h"
@@ -11,6 +12,10 @@
 #include "Runtime/Linker.h"
 #include "Runtime/Intrinsics.h"
 
+#include <algorithm>
+#include <atomic>
+#include <iterator>
+#include <map>
 #include <mutex>
 
 using namespace IR;
@@ -20,11 +25,83 @@ namespace ftl {
 
     running_instance_context the_running_instance_context;
 
-    wasm_instantiated_module::wasm_instantiated_module(ModuleInstance *instance, std::unique_ptr<Module> module,
-                                                       std::vector<uint8_t> initial_mem) :
-            _initial_memory(initial_mem),
-            _instance(instance),
-            _module(std::move(module)) {}
+    //zeros a run keeps rather than being split in two around them
+    static const size_t __max_zeros_in_run = 64;
+
+    void memory_image::set(uint32_t offset, const uint8_t *data, size_t size) {
+        if (!size)
+            return;
+        const uint64_t end = uint64_t(offset) + size;
+
+        //the runs the bytes overlap or touch are merged with them
+        auto first = std::lower_bound(_runs.begin(), _runs.end(), offset, [](const run &r, uint32_t o) {
+            return r.offset + uint64_t(r.data.size()) < o;
+        });
+        auto last = first;
+        while (last != _runs.end() && last->offset <= end)
+            last++;
+        const uint32_t start = first == last ? offset : std::min(offset, first->offset);
+        const uint64_t stop = first == last ? end : std::max(end, (last - 1)->offset + uint64_t((last - 1)->data.size()));
+        bytes merged(stop - start, 0);
+        for (auto it = first; it != last; it++)
+            memcpy(merged.data() + (it->offset - start), it->data.data(), it->data.size());
+        memcpy(merged.data() + (offset - start), data, size);
+
+        //the memory starts zeroed, so the zeros before and after the merged bytes are left out, and so are long
+        //stretches of them in between
+        std::vector<run> runs;
+        size_t i = 0;
+        while (i < merged.size()) {
+            while (i < merged.size() && !merged[i])
+                i++;
+            if (i == merged.size())
+                break;
+            size_t begin = i, run_end = i, zeros = 0;
+            for (; i < merged.size() && zeros <= __max_zeros_in_run; i++) {
+                if (merged[i]) {
+                    run_end = i + 1;
+                    zeros = 0;
+                } else {
+                    zeros++;
+                }
+            }
+            runs.push_back({uint32_t(start + begin), bytes(merged.begin() + begin, merged.begin() + run_end)});
+        }
+
+        auto at = _runs.erase(first, last);
+        _runs.insert(at, std::make_move_iterator(runs.begin()), std::make_move_iterator(runs.end()));
+    }
+
+    void memory_image::copy_to(uint8_t *memory) const {
+        for (const run &r : _runs)
+            memcpy(memory + r.offset, r.data.data(), r.data.size());
+    }
+
+    size_t memory_image::footprint() const {
+        size_t bytes = _runs.capacity() * sizeof(run);
+        for (const run &r : _runs)
+            bytes += r.data.capacity();
+        return bytes;
+    }
+
+    wasm_instantiated_module::wasm_instantiated_module(ModuleInstance *instance, const Module &module,
+                                                       memory_image initial_memory,
+                                                       std::shared_ptr<ModuleProfile> collecting_profile) :
+            _initial_memory(std::move(initial_memory)),
+            _collecting_profile(std::move(collecting_profile)),
+            _instance(instance) {
+        if (module.memories.defs.size())
+            _memory_type = module.memories.defs[0].type;
+        addModuleInstanceReference(_instance);
+    }
+
+    wasm_instantiated_module::~wasm_instantiated_module() {
+        removeModuleInstanceReference(_instance);
+    }
+
+    size_t wasm_instantiated_module::footprint() const {
+        return sizeof(*this) + _initial_memory.footprint() + getInstanceCodeSize(_instance);
+    }
 
     void wasm_instantiated_module::apply(wasm_context &context) {
         std::vector<Value> args = {Value(uint64_t(context.act.name))};
@@ -47,10 +124,9 @@ namespace ftl {
         if (default_mem) {
             //reset memory resizes the sandbox'ed memory to the module's init memory size and then
             // (effectively) memzeros it all
-            resetMemory(default_mem, _module->memories.defs[0].type);
-
-            char *memstart = &memoryRef<char>(getDefaultMemory(_instance), 0);
-            memcpy(memstart, _initial_memory.data(), _initial_memory.size());
+            metrics::add(metrics::memory_reset_committed_bytes, getMemoryNumPages(default_mem) << IR::numBytesPerPageLog2);
+            resetMemory(default_mem, _memory_type);
+            _initial_memory.copy_to(getMemoryBaseAddress(default_mem));
         }
 
         the_running_instance_context.memory = default_mem;
@@ -58,8 +134,13 @@ namespace ftl {
         context.memory = default_mem;
 
         resetGlobalInstances(_instance);
-        runInstanceStartFunc(_instance);
-        Runtime::invokeFunction(call, args);
+        try {
+            runInstanceStartFunc(_instance);
+            Runtime::invokeFunction(call, args);
+        } catch (const Runtime::Exception &e) {
+            metrics::add_trap(uint8_t(e.cause));
+            FTL_THROW(wasm_runtime_exception, describeExceptionCause(e.cause));
+        }
     }
 
 
@@ -67,6 +148,9 @@ namespace ftl {
         // TODO clean this up
         //check_wasm_opcode_dispositions();
         Runtime::init();
+        Runtime::setMaxCallDepth(wasm_constraints::maximum_call_depth);
+        //contract memories can't grow past maximum_linear_memory, so they all fit in the runtime's pooled slots
+        Runtime::setMemorySlotMaxPages(wasm_constraints::maximum_linear_memory >> IR::numBytesPerPageLog2);
     }
 
     wavm_runtime::runtime_guard::~runtime_guard() {
@@ -89,25 +173,103 @@ namespace ftl {
     wavm_runtime::~wavm_runtime() {
     }
 
+    //import bindings only depend on the code, and intrinsics live as long as the process, so they're
+    // resolved once per code hash and reused by every later instantiation
+    static std::map<sha256, ImportBindings> __import_bindings_cache;
+    static std::mutex __import_bindings_cache_lock;
+    static const size_t __max_import_bindings_cache_size = 4096;
+
+    static ImportBindings get_import_bindings(const sha256 &code_id, const Module &module) {
+        {
+            std::lock_guard<std::mutex> l(__import_bindings_cache_lock);
+            auto it = __import_bindings_cache.find(code_id);
+            if (it != __import_bindings_cache.end())
+                return it->second;
+        }
+
+        webassembly::common::root_resolver resolver;
+        LinkResult link_result = linkModule(module, resolver);
+        if (!link_result.success) {
+            //a partial binding list must never be cached, or every later instantiation of the code would use it
+            std::string missing_imports;
+            for (const LinkResult::MissingImport &missing_import : link_result.missingImports) {
+                if (!missing_imports.empty())
+                    missing_imports += ", ";
+                missing_imports += missing_import.moduleName + "." + missing_import.exportName;
+            }
+            FTL_THROW(wasm_runtime_exception, "unresolved imports: ${0}", missing_imports);
+        }
+
+        std::lock_guard<std::mutex> l(__import_bindings_cache_lock);
+        //code hashes are uniformly distributed, so dropping the lowest one evicts an arbitrary entry
+        if (__import_bindings_cache.size() >= __max_import_bindings_cache_size)
+            __import_bindings_cache.erase(__import_bindings_cache.begin());
+        __import_bindings_cache.emplace(code_id, link_result.resolvedImports);
+        return std::move(link_result.resolvedImports);
+    }
+
+    //the profiles the instances of a code collected, and how many collected into it, by code hash. a profile is only
+    //shared with the instances collecting into it; it's copied when a module is compiled with it
+    struct code_profile {
+        std::shared_ptr<ModuleProfile> profile = std::make_shared<ModuleProfile>();
+        uint32_t instantiations = 0;
+    };
+    static std::map<sha256, code_profile> __code_profiles;
+    static std::mutex __code_profiles_lock;
+    static const size_t __max_code_profiles = 4096;
+    static std::atomic<uint32_t> __profiled_instantiations(0);
+
+    void wavm_runtime::set_profile_guided_compilation(uint32_t instantiations) {
+        __profiled_instantiations.store(instantiations, std::memory_order_relaxed);
+    }
+
+    void wavm_runtime::set_inline_int128_builtins(bool enable) {
+        Runtime::setInlineInt128Builtins(enable);
+    }
+
     std::unique_ptr<wasm_instantiated_module>
-    wavm_runtime::instantiate_module(const char *code_bytes, size_t code_size,
-                                     std::vector<uint8_t> initial_memory) {
-        std::unique_ptr<Module> module = std::make_unique<Module>();
+    wavm_runtime::instantiate_module(const sha256 &code_id, std::unique_ptr<Module> module,
+                                     memory_image initial_memory) {
+        //the module was validated when it was parsed, but the injections add imports, functions and globals to it and
+        //rewrite the function bodies, so it's validated again before it's compiled
         try {
-            Serialization::MemoryInputStream stream((const U8 *) code_bytes, code_size);
-            WASM::serialize(stream, *module);
-        } catch (const Serialization::FatalSerializationException &e) {
-            FTL_ASSERT(false, wasm_serialization_exception, e.message.c_str());
+            IR::validateDefinitions(*module);
+            Platform::parallelFor(module->functions.defs.size(), [&](Uptr function_index) {
+                IR::validateFunctionBody(*module, module->functions.defs[function_index]);
+            });
         } catch (const IR::ValidationException &e) {
             FTL_ASSERT(false, wasm_serialization_exception, e.message.c_str());
         }
 
-        webassembly::common::root_resolver resolver;
-        LinkResult link_result = linkModule(*module, resolver);
-        ModuleInstance *instance = instantiateModule(*module, std::move(link_result.resolvedImports));
+        std::shared_ptr<ModuleProfile> profile;
+        bool collecting = false;
+        const uint32_t profiled_instantiations = __profiled_instantiations.load(std::memory_order_relaxed);
+        if (profiled_instantiations) {
+            std::lock_guard<std::mutex> l(__code_profiles_lock);
+            if (__code_profiles.size() >= __max_code_profiles && !__code_profiles.count(code_id))
+                __code_profiles.clear();
+            code_profile &p = __code_profiles[code_id];
+            profile = p.profile;
+            collecting = p.instantiations < profiled_instantiations;
+            if (collecting)
+                p.instantiations++;
+        }
+
+        ModuleInstance *instance;
+        if (profile) {
+            instance = instantiateModule(*module, get_import_bindings(code_id, *module), profile.get(), collecting);
+            if (!collecting)
+                metrics::add(metrics::profile_guided_compilations);
+        } else {
+            instance = instantiateModule(*module, get_import_bindings(code_id, *module));
+        }
         FTL_ASSERT(instance != nullptr, wasm_runtime_exception, "Fail to Instantiate WAVM Module");
+        metrics::add(metrics::instantiated_functions, module->functions.defs.size());
+        metrics::add(metrics::shared_functions, getInstanceNumSharedFunctions(instance));
 
-        return std::make_unique<wasm_instantiated_module>(instance, std::move(module), initial_memory);
+        //the module itself is freed here; the instance doesn't refer to it once it's compiled
+        return std::make_unique<wasm_instantiated_module>(instance, *module, std::move(initial_memory),
+                                                          collecting ? profile : nullptr);
     }
 
     void wavm_runtime::immediately_exit_currently_running_module() {